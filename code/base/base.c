@@ -40,6 +40,18 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sys/auxv.h>
+#include <fcntl.h>
+#include <signal.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#if defined(__aarch64__)
+#include <arm_acle.h>
+#include <asm/hwcap.h>
+#endif
 
 u32 g_TimeNow = 0;
 u32 g_TimeStart = 0;
@@ -71,6 +83,39 @@ static int s_logOnlyErrors = 0;
 static int s_logAddTime = 1;
 static char s_szAdditionalLogFile[128];
 
+// Async log backend: log calls format the line and push it to a lock free ring,
+// a background thread appends the lines to the log files.
+#define LOG_ASYNC_RING_SLOTS 256
+#define LOG_ASYNC_LINE_SIZE MAX_SERVICE_LOG_ENTRY_LENGTH
+#define LOG_ASYNC_WRITER_PERIOD_MS 20
+// Create this file to get the old synchronous file writes
+#define LOG_ASYNC_DISABLE_FLAG_FILE "/tmp/logsync"
+
+#define LOG_ASYNC_TYPE_LINE 0
+#define LOG_ASYNC_TYPE_ERROR 1
+#define LOG_ASYNC_TYPE_SOFTERROR 2
+
+typedef struct
+{
+   u32 uSeq;
+   u16 uType;
+   u16 uLength;
+   char szLine[LOG_ASYNC_LINE_SIZE];
+} type_log_async_slot;
+
+static type_log_async_slot s_LogAsyncRing[LOG_ASYNC_RING_SLOTS];
+static u32 s_uLogAsyncWritePos = 0;
+static u32 s_uLogAsyncReadPos = 0;
+static u32 s_uLogAsyncDroppedCount = 0;
+static u32 s_uLogAsyncDroppedReported = 0;
+static u32 s_uLogAsyncTimeLastDropReport = 0;
+static int s_iLogAsyncDrainBusy = 0;
+// 0: not started, 1: running, -1: disabled (synchronous writes)
+static volatile int s_iLogAsyncState = 0;
+static volatile int s_iLogAsyncMustStop = 0;
+static pthread_t s_pThreadLogAsyncWriter;
+static pthread_once_t s_LogAsyncInitOnce = PTHREAD_ONCE_INIT;
+
 const u32 crc32_table[] = {
 	0x00000000, 0x77073096, 0xee0e612c, 0x990951ba, 0x076dc419, 0x706af48f,
 	0xe963a535, 0x9e6495a3,	0x0edb8832, 0x79dcb8a4, 0xe0d5e91e, 0x97d2d988,
@@ -161,18 +206,293 @@ void reset_counters(type_u32_couters* pCounters)
    pCounters->uValueNow = 0;
 }
 
+/*
+ * CRC32 engine (standard reflected CRC-32, poly 0xEDB88320, same values as the
+ * byte table above). Picked once at runtime:
+ *  - ARMv8 CRC32 instructions (aarch64 with the crc extension);
+ *  - x86 PCLMULQDQ folding for buffers of 64 bytes or more;
+ *  - slice-by-8 tables otherwise and for the tails.
+ * All engines work on the non inverted internal state.
+ */
+
+typedef u32 (*t_crc32_engine)(u32 uState, const u8* pBuffer, size_t uLength);
+
+static pthread_once_t s_CRC32InitOnce = PTHREAD_ONCE_INIT;
+static u32 s_uCRC32Slice8Table[8][256];
+static t_crc32_engine s_pCRC32Engine = NULL;
+static const char* s_szCRC32EngineName = "table";
+
+static u32 _crc32_slice8(u32 uState, const u8* pBuffer, size_t uLength)
+{
+   while ( (uLength > 0) && (((uintptr_t)pBuffer) & 3) )
+   {
+      uState = s_uCRC32Slice8Table[0][(uState ^ *pBuffer++) & 0xFF] ^ (uState >> 8);
+      uLength--;
+   }
+   while ( uLength >= 8 )
+   {
+      u32 uOne, uTwo;
+      memcpy(&uOne, pBuffer, sizeof(u32));
+      memcpy(&uTwo, pBuffer+4, sizeof(u32));
+      #if __BYTE_ORDER == __BIG_ENDIAN
+      uOne = __builtin_bswap32(uOne);
+      uTwo = __builtin_bswap32(uTwo);
+      #endif
+      uOne ^= uState;
+      uState = s_uCRC32Slice8Table[7][uOne & 0xFF] ^
+               s_uCRC32Slice8Table[6][(uOne >> 8) & 0xFF] ^
+               s_uCRC32Slice8Table[5][(uOne >> 16) & 0xFF] ^
+               s_uCRC32Slice8Table[4][uOne >> 24] ^
+               s_uCRC32Slice8Table[3][uTwo & 0xFF] ^
+               s_uCRC32Slice8Table[2][(uTwo >> 8) & 0xFF] ^
+               s_uCRC32Slice8Table[1][(uTwo >> 16) & 0xFF] ^
+               s_uCRC32Slice8Table[0][uTwo >> 24];
+      pBuffer += 8;
+      uLength -= 8;
+   }
+   while ( uLength > 0 )
+   {
+      uState = s_uCRC32Slice8Table[0][(uState ^ *pBuffer++) & 0xFF] ^ (uState >> 8);
+      uLength--;
+   }
+   return uState;
+}
+
+#if defined(__aarch64__)
+__attribute__((target("+crc")))
+static u32 _crc32_armv8(u32 uState, const u8* pBuffer, size_t uLength)
+{
+   while ( (uLength > 0) && (((uintptr_t)pBuffer) & 7) )
+   {
+      uState = __crc32b(uState, *pBuffer++);
+      uLength--;
+   }
+   while ( uLength >= 8 )
+   {
+      uint64_t uValue;
+      memcpy(&uValue, pBuffer, sizeof(uint64_t));
+      uState = __crc32d(uState, uValue);
+      pBuffer += 8;
+      uLength -= 8;
+   }
+   while ( uLength > 0 )
+   {
+      uState = __crc32b(uState, *pBuffer++);
+      uLength--;
+   }
+   return uState;
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+// Folding constants for the CRC-32 polynomial (see Intel's "Fast CRC Computation
+// for Generic Polynomials Using PCLMULQDQ Instruction")
+static const uint64_t s_uCRC32FoldK1K2[2] __attribute__((aligned(16))) = { 0x0154442bd4ULL, 0x01c6e41596ULL };
+static const uint64_t s_uCRC32FoldK3K4[2] __attribute__((aligned(16))) = { 0x01751997d0ULL, 0x00ccaa009eULL };
+static const uint64_t s_uCRC32FoldK5K0[2] __attribute__((aligned(16))) = { 0x0163cd6124ULL, 0x0000000000ULL };
+static const uint64_t s_uCRC32FoldPoly[2] __attribute__((aligned(16))) = { 0x01db710641ULL, 0x01f7011641ULL };
+
+__attribute__((target("pclmul,sse4.1")))
+static u32 _crc32_pclmul(u32 uState, const u8* pBuffer, size_t uLength)
+{
+   if ( uLength < 64 )
+      return _crc32_slice8(uState, pBuffer, uLength);
+
+   size_t uTail = uLength & 15;
+   uLength -= uTail;
+
+   __m128i x0, x1, x2, x3, x4, x5, x6, x7, x8;
+   x1 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x00));
+   x2 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x10));
+   x3 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x20));
+   x4 = _mm_loadu_si128((const __m128i*)(pBuffer + 0x30));
+   x1 = _mm_xor_si128(x1, _mm_cvtsi32_si128((int)uState));
+   x0 = _mm_load_si128((const __m128i*)s_uCRC32FoldK1K2);
+   pBuffer += 64;
+   uLength -= 64;
+
+   // Fold by 4 x 128 bits
+   while ( uLength >= 64 )
+   {
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x6 = _mm_clmulepi64_si128(x2, x0, 0x00);
+      x7 = _mm_clmulepi64_si128(x3, x0, 0x00);
+      x8 = _mm_clmulepi64_si128(x4, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x2 = _mm_clmulepi64_si128(x2, x0, 0x11);
+      x3 = _mm_clmulepi64_si128(x3, x0, 0x11);
+      x4 = _mm_clmulepi64_si128(x4, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x5), _mm_loadu_si128((const __m128i*)(pBuffer + 0x00)));
+      x2 = _mm_xor_si128(_mm_xor_si128(x2, x6), _mm_loadu_si128((const __m128i*)(pBuffer + 0x10)));
+      x3 = _mm_xor_si128(_mm_xor_si128(x3, x7), _mm_loadu_si128((const __m128i*)(pBuffer + 0x20)));
+      x4 = _mm_xor_si128(_mm_xor_si128(x4, x8), _mm_loadu_si128((const __m128i*)(pBuffer + 0x30)));
+      pBuffer += 64;
+      uLength -= 64;
+   }
+
+   // Fold into 128 bits
+   x0 = _mm_load_si128((const __m128i*)s_uCRC32FoldK3K4);
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x3), x5);
+   x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+   x1 = _mm_xor_si128(_mm_xor_si128(x1, x4), x5);
+
+   while ( uLength >= 16 )
+   {
+      x2 = _mm_loadu_si128((const __m128i*)pBuffer);
+      x5 = _mm_clmulepi64_si128(x1, x0, 0x00);
+      x1 = _mm_clmulepi64_si128(x1, x0, 0x11);
+      x1 = _mm_xor_si128(_mm_xor_si128(x1, x2), x5);
+      pBuffer += 16;
+      uLength -= 16;
+   }
+
+   // Fold 128 bits to 64 bits
+   x2 = _mm_clmulepi64_si128(x1, x0, 0x10);
+   x3 = _mm_setr_epi32(~0, 0, ~0, 0);
+   x1 = _mm_srli_si128(x1, 8);
+   x1 = _mm_xor_si128(x1, x2);
+   x0 = _mm_loadl_epi64((const __m128i*)s_uCRC32FoldK5K0);
+   x2 = _mm_srli_si128(x1, 4);
+   x1 = _mm_and_si128(x1, x3);
+   x1 = _mm_clmulepi64_si128(x1, x0, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+
+   // Barrett reduction to 32 bits
+   x0 = _mm_load_si128((const __m128i*)s_uCRC32FoldPoly);
+   x2 = _mm_and_si128(x1, x3);
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x10);
+   x2 = _mm_and_si128(x2, x3);
+   x2 = _mm_clmulepi64_si128(x2, x0, 0x00);
+   x1 = _mm_xor_si128(x1, x2);
+   uState = (u32)_mm_extract_epi32(x1, 1);
+
+   if ( uTail > 0 )
+      uState = _crc32_slice8(uState, pBuffer, uTail);
+   return uState;
+}
+#endif
+
+static int _crc32_engine_supported(int iEngine)
+{
+   if ( CRC32_ENGINE_SLICE8 == iEngine )
+      return 1;
+   #if defined(__aarch64__)
+   if ( CRC32_ENGINE_ARMV8 == iEngine )
+      return (getauxval(AT_HWCAP) & HWCAP_CRC32)?1:0;
+   #endif
+   #if defined(__x86_64__) || defined(__i386__)
+   if ( CRC32_ENGINE_PCLMUL == iEngine )
+   {
+      __builtin_cpu_init();
+      return (__builtin_cpu_supports("pclmul") && __builtin_cpu_supports("sse4.1"))?1:0;
+   }
+   #endif
+   return 0;
+}
+
+static int _crc32_select_engine(int iEngine)
+{
+   if ( CRC32_ENGINE_AUTO == iEngine )
+   {
+      iEngine = CRC32_ENGINE_SLICE8;
+      if ( _crc32_engine_supported(CRC32_ENGINE_ARMV8) )
+         iEngine = CRC32_ENGINE_ARMV8;
+      if ( _crc32_engine_supported(CRC32_ENGINE_PCLMUL) )
+         iEngine = CRC32_ENGINE_PCLMUL;
+   }
+   if ( ! _crc32_engine_supported(iEngine) )
+      iEngine = CRC32_ENGINE_SLICE8;
+
+   s_pCRC32Engine = _crc32_slice8;
+   s_szCRC32EngineName = "slice8";
+   #if defined(__aarch64__)
+   if ( CRC32_ENGINE_ARMV8 == iEngine )
+   {
+      s_pCRC32Engine = _crc32_armv8;
+      s_szCRC32EngineName = "armv8-crc";
+   }
+   #endif
+   #if defined(__x86_64__) || defined(__i386__)
+   if ( CRC32_ENGINE_PCLMUL == iEngine )
+   {
+      s_pCRC32Engine = _crc32_pclmul;
+      s_szCRC32EngineName = "pclmul";
+   }
+   #endif
+   return iEngine;
+}
+
+static void _crc32_init_engine()
+{
+   for( int i=0; i<256; i++ )
+      s_uCRC32Slice8Table[0][i] = crc32_table[i];
+   for( int i=0; i<256; i++ )
+   {
+      u32 uValue = s_uCRC32Slice8Table[0][i];
+      for( int k=1; k<8; k++ )
+      {
+         uValue = s_uCRC32Slice8Table[0][uValue & 0xFF] ^ (uValue >> 8);
+         s_uCRC32Slice8Table[k][i] = uValue;
+      }
+   }
+   _crc32_select_engine(CRC32_ENGINE_AUTO);
+}
+
+const char* base_get_crc32_engine_name()
+{
+   pthread_once(&s_CRC32InitOnce, _crc32_init_engine);
+   return s_szCRC32EngineName;
+}
+
+// Not thread safe: only for tests/benchmarks, before any other thread computes CRCs
+int base_set_crc32_engine(int iEngine)
+{
+   pthread_once(&s_CRC32InitOnce, _crc32_init_engine);
+   return _crc32_select_engine(iEngine);
+}
+
 u32 base_compute_crc32(u8 *buf, int length)
 {
-   u8* p = buf;
-   u32 crc;
-   crc = ~0U;
+   if ( length <= 0 )
+      return 0;
+   pthread_once(&s_CRC32InitOnce, _crc32_init_engine);
+   return s_pCRC32Engine(~0U, buf, (size_t)length) ^ ~0U;
+}
+
+u32 base_compute_crc32_continue(u32 uCRC, u8* pBuffer, int iLength)
+{
+   if ( iLength <= 0 )
+      return uCRC;
+   pthread_once(&s_CRC32InitOnce, _crc32_init_engine);
+   return s_pCRC32Engine(uCRC ^ ~0U, pBuffer, (size_t)iLength) ^ ~0U;
+}
 
-   while (length--)
+// Copies in chunks small enough to still be in L1 cache when the copy reads them again.
+// The CRC reads the source: reading back the just written destination stalls on store forwarding.
+// Chunks are 16K: with a smaller known bound gcc inlines the memcpy as a slow rep movsq.
+u32 base_copy_and_compute_crc32(u8* pDest, u8* pSrc, int iLength, u32 uCRC)
+{
+   if ( iLength <= 0 )
+      return uCRC;
+   pthread_once(&s_CRC32InitOnce, _crc32_init_engine);
+   u32 uState = uCRC ^ ~0U;
+   while ( iLength > 0 )
    {
-      crc = crc32_table[(crc ^ *p++) & 0xFF] ^ (crc >> 8);
+      int iChunk = (iLength > 16384)?16384:iLength;
+      uState = s_pCRC32Engine(uState, pSrc, (size_t)iChunk);
+      memcpy(pDest, pSrc, iChunk);
+      pDest += iChunk;
+      pSrc += iChunk;
+      iLength -= iChunk;
    }
-   return crc ^ ~0U;
-} 
+   return uState ^ ~0U;
+}
 
 u8 base_compute_crc8(u8* pBuffer, int iLength)
 {
@@ -510,6 +830,255 @@ int _log_service_entry_softerror(char* szTime, char* szBuff)
    return 1;
 }
 
+static int _log_async_open_file(const char* szFolder, const char* szFile)
+{
+   char szPath[MAX_FILE_PATH_SIZE];
+   strcpy(szPath, szFolder);
+   strcat(szPath, szFile);
+   return open(szPath, O_WRONLY | O_APPEND | O_CREAT, 0666);
+}
+
+static void _log_async_write_all(int iFd, const char* pData, int iLength)
+{
+   while ( (iFd >= 0) && (iLength > 0) )
+   {
+      int iRes = write(iFd, pData, iLength);
+      if ( iRes <= 0 )
+         return;
+      pData += iRes;
+      iLength -= iRes;
+   }
+}
+
+// Writes out all the queued lines. Only uses open/write/close, so it can be used from a crash handler too.
+// Returns the number of lines written.
+static int _log_async_drain(int bFromSignal)
+{
+   int iExpected = 0;
+   if ( ! __atomic_compare_exchange_n(&s_iLogAsyncDrainBusy, &iExpected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED) )
+      return 0;
+
+   int fdSystem = -1;
+   int fdErrors = -1;
+   int fdSoftErrors = -1;
+   int fdAux = -1;
+   int iCount = 0;
+   char szBatch[4096];
+   int iBatchLength = 0;
+
+   while ( 1 )
+   {
+      type_log_async_slot* pSlot = &s_LogAsyncRing[s_uLogAsyncReadPos % LOG_ASYNC_RING_SLOTS];
+      if ( __atomic_load_n(&pSlot->uSeq, __ATOMIC_ACQUIRE) != s_uLogAsyncReadPos + 1 )
+         break;
+
+      if ( 0 == iCount )
+      {
+         fdSystem = _log_async_open_file(FOLDER_LOGS, LOG_FILE_SYSTEM);
+         if ( 0 != s_szAdditionalLogFile[0] )
+            fdAux = open(s_szAdditionalLogFile, O_WRONLY | O_APPEND | O_CREAT, 0666);
+      }
+      iCount++;
+
+      if ( iBatchLength + pSlot->uLength > (int)sizeof(szBatch) )
+      {
+         _log_async_write_all(fdSystem, szBatch, iBatchLength);
+         _log_async_write_all(fdAux, szBatch, iBatchLength);
+         iBatchLength = 0;
+      }
+      memcpy(&szBatch[iBatchLength], pSlot->szLine, pSlot->uLength);
+      iBatchLength += pSlot->uLength;
+
+      if ( (LOG_ASYNC_TYPE_ERROR == pSlot->uType) && (fdErrors < 0) )
+         fdErrors = _log_async_open_file(FOLDER_LOGS, LOG_FILE_ERRORS);
+      if ( (LOG_ASYNC_TYPE_SOFTERROR == pSlot->uType) && (fdSoftErrors < 0) )
+         fdSoftErrors = _log_async_open_file(FOLDER_LOGS, LOG_FILE_ERRORS_SOFT);
+      if ( LOG_ASYNC_TYPE_ERROR == pSlot->uType )
+         _log_async_write_all(fdErrors, pSlot->szLine, pSlot->uLength);
+      if ( LOG_ASYNC_TYPE_SOFTERROR == pSlot->uType )
+         _log_async_write_all(fdSoftErrors, pSlot->szLine, pSlot->uLength);
+
+      __atomic_store_n(&pSlot->uSeq, s_uLogAsyncReadPos + LOG_ASYNC_RING_SLOTS, __ATOMIC_RELEASE);
+      s_uLogAsyncReadPos++;
+   }
+
+   u32 uDropped = __atomic_load_n(&s_uLogAsyncDroppedCount, __ATOMIC_RELAXED);
+   if ( (!bFromSignal) && (uDropped != s_uLogAsyncDroppedReported) &&
+        (s_iLogAsyncMustStop || (get_current_timestamp_ms() >= s_uLogAsyncTimeLastDropReport + 1000)) )
+   {
+      s_uLogAsyncTimeLastDropReport = get_current_timestamp_ms();
+      if ( fdSystem < 0 )
+         fdSystem = _log_async_open_file(FOLDER_LOGS, LOG_FILE_SYSTEM);
+      char szTime[64];
+      szTime[0] = 0;
+      if ( s_logAddTime )
+         log_format_time(get_current_timestamp_ms(), szTime);
+      int iLength = snprintf(&szBatch[iBatchLength], sizeof(szBatch) - iBatchLength, "%s %s: [Log] Dropped %u log lines (log queue full), %u total.\n",
+         szTime, sszComponentName, uDropped - s_uLogAsyncDroppedReported, uDropped);
+      if ( (iLength > 0) && (iLength < (int)sizeof(szBatch) - iBatchLength) )
+         iBatchLength += iLength;
+      s_uLogAsyncDroppedReported = uDropped;
+   }
+
+   _log_async_write_all(fdSystem, szBatch, iBatchLength);
+   _log_async_write_all(fdAux, szBatch, iBatchLength);
+
+   if ( fdSystem >= 0 )
+      close(fdSystem);
+   if ( fdAux >= 0 )
+      close(fdAux);
+   if ( fdErrors >= 0 )
+      close(fdErrors);
+   if ( fdSoftErrors >= 0 )
+      close(fdSoftErrors);
+
+   __atomic_store_n(&s_iLogAsyncDrainBusy, 0, __ATOMIC_RELEASE);
+   return iCount;
+}
+
+static void* _thread_log_async_writer(void *argument)
+{
+   while ( ! s_iLogAsyncMustStop )
+   {
+      // Come back sooner when lines are coming in bursts, to avoid dropping them
+      if ( _log_async_drain(0) > LOG_ASYNC_RING_SLOTS/8 )
+         usleep(1000);
+      else
+         usleep(LOG_ASYNC_WRITER_PERIOD_MS*1000);
+   }
+   return NULL;
+}
+
+static void _log_async_at_exit()
+{
+   if ( 1 != s_iLogAsyncState )
+      return;
+   s_iLogAsyncMustStop = 1;
+   pthread_join(s_pThreadLogAsyncWriter, NULL);
+   s_iLogAsyncState = -1;
+   _log_async_drain(0);
+}
+
+static void _log_async_crash_handler(int iSignal)
+{
+   // Best effort: write out what is queued, then crash the default way
+   _log_async_drain(1);
+   signal(iSignal, SIG_DFL);
+   raise(iSignal);
+}
+
+// The writer thread does not exist in a forked child, log synchronously there
+static void _log_async_after_fork_child()
+{
+   s_iLogAsyncState = -1;
+   s_iLogAsyncDrainBusy = 0;
+}
+
+static void _log_async_start()
+{
+   s_iLogAsyncState = -1;
+   if ( access(LOG_ASYNC_DISABLE_FLAG_FILE, R_OK) != -1 )
+      return;
+
+   for( u32 i=0; i<LOG_ASYNC_RING_SLOTS; i++ )
+      s_LogAsyncRing[i].uSeq = i;
+   s_uLogAsyncWritePos = 0;
+   s_uLogAsyncReadPos = 0;
+   s_iLogAsyncMustStop = 0;
+
+   if ( 0 != pthread_create(&s_pThreadLogAsyncWriter, NULL, &_thread_log_async_writer, NULL) )
+      return;
+
+   s_iLogAsyncState = 1;
+   atexit(_log_async_at_exit);
+   pthread_atfork(NULL, NULL, _log_async_after_fork_child);
+
+   const int iCrashSignals[] = { SIGSEGV, SIGBUS, SIGILL, SIGFPE, SIGABRT };
+   for( int i=0; i<(int)(sizeof(iCrashSignals)/sizeof(iCrashSignals[0])); i++ )
+   {
+      struct sigaction sa;
+      if ( (0 != sigaction(iCrashSignals[i], NULL, &sa)) || (SIG_DFL != sa.sa_handler) )
+         continue;
+      memset(&sa, 0, sizeof(sa));
+      sa.sa_handler = _log_async_crash_handler;
+      sa.sa_flags = SA_RESETHAND;
+      sigemptyset(&sa.sa_mask);
+      sigaction(iCrashSignals[i], &sa, NULL);
+   }
+}
+
+// Returns 1 if the line was handled by the async backend (queued or dropped),
+// 0 if the caller must write it synchronously.
+static int _log_async_push(int iType, const char* szPrefix, const char* format, va_list args)
+{
+   if ( 0 == s_iLogAsyncState )
+      pthread_once(&s_LogAsyncInitOnce, _log_async_start);
+   if ( 1 != s_iLogAsyncState )
+      return 0;
+
+   char szLine[LOG_ASYNC_LINE_SIZE];
+   int iLength = snprintf(szLine, sizeof(szLine), "%s", szPrefix);
+   if ( (iLength < 0) || (iLength >= (int)sizeof(szLine)-1) )
+      iLength = sizeof(szLine)-2;
+   int iRes = vsnprintf(&szLine[iLength], sizeof(szLine) - 1 - iLength, format, args);
+   if ( iRes > 0 )
+      iLength += iRes;
+   if ( iLength > (int)sizeof(szLine) - 2 )
+      iLength = sizeof(szLine) - 2;
+   szLine[iLength++] = '\n';
+   szLine[iLength] = 0;
+
+   if ( ! s_logDisabledStdout )
+      printf("%s", szLine);
+
+   u32 uPos = __atomic_load_n(&s_uLogAsyncWritePos, __ATOMIC_RELAXED);
+   type_log_async_slot* pSlot = NULL;
+   while ( 1 )
+   {
+      pSlot = &s_LogAsyncRing[uPos % LOG_ASYNC_RING_SLOTS];
+      int iDiff = (int)(__atomic_load_n(&pSlot->uSeq, __ATOMIC_ACQUIRE) - uPos);
+      if ( 0 == iDiff )
+      {
+         if ( __atomic_compare_exchange_n(&s_uLogAsyncWritePos, &uPos, uPos+1, 1, __ATOMIC_RELAXED, __ATOMIC_RELAXED) )
+            break;
+      }
+      else if ( iDiff < 0 )
+      {
+         // Queue full: never block the caller, the writer thread reports the dropped count
+         __atomic_add_fetch(&s_uLogAsyncDroppedCount, 1, __ATOMIC_RELAXED);
+         return 1;
+      }
+      else
+         uPos = __atomic_load_n(&s_uLogAsyncWritePos, __ATOMIC_RELAXED);
+   }
+
+   pSlot->uType = (u16)iType;
+   pSlot->uLength = (u16)iLength;
+   memcpy(pSlot->szLine, szLine, iLength+1);
+   __atomic_store_n(&pSlot->uSeq, uPos+1, __ATOMIC_RELEASE);
+   return 1;
+}
+
+u32 log_get_dropped_messages_count()
+{
+   return __atomic_load_n(&s_uLogAsyncDroppedCount, __ATOMIC_RELAXED);
+}
+
+void log_flush()
+{
+   if ( 1 != s_iLogAsyncState )
+      return;
+   // The writer thread may be draining right now; wait for it to finish
+   for( int i=0; i<100; i++ )
+   {
+      _log_async_drain(0);
+      u32 uWritePos = __atomic_load_n(&s_uLogAsyncWritePos, __ATOMIC_ACQUIRE);
+      if ( (uWritePos == s_uLogAsyncReadPos) && (0 == __atomic_load_n(&s_iLogAsyncDrainBusy, __ATOMIC_ACQUIRE)) )
+         return;
+      usleep(1000);
+   }
+}
+
 void log_init_local_only(const char* component_name)
 {
    s_logServiceMessageQueue = -1;
@@ -528,6 +1097,11 @@ void log_init_local_only(const char* component_name)
    log_line(szLogLine);
 }
 
+const char* log_get_component_name()
+{
+   return sszComponentName;
+}
+
 void log_init(const char* component_name)
 {
    s_logServiceMessageQueue = -1;
@@ -689,6 +1263,14 @@ void log_line(const char* format, ...)
       return;
    }
 
+   char szPrefix[128];
+   snprintf(szPrefix, sizeof(szPrefix), "%s %s: ", szTime, sszComponentName);
+   if ( _log_async_push(LOG_ASYNC_TYPE_LINE, szPrefix, format, args) )
+   {
+      va_end(args);
+      return;
+   }
+
    char szFile[MAX_FILE_PATH_SIZE];
    strcpy(szFile, FOLDER_LOGS);
    strcat(szFile, LOG_FILE_SYSTEM);
@@ -758,6 +1340,15 @@ void log_line_forced_to_file(const char* format, ...)
    if ( s_logAddTime )
       _log_format_time_mstens(szTime);
 
+   // Goes through the same queue as regular lines, to keep the order of the lines in the log file
+   char szPrefix[128];
+   snprintf(szPrefix, sizeof(szPrefix), "%s(F) %s: ", szTime, sszComponentName);
+   if ( _log_async_push(LOG_ASYNC_TYPE_LINE, szPrefix, format, args) )
+   {
+      va_end(args);
+      return;
+   }
+
    char szFile[MAX_FILE_PATH_SIZE];
    strcpy(szFile, FOLDER_LOGS);
    strcat(szFile, LOG_FILE_SYSTEM);
@@ -1259,6 +1850,14 @@ void log_error_and_alarm(const char* format, ...)
       return;
    }
 
+   char szPrefix[128];
+   snprintf(szPrefix, sizeof(szPrefix), "%s %s: ERROR: ", szTime, sszComponentName);
+   if ( _log_async_push(LOG_ASYNC_TYPE_ERROR, szPrefix, format, args) )
+   {
+      va_end(args);
+      return;
+   }
+
    char szFile[MAX_FILE_PATH_SIZE];
    strcpy(szFile, FOLDER_LOGS);
    strcat(szFile, LOG_FILE_SYSTEM);
@@ -1360,6 +1959,14 @@ void log_softerror_and_alarm(const char* format, ...)
       return;
    }
 
+   char szPrefix[128];
+   snprintf(szPrefix, sizeof(szPrefix), "%s %s: SOFT_ERROR: ", szTime, sszComponentName);
+   if ( _log_async_push(LOG_ASYNC_TYPE_SOFTERROR, szPrefix, format, args) )
+   {
+      va_end(args);
+      return;
+   }
+
    char szFile[MAX_FILE_PATH_SIZE];
    strcpy(szFile, FOLDER_LOGS);
    strcat(szFile, LOG_FILE_SYSTEM);
@@ -83,6 +83,20 @@ u32 revert_word(u32 input);
 void reset_counters(type_u32_couters* pCounters);
 
 u32 base_compute_crc32(u8 *buf, int length);
+// Continues the CRC32 returned by a previous call over more data (uCRC = 0 starts a new CRC)
+u32 base_compute_crc32_continue(u32 uCRC, u8* pBuffer, int iLength);
+// Copies iLength bytes from pSrc to pDest and continues uCRC over them. Same result as memcpy + CRC.
+u32 base_copy_and_compute_crc32(u8* pDest, u8* pSrc, int iLength, u32 uCRC);
+const char* base_get_crc32_engine_name();
+
+// CRC32 engines; the best supported one is used by default (CRC32_ENGINE_AUTO).
+// base_set_crc32_engine() forces one (for tests/benchmarks), falls back to
+// CRC32_ENGINE_SLICE8 if it's not supported and returns the engine selected.
+#define CRC32_ENGINE_SLICE8 0
+#define CRC32_ENGINE_ARMV8 1
+#define CRC32_ENGINE_PCLMUL 2
+#define CRC32_ENGINE_AUTO 0xFF
+int base_set_crc32_engine(int iEngine);
 u8 base_compute_crc8(u8* pBuffer, int iLength);
 int base_check_crc32(u8* pBuffer, int iLength);
 
@@ -104,6 +118,7 @@ char* replaceNewLinesToSpaces(char* szBuff);
 
 void log_init_local_only(const char* component_name);
 void log_init(const char* component_name);
+const char* log_get_component_name();
 void log_arguments(int argc, char *argv[]);
 void log_add_file(const char* szFileName);
 void log_disable();
@@ -130,6 +145,9 @@ void log_softerror_and_alarm(const char* format, ...);
 void log_error_and_alarm(const char* format, ...);
 void log_line_watchdog(const char* format, ...);
 void log_line_commands(const char* format, ...);
+// Log lines are written to files by a background thread; these report drops and write out pending lines
+u32 log_get_dropped_messages_count();
+void log_flush();
 
 int check_licences();
 
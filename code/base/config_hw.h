@@ -40,7 +40,10 @@
 #define HW_CAPABILITY_IONICE
 #endif
 
+// The standalone OSD benchmark build (RUBY_BUILD_OSD_BENCH) does not use the GPIO/I2C libraries
 #ifdef HW_PLATFORM_RADXA
+#ifndef RUBY_BUILD_OSD_BENCH
 #define HW_CAPABILITY_GPIO
 #define HW_CAPABILITY_I2C
 #endif
+#endif
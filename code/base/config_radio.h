@@ -49,6 +49,8 @@
 
 #define DEFAULT_USE_PPCAP_FOR_TX 0
 #define DEFAULT_BYPASS_SOCKET_BUFFERS 1
+#define DEFAULT_RADIO_RX_USE_MMAP_RING 1 // Use a TPACKET_V2 memory mapped ring (per frame delivery, no added latency) for wifi radio rx instead of libpcap (libpcap is still used as fallback)
+#define DEFAULT_RADIO_CTRL_USE_NETLINK 1 // Control wifi radio interfaces (frequency, tx power, bitrates, monitor mode) through nl80211/rtnetlink instead of iw/ip commands
 #define DEFAULT_RADIO_TX_POWER_CONTROLLER 20
 #define DEFAULT_RADIO_TX_POWER 20
 #define DEFAULT_RADIO_SIK_TX_POWER 11
@@ -127,6 +127,8 @@ controller_runtime_info_vehicle* controller_rt_info_get_vehicle_info(controller_
       {
          pRTInfo->vehicles[i].uVehicleId = uVehicleId;
          pRTInfo->vehicles[i].iCountBlocksInVideoRxBuffers = 0;
+         pRTInfo->vehicles[i].uECDecodeCacheHits = 0;
+         pRTInfo->vehicles[i].uECDecodeCacheMisses = 0;
          return &(pRTInfo->vehicles[i]);
       }
    }
@@ -28,6 +28,8 @@ typedef struct
    u8 uCountAckRetransmissions[SYSTEM_RT_INFO_INTERVALS];
    u8 uAckTimes[SYSTEM_RT_INFO_INTERVALS][MAX_RADIO_INTERFACES];
    int iAckTimeIndex[MAX_RADIO_INTERFACES];
+   u32 uECDecodeCacheHits;
+   u32 uECDecodeCacheMisses;
 } ALIGN_STRUCT_SPEC_INFO controller_runtime_info_vehicle;
 
 typedef struct
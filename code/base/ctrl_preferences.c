@@ -139,6 +139,9 @@ void reset_Preferences()
    #endif
 
    s_Preferences.iShowCompactMenus = 1;
+   s_Preferences.iOSDRenderMode = 1;
+   s_Preferences.iOSDRenderThread = 1;
+   s_Preferences.iOSDPluginsRenderBudget = 4;
 }
 
 int save_Preferences()
@@ -215,6 +218,9 @@ int save_Preferences()
    fprintf(fd, "%d %d\n", s_Preferences.iOSDFontBold, s_Preferences.iMenuFontBold);
    fprintf(fd, "%d %d %d\n", s_Preferences.iMSPOSDSize, s_Preferences.iMSPOSDDeltaX, s_Preferences.iMSPOSDDeltaY);
    fprintf(fd, "%d\n", s_Preferences.iShowCompactMenus);
+   fprintf(fd, "%d\n", s_Preferences.iOSDRenderMode);
+   fprintf(fd, "%d\n", s_Preferences.iOSDRenderThread);
+   fprintf(fd, "%d\n", s_Preferences.iOSDPluginsRenderBudget);
    fclose(fd);
    log_line("Saved preferences to file: %s", szFile);
    return 1;
@@ -439,6 +445,27 @@ int load_Preferences()
       s_Preferences.iShowCompactMenus = 1;
    }
 
+   if ( bOk && (1 != fscanf(fd, "%d", &s_Preferences.iOSDRenderMode)) )
+   {
+      s_Preferences.iOSDRenderMode = 1;
+   }
+   if ( (s_Preferences.iOSDRenderMode < 0) || (s_Preferences.iOSDRenderMode > 2) )
+      s_Preferences.iOSDRenderMode = 1;
+
+   if ( bOk && (1 != fscanf(fd, "%d", &s_Preferences.iOSDRenderThread)) )
+   {
+      s_Preferences.iOSDRenderThread = 1;
+   }
+   if ( (s_Preferences.iOSDRenderThread < 0) || (s_Preferences.iOSDRenderThread > 1) )
+      s_Preferences.iOSDRenderThread = 1;
+
+   if ( bOk && (1 != fscanf(fd, "%d", &s_Preferences.iOSDPluginsRenderBudget)) )
+   {
+      s_Preferences.iOSDPluginsRenderBudget = 4;
+   }
+   if ( (s_Preferences.iOSDPluginsRenderBudget < 0) || (s_Preferences.iOSDPluginsRenderBudget > 50) )
+      s_Preferences.iOSDPluginsRenderBudget = 4;
+
    // ----------------------------------------------------
    // End reading file;
    // Validate settings
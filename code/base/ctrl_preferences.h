@@ -141,6 +141,9 @@ typedef struct
    int iMSPOSDDeltaX; // delta chars
    int iMSPOSDDeltaY; // delta chars
    int iShowCompactMenus;
+   int iOSDRenderMode; // 0: redraw everything each frame, 1: redraw only changed areas, 2: same as 1 and show the redrawn areas
+   int iOSDRenderThread; // 0: OSD is drawn from the main loop, 1: OSD is drawn by a separate thread, paced by the display
+   int iOSDPluginsRenderBudget; // max average render time of an OSD plugin, in ms per frame; slower plugins are rendered less often; 0: no limit
 } Preferences;
 
 int save_Preferences();
@@ -41,6 +41,52 @@
 u8 s_epp[MAX_PASS_LENGTH+1];
 u8 s_eppl = 0;
 
+// The pass phrase repeated over (about) a full radio packet, built once when the pass phrase changes.
+// epp/dpp just XOR the data with it, a word at a time, instead of indexing the pass phrase modulo its length for each byte.
+// The length is a multiple of the pass phrase length, so longer buffers are done in chunks with the same key phase.
+u8 s_eppKeyStream[MAX_PACKET_TOTAL_SIZE + MAX_PASS_LENGTH] __attribute__((aligned(16)));
+int s_iEppKeyStreamLength = 0;
+
+void _epp_update_key_stream()
+{
+   s_iEppKeyStreamLength = 0;
+   if ( 0 == s_eppl )
+      return;
+
+   s_iEppKeyStreamLength = (MAX_PACKET_TOTAL_SIZE / s_eppl) * s_eppl;
+   if ( s_iEppKeyStreamLength < MAX_PACKET_TOTAL_SIZE )
+      s_iEppKeyStreamLength += s_eppl;
+   for( int i=0; i<s_iEppKeyStreamLength; i++ )
+      s_eppKeyStream[i] = s_epp[i % s_eppl];
+}
+
+void _epp_xor_key_stream(u8* pData, int len)
+{
+   while ( len > 0 )
+   {
+      int iChunk = len;
+      if ( iChunk > s_iEppKeyStreamLength )
+         iChunk = s_iEppKeyStreamLength;
+
+      int pos = 0;
+      for( ; pos + 16 <= iChunk; pos += 16 )
+      {
+         uint64_t uData[2];
+         uint64_t uKey[2];
+         memcpy(uData, pData + pos, 16);
+         memcpy(uKey, s_eppKeyStream + pos, 16);
+         uData[0] ^= uKey[0];
+         uData[1] ^= uKey[1];
+         memcpy(pData + pos, uData, 16);
+      }
+      for( ; pos < iChunk; pos++ )
+         pData[pos] ^= s_eppKeyStream[pos];
+
+      pData += iChunk;
+      len -= iChunk;
+   }
+}
+
 int lpp(char* szOutputBuffer, int maxLength)
 {
    char szFile[128];
@@ -88,9 +134,12 @@ int lpp(char* szOutputBuffer, int maxLength)
       return 0;
 
    szBuffer[pos] = 0;
+   if ( pos > MAX_PASS_LENGTH )
+      pos = MAX_PASS_LENGTH;
    s_eppl = pos;
    strncpy((char*)s_epp, szBuffer, MAX_PASS_LENGTH);
    s_epp[MAX_PASS_LENGTH] = 0;
+   _epp_update_key_stream();
 
    if ( NULL != szOutputBuffer )
       strncpy(szOutputBuffer, szBuffer, maxLength);
@@ -110,9 +159,12 @@ int spp(char* szBuffer)
    if ( NULL == fd )
       return 0;
 
-   s_eppl = strlen(szBuffer);
+   s_eppl = MAX_PASS_LENGTH;
+   if ( strlen(szBuffer) < MAX_PASS_LENGTH )
+      s_eppl = strlen(szBuffer);
    strncpy((char*)s_epp, szBuffer, MAX_PASS_LENGTH);
    s_epp[MAX_PASS_LENGTH] = 0;
+   _epp_update_key_stream();
 
    u8 sBlockSeed[ENC_BLOCK_SIZE];
    u8 sBlockInput[ENC_BLOCK_SIZE];
@@ -165,6 +217,23 @@ void rpp()
 {
    s_eppl = 0;
    s_epp[0] = 0;
+   _epp_update_key_stream();
+}
+
+// Uses the pass phrase for this session only, without saving it
+void upp(u8* pBuffer, int len)
+{
+   if ( (NULL == pBuffer) || (len <= 0) )
+   {
+      rpp();
+      return;
+   }
+   if ( len > MAX_PASS_LENGTH )
+      len = MAX_PASS_LENGTH;
+   memcpy(s_epp, pBuffer, len);
+   s_epp[len] = 0;
+   s_eppl = len;
+   _epp_update_key_stream();
 }
 
 u8* gpp(int* pLen)
@@ -188,12 +257,7 @@ int epp(u8* pData, int len)
    if ( 0 == s_eppl )
       return 1;
 
-   for(int pos=0; pos < len; pos++ )
-   {
-      //*pData = (*pData)+1;
-      *pData = (*pData) ^ s_epp[pos%s_eppl];
-      pData++;
-   }
+   _epp_xor_key_stream(pData, len);
    return 1;
 }
 
@@ -204,11 +268,6 @@ int dpp(u8* pData, int len)
    if ( 0 == s_eppl )
       return 1;
 
-   for(int pos=0; pos < len; pos++ )
-   {
-      //*pData = (*pData)-1;
-      *pData = (*pData) ^ s_epp[pos%s_eppl];
-      pData++;
-   }
+   _epp_xor_key_stream(pData, len);
    return 1;
 }
@@ -16,6 +16,7 @@ int lpp(char* szOutputBuffer, int maxLength);
 int spp(char* szBuffer);
 
 void rpp();
+void upp(u8* pBuffer, int len);
 u8* gpp(int* pLen);
 int hpp();
 
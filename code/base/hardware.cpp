@@ -488,6 +488,8 @@ int init_hardware_only_detection_pins()
 void hardware_reboot()
 {
    log_line("[Hardware] Entered reboot sequence...");
+   // Write out the queued log lines before the sync, so they make it to disk
+   log_flush();
    hardware_sleep_ms(200);
    hw_execute_bash_command("sync", NULL);
    hardware_sleep_ms(500);
@@ -8,6 +8,9 @@
 #include <sys/wait.h>
 #include <unistd.h>
 #include <poll.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <sys/socket.h>
 
 #include "base.h"
 #include "config.h"
@@ -846,7 +849,403 @@ void hw_set_proc_affinity(const char* szProcName, int iExceptThreadId, int iCore
 }
 
 
+// Command executor:
+// Most commands are run by a long lived /bin/sh co-process (one per Ruby process), started
+// on first use, instead of a popen() (fork + new /bin/sh) for each command.
+// Request: "{ command\n} </dev/null; printf '\036RBX<id>:%d\036' $?\n" is written to the shell stdin;
+// the command output is read from the shell stdout until the end marker.
+// - If the command does not finish in the requested timeout, the output is abandoned (as before) but
+//   the command is allowed to run up to HW_CMD_EXECUTOR_HARD_TIMEOUT_MS more; after that the co-process
+//   and all its children are killed and a new co-process is started on the next command.
+// - Commands that run in background, change the shell state (cd, exit, export...) or that are run while
+//   the co-process is busy with a command from another thread still go through popen().
+// - "cat <file>" is served directly by reading the file (sysfs/procfs queries), no process is started.
+
+#define HW_CMD_EXECUTOR_HARD_TIMEOUT_MS 30000
+#define HW_CMD_EXECUTOR_RETRY_START_MS 5000
+#define HW_CMD_EXECUTOR_MAX_COMMAND_LENGTH 1000
+#define HW_CMD_MAX_OUTPUT_LENGTH 4094
+#define HW_CMD_END_MARKER_CHAR '\036'
+
+static pthread_mutex_t s_MutexCmdExecutor = PTHREAD_MUTEX_INITIALIZER;
+static int s_iCmdExecutorPID = -1;
+static int s_iCmdExecutorSocket = -1;
+static u32 s_uCmdExecutorRequestId = 0;
+static u32 s_uCmdExecutorTimeLastStartFailed = 0;
+static u32 s_uCmdExecutorStartsCount = 0;
+
+static int _hw_execute_bash_command_popen(const char* command, char* outBuffer, int iSilent, u32 uTimeoutMs);
+
+static void _hw_cmd_executor_stop(int bKill)
+{
+   if ( s_iCmdExecutorSocket >= 0 )
+      close(s_iCmdExecutorSocket);
+   s_iCmdExecutorSocket = -1;
+   if ( s_iCmdExecutorPID > 0 )
+   {
+      if ( bKill )
+         kill(-s_iCmdExecutorPID, SIGKILL);
+      // The shell exits by itself on stdin EOF
+      waitpid(s_iCmdExecutorPID, NULL, bKill?0:WNOHANG);
+   }
+   s_iCmdExecutorPID = -1;
+}
+
+static int _hw_cmd_executor_start()
+{
+   if ( (0 != s_uCmdExecutorTimeLastStartFailed) && (get_current_timestamp_ms() < s_uCmdExecutorTimeLastStartFailed + HW_CMD_EXECUTOR_RETRY_START_MS) )
+      return 0;
+
+   int iSockets[2];
+   if ( 0 != socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, iSockets) )
+   {
+      log_softerror_and_alarm("[HwProcs] Failed to create command executor socket, error: %d (%s)", errno, strerror(errno));
+      s_uCmdExecutorTimeLastStartFailed = get_current_timestamp_ms();
+      return 0;
+   }
+
+   int iPID = fork();
+   if ( iPID < 0 )
+   {
+      log_softerror_and_alarm("[HwProcs] Failed to start command executor, error: %d (%s)", errno, strerror(errno));
+      close(iSockets[0]);
+      close(iSockets[1]);
+      s_uCmdExecutorTimeLastStartFailed = get_current_timestamp_ms();
+      return 0;
+   }
+
+   if ( 0 == iPID )
+   {
+      // Child: only async signal safe calls until exec
+      setpgid(0, 0);
+      sigset_t sigMask;
+      sigemptyset(&sigMask);
+      sigprocmask(SIG_SETMASK, &sigMask, NULL);
+      dup2(iSockets[1], STDIN_FILENO);
+      dup2(iSockets[1], STDOUT_FILENO);
+      for( int i=STDERR_FILENO+1; i<1024; i++ )
+         close(i);
+      execl("/bin/sh", "sh", (char*)NULL);
+      _exit(127);
+   }
+
+   close(iSockets[1]);
+   setpgid(iPID, iPID);
+   s_iCmdExecutorPID = iPID;
+   s_iCmdExecutorSocket = iSockets[0];
+   s_uCmdExecutorTimeLastStartFailed = 0;
+   s_uCmdExecutorStartsCount++;
+   log_line("[HwProcs] Started command executor, pid: %d (start count: %u)", iPID, s_uCmdExecutorStartsCount);
+   return 1;
+}
+
+// Returns 1 if the command can run in the shared shell co-process without side effects on later commands
+static int _hw_cmd_executor_can_run(const char* szCommand)
+{
+   int iLen = strlen(szCommand);
+   if ( (0 == iLen) || (iLen > HW_CMD_EXECUTOR_MAX_COMMAND_LENGTH) )
+      return 0;
+
+   for( const char* p = szCommand; *p; p++ )
+   {
+      if ( ((*p) == '\n') || ((*p) == '\r') || ((*p) == HW_CMD_END_MARKER_CHAR) )
+         return 0;
+      if ( (*p) != '&' )
+         continue;
+      // Only redirects (2>&1, >&2) and && are allowed, no background jobs
+      if ( (p[1] == '&') )
+      {
+         p++;
+         continue;
+      }
+      if ( (p > szCommand) && (p[-1] == '>') )
+         continue;
+      return 0;
+   }
+
+   static const char* s_szShellStateKeywords[] = { "cd", "exit", "export", "exec", "unset", "set", "ulimit", "umask", "trap", "source", ".", "alias", "read", "shift", "eval" };
+   // Check the first word of each command in the line
+   const char* p = szCommand;
+   while ( *p )
+   {
+      while ( ((*p) == ' ') || ((*p) == '\t') || ((*p) == ';') || ((*p) == '&') || ((*p) == '|') || ((*p) == '(') || ((*p) == '{') )
+         p++;
+      int iWordLen = 0;
+      while ( p[iWordLen] && (p[iWordLen] != ' ') && (p[iWordLen] != '\t') && (p[iWordLen] != ';') )
+         iWordLen++;
+      for( int i=0; i<(int)(sizeof(s_szShellStateKeywords)/sizeof(s_szShellStateKeywords[0])); i++ )
+      {
+         if ( ((int)strlen(s_szShellStateKeywords[i]) == iWordLen) && (0 == strncmp(p, s_szShellStateKeywords[i], iWordLen)) )
+            return 0;
+      }
+      // Variable assignments would persist in the shell
+      for( int i=0; i<iWordLen; i++ )
+      {
+         if ( p[i] == '=' )
+            return 0;
+         if ( ! (isalnum(p[i]) || (p[i] == '_')) )
+            break;
+      }
+      // Skip to the next command separator
+      while ( (*p) && ((*p) != ';') && ((*p) != '|') && ((*p) != '&') )
+      {
+         if ( ((*p) == '\'') || ((*p) == '"') )
+         {
+            char cQuote = *p;
+            p++;
+            while ( (*p) && ((*p) != cQuote) )
+               p++;
+            if ( 0 == (*p) )
+               break;
+         }
+         p++;
+      }
+   }
+   return 1;
+}
+
+// "cat <file>" (optionally with 2>/dev/null and/or a trailing &): reads the file directly.
+// Returns the number of bytes read, or -1 if the command is not a plain cat of an existing readable file.
+static int _hw_cmd_fast_path_cat(const char* szCommand, char* outBuffer)
+{
+   if ( 0 != strncmp(szCommand, "cat ", 4) )
+      return -1;
+   const char* pFile = szCommand + 4;
+   while ( (*pFile) == ' ' )
+      pFile++;
+   if ( ((*pFile) != '/') || (0 != strncmp(pFile, "/sys/", 5) && 0 != strncmp(pFile, "/proc/", 6) && 0 != strncmp(pFile, "/etc/", 5)) )
+      return -1;
+
+   char szFile[256];
+   int iLen = 0;
+   while ( pFile[iLen] && (pFile[iLen] != ' ') )
+   {
+      if ( (NULL != strchr("*?[]$`\\\"'<>|;&(){}~", pFile[iLen])) || (iLen >= (int)sizeof(szFile)-1) )
+         return -1;
+      szFile[iLen] = pFile[iLen];
+      iLen++;
+   }
+   szFile[iLen] = 0;
+
+   // Only allowed after the file name: 2>/dev/null and &
+   const char* p = pFile + iLen;
+   while ( *p )
+   {
+      if ( (*p) == ' ' )
+         p++;
+      else if ( 0 == strncmp(p, "2>/dev/null", 11) )
+         p += 11;
+      else if ( ((*p) == '&') && (p[1] != '&') )
+         p++;
+      else
+         return -1;
+   }
+
+   int fd = open(szFile, O_RDONLY | O_CLOEXEC);
+   if ( fd < 0 )
+      return -1;
+
+   char szBuff[1024];
+   int iCountRead = 0;
+   while ( 1 )
+   {
+      int iRead = read(fd, szBuff, sizeof(szBuff));
+      if ( (iRead < 0) && (errno == EINTR) )
+         continue;
+      if ( iRead <= 0 )
+         break;
+      if ( (NULL != outBuffer) && (iCountRead < HW_CMD_MAX_OUTPUT_LENGTH) )
+      {
+         int iCopy = iRead;
+         if ( iCountRead + iCopy > HW_CMD_MAX_OUTPUT_LENGTH )
+            iCopy = HW_CMD_MAX_OUTPUT_LENGTH - iCountRead;
+         memcpy(outBuffer + iCountRead, szBuff, iCopy);
+         outBuffer[iCountRead + iCopy] = 0;
+      }
+      iCountRead += iRead;
+   }
+   close(fd);
+   return iCountRead;
+}
+
+// Returns 1 on success, -1 on timeout, 0 if the command could not be sent (caller falls back to popen)
+// Must be called with s_MutexCmdExecutor locked.
+static int _hw_cmd_executor_run(const char* szCommand, char* outBuffer, u32 uTimeoutMs, int* piCountRead)
+{
+   *piCountRead = 0;
+   if ( (s_iCmdExecutorSocket < 0) && (! _hw_cmd_executor_start()) )
+      return 0;
+
+   s_uCmdExecutorRequestId++;
+   char szMarker[32];
+   snprintf(szMarker, sizeof(szMarker)/sizeof(szMarker[0]), "RBX%u:", s_uCmdExecutorRequestId);
+   int iMarkerLen = strlen(szMarker);
+
+   char szRequest[HW_CMD_EXECUTOR_MAX_COMMAND_LENGTH + 128];
+   int iRequestLen = snprintf(szRequest, sizeof(szRequest)/sizeof(szRequest[0]), "{ %s\n} </dev/null; printf '\\036%s%%d\\036' $?\n", szCommand, szMarker);
+
+   int iSent = 0;
+   while ( iSent < iRequestLen )
+   {
+      int iRes = send(s_iCmdExecutorSocket, szRequest + iSent, iRequestLen - iSent, MSG_NOSIGNAL);
+      if ( (iRes < 0) && (errno == EINTR) )
+         continue;
+      if ( iRes <= 0 )
+      {
+         log_softerror_and_alarm("[HwProcs] Command executor is gone (error %d), restarting it.", errno);
+         _hw_cmd_executor_stop(1);
+         if ( (0 != iSent) || (! _hw_cmd_executor_start()) )
+            return 0;
+         continue;
+      }
+      iSent += iRes;
+   }
+
+   u32 uTimeStart = get_current_timestamp_ms();
+   int iResult = 1;
+   int bAbandoned = 0;
+   int iCountRead = 0;
+   // Bytes after an end marker char, until the marker is confirmed or rejected
+   char szPending[40];
+   int iPending = -1;
+   char szBuff[1024];
+
+   while ( 1 )
+   {
+      u32 uTimeNow = get_current_timestamp_ms();
+      u32 uDeadline = uTimeStart + (bAbandoned?(uTimeoutMs + HW_CMD_EXECUTOR_HARD_TIMEOUT_MS):uTimeoutMs);
+      if ( uTimeNow >= uDeadline )
+      {
+         if ( ! bAbandoned )
+         {
+            log_line("Abandoning reading start process output.");
+            iResult = -1;
+            bAbandoned = 1;
+            continue;
+         }
+         log_softerror_and_alarm("[HwProcs] Command did not finish in %u ms, killing it: %s", uTimeoutMs + HW_CMD_EXECUTOR_HARD_TIMEOUT_MS, szCommand);
+         _hw_cmd_executor_stop(1);
+         break;
+      }
+
+      struct pollfd pfd;
+      pfd.fd = s_iCmdExecutorSocket;
+      pfd.events = POLLIN;
+      pfd.revents = 0;
+      int iRes = poll(&pfd, 1, (int)(uDeadline - uTimeNow));
+      if ( (iRes < 0) && (errno != EINTR) )
+      {
+         _hw_cmd_executor_stop(1);
+         break;
+      }
+      if ( iRes <= 0 )
+         continue;
+
+      int iRead = recv(s_iCmdExecutorSocket, szBuff, sizeof(szBuff), 0);
+      if ( (iRead < 0) && (errno == EINTR) )
+         continue;
+      if ( iRead <= 0 )
+      {
+         // Shell exited (the command ended it)
+         _hw_cmd_executor_stop(0);
+         break;
+      }
+
+      int bDone = 0;
+      for( int i=0; i<iRead; i++ )
+      {
+         char c = szBuff[i];
+         if ( iPending >= 0 )
+         {
+            if ( (iPending < iMarkerLen) && (c == szMarker[iPending]) )
+            {
+               szPending[iPending++] = c;
+               continue;
+            }
+            if ( iPending >= iMarkerLen )
+            {
+               if ( c == HW_CMD_END_MARKER_CHAR )
+               {
+                  bDone = 1;
+                  break;
+               }
+               if ( (isdigit(c) || (c == '-')) && (iPending < (int)sizeof(szPending)-1) )
+               {
+                  szPending[iPending++] = c;
+                  continue;
+               }
+            }
+            // Not our marker: it was command output
+            if ( (NULL != outBuffer) && (iCountRead < HW_CMD_MAX_OUTPUT_LENGTH) )
+               outBuffer[iCountRead] = HW_CMD_END_MARKER_CHAR;
+            iCountRead++;
+            for( int k=0; k<iPending; k++ )
+            {
+               if ( (NULL != outBuffer) && (iCountRead < HW_CMD_MAX_OUTPUT_LENGTH) )
+                  outBuffer[iCountRead] = szPending[k];
+               iCountRead++;
+            }
+            iPending = -1;
+         }
+         if ( c == HW_CMD_END_MARKER_CHAR )
+         {
+            iPending = 0;
+            continue;
+         }
+         if ( bAbandoned )
+            continue;
+         if ( (NULL != outBuffer) && (iCountRead < HW_CMD_MAX_OUTPUT_LENGTH) )
+            outBuffer[iCountRead] = c;
+         iCountRead++;
+      }
+      if ( (NULL != outBuffer) )
+         outBuffer[(iCountRead < HW_CMD_MAX_OUTPUT_LENGTH)?iCountRead:HW_CMD_MAX_OUTPUT_LENGTH] = 0;
+      if ( bDone )
+         break;
+   }
+   *piCountRead = iCountRead;
+   return iResult;
+}
+
 int _hw_execute_bash_command(const char* command, char* outBuffer, int iSilent, u32 uTimeoutMs)
+{
+   if ( NULL != outBuffer )
+      *outBuffer = 0;
+   if ( uTimeoutMs == 0 )
+      uTimeoutMs = 5;
+
+   u32 uTimeStart = get_current_timestamp_ms();
+   int iCountRead = _hw_cmd_fast_path_cat(command, outBuffer);
+   int iResult = 1;
+   if ( iCountRead < 0 )
+   {
+      iResult = 0;
+      if ( _hw_cmd_executor_can_run(command) && (0 == pthread_mutex_trylock(&s_MutexCmdExecutor)) )
+      {
+         iResult = _hw_cmd_executor_run(command, outBuffer, uTimeoutMs, &iCountRead);
+         pthread_mutex_unlock(&s_MutexCmdExecutor);
+      }
+      if ( 0 == iResult )
+         return _hw_execute_bash_command_popen(command, outBuffer, iSilent, uTimeoutMs);
+   }
+
+   if ( 0 == iSilent )
+   {
+      if ( (iCountRead < 20) && (NULL != outBuffer) )
+      {
+         char szTmp[24];
+         strncpy(szTmp, outBuffer, 23);
+         szTmp[23] = 0;
+         removeTrailingNewLines(szTmp);
+         log_line("Read process output: %d bytes in %u ms. Content: [%s]", iCountRead, get_current_timestamp_ms() - uTimeStart, szTmp);
+      }
+      else
+         log_line("Read process output: %d bytes in %u ms", iCountRead, get_current_timestamp_ms() - uTimeStart);
+   }
+   return iResult;
+}
+
+static int _hw_execute_bash_command_popen(const char* command, char* outBuffer, int iSilent, u32 uTimeoutMs)
 {
    if ( NULL != outBuffer )
       *outBuffer = 0;
@@ -51,6 +51,7 @@
 #include "hardware_serial.h"
 #include "hardware_radio_sik.h"
 #include "hardware_procs.h"
+#include "hardware_radio_ctrl.h"
 #include "../common/string_utils.h"
 
 #define MAX_USB_DEVICES_INFO 24
@@ -66,6 +67,17 @@ static int s_iHwRadiosSupportedCount = 0;
 static int s_HardwareRadiosEnumeratedOnce = 0;
 
 static int s_iHardwareHasBonnetUSBHub = 0;
+static u32 s_uHardwareRadioLastOpenId = 0;
+
+// Unique (per process) id for each open of a radio interface, so that users of the
+// selectable fd can detect a reopen that got back the same fd number
+u32 hardware_radio_get_new_open_id()
+{
+   u32 uOpenId = __atomic_add_fetch(&s_uHardwareRadioLastOpenId, 1, __ATOMIC_RELAXED);
+   if ( 0 == uOpenId )
+      uOpenId = __atomic_add_fetch(&s_uHardwareRadioLastOpenId, 1, __ATOMIC_RELAXED);
+   return uOpenId;
+}
 
 void reset_runtime_radio_rx_info(type_runtime_radio_rx_info* pRuntimeRadioRxInfo)
 {
@@ -1024,12 +1036,7 @@ int _hardware_enumerate_wifi_radios()
          sRadioInfo[i].szProductId[kk] = 0;
 
       // Find the MAC address
-      sprintf(szComm, "iw dev %s info | grep addr", sRadioInfo[i].szName );
-      if ( 1 != hw_execute_bash_command_raw(szComm, szBuff) )
-      {
-         log_softerror_and_alarm("Failed to find MAC address for %s", sRadioInfo[i].szName);
-      }
-      else if ( 1 != sscanf(szBuff, "%*s %s", szComm) )
+      if ( 0 != radio_ctrl_get_mac_address(sRadioInfo[i].szName, szComm, sizeof(szComm)/sizeof(szComm[0])) )
       {
          log_softerror_and_alarm("Failed to find MAC address for %s", sRadioInfo[i].szName);
       }
@@ -1057,50 +1064,29 @@ int _hardware_enumerate_wifi_radios()
 
       // Find physical interface number, in form phy#0
 
-      sprintf(szComm, "iw dev | grep -B 1 %s", sRadioInfo[i].szName );
-      if ( 1 != hw_execute_bash_command_raw(szComm, szBuff) )
-      {
-         sRadioInfo[i].phy_index = i;
-         log_softerror_and_alarm("Failed to find physical interface index for %s", sRadioInfo[i].szName);
-      }
-      else if ( 1 != sscanf(szBuff, "%s", szComm) )
+      int iPhyIndex = radio_ctrl_get_phy_index(sRadioInfo[i].szName);
+      if ( iPhyIndex < 0 )
       {
          sRadioInfo[i].phy_index = i;
          log_softerror_and_alarm("Failed to find physical interface index for %s", sRadioInfo[i].szName);
       }
       else
       {
-         int iPhyStrLen = strlen(szComm);
-         log_line("phy string: [%s], length: %d", szComm, iPhyStrLen);
-         sRadioInfo[i].phy_index = szComm[iPhyStrLen-1] - '0';
-         if ( (iPhyStrLen > 2) && isdigit(szComm[iPhyStrLen-2]) )
-         {
-            sRadioInfo[i].phy_index = 10 * (szComm[iPhyStrLen-2] - '0') + sRadioInfo[i].phy_index;
-         }
+         sRadioInfo[i].phy_index = iPhyIndex;
+         log_line("Found physical interface index for %s: phy#%d", sRadioInfo[i].szName, iPhyIndex);
       }
 
       // Check supported bands
 
       sRadioInfo[i].supportedBands = 0;
-      sprintf(szComm, "iw phy%d info | grep 2377", sRadioInfo[i].phy_index);
-      hw_execute_bash_command_raw(szComm, szBuff);
-      if ( 5 < strlen(szBuff) )
-        sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_23;
-
-      sprintf(szComm, "iw phy%d info | grep 2427", sRadioInfo[i].phy_index);
-      hw_execute_bash_command_raw(szComm, szBuff);
-      if ( 5 < strlen(szBuff) )
-        sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_24;
-
-      sprintf(szComm, "iw phy%d info | grep 2512", sRadioInfo[i].phy_index);
-      hw_execute_bash_command_raw(szComm, szBuff);
-      if ( 5 < strlen(szBuff) )
-        sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_25;
-
-      sprintf(szComm, "iw phy%d info | grep 5745", sRadioInfo[i].phy_index);
-      hw_execute_bash_command_raw(szComm, szBuff);
-      if ( 5 < strlen(szBuff) )
-        sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_58;
+      if ( radio_ctrl_phy_supports_frequency(sRadioInfo[i].phy_index, 2377) )
+         sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_23;
+      if ( radio_ctrl_phy_supports_frequency(sRadioInfo[i].phy_index, 2427) )
+         sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_24;
+      if ( radio_ctrl_phy_supports_frequency(sRadioInfo[i].phy_index, 2512) )
+         sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_25;
+      if ( radio_ctrl_phy_supports_frequency(sRadioInfo[i].phy_index, 5745) )
+         sRadioInfo[i].supportedBands |= RADIO_HW_SUPPORTED_BAND_58;
 
       if ( sRadioInfo[i].iRadioDriver == RADIO_HW_DRIVER_REALTEK_8812EU )
          sRadioInfo[i].supportedBands &= ~RADIO_HW_SUPPORTED_BAND_24;
@@ -1835,59 +1821,41 @@ int _configure_radio_interface_atheros(int iInterfaceIndex, radio_hw_info_t* pRa
    if ( (NULL == pRadioHWInfo) || (iInterfaceIndex < 0) || (iInterfaceIndex >= hardware_get_radio_interfaces_count()) )
       return 0;
 
-   char szComm[128];
-   char szOutput[2048];
-
    #ifdef HW_PLATFORM_OPENIPC_CAMERA
 
-   //sprintf(szComm, "iwconfig %s mode monitor", pRadioHWInfo->szName);
-   sprintf(szComm, "iw dev %s set type monitor", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_type(pRadioHWInfo->szName, RADIO_CTRL_IFTYPE_MONITOR);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "iw dev %s set monitor fcsfail", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
    hardware_sleep_ms(uDelayMS);
 
-   //sprintf(szComm, "ifconfig %s up", pRadioHWInfo->szName );
-   sprintf(szComm, "ip link set dev %s up", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(uDelayMS);
 
    return 1;
    #endif
 
-   sprintf(szComm, "iw dev %s set monitor fcsfail", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "ip link set dev %s up", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(uDelayMS);
    int dataRateMb = DEFAULT_RADIO_DATARATE_VIDEO_ATHEROS/1000/1000;
    if ( dataRateMb > 0 )
-      sprintf(szComm, "iw dev %s set bitrates legacy-2.4 %d lgi-2.4", pRadioHWInfo->szName, dataRateMb );
+      radio_ctrl_set_bitrate(pRadioHWInfo->szName, dataRateMb*1000*1000, 1);
    else
-      sprintf(szComm, "iw dev %s set bitrates ht-mcs-2.4 %d lgi-2.4", pRadioHWInfo->szName, -dataRateMb-1 );
-   hw_execute_bash_command(szComm, NULL);
+      radio_ctrl_set_bitrate(pRadioHWInfo->szName, dataRateMb, 1);
    hardware_sleep_ms(uDelayMS);
-   //sprintf(szComm, "ifconfig %s down 2>&1", pRadioHWInfo->szName );
-   sprintf(szComm, "ip link set dev %s down", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, NULL);
-   if ( 0 != szOutput[0] )
-      log_softerror_and_alarm("Unexpected result: [%s]", szOutput);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 0);
    hardware_sleep_ms(uDelayMS);
    
-   sprintf(szComm, "iw dev %s set monitor none", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAGS_NONE);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "iw dev %s set monitor fcsfail", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "ip link set dev %s up", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(uDelayMS);
    
    pRadioHWInfo->iCurrentDataRateBPS = dataRateMb*1000*1000;
@@ -1900,47 +1868,31 @@ int _configure_radio_interface_realtek(int iInterfaceIndex, radio_hw_info_t* pRa
    if ( (NULL == pRadioHWInfo) || (iInterfaceIndex < 0) || (iInterfaceIndex >= hardware_get_radio_interfaces_count()) )
       return 0;
 
-   char szComm[128];
-   char szOutput[2048];
-
    #ifdef HW_PLATFORM_OPENIPC_CAMERA
    
-   sprintf(szComm, "ip link set dev %s up", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "iwconfig %s mode monitor", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_type(pRadioHWInfo->szName, RADIO_CTRL_IFTYPE_MONITOR);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "iw dev %s set monitor fcsfail", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
    hardware_sleep_ms(uDelayMS);
    
    return 1;
 
    #endif
 
-   sprintf(szComm, "ip link set dev %s down", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, szOutput);
-   if ( 0 != szOutput[0] )
-      log_softerror_and_alarm("[HardwareRadio] Unexpected result: [%s]", szOutput);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 0);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "iw dev %s set monitor none 2>&1", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
-   if ( 0 != szOutput[0] )
-      log_softerror_and_alarm("Unexpected result: [%s]", szOutput);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAGS_NONE);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "iw dev %s set monitor fcsfail", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
    hardware_sleep_ms(uDelayMS);
 
-   sprintf(szComm, "ip link set dev %s up", pRadioHWInfo->szName );
-   hw_execute_bash_command(szComm, szOutput);
-   if ( 0 != szOutput[0] )
-      log_softerror_and_alarm("Unexpected result: [%s]", szOutput);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(uDelayMS);
 
    return 1;
@@ -1951,8 +1903,6 @@ int hardware_initialize_radio_interface(int iInterfaceIndex, u32 uDelayMS)
    if ( (iInterfaceIndex < 0) || (iInterfaceIndex >= hardware_get_radio_interfaces_count()) )
       return 0;
 
-   char szComm[128];
-   char szOutput[2048];
    radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(iInterfaceIndex);
    if ( NULL == pRadioHWInfo )
    {
@@ -1960,16 +1910,10 @@ int hardware_initialize_radio_interface(int iInterfaceIndex, u32 uDelayMS)
       return 0;
    }
 
-   log_line("[HardwareRadio] Initialize radio interface %d: %s, (%s)", iInterfaceIndex+1, pRadioHWInfo->szName, pRadioHWInfo->szDriver);
-
-   sprintf(szComm, "ip link set dev %s down", pRadioHWInfo->szName );
+   log_line("[HardwareRadio] Initialize radio interface %d: %s, (%s), using %s radio control", iInterfaceIndex+1, pRadioHWInfo->szName, pRadioHWInfo->szDriver, radio_ctrl_get_backend_name(radio_ctrl_get_backend()));
 
    pRadioHWInfo->iCurrentDataRateBPS = 0;
-   //sprintf(szComm, "ifconfig %s mtu 2304 2>&1", pRadioHWInfo->szName );
-   sprintf(szComm, "ip link set dev %s mtu 1400", pRadioHWInfo->szName);
-   hw_execute_bash_command(szComm, szOutput);
-   if ( 0 != szOutput[0] )
-      log_softerror_and_alarm("[HardwareRadio] Unexpected result: [%s]", szOutput);
+   radio_ctrl_set_mtu(pRadioHWInfo->szName, 1400);
    hardware_sleep_ms(uDelayMS);
 
    if ( pRadioHWInfo->iRadioType == RADIO_TYPE_ATHEROS )
@@ -1982,9 +1926,7 @@ int hardware_initialize_radio_interface(int iInterfaceIndex, u32 uDelayMS)
    pRadioHWInfo->lastFrequencySetFailed = 1;
    pRadioHWInfo->uFailedFrequencyKhz = DEFAULT_FREQUENCY;
 
-   sprintf(szComm, "iwconfig %s rts off", pRadioHWInfo->szName);
-   //hw_execute_process_wait(szComm);
-   hw_execute_bash_command(szComm, NULL);
+   radio_ctrl_set_rts_threshold(pRadioHWInfo->szName, RADIO_CTRL_RTS_OFF);
    log_line("[HardwareRadio] Initialized radio interface %d: %s", iInterfaceIndex+1, pRadioHWInfo->szName);
    return 1;
 }
@@ -121,6 +121,7 @@ typedef struct
 
 void reset_runtime_radio_rx_info(type_runtime_radio_rx_info* pRuntimeRadioRxInfo);
 void reset_runtime_radio_rx_signal_info(type_runtime_radio_rx_signal_info* pRuntimeRadioRxSignalInfo);
+u32 hardware_radio_get_new_open_id();
 
 typedef struct
 {
@@ -130,6 +131,7 @@ typedef struct
    int nRadioType;
    int nPort;
    int iErrorCount;
+   u32 uOpenId; // changes each time the interface is opened, even if the same fd is reused
    type_runtime_radio_rx_info radioHwRxInfo;
 } ALIGN_STRUCT_SPEC_INFO type_runtime_radio_interface_info;
 
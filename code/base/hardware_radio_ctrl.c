@@ -0,0 +1,643 @@
+#include <errno.h>
+#include <pthread.h>
+#include <ctype.h>
+
+#include "base.h"
+#include "config.h"
+#include "hardware_radio_ctrl.h"
+#include "hardware_procs.h"
+
+static int s_iRadioCtrlBackend = DEFAULT_RADIO_CTRL_USE_NETLINK?RADIO_CTRL_BACKEND_NETLINK:RADIO_CTRL_BACKEND_SHELL;
+
+//---------------------------------------------------------
+// Shell backend (iw, ip, iwconfig)
+
+// Maps the text output of iw/ip/iwconfig (stderr included) to an errno
+static int _radio_ctrl_shell_result(int iExecResult, const char* szOutput)
+{
+   if ( 1 != iExecResult )
+      return -ETIMEDOUT;
+   if ( (NULL != strstr(szOutput, "busy")) || (NULL != strstr(szOutput, "Busy")) )
+      return -EBUSY;
+   if ( (NULL != strstr(szOutput, "such device")) || (NULL != strstr(szOutput, "Cannot find device")) )
+      return -ENODEV;
+   if ( NULL != strstr(szOutput, "Invalid argument") )
+      return -EINVAL;
+   if ( NULL != strstr(szOutput, "not supported") )
+      return -EOPNOTSUPP;
+   if ( (NULL != strstr(szOutput, "failed")) || (NULL != strstr(szOutput, "rror")) )
+      return -EIO;
+   return 0;
+}
+
+static int _radio_ctrl_shell_exec(const char* szCommand)
+{
+   char szOutput[4096];
+   szOutput[0] = 0;
+   int iRes = hw_execute_bash_command(szCommand, szOutput);
+   iRes = _radio_ctrl_shell_result(iRes, szOutput);
+   if ( 0 != iRes )
+   {
+      removeTrailingNewLines(szOutput);
+      log_softerror_and_alarm("[RadioCtrl] Command [%s] failed (%d), output: [%s]", szCommand, iRes, szOutput);
+   }
+   return iRes;
+}
+
+static int _radio_ctrl_shell_set_link_up(const char* szIfName, int bUp)
+{
+   char szComm[128];
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "ip link set dev %s %s 2>&1", szIfName, bUp?"up":"down");
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_mtu(const char* szIfName, int iMTU)
+{
+   char szComm[128];
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "ip link set dev %s mtu %d 2>&1", szIfName, iMTU);
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_type(const char* szIfName, int iIfType)
+{
+   char szComm[128];
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s set type %s 2>&1", szIfName, (iIfType == RADIO_CTRL_IFTYPE_MONITOR)?"monitor":"managed");
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_monitor_flags(const char* szIfName, u32 uMonitorFlags)
+{
+   char szComm[128];
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s set monitor %s 2>&1", szIfName, (uMonitorFlags & RADIO_CTRL_MONITOR_FLAG_FCSFAIL)?"fcsfail":"none");
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_frequency(const char* szIfName, u32 uFreqKhz, int iChannelType)
+{
+   char szComm[128];
+   #if defined(HW_PLATFORM_RASPBERRY)
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s set freq %u%s 2>&1", szIfName, uFreqKhz/1000, (iChannelType == RADIO_CTRL_CHANNEL_HT40_PLUS)?" HT40+":"");
+   #else
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iwconfig %s freq %u000 2>&1", szIfName, uFreqKhz);
+   #endif
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_txpower(const char* szIfName, int iTxPowerMbm)
+{
+   char szComm[128];
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s set txpower fixed %d 2>&1", szIfName, iTxPowerMbm);
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_bitrate(const char* szIfName, int iDataRate, int bLongGuardInterval)
+{
+   char szComm[128];
+   if ( iDataRate > 0 )
+      snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s set bitrates legacy-2.4 %d%s 2>&1", szIfName, iDataRate/1000/1000, bLongGuardInterval?" lgi-2.4":"");
+   else
+      snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s set bitrates ht-mcs-2.4 %d%s 2>&1", szIfName, -iDataRate-1, bLongGuardInterval?" lgi-2.4":"");
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_set_rts_threshold(const char* szIfName, int iThreshold)
+{
+   char szComm[128];
+   if ( iThreshold < 0 )
+      snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iwconfig %s rts off 2>&1", szIfName);
+   else
+      snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iwconfig %s rts %d 2>&1", szIfName, iThreshold);
+   return _radio_ctrl_shell_exec(szComm);
+}
+
+static int _radio_ctrl_shell_get_phy_index(const char* szIfName)
+{
+   char szComm[128];
+   char szBuff[4096];
+   // Output is in the form: phy#0 \n Interface wlan0
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev | grep -B 1 %s", szIfName);
+   if ( 1 != hw_execute_bash_command_raw(szComm, szBuff) )
+      return -EIO;
+   char* pPhy = strstr(szBuff, "phy#");
+   int iPhyIndex = 0;
+   if ( (NULL == pPhy) || (1 != sscanf(pPhy+4, "%d", &iPhyIndex)) )
+      return -ENODEV;
+   return iPhyIndex;
+}
+
+static int _radio_ctrl_shell_get_phy_frequencies(int iPhyIndex, u32* puFreqsMhz, int iMaxCount)
+{
+   char szComm[128];
+   char szBuff[4096];
+   // Only the "2412 MHz" like tokens, the full iw phy info output is too long
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw phy%d info | grep -o '[0-9]* MHz'", iPhyIndex);
+   if ( 1 != hw_execute_bash_command_raw_silent(szComm, szBuff) )
+      return -EIO;
+
+   int iCount = 0;
+   char* p = szBuff;
+   while ( *p )
+   {
+      u32 uFreq = 0;
+      int iChars = 0;
+      if ( 1 != sscanf(p, "%u MHz%n", &uFreq, &iChars) )
+         break;
+      // Skip channel widths and other small MHz values
+      if ( uFreq > 1000 )
+      {
+         if ( iCount < iMaxCount )
+            puFreqsMhz[iCount] = uFreq;
+         iCount++;
+      }
+      p += iChars;
+      while ( ((*p) == '\n') || ((*p) == '\r') || ((*p) == ' ') )
+         p++;
+   }
+   return iCount;
+}
+
+static int _radio_ctrl_shell_get_mac_address(const char* szIfName, char* szMAC, int iMaxLength)
+{
+   char szComm[128];
+   char szBuff[4096];
+   char szAddr[64];
+   snprintf(szComm, sizeof(szComm)/sizeof(szComm[0]), "iw dev %s info | grep addr", szIfName);
+   if ( 1 != hw_execute_bash_command_raw(szComm, szBuff) )
+      return -EIO;
+   if ( 1 != sscanf(szBuff, "%*s %63s", szAddr) )
+      return -ENODEV;
+   strncpy(szMAC, szAddr, iMaxLength-1);
+   szMAC[iMaxLength-1] = 0;
+   return 0;
+}
+
+static const type_radio_ctrl_backend s_RadioCtrlBackendShell =
+{
+   "shell",
+   _radio_ctrl_shell_set_link_up,
+   _radio_ctrl_shell_set_mtu,
+   _radio_ctrl_shell_set_type,
+   _radio_ctrl_shell_set_monitor_flags,
+   _radio_ctrl_shell_set_frequency,
+   _radio_ctrl_shell_set_txpower,
+   _radio_ctrl_shell_set_bitrate,
+   _radio_ctrl_shell_set_rts_threshold,
+   _radio_ctrl_shell_get_phy_index,
+   _radio_ctrl_shell_get_phy_frequencies,
+   _radio_ctrl_shell_get_mac_address
+};
+
+//---------------------------------------------------------
+// Mock backend
+
+static pthread_mutex_t s_MutexRadioCtrlMock = PTHREAD_MUTEX_INITIALIZER;
+static type_radio_ctrl_mock_interface s_RadioCtrlMockInterfaces[RADIO_CTRL_MAX_MOCK_INTERFACES];
+static int s_iRadioCtrlMockInterfacesCount = 0;
+
+// Must be called with the mock mutex locked. Returns NULL and sets *piError if the operation must fail.
+static type_radio_ctrl_mock_interface* _radio_ctrl_mock_begin_operation(const char* szIfName, int* piError)
+{
+   *piError = -ENODEV;
+   for( int i=0; i<s_iRadioCtrlMockInterfacesCount; i++ )
+   {
+      type_radio_ctrl_mock_interface* pInterface = &s_RadioCtrlMockInterfaces[i];
+      if ( 0 != strcmp(pInterface->szName, szIfName) )
+         continue;
+      pInterface->uOperationsCount++;
+      if ( pInterface->iFailNextCount > 0 )
+      {
+         pInterface->iFailNextCount--;
+         *piError = pInterface->iFailError;
+         return NULL;
+      }
+      *piError = 0;
+      return pInterface;
+   }
+   return NULL;
+}
+
+static int _radio_ctrl_mock_has_frequency(type_radio_ctrl_mock_interface* pInterface, u32 uFreqMhz)
+{
+   for( int i=0; i<pInterface->iFreqsCount; i++ )
+   {
+      if ( pInterface->uFreqsMhz[i] == uFreqMhz )
+         return 1;
+   }
+   return 0;
+}
+
+static int _radio_ctrl_mock_set_link_up(const char* szIfName, int bUp)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+      pInterface->bUp = bUp;
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_mtu(const char* szIfName, int iMTU)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+   {
+      if ( (iMTU < 68) || (iMTU > 2304) )
+         iError = -EINVAL;
+      else
+         pInterface->iMTU = iMTU;
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_type(const char* szIfName, int iIfType)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+   {
+      // Like the kernel: the interface type can't change while the interface is up
+      if ( pInterface->bUp && (pInterface->iIfType != iIfType) )
+         iError = -EBUSY;
+      else
+         pInterface->iIfType = iIfType;
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_monitor_flags(const char* szIfName, u32 uMonitorFlags)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+   {
+      if ( pInterface->bUp && (pInterface->iIfType != RADIO_CTRL_IFTYPE_MONITOR) )
+         iError = -EBUSY;
+      else
+      {
+         pInterface->iIfType = RADIO_CTRL_IFTYPE_MONITOR;
+         pInterface->uMonitorFlags = uMonitorFlags;
+      }
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_frequency(const char* szIfName, u32 uFreqKhz, int iChannelType)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+   {
+      if ( ! _radio_ctrl_mock_has_frequency(pInterface, uFreqKhz/1000) )
+         iError = -EINVAL;
+      else if ( (iChannelType == RADIO_CTRL_CHANNEL_HT40_PLUS) && (! _radio_ctrl_mock_has_frequency(pInterface, uFreqKhz/1000 + 20)) )
+         iError = -EINVAL;
+      else
+      {
+         pInterface->uFreqKhz = uFreqKhz;
+         pInterface->iChannelType = iChannelType;
+         pInterface->uFrequencyChangesCount++;
+      }
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_txpower(const char* szIfName, int iTxPowerMbm)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+      pInterface->iTxPowerMbm = iTxPowerMbm;
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_bitrate(const char* szIfName, int iDataRate, int bLongGuardInterval)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+   {
+      if ( (0 == iDataRate) || (iDataRate < -32) || (iDataRate > 54000000) )
+         iError = -EINVAL;
+      else
+      {
+         pInterface->iDataRate = iDataRate;
+         pInterface->bLongGuardInterval = bLongGuardInterval;
+         pInterface->uDataRateChangesCount++;
+      }
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_set_rts_threshold(const char* szIfName, int iThreshold)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+      pInterface->iRTSThreshold = iThreshold;
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_get_phy_index(const char* szIfName)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+      iError = pInterface->iPhyIndex;
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static int _radio_ctrl_mock_get_phy_frequencies(int iPhyIndex, u32* puFreqsMhz, int iMaxCount)
+{
+   int iResult = -ENODEV;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   for( int i=0; i<s_iRadioCtrlMockInterfacesCount; i++ )
+   {
+      if ( s_RadioCtrlMockInterfaces[i].iPhyIndex != iPhyIndex )
+         continue;
+      iResult = s_RadioCtrlMockInterfaces[i].iFreqsCount;
+      memcpy(puFreqsMhz, s_RadioCtrlMockInterfaces[i].uFreqsMhz, ((iResult < iMaxCount)?iResult:iMaxCount)*sizeof(u32));
+      break;
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iResult;
+}
+
+static int _radio_ctrl_mock_get_mac_address(const char* szIfName, char* szMAC, int iMaxLength)
+{
+   int iError = 0;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   type_radio_ctrl_mock_interface* pInterface = _radio_ctrl_mock_begin_operation(szIfName, &iError);
+   if ( NULL != pInterface )
+   {
+      strncpy(szMAC, pInterface->szMAC, iMaxLength-1);
+      szMAC[iMaxLength-1] = 0;
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iError;
+}
+
+static const type_radio_ctrl_backend s_RadioCtrlBackendMock =
+{
+   "mock",
+   _radio_ctrl_mock_set_link_up,
+   _radio_ctrl_mock_set_mtu,
+   _radio_ctrl_mock_set_type,
+   _radio_ctrl_mock_set_monitor_flags,
+   _radio_ctrl_mock_set_frequency,
+   _radio_ctrl_mock_set_txpower,
+   _radio_ctrl_mock_set_bitrate,
+   _radio_ctrl_mock_set_rts_threshold,
+   _radio_ctrl_mock_get_phy_index,
+   _radio_ctrl_mock_get_phy_frequencies,
+   _radio_ctrl_mock_get_mac_address
+};
+
+int radio_ctrl_mock_add_interface(const char* szIfName, int iPhyIndex, const char* szMAC, const u32* puFreqsMhz, int iFreqsCount)
+{
+   if ( (NULL == szIfName) || (0 == szIfName[0]) )
+      return -EINVAL;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   if ( s_iRadioCtrlMockInterfacesCount >= RADIO_CTRL_MAX_MOCK_INTERFACES )
+   {
+      pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+      return -ENOSPC;
+   }
+   type_radio_ctrl_mock_interface* pInterface = &s_RadioCtrlMockInterfaces[s_iRadioCtrlMockInterfacesCount];
+   memset(pInterface, 0, sizeof(type_radio_ctrl_mock_interface));
+   strncpy(pInterface->szName, szIfName, sizeof(pInterface->szName)-1);
+   if ( NULL != szMAC )
+      strncpy(pInterface->szMAC, szMAC, sizeof(pInterface->szMAC)-1);
+   pInterface->iPhyIndex = iPhyIndex;
+   if ( iFreqsCount > RADIO_CTRL_MAX_MOCK_FREQUENCIES )
+      iFreqsCount = RADIO_CTRL_MAX_MOCK_FREQUENCIES;
+   if ( (NULL != puFreqsMhz) && (iFreqsCount > 0) )
+   {
+      memcpy(pInterface->uFreqsMhz, puFreqsMhz, iFreqsCount*sizeof(u32));
+      pInterface->iFreqsCount = iFreqsCount;
+   }
+   pInterface->iMTU = 1500;
+   pInterface->iIfType = RADIO_CTRL_IFTYPE_MANAGED;
+   s_iRadioCtrlMockInterfacesCount++;
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return 0;
+}
+
+void radio_ctrl_mock_remove_all_interfaces()
+{
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   s_iRadioCtrlMockInterfacesCount = 0;
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+}
+
+int radio_ctrl_mock_get_interface(const char* szIfName, type_radio_ctrl_mock_interface* pOutput)
+{
+   int iResult = -ENODEV;
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   for( int i=0; i<s_iRadioCtrlMockInterfacesCount; i++ )
+   {
+      if ( 0 != strcmp(s_RadioCtrlMockInterfaces[i].szName, szIfName) )
+         continue;
+      if ( NULL != pOutput )
+         memcpy(pOutput, &s_RadioCtrlMockInterfaces[i], sizeof(type_radio_ctrl_mock_interface));
+      iResult = 0;
+      break;
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+   return iResult;
+}
+
+void radio_ctrl_mock_fail_next_operations(const char* szIfName, int iError, int iCount)
+{
+   pthread_mutex_lock(&s_MutexRadioCtrlMock);
+   for( int i=0; i<s_iRadioCtrlMockInterfacesCount; i++ )
+   {
+      if ( 0 != strcmp(s_RadioCtrlMockInterfaces[i].szName, szIfName) )
+         continue;
+      s_RadioCtrlMockInterfaces[i].iFailError = iError;
+      s_RadioCtrlMockInterfaces[i].iFailNextCount = iCount;
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlMock);
+}
+
+//---------------------------------------------------------
+
+void radio_ctrl_set_backend(int iBackend)
+{
+   if ( (iBackend < RADIO_CTRL_BACKEND_SHELL) || (iBackend > RADIO_CTRL_BACKEND_MOCK) )
+      iBackend = RADIO_CTRL_BACKEND_SHELL;
+   if ( iBackend != s_iRadioCtrlBackend )
+      log_line("[RadioCtrl] Switched radio control backend from %s to %s", radio_ctrl_get_backend_name(s_iRadioCtrlBackend), radio_ctrl_get_backend_name(iBackend));
+   s_iRadioCtrlBackend = iBackend;
+}
+
+int radio_ctrl_get_backend()
+{
+   return s_iRadioCtrlBackend;
+}
+
+const char* radio_ctrl_get_backend_name(int iBackend)
+{
+   if ( iBackend == RADIO_CTRL_BACKEND_NETLINK )
+      return g_RadioCtrlBackendNetlink.szName;
+   if ( iBackend == RADIO_CTRL_BACKEND_MOCK )
+      return s_RadioCtrlBackendMock.szName;
+   return s_RadioCtrlBackendShell.szName;
+}
+
+static const type_radio_ctrl_backend* _radio_ctrl_get_backend()
+{
+   if ( s_iRadioCtrlBackend == RADIO_CTRL_BACKEND_NETLINK )
+      return &g_RadioCtrlBackendNetlink;
+   if ( s_iRadioCtrlBackend == RADIO_CTRL_BACKEND_MOCK )
+      return &s_RadioCtrlBackendMock;
+   return &s_RadioCtrlBackendShell;
+}
+
+// Netlink results that mean "can't do it this way": retry with the shell backend
+static int _radio_ctrl_must_fallback(int iResult)
+{
+   if ( s_iRadioCtrlBackend != RADIO_CTRL_BACKEND_NETLINK )
+      return 0;
+   return (iResult == -EOPNOTSUPP) || (iResult == -EAFNOSUPPORT) || (iResult == -EPROTONOSUPPORT) || (iResult == -ENOENT);
+}
+
+static void _radio_ctrl_log_result(const char* szOperation, const char* szIfName, int iResult, u32 uTimeStartMicros)
+{
+   u32 uDuration = get_current_timestamp_micros() - uTimeStartMicros;
+   if ( 0 == iResult )
+      log_line("[RadioCtrl] %s %s: done in %u us (%s)", szOperation, szIfName, uDuration, _radio_ctrl_get_backend()->szName);
+   else
+      log_softerror_and_alarm("[RadioCtrl] %s %s: failed, error %d (%s), in %u us (%s)", szOperation, szIfName, iResult, strerror(-iResult), uDuration, _radio_ctrl_get_backend()->szName);
+}
+
+#define RADIO_CTRL_DISPATCH(szOperationDesc, pfn, ...) \
+   if ( (NULL == szIfName) || (0 == szIfName[0]) ) \
+      return -EINVAL; \
+   u32 uTimeStart = get_current_timestamp_micros(); \
+   int iResult = _radio_ctrl_get_backend()->pfn(__VA_ARGS__); \
+   if ( _radio_ctrl_must_fallback(iResult) ) \
+      iResult = s_RadioCtrlBackendShell.pfn(__VA_ARGS__); \
+   _radio_ctrl_log_result(szOperationDesc, szIfName, iResult, uTimeStart); \
+   return iResult;
+
+int radio_ctrl_set_link_up(const char* szIfName, int bUp)
+{
+   RADIO_CTRL_DISPATCH(bUp?"Set link up":"Set link down", pfnSetLinkUp, szIfName, bUp);
+}
+
+int radio_ctrl_set_mtu(const char* szIfName, int iMTU)
+{
+   RADIO_CTRL_DISPATCH("Set MTU", pfnSetMTU, szIfName, iMTU);
+}
+
+int radio_ctrl_set_type(const char* szIfName, int iIfType)
+{
+   RADIO_CTRL_DISPATCH((iIfType == RADIO_CTRL_IFTYPE_MONITOR)?"Set type monitor":"Set type managed", pfnSetType, szIfName, iIfType);
+}
+
+int radio_ctrl_set_monitor_flags(const char* szIfName, u32 uMonitorFlags)
+{
+   RADIO_CTRL_DISPATCH((uMonitorFlags & RADIO_CTRL_MONITOR_FLAG_FCSFAIL)?"Set monitor fcsfail":"Set monitor none", pfnSetMonitorFlags, szIfName, uMonitorFlags);
+}
+
+int radio_ctrl_set_frequency(const char* szIfName, u32 uFreqKhz, int iChannelType)
+{
+   RADIO_CTRL_DISPATCH((iChannelType == RADIO_CTRL_CHANNEL_HT40_PLUS)?"Set frequency (HT40+)":"Set frequency", pfnSetFrequency, szIfName, uFreqKhz, iChannelType);
+}
+
+int radio_ctrl_set_txpower(const char* szIfName, int iTxPowerMbm)
+{
+   RADIO_CTRL_DISPATCH("Set tx power", pfnSetTxPower, szIfName, iTxPowerMbm);
+}
+
+int radio_ctrl_set_bitrate(const char* szIfName, int iDataRate, int bLongGuardInterval)
+{
+   RADIO_CTRL_DISPATCH((iDataRate > 0)?"Set legacy bitrate":"Set MCS bitrate", pfnSetBitrate, szIfName, iDataRate, bLongGuardInterval);
+}
+
+int radio_ctrl_set_rts_threshold(const char* szIfName, int iThreshold)
+{
+   RADIO_CTRL_DISPATCH("Set RTS threshold", pfnSetRTSThreshold, szIfName, iThreshold);
+}
+
+int radio_ctrl_get_phy_index(const char* szIfName)
+{
+   if ( (NULL == szIfName) || (0 == szIfName[0]) )
+      return -EINVAL;
+   int iResult = _radio_ctrl_get_backend()->pfnGetPhyIndex(szIfName);
+   if ( _radio_ctrl_must_fallback(iResult) )
+      iResult = s_RadioCtrlBackendShell.pfnGetPhyIndex(szIfName);
+   return iResult;
+}
+
+int radio_ctrl_get_phy_frequencies(int iPhyIndex, u32* puFreqsMhz, int iMaxCount)
+{
+   if ( (iPhyIndex < 0) || (NULL == puFreqsMhz) || (iMaxCount <= 0) )
+      return -EINVAL;
+   int iResult = _radio_ctrl_get_backend()->pfnGetPhyFrequencies(iPhyIndex, puFreqsMhz, iMaxCount);
+   if ( _radio_ctrl_must_fallback(iResult) )
+      iResult = s_RadioCtrlBackendShell.pfnGetPhyFrequencies(iPhyIndex, puFreqsMhz, iMaxCount);
+   return iResult;
+}
+
+int radio_ctrl_phy_supports_frequency(int iPhyIndex, u32 uFreqMhz)
+{
+   u32 uFreqsStack[RADIO_CTRL_MAX_PHY_FREQUENCIES];
+   u32* puFreqs = uFreqsStack;
+   int iCount = radio_ctrl_get_phy_frequencies(iPhyIndex, puFreqs, RADIO_CTRL_MAX_PHY_FREQUENCIES);
+   if ( iCount > RADIO_CTRL_MAX_PHY_FREQUENCIES )
+   {
+      // Long list (i.e. patched drivers with extended channels), get all of it
+      int iMaxCount = iCount;
+      puFreqs = (u32*) malloc(iMaxCount*sizeof(u32));
+      if ( NULL == puFreqs )
+      {
+         log_softerror_and_alarm("[RadioCtrl] Failed to allocate the frequencies list of phy#%d (%d frequencies).", iPhyIndex, iMaxCount);
+         return 0;
+      }
+      iCount = radio_ctrl_get_phy_frequencies(iPhyIndex, puFreqs, iMaxCount);
+      if ( iCount > iMaxCount )
+         iCount = iMaxCount;
+   }
+   int iFound = 0;
+   for( int i=0; i<iCount; i++ )
+   {
+      if ( puFreqs[i] == uFreqMhz )
+      {
+         iFound = 1;
+         break;
+      }
+   }
+   if ( puFreqs != uFreqsStack )
+      free(puFreqs);
+   return iFound;
+}
+
+int radio_ctrl_get_mac_address(const char* szIfName, char* szMAC, int iMaxLength)
+{
+   if ( (NULL == szIfName) || (0 == szIfName[0]) || (NULL == szMAC) || (iMaxLength < 2) )
+      return -EINVAL;
+   szMAC[0] = 0;
+   int iResult = _radio_ctrl_get_backend()->pfnGetMACAddress(szIfName, szMAC, iMaxLength);
+   if ( _radio_ctrl_must_fallback(iResult) )
+      iResult = s_RadioCtrlBackendShell.pfnGetMACAddress(szIfName, szMAC, iMaxLength);
+   return iResult;
+}
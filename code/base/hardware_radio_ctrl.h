@@ -0,0 +1,115 @@
+#pragma once
+#include "base.h"
+
+// Wifi radio interface control: link up/down, MTU, monitor mode, frequency, tx power,
+// bitrates and interface detection (phy index, MAC, supported frequencies).
+//
+// Backends:
+// - shell: iw/ip/iwconfig commands (the original implementation);
+// - netlink: nl80211 + rtnetlink requests done in process, no command is spawned;
+// - mock: in memory interfaces, so frequency and datarate switching can be tested without radio hardware.
+//
+// All operations return 0 on success or a negative errno on failure (-EBUSY, -ENODEV, -EINVAL...).
+// Operations the netlink backend can't do (no nl80211 in the kernel, unsupported request)
+// are retried with the shell backend.
+
+#define RADIO_CTRL_BACKEND_SHELL 0
+#define RADIO_CTRL_BACKEND_NETLINK 1
+#define RADIO_CTRL_BACKEND_MOCK 2
+
+#define RADIO_CTRL_IFTYPE_MANAGED 0
+#define RADIO_CTRL_IFTYPE_MONITOR 1
+
+#define RADIO_CTRL_MONITOR_FLAGS_NONE 0
+#define RADIO_CTRL_MONITOR_FLAG_FCSFAIL 0x01
+
+#define RADIO_CTRL_CHANNEL_20MHZ 0
+#define RADIO_CTRL_CHANNEL_HT40_PLUS 1
+
+#define RADIO_CTRL_RTS_OFF -1
+
+#define RADIO_CTRL_MAX_MOCK_INTERFACES 8
+// Stack buffer size for phy frequency lists; patched drivers can list more, see radio_ctrl_get_phy_frequencies
+#define RADIO_CTRL_MAX_PHY_FREQUENCIES 128
+#define RADIO_CTRL_MAX_MOCK_FREQUENCIES 256
+
+typedef struct
+{
+   const char* szName;
+   int (*pfnSetLinkUp)(const char* szIfName, int bUp);
+   int (*pfnSetMTU)(const char* szIfName, int iMTU);
+   int (*pfnSetType)(const char* szIfName, int iIfType);
+   int (*pfnSetMonitorFlags)(const char* szIfName, u32 uMonitorFlags);
+   int (*pfnSetFrequency)(const char* szIfName, u32 uFreqKhz, int iChannelType);
+   int (*pfnSetTxPower)(const char* szIfName, int iTxPowerMbm);
+   // positive: legacy rate in bps, negative: MCS (-1 is MCS0)
+   int (*pfnSetBitrate)(const char* szIfName, int iDataRate, int bLongGuardInterval);
+   int (*pfnSetRTSThreshold)(const char* szIfName, int iThreshold);
+   // Return the phy index / the number of frequencies (MHz) the phy has, or a negative errno.
+   // Only the first iMaxCount frequencies are written, the count can be bigger than iMaxCount.
+   int (*pfnGetPhyIndex)(const char* szIfName);
+   int (*pfnGetPhyFrequencies)(int iPhyIndex, u32* puFreqsMhz, int iMaxCount);
+   // MAC as "AA:BB:CC:DD:EE:FF"
+   int (*pfnGetMACAddress)(const char* szIfName, char* szMAC, int iMaxLength);
+} type_radio_ctrl_backend;
+
+typedef struct
+{
+   char szName[32];
+   char szMAC[24];
+   int iPhyIndex;
+   u32 uFreqsMhz[RADIO_CTRL_MAX_MOCK_FREQUENCIES];
+   int iFreqsCount;
+
+   int bUp;
+   int iMTU;
+   int iIfType;
+   u32 uMonitorFlags;
+   u32 uFreqKhz;
+   int iChannelType;
+   int iTxPowerMbm;
+   int iDataRate;
+   int bLongGuardInterval;
+   int iRTSThreshold;
+
+   u32 uOperationsCount;
+   u32 uFrequencyChangesCount;
+   u32 uDataRateChangesCount;
+   // Next iFailNextCount operations fail with iFailError
+   int iFailError;
+   int iFailNextCount;
+} type_radio_ctrl_mock_interface;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+extern const type_radio_ctrl_backend g_RadioCtrlBackendNetlink;
+
+void radio_ctrl_set_backend(int iBackend);
+int radio_ctrl_get_backend();
+const char* radio_ctrl_get_backend_name(int iBackend);
+
+int radio_ctrl_set_link_up(const char* szIfName, int bUp);
+int radio_ctrl_set_mtu(const char* szIfName, int iMTU);
+int radio_ctrl_set_type(const char* szIfName, int iIfType);
+int radio_ctrl_set_monitor_flags(const char* szIfName, u32 uMonitorFlags);
+int radio_ctrl_set_frequency(const char* szIfName, u32 uFreqKhz, int iChannelType);
+int radio_ctrl_set_txpower(const char* szIfName, int iTxPowerMbm);
+int radio_ctrl_set_bitrate(const char* szIfName, int iDataRate, int bLongGuardInterval);
+int radio_ctrl_set_rts_threshold(const char* szIfName, int iThreshold);
+int radio_ctrl_get_phy_index(const char* szIfName);
+// Returns the total count of frequencies, more than iMaxCount if the list did not fit
+int radio_ctrl_get_phy_frequencies(int iPhyIndex, u32* puFreqsMhz, int iMaxCount);
+int radio_ctrl_phy_supports_frequency(int iPhyIndex, u32 uFreqMhz);
+int radio_ctrl_get_mac_address(const char* szIfName, char* szMAC, int iMaxLength);
+
+// Mock backend
+int radio_ctrl_mock_add_interface(const char* szIfName, int iPhyIndex, const char* szMAC, const u32* puFreqsMhz, int iFreqsCount);
+void radio_ctrl_mock_remove_all_interfaces();
+int radio_ctrl_mock_get_interface(const char* szIfName, type_radio_ctrl_mock_interface* pOutput);
+void radio_ctrl_mock_fail_next_operations(const char* szIfName, int iError, int iCount);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,583 @@
+#include <errno.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <net/if.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/genetlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/nl80211.h>
+
+#include "base.h"
+#include "config.h"
+#include "hardware_radio_ctrl.h"
+
+// nl80211 (generic netlink) and rtnetlink backend for the radio interfaces control.
+// Requests are built by hand (no libnl dependency), one request at a time, synchronously:
+// send the request with NLM_F_ACK and read replies until the ack (or the end of a dump).
+
+#define NETLINK_MSG_BUFFER_SIZE 4096
+#define NETLINK_RX_BUFFER_SIZE 32768
+#define NETLINK_RECV_TIMEOUT_MS 1000
+#define NETLINK_RETRY_RESOLVE_MS 5000
+
+typedef struct
+{
+   u8 uBuffer[NETLINK_MSG_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+   int iLength;
+} type_netlink_msg;
+
+typedef int (*netlink_msg_callback)(struct nlmsghdr* pHeader, void* pContext);
+
+static pthread_mutex_t s_MutexRadioCtrlNetlink = PTHREAD_MUTEX_INITIALIZER;
+static int s_iNetlinkGenericSocket = -1;
+static int s_iNetlinkRouteSocket = -1;
+static int s_iNl80211FamilyId = -1;
+static u32 s_uTimeLastNl80211ResolveFailed = 0;
+static u32 s_uNetlinkSequence = 0;
+static u8 s_uNetlinkRxBuffer[NETLINK_RX_BUFFER_SIZE] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+//---------------------------------------------------------
+// Messages
+
+static void _netlink_msg_init(type_netlink_msg* pMsg, u16 uType, u16 uFlags)
+{
+   memset(pMsg->uBuffer, 0, NLMSG_HDRLEN);
+   struct nlmsghdr* pHeader = (struct nlmsghdr*)pMsg->uBuffer;
+   pHeader->nlmsg_type = uType;
+   pHeader->nlmsg_flags = NLM_F_REQUEST | NLM_F_ACK | uFlags;
+   pMsg->iLength = NLMSG_HDRLEN;
+}
+
+static void* _netlink_msg_reserve(type_netlink_msg* pMsg, int iLength)
+{
+   int iAligned = NLMSG_ALIGN(iLength);
+   if ( pMsg->iLength + iAligned > NETLINK_MSG_BUFFER_SIZE )
+      return NULL;
+   void* pData = pMsg->uBuffer + pMsg->iLength;
+   memset(pData, 0, iAligned);
+   pMsg->iLength += iAligned;
+   return pData;
+}
+
+static void _netlink_msg_init_nl80211(type_netlink_msg* pMsg, u8 uCommand, u16 uFlags)
+{
+   _netlink_msg_init(pMsg, (u16)s_iNl80211FamilyId, uFlags);
+   struct genlmsghdr* pGenHeader = (struct genlmsghdr*)_netlink_msg_reserve(pMsg, GENL_HDRLEN);
+   pGenHeader->cmd = uCommand;
+   pGenHeader->version = 0;
+}
+
+static int _netlink_put_attr(type_netlink_msg* pMsg, u16 uType, const void* pData, int iLength)
+{
+   struct nlattr* pAttr = (struct nlattr*)_netlink_msg_reserve(pMsg, NLA_HDRLEN + iLength);
+   if ( NULL == pAttr )
+      return -ENOBUFS;
+   pAttr->nla_type = uType;
+   pAttr->nla_len = NLA_HDRLEN + iLength;
+   if ( iLength > 0 )
+      memcpy(((u8*)pAttr) + NLA_HDRLEN, pData, iLength);
+   return 0;
+}
+
+static int _netlink_put_u32(type_netlink_msg* pMsg, u16 uType, u32 uValue)
+{
+   return _netlink_put_attr(pMsg, uType, &uValue, sizeof(u32));
+}
+
+static int _netlink_put_u8(type_netlink_msg* pMsg, u16 uType, u8 uValue)
+{
+   return _netlink_put_attr(pMsg, uType, &uValue, sizeof(u8));
+}
+
+// Returns the nest offset in the message, to be passed to _netlink_nest_end, or -1
+static int _netlink_nest_start(type_netlink_msg* pMsg, u16 uType)
+{
+   int iOffset = pMsg->iLength;
+   if ( 0 != _netlink_put_attr(pMsg, uType | NLA_F_NESTED, NULL, 0) )
+      return -1;
+   return iOffset;
+}
+
+static void _netlink_nest_end(type_netlink_msg* pMsg, int iNestOffset)
+{
+   struct nlattr* pAttr = (struct nlattr*)(pMsg->uBuffer + iNestOffset);
+   pAttr->nla_len = pMsg->iLength - iNestOffset;
+}
+
+static struct nlattr* _netlink_find_attr(void* pAttrs, int iLength, u16 uType)
+{
+   struct nlattr* pAttr = (struct nlattr*)pAttrs;
+   while ( (iLength >= NLA_HDRLEN) && (pAttr->nla_len >= NLA_HDRLEN) && (pAttr->nla_len <= iLength) )
+   {
+      if ( (pAttr->nla_type & NLA_TYPE_MASK) == uType )
+         return pAttr;
+      iLength -= NLA_ALIGN(pAttr->nla_len);
+      pAttr = (struct nlattr*)(((u8*)pAttr) + NLA_ALIGN(pAttr->nla_len));
+   }
+   return NULL;
+}
+
+#define NETLINK_ATTR_DATA(pAttr) ((void*)(((u8*)(pAttr)) + NLA_HDRLEN))
+#define NETLINK_ATTR_LEN(pAttr) ((int)(pAttr)->nla_len - NLA_HDRLEN)
+
+// Generic netlink message: attributes start after the genl header
+#define NETLINK_GENL_ATTRS(pHeader) ((void*)(((u8*)NLMSG_DATA(pHeader)) + GENL_HDRLEN))
+#define NETLINK_GENL_ATTRS_LEN(pHeader) ((int)(pHeader)->nlmsg_len - NLMSG_HDRLEN - GENL_HDRLEN)
+
+//---------------------------------------------------------
+// Transport
+
+static int _netlink_open_socket(int iProtocol)
+{
+   int iSocket = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, iProtocol);
+   if ( iSocket < 0 )
+      return -errno;
+
+   struct sockaddr_nl addr;
+   memset(&addr, 0, sizeof(addr));
+   addr.nl_family = AF_NETLINK;
+   if ( 0 != bind(iSocket, (struct sockaddr*)&addr, sizeof(addr)) )
+   {
+      int iError = -errno;
+      close(iSocket);
+      return iError;
+   }
+   struct timeval tv;
+   tv.tv_sec = NETLINK_RECV_TIMEOUT_MS/1000;
+   tv.tv_usec = (NETLINK_RECV_TIMEOUT_MS%1000)*1000;
+   setsockopt(iSocket, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+   return iSocket;
+}
+
+// Sends the request and reads the replies. pfnCallback is called for each reply data message.
+// Returns 0 on ack/end of dump, a negative errno otherwise.
+static int _netlink_transact(int iSocket, type_netlink_msg* pMsg, netlink_msg_callback pfnCallback, void* pContext)
+{
+   struct nlmsghdr* pRequest = (struct nlmsghdr*)pMsg->uBuffer;
+   pRequest->nlmsg_len = pMsg->iLength;
+   pRequest->nlmsg_seq = ++s_uNetlinkSequence;
+
+   struct sockaddr_nl addrKernel;
+   memset(&addrKernel, 0, sizeof(addrKernel));
+   addrKernel.nl_family = AF_NETLINK;
+
+   if ( sendto(iSocket, pMsg->uBuffer, pMsg->iLength, 0, (struct sockaddr*)&addrKernel, sizeof(addrKernel)) < 0 )
+      return -errno;
+
+   while ( 1 )
+   {
+      int iRead = recv(iSocket, s_uNetlinkRxBuffer, sizeof(s_uNetlinkRxBuffer), 0);
+      if ( iRead < 0 )
+      {
+         if ( errno == EINTR )
+            continue;
+         if ( (errno == EAGAIN) || (errno == EWOULDBLOCK) )
+            return -ETIMEDOUT;
+         return -errno;
+      }
+      if ( 0 == iRead )
+         return -EIO;
+
+      struct nlmsghdr* pHeader = (struct nlmsghdr*)s_uNetlinkRxBuffer;
+      int iLeft = iRead;
+      for( ; NLMSG_OK(pHeader, iLeft); pHeader = NLMSG_NEXT(pHeader, iLeft) )
+      {
+         // Late replies to a previous (timed out) request
+         if ( pHeader->nlmsg_seq != pRequest->nlmsg_seq )
+            continue;
+         if ( pHeader->nlmsg_type == NLMSG_DONE )
+            return 0;
+         if ( pHeader->nlmsg_type == NLMSG_ERROR )
+         {
+            struct nlmsgerr* pError = (struct nlmsgerr*)NLMSG_DATA(pHeader);
+            return pError->error;
+         }
+         if ( NULL != pfnCallback )
+            pfnCallback(pHeader, pContext);
+      }
+   }
+   return -EIO;
+}
+
+static int _netlink_on_family_reply(struct nlmsghdr* pHeader, void* pContext)
+{
+   struct nlattr* pAttr = _netlink_find_attr(NETLINK_GENL_ATTRS(pHeader), NETLINK_GENL_ATTRS_LEN(pHeader), CTRL_ATTR_FAMILY_ID);
+   if ( (NULL != pAttr) && (NETLINK_ATTR_LEN(pAttr) >= (int)sizeof(u16)) )
+      *((int*)pContext) = *((u16*)NETLINK_ATTR_DATA(pAttr));
+   return 0;
+}
+
+// Must be called with the netlink mutex locked. Returns 0 if nl80211 requests can be sent.
+static int _netlink_nl80211_open()
+{
+   if ( (s_iNetlinkGenericSocket >= 0) && (s_iNl80211FamilyId > 0) )
+      return 0;
+   if ( (0 != s_uTimeLastNl80211ResolveFailed) && (get_current_timestamp_ms() < s_uTimeLastNl80211ResolveFailed + NETLINK_RETRY_RESOLVE_MS) )
+      return -EOPNOTSUPP;
+
+   if ( s_iNetlinkGenericSocket < 0 )
+   {
+      s_iNetlinkGenericSocket = _netlink_open_socket(NETLINK_GENERIC);
+      if ( s_iNetlinkGenericSocket < 0 )
+      {
+         log_softerror_and_alarm("[RadioCtrl] Failed to open generic netlink socket, error: %d", s_iNetlinkGenericSocket);
+         s_iNetlinkGenericSocket = -1;
+         s_uTimeLastNl80211ResolveFailed = get_current_timestamp_ms();
+         return -EOPNOTSUPP;
+      }
+   }
+
+   type_netlink_msg msg;
+   _netlink_msg_init(&msg, GENL_ID_CTRL, 0);
+   struct genlmsghdr* pGenHeader = (struct genlmsghdr*)_netlink_msg_reserve(&msg, GENL_HDRLEN);
+   pGenHeader->cmd = CTRL_CMD_GETFAMILY;
+   pGenHeader->version = 1;
+   _netlink_put_attr(&msg, CTRL_ATTR_FAMILY_NAME, NL80211_GENL_NAME, strlen(NL80211_GENL_NAME)+1);
+
+   int iFamilyId = -1;
+   int iRes = _netlink_transact(s_iNetlinkGenericSocket, &msg, _netlink_on_family_reply, &iFamilyId);
+   if ( (0 != iRes) || (iFamilyId <= 0) )
+   {
+      log_softerror_and_alarm("[RadioCtrl] nl80211 is not available (error %d), using iw/ip commands.", iRes);
+      s_uTimeLastNl80211ResolveFailed = get_current_timestamp_ms();
+      return -EOPNOTSUPP;
+   }
+   s_iNl80211FamilyId = iFamilyId;
+   s_uTimeLastNl80211ResolveFailed = 0;
+   log_line("[RadioCtrl] nl80211 family id: %d", s_iNl80211FamilyId);
+   return 0;
+}
+
+static int _netlink_route_open()
+{
+   if ( s_iNetlinkRouteSocket >= 0 )
+      return 0;
+   s_iNetlinkRouteSocket = _netlink_open_socket(NETLINK_ROUTE);
+   if ( s_iNetlinkRouteSocket < 0 )
+   {
+      log_softerror_and_alarm("[RadioCtrl] Failed to open rtnetlink socket, error: %d", s_iNetlinkRouteSocket);
+      s_iNetlinkRouteSocket = -1;
+      return -EOPNOTSUPP;
+   }
+   return 0;
+}
+
+// Builds, sends and waits for an nl80211 request on an interface. pfnAddAttrs adds the request attributes.
+static int _netlink_nl80211_ifindex_request(const char* szIfName, u8 uCommand, int (*pfnAddAttrs)(type_netlink_msg*, const void*), const void* pParams, netlink_msg_callback pfnCallback, void* pContext)
+{
+   u32 uIfIndex = if_nametoindex(szIfName);
+   if ( 0 == uIfIndex )
+      return -ENODEV;
+
+   pthread_mutex_lock(&s_MutexRadioCtrlNetlink);
+   int iRes = _netlink_nl80211_open();
+   if ( 0 == iRes )
+   {
+      type_netlink_msg msg;
+      _netlink_msg_init_nl80211(&msg, uCommand, 0);
+      iRes = _netlink_put_u32(&msg, NL80211_ATTR_IFINDEX, uIfIndex);
+      if ( (0 == iRes) && (NULL != pfnAddAttrs) )
+         iRes = pfnAddAttrs(&msg, pParams);
+      if ( 0 == iRes )
+         iRes = _netlink_transact(s_iNetlinkGenericSocket, &msg, pfnCallback, pContext);
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlNetlink);
+   return iRes;
+}
+
+static int _netlink_rtnl_setlink(const char* szIfName, u32 uFlags, u32 uFlagsChange, int iMTU)
+{
+   u32 uIfIndex = if_nametoindex(szIfName);
+   if ( 0 == uIfIndex )
+      return -ENODEV;
+
+   pthread_mutex_lock(&s_MutexRadioCtrlNetlink);
+   int iRes = _netlink_route_open();
+   if ( 0 == iRes )
+   {
+      type_netlink_msg msg;
+      _netlink_msg_init(&msg, RTM_NEWLINK, 0);
+      struct ifinfomsg* pInfo = (struct ifinfomsg*)_netlink_msg_reserve(&msg, sizeof(struct ifinfomsg));
+      pInfo->ifi_family = AF_UNSPEC;
+      pInfo->ifi_index = (int)uIfIndex;
+      pInfo->ifi_flags = uFlags;
+      pInfo->ifi_change = uFlagsChange;
+      if ( iMTU > 0 )
+         iRes = _netlink_put_u32(&msg, IFLA_MTU, (u32)iMTU);
+      if ( 0 == iRes )
+         iRes = _netlink_transact(s_iNetlinkRouteSocket, &msg, NULL, NULL);
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlNetlink);
+   return iRes;
+}
+
+//---------------------------------------------------------
+// Operations
+
+static int _radio_ctrl_netlink_set_link_up(const char* szIfName, int bUp)
+{
+   return _netlink_rtnl_setlink(szIfName, bUp?IFF_UP:0, IFF_UP, 0);
+}
+
+static int _radio_ctrl_netlink_set_mtu(const char* szIfName, int iMTU)
+{
+   if ( iMTU <= 0 )
+      return -EINVAL;
+   return _netlink_rtnl_setlink(szIfName, 0, 0, iMTU);
+}
+
+static int _netlink_add_iftype(type_netlink_msg* pMsg, const void* pParams)
+{
+   int iIfType = *((const int*)pParams);
+   return _netlink_put_u32(pMsg, NL80211_ATTR_IFTYPE, (iIfType == RADIO_CTRL_IFTYPE_MONITOR)?NL80211_IFTYPE_MONITOR:NL80211_IFTYPE_STATION);
+}
+
+static int _radio_ctrl_netlink_set_type(const char* szIfName, int iIfType)
+{
+   return _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_SET_INTERFACE, _netlink_add_iftype, &iIfType, NULL, NULL);
+}
+
+static int _netlink_add_monitor_flags(type_netlink_msg* pMsg, const void* pParams)
+{
+   u32 uMonitorFlags = *((const u32*)pParams);
+   int iRes = _netlink_put_u32(pMsg, NL80211_ATTR_IFTYPE, NL80211_IFTYPE_MONITOR);
+   int iNest = _netlink_nest_start(pMsg, NL80211_ATTR_MNTR_FLAGS);
+   if ( (0 != iRes) || (iNest < 0) )
+      return -ENOBUFS;
+   if ( uMonitorFlags & RADIO_CTRL_MONITOR_FLAG_FCSFAIL )
+      iRes = _netlink_put_attr(pMsg, NL80211_MNTR_FLAG_FCSFAIL, NULL, 0);
+   _netlink_nest_end(pMsg, iNest);
+   return iRes;
+}
+
+static int _radio_ctrl_netlink_set_monitor_flags(const char* szIfName, u32 uMonitorFlags)
+{
+   return _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_SET_INTERFACE, _netlink_add_monitor_flags, &uMonitorFlags, NULL, NULL);
+}
+
+typedef struct
+{
+   u32 uFreqKhz;
+   int iChannelType;
+} type_netlink_freq_params;
+
+static int _netlink_add_frequency(type_netlink_msg* pMsg, const void* pParams)
+{
+   const type_netlink_freq_params* pFreq = (const type_netlink_freq_params*)pParams;
+   int iRes = _netlink_put_u32(pMsg, NL80211_ATTR_WIPHY_FREQ, pFreq->uFreqKhz/1000);
+   if ( 0 == iRes )
+      iRes = _netlink_put_u32(pMsg, NL80211_ATTR_WIPHY_CHANNEL_TYPE, (pFreq->iChannelType == RADIO_CTRL_CHANNEL_HT40_PLUS)?NL80211_CHAN_HT40PLUS:NL80211_CHAN_NO_HT);
+   return iRes;
+}
+
+static int _radio_ctrl_netlink_set_frequency(const char* szIfName, u32 uFreqKhz, int iChannelType)
+{
+   type_netlink_freq_params params;
+   params.uFreqKhz = uFreqKhz;
+   params.iChannelType = iChannelType;
+   return _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_SET_WIPHY, _netlink_add_frequency, &params, NULL, NULL);
+}
+
+static int _netlink_add_txpower(type_netlink_msg* pMsg, const void* pParams)
+{
+   int iTxPowerMbm = *((const int*)pParams);
+   int iRes = _netlink_put_u32(pMsg, NL80211_ATTR_WIPHY_TX_POWER_SETTING, NL80211_TX_POWER_FIXED);
+   if ( 0 == iRes )
+      iRes = _netlink_put_u32(pMsg, NL80211_ATTR_WIPHY_TX_POWER_LEVEL, (u32)iTxPowerMbm);
+   return iRes;
+}
+
+static int _radio_ctrl_netlink_set_txpower(const char* szIfName, int iTxPowerMbm)
+{
+   return _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_SET_WIPHY, _netlink_add_txpower, &iTxPowerMbm, NULL, NULL);
+}
+
+typedef struct
+{
+   int iDataRate;
+   int bLongGuardInterval;
+} type_netlink_bitrate_params;
+
+// Same request as "iw dev x set bitrates legacy-2.4 n / ht-mcs-2.4 n [lgi-2.4]"
+static int _netlink_add_bitrate(type_netlink_msg* pMsg, const void* pParams)
+{
+   const type_netlink_bitrate_params* pRate = (const type_netlink_bitrate_params*)pParams;
+   int iNestRates = _netlink_nest_start(pMsg, NL80211_ATTR_TX_RATES);
+   int iNestBand = _netlink_nest_start(pMsg, NL80211_BAND_2GHZ);
+   if ( (iNestRates < 0) || (iNestBand < 0) )
+      return -ENOBUFS;
+   int iRes = 0;
+   if ( pRate->iDataRate > 0 )
+   {
+      // Legacy rates are in 500 kbps units
+      u8 uRate = (u8)(pRate->iDataRate/500000);
+      iRes = _netlink_put_attr(pMsg, NL80211_TXRATE_LEGACY, &uRate, 1);
+   }
+   else
+   {
+      // List of MCS indexes
+      u8 uMCS = (u8)(-pRate->iDataRate-1);
+      iRes = _netlink_put_attr(pMsg, NL80211_TXRATE_HT, &uMCS, 1);
+   }
+   if ( (0 == iRes) && pRate->bLongGuardInterval )
+      iRes = _netlink_put_u8(pMsg, NL80211_TXRATE_GI, NL80211_TXRATE_FORCE_LGI);
+   _netlink_nest_end(pMsg, iNestBand);
+   _netlink_nest_end(pMsg, iNestRates);
+   return iRes;
+}
+
+static int _radio_ctrl_netlink_set_bitrate(const char* szIfName, int iDataRate, int bLongGuardInterval)
+{
+   if ( (0 == iDataRate) || (iDataRate < -77) )
+      return -EINVAL;
+   type_netlink_bitrate_params params;
+   params.iDataRate = iDataRate;
+   params.bLongGuardInterval = bLongGuardInterval;
+   return _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_SET_TX_BITRATE_MASK, _netlink_add_bitrate, &params, NULL, NULL);
+}
+
+static int _netlink_add_rts_threshold(type_netlink_msg* pMsg, const void* pParams)
+{
+   int iThreshold = *((const int*)pParams);
+   return _netlink_put_u32(pMsg, NL80211_ATTR_WIPHY_RTS_THRESHOLD, (iThreshold < 0)?0xFFFFFFFF:(u32)iThreshold);
+}
+
+static int _radio_ctrl_netlink_set_rts_threshold(const char* szIfName, int iThreshold)
+{
+   return _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_SET_WIPHY, _netlink_add_rts_threshold, &iThreshold, NULL, NULL);
+}
+
+static int _netlink_on_interface_reply(struct nlmsghdr* pHeader, void* pContext)
+{
+   struct nlattr* pAttr = _netlink_find_attr(NETLINK_GENL_ATTRS(pHeader), NETLINK_GENL_ATTRS_LEN(pHeader), NL80211_ATTR_WIPHY);
+   if ( (NULL != pAttr) && (NETLINK_ATTR_LEN(pAttr) >= (int)sizeof(u32)) )
+      *((int*)pContext) = (int)*((u32*)NETLINK_ATTR_DATA(pAttr));
+   return 0;
+}
+
+static int _radio_ctrl_netlink_get_phy_index(const char* szIfName)
+{
+   int iPhyIndex = -1;
+   int iRes = _netlink_nl80211_ifindex_request(szIfName, NL80211_CMD_GET_INTERFACE, NULL, NULL, _netlink_on_interface_reply, &iPhyIndex);
+   if ( 0 != iRes )
+      return iRes;
+   if ( iPhyIndex < 0 )
+      return -ENODEV;
+   return iPhyIndex;
+}
+
+typedef struct
+{
+   u32 uPhyIndex;
+   u32* puFreqsMhz;
+   int iMaxCount;
+   int iCount;
+} type_netlink_phy_freqs_context;
+
+static int _netlink_on_wiphy_reply(struct nlmsghdr* pHeader, void* pContext)
+{
+   type_netlink_phy_freqs_context* pFreqs = (type_netlink_phy_freqs_context*)pContext;
+   void* pAttrs = NETLINK_GENL_ATTRS(pHeader);
+   int iAttrsLen = NETLINK_GENL_ATTRS_LEN(pHeader);
+
+   struct nlattr* pAttr = _netlink_find_attr(pAttrs, iAttrsLen, NL80211_ATTR_WIPHY);
+   if ( (NULL == pAttr) || (*((u32*)NETLINK_ATTR_DATA(pAttr)) != pFreqs->uPhyIndex) )
+      return 0;
+   struct nlattr* pBands = _netlink_find_attr(pAttrs, iAttrsLen, NL80211_ATTR_WIPHY_BANDS);
+   if ( NULL == pBands )
+      return 0;
+
+   // Bands -> band -> freqs -> freq -> NL80211_FREQUENCY_ATTR_FREQ
+   int iBandsLeft = NETLINK_ATTR_LEN(pBands);
+   struct nlattr* pBand = (struct nlattr*)NETLINK_ATTR_DATA(pBands);
+   while ( (iBandsLeft >= NLA_HDRLEN) && (pBand->nla_len >= NLA_HDRLEN) && (pBand->nla_len <= iBandsLeft) )
+   {
+      struct nlattr* pFreqsList = _netlink_find_attr(NETLINK_ATTR_DATA(pBand), NETLINK_ATTR_LEN(pBand), NL80211_BAND_ATTR_FREQS);
+      if ( NULL != pFreqsList )
+      {
+         int iFreqsLeft = NETLINK_ATTR_LEN(pFreqsList);
+         struct nlattr* pFreq = (struct nlattr*)NETLINK_ATTR_DATA(pFreqsList);
+         while ( (iFreqsLeft >= NLA_HDRLEN) && (pFreq->nla_len >= NLA_HDRLEN) && (pFreq->nla_len <= iFreqsLeft) )
+         {
+            struct nlattr* pValue = _netlink_find_attr(NETLINK_ATTR_DATA(pFreq), NETLINK_ATTR_LEN(pFreq), NL80211_FREQUENCY_ATTR_FREQ);
+            if ( NULL != pValue )
+            {
+               if ( pFreqs->iCount < pFreqs->iMaxCount )
+                  pFreqs->puFreqsMhz[pFreqs->iCount] = *((u32*)NETLINK_ATTR_DATA(pValue));
+               pFreqs->iCount++;
+            }
+            iFreqsLeft -= NLA_ALIGN(pFreq->nla_len);
+            pFreq = (struct nlattr*)(((u8*)pFreq) + NLA_ALIGN(pFreq->nla_len));
+         }
+      }
+      iBandsLeft -= NLA_ALIGN(pBand->nla_len);
+      pBand = (struct nlattr*)(((u8*)pBand) + NLA_ALIGN(pBand->nla_len));
+   }
+   return 0;
+}
+
+static int _radio_ctrl_netlink_get_phy_frequencies(int iPhyIndex, u32* puFreqsMhz, int iMaxCount)
+{
+   type_netlink_phy_freqs_context context;
+   context.uPhyIndex = (u32)iPhyIndex;
+   context.puFreqsMhz = puFreqsMhz;
+   context.iMaxCount = iMaxCount;
+   context.iCount = 0;
+
+   pthread_mutex_lock(&s_MutexRadioCtrlNetlink);
+   int iRes = _netlink_nl80211_open();
+   if ( 0 == iRes )
+   {
+      // Split dump: the band info of a phy does not fit in a single message on newer kernels
+      type_netlink_msg msg;
+      _netlink_msg_init_nl80211(&msg, NL80211_CMD_GET_WIPHY, NLM_F_DUMP);
+      iRes = _netlink_put_u32(&msg, NL80211_ATTR_WIPHY, (u32)iPhyIndex);
+      if ( 0 == iRes )
+         iRes = _netlink_put_attr(&msg, NL80211_ATTR_SPLIT_WIPHY_DUMP, NULL, 0);
+      if ( 0 == iRes )
+         iRes = _netlink_transact(s_iNetlinkGenericSocket, &msg, _netlink_on_wiphy_reply, &context);
+   }
+   pthread_mutex_unlock(&s_MutexRadioCtrlNetlink);
+   if ( 0 != iRes )
+      return iRes;
+   if ( 0 == context.iCount )
+      return -ENODEV;
+   return context.iCount;
+}
+
+static int _radio_ctrl_netlink_get_mac_address(const char* szIfName, char* szMAC, int iMaxLength)
+{
+   char szFile[128];
+   snprintf(szFile, sizeof(szFile)/sizeof(szFile[0]), "/sys/class/net/%s/address", szIfName);
+   int fd = open(szFile, O_RDONLY | O_CLOEXEC);
+   if ( fd < 0 )
+      return -ENODEV;
+   char szBuff[64];
+   int iRead = read(fd, szBuff, sizeof(szBuff)-1);
+   close(fd);
+   if ( iRead <= 0 )
+      return -EIO;
+   szBuff[iRead] = 0;
+   removeTrailingNewLines(szBuff);
+   strncpy(szMAC, szBuff, iMaxLength-1);
+   szMAC[iMaxLength-1] = 0;
+   return 0;
+}
+
+const type_radio_ctrl_backend g_RadioCtrlBackendNetlink =
+{
+   "netlink",
+   _radio_ctrl_netlink_set_link_up,
+   _radio_ctrl_netlink_set_mtu,
+   _radio_ctrl_netlink_set_type,
+   _radio_ctrl_netlink_set_monitor_flags,
+   _radio_ctrl_netlink_set_frequency,
+   _radio_ctrl_netlink_set_txpower,
+   _radio_ctrl_netlink_set_bitrate,
+   _radio_ctrl_netlink_set_rts_threshold,
+   _radio_ctrl_netlink_get_phy_index,
+   _radio_ctrl_netlink_get_phy_frequencies,
+   _radio_ctrl_netlink_get_mac_address
+};
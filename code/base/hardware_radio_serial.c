@@ -182,6 +182,7 @@ int hardware_radio_serial_open_for_read_write(int iHWRadioInterfaceIndex)
    pRadioInfo->openedForWrite = 1;
    pRadioInfo->openedForRead = 1;
    pRadioInfo->runtimeInterfaceInfoRx.selectable_fd = iSerialPortFD;
+   pRadioInfo->runtimeInterfaceInfoRx.uOpenId = hardware_radio_get_new_open_id();
    pRadioInfo->runtimeInterfaceInfoTx.selectable_fd = iSerialPortFD;
 
    log_line("[HardwareRadio] Opened serial radio interface %d for read/write. fd=%d", iHWRadioInterfaceIndex+1, iSerialPortFD);
@@ -35,6 +35,8 @@
 #include "models.h"
 #include <stdlib.h>
 #include <math.h>
+#include <sys/stat.h>
+#include <new>
 #include "config.h"
 #include "ctrl_preferences.h"
 #include "hardware.h"
@@ -42,6 +44,7 @@
 #include "hardware_camera.h"
 #include "hardware_procs.h"
 #include "hardware_i2c.h"
+#include "shared_mem.h"
 #include "camera_utils.h"
 #include "utils.h"
 #include "../common/string_utils.h"
@@ -50,6 +53,59 @@
 
 #define MODEL_FILE_STAMP_ID "vVIII.3stamp"
 
+// Binary snapshot of the text model file, written next to it (*.snp).
+// Holds the model state exactly as the text loader produces it, so it can be
+// loaded with a single read. The text file stays the source of truth: the snapshot
+// is used only if it matches the text file save counter, size and modification time.
+#define MODEL_SNAPSHOT_MAGIC 0x4E534D52 // "RMSN"
+#define MODEL_SNAPSHOT_FORMAT_VERSION 1
+#define MODEL_SNAPSHOT_MAX_SIZE 1000000
+
+typedef struct
+{
+   u32 uMagic;
+   u32 uFormatVersion;
+   u32 uLayoutSignature;
+   u32 uSWVersion;
+   int iTextFileVersion;
+   int iTextFileSaveCount;
+   u32 uTextFileSize;
+   u32 uTextFileMTimeSec;
+   u32 uTextFileMTimeNSec;
+   u32 uPayloadSize;
+   u32 uPayloadCRC;
+} type_model_snapshot_header;
+
+// Persistent members stored in the snapshot, in order, and the model section each one belongs to
+#define MODEL_SNAPSHOT_MEMBERS(X) \
+   X(uModelFlags, MODEL_SECTION_GENERAL) X(uModelPersistentStatusFlags, MODEL_SECTION_GENERAL) X(uDeveloperFlags, MODEL_SECTION_GENERAL) \
+   X(hwCapabilities, MODEL_SECTION_HARDWARE) X(vehicle_name, MODEL_SECTION_GENERAL) X(uVehicleId, MODEL_SECTION_GENERAL) \
+   X(uControllerId, MODEL_SECTION_GENERAL) X(uControllerBoardType, MODEL_SECTION_GENERAL) X(sw_version, MODEL_SECTION_GENERAL) \
+   X(is_spectator, MODEL_SECTION_GENERAL) X(vehicle_type, MODEL_SECTION_GENERAL) X(rxtx_sync_type, MODEL_SECTION_GENERAL) \
+   X(alarms, MODEL_SECTION_ALARMS) X(hardwareInterfacesInfo, MODEL_SECTION_HARDWARE) X(processesPriorities, MODEL_SECTION_PROCESSES) \
+   X(radioInterfacesParams, MODEL_SECTION_RADIO_INTERFACES) X(radioLinksParams, MODEL_SECTION_RADIO_LINKS) \
+   X(radioRuntimeCapabilities, MODEL_SECTION_RADIO_LINKS) X(enableDHCP, MODEL_SECTION_GENERAL) X(camera_rc_channels, MODEL_SECTION_CAMERA) \
+   X(enc_flags, MODEL_SECTION_GENERAL) X(m_Stats, MODEL_SECTION_STATS) X(iGPSCount, MODEL_SECTION_TELEMETRY) \
+   X(camera_params, MODEL_SECTION_CAMERA) X(iCameraCount, MODEL_SECTION_CAMERA) X(iCurrentCamera, MODEL_SECTION_CAMERA) \
+   X(video_params, MODEL_SECTION_VIDEO) X(video_link_profiles, MODEL_SECTION_VIDEO) X(osd_params, MODEL_SECTION_OSD) \
+   X(rc_params, MODEL_SECTION_RC) X(telemetry_params, MODEL_SECTION_TELEMETRY) X(audio_params, MODEL_SECTION_AUDIO) \
+   X(functions_params, MODEL_SECTION_FUNCTIONS) X(relay_params, MODEL_SECTION_RELAY) X(alarms_params, MODEL_SECTION_ALARMS)
+
+// Chunks of the model pointed by pChunksModel
+#define MODEL_SNAPSHOT_MEMBER_CHUNK(m, section) { (u8*)&(pChunksModel->m), (int)sizeof(pChunksModel->m), section },
+
+typedef struct
+{
+   u8* pData;
+   int iSize;
+   u32 uSection;
+} type_model_snapshot_chunk;
+
+static bool s_bModelUseSnapshotFiles = true;
+
+static type_model_changes_info* s_pModelChangesInfo = NULL;
+static u32 s_uTimeLastModelChangesInfoOpenAttempt = 0;
+
 static const char* s_szModelFlightModeNONE = "NONE";
 static const char* s_szModelFlightModeMAN  = "MAN";
 static const char* s_szModelFlightModeSTAB = "STAB";
@@ -212,6 +268,7 @@ Model::Model(void)
    memset((u8*)&m_Stats, 0, sizeof(type_vehicle_stats_info));
 
    iSaveCount = 0;
+   uLastChangesGeneration = 0;
    b_mustSyncFromVehicle = false;
    iCameraCount = 0;
    iCurrentCamera = -1;
@@ -277,25 +334,84 @@ bool Model::isRunningOnRadxaHardware()
    return false;
 }
 
+// Reads the file version and save counter from the start of a text model file
+static bool _model_read_text_file_header(const char* szFile, int* piVersion, int* piSaveCount)
+{
+   FILE* fd = fopen(szFile, "r");
+   if ( NULL == fd )
+      return false;
+
+   char szStamp[64];
+   bool bOk = false;
+   if ( 1 == fscanf(fd, "%*s %d", piVersion) )
+   if ( 1 == fscanf(fd, "%63s", szStamp) )
+   if ( 1 == fscanf(fd, "%*s %d", piSaveCount) )
+      bOk = true;
+   fclose(fd);
+   return bOk;
+}
+
 bool Model::reloadIfChanged(bool bLoadStats)
 {
    char szFile[MAX_FILE_PATH_SIZE];
    strcpy(szFile, FOLDER_CONFIG);
    strcat(szFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
-   FILE* fd = fopen(szFile, "r");
-   if ( NULL == fd )
-      return false;
 
-   int iV, iS = 0;
-   if ( 1 == fscanf(fd, "%*s %d", &iV) )
-   if ( 1 == fscanf(fd, "%*s %d", &iS) )
-   if ( iS != iSaveCount )
+   type_model_changes_info changesInfo;
+   if ( ! model_get_changes_info(&changesInfo) )
    {
-      log_line("Model: changed. Reload");
-      fclose(fd);
-      return loadFromFile(szFile, bLoadStats);
+      // No changes notifications, check the model file itself
+      int iV = 0, iS = 0;
+      if ( ! _model_read_text_file_header(szFile, &iV, &iS) )
+         return false;
+
+      if ( iS != iSaveCount )
+      {
+         log_line("Model: changed. Reload");
+         return loadFromFile(szFile, bLoadStats);
+      }
+      return true;
    }
-   fclose(fd);
+   return reloadChanges(szFile, &changesInfo, bLoadStats);
+}
+
+bool Model::reloadChanges(const char* szFile, const type_model_changes_info* pChangesInfo, bool bLoadStats)
+{
+   if ( pChangesInfo->uGeneration == uLastChangesGeneration )
+      return true;
+   uLastChangesGeneration = pChangesInfo->uGeneration;
+
+   // Already up to date (loaded or saved after this change)
+   if ( (pChangesInfo->uVehicleId == uVehicleId) && (pChangesInfo->iSaveCount == iSaveCount) )
+      return true;
+
+   log_line("Model: changed by %s (PID %d), save count %d -> %d, changed sections: %s. Reload.",
+      pChangesInfo->szChangedByProcess, pChangesInfo->iChangedByPID, iSaveCount, pChangesInfo->iSaveCount,
+      model_get_sections_description(pChangesInfo->uChangedSections));
+
+   // This model is the one before the change: reload only what changed
+   if ( (pChangesInfo->uVehicleId == uVehicleId) && (pChangesInfo->iPreviousSaveCount == iSaveCount) )
+   if ( reloadSections(szFile, pChangesInfo->uChangedSections, pChangesInfo->iSaveCount, bLoadStats) )
+      return true;
+
+   return loadFromFile(szFile, bLoadStats);
+}
+
+bool Model::reloadSections(const char* szFile, u32 uSections, int iSaveCountAfterChanges, bool bLoadStats)
+{
+   type_vehicle_stats_info stats;
+   memcpy((u8*)&stats, (u8*)&m_Stats, sizeof(type_vehicle_stats_info));
+
+   // The file can already be saved again after this change (back to back saves): the snapshot
+   // then holds more changes than uSections, so a partial copy would miss them.
+   if ( ! loadSnapshot(szFile, uSections, iSaveCountAfterChanges) )
+      return false;
+
+   if ( ! bLoadStats ) 
+      memcpy((u8*)&m_Stats, (u8*)&stats, sizeof(type_vehicle_stats_info));
+   validate_settings();
+   constructLongName();
+   log_line("Model: reloaded sections: %s; save count: %d", model_get_sections_description(uSections), iSaveCount);
    return true;
 }
 
@@ -320,7 +436,12 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
 
    int iVersionMain = 0;
    int iVersionBackup = 0;
-   FILE* fd = fopen(szFileNormal, "r");
+   FILE* fd = NULL;
+   bool bFromSnapshot = loadSnapshot(szFileNormal);
+   if ( bFromSnapshot )
+      bMainFileLoadedOk = true;
+   else
+      fd = fopen(szFileNormal, "r");
    if ( NULL != fd )
    {
       if ( 1 != fscanf(fd, "%*s %d", &iVersionMain) )
@@ -341,9 +462,9 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
             log_softerror_and_alarm("Invalid vehicle configuration file: %s",szFileNormal);
       }
       fclose(fd);
+      if ( bMainFileLoadedOk )
+         saveSnapshot(szFileNormal);
    }
-   else
-      bMainFileLoadedOk = false;
 
    if ( bMainFileLoadedOk )
    {
@@ -359,8 +480,9 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
       strcpy(szFreq2, str_format_frequency(radioLinksParams.link_frequency_khz[1]));
       strcpy(szFreq3, str_format_frequency(radioLinksParams.link_frequency_khz[2]));
 
-      log_line("Loaded vehicle (%s) successfully from file: %s; name: [%s], VID: %u, %s, software: %d.%d (b%d), on time: %02d:%02d",
+      log_line("Loaded vehicle (%s) successfully (%u ms, from %s) from file: %s; name: [%s], VID: %u, %s, software: %d.%d (b%d), on time: %02d:%02d",
          bLoadStats?"with stats":"without stats",
+         timeStart, bFromSnapshot?"snapshot":"text file",
          filename, vehicle_name, uVehicleId, 
          is_spectator?"spectator mode": "control mode",
          (sw_version >> 8) & 0xFF, sw_version & 0xFF, sw_version>>16,
@@ -419,6 +541,9 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
       saveVersion10(fd, false);
       fclose(fd);
       log_line("Restored main model file from backup model file.");
+      int iPreviousSaveCount = -1;
+      u32 uChangedSections = updateSnapshotFromTextFile(szFileNormal, &iPreviousSaveCount);
+      notifyChanges(szFileNormal, uChangedSections, iPreviousSaveCount);
    }
    else
       log_softerror_and_alarm("Failed to write main model file from backup model file.");
@@ -426,6 +551,432 @@ bool Model::loadFromFile(const char* filename, bool bLoadStats)
    return true;
 }
 
+// Parses only the given text file: no snapshot, no backup file fallback, nothing is written
+bool Model::loadFromFileReadOnly(const char* filename)
+{
+   FILE* fd = fopen(filename, "r");
+   if ( NULL == fd )
+   {
+      log_softerror_and_alarm("Load model (read only): can't open file: %s", filename);
+      return false;
+   }
+   int iVersion = 0;
+   bool bOk = false;
+   if ( (1 == fscanf(fd, "%*s %d", &iVersion)) && (10 == iVersion) )
+      bOk = loadVersion10(fd);
+   fclose(fd);
+   if ( ! bOk )
+   {
+      log_softerror_and_alarm("Load model (read only): invalid vehicle configuration file: %s", filename);
+      return false;
+   }
+   iLoadedFileVersion = iVersion;
+   validate_settings();
+   constructLongName();
+   log_line("Loaded vehicle (read only) from file: %s; name: [%s], VID: %u", filename, vehicle_name, uVehicleId);
+   return true;
+}
+
+static void _model_get_snapshot_file_name(const char* szTextFile, char* szSnapshotFile)
+{
+   strcpy(szSnapshotFile, szTextFile);
+   int iLen = strlen(szSnapshotFile);
+   if ( (iLen > 4) && (szSnapshotFile[iLen-4] == '.') )
+      strcpy(&szSnapshotFile[iLen-3], "snp");
+   else
+      strcat(szSnapshotFile, ".snp");
+}
+
+static u32 _model_get_snapshot_layout_signature(type_model_snapshot_chunk* pChunks, int iCount)
+{
+   u32 uSignature = base_compute_crc32((u8*)MODEL_FILE_STAMP_ID, strlen(MODEL_FILE_STAMP_ID));
+   for( int i=0; i<iCount; i++ )
+      uSignature = base_compute_crc32_continue(uSignature, (u8*)&(pChunks[i].iSize), sizeof(int));
+   return uSignature;
+}
+
+void model_set_snapshot_files_enabled(bool bEnabled)
+{
+   s_bModelUseSnapshotFiles = bEnabled;
+}
+
+// Reads and validates a snapshot file (format, layout, CRC), without checking it against the text file.
+// Returns a buffer to be freed by the caller, or NULL (and the reason, if the file exists but is not valid)
+static u8* _model_read_snapshot_file(const char* szSnapshotFile, type_model_snapshot_chunk* pChunks, int iChunks, const char** pszReason)
+{
+   *pszReason = NULL;
+   int fdSnapshot = open(szSnapshotFile, O_RDONLY);
+   if ( fdSnapshot < 0 )
+      return NULL;
+
+   struct stat statSnapshot;
+   if ( (0 != fstat(fdSnapshot, &statSnapshot)) || (statSnapshot.st_size < (int)sizeof(type_model_snapshot_header)) || (statSnapshot.st_size > MODEL_SNAPSHOT_MAX_SIZE) )
+   {
+      close(fdSnapshot);
+      *pszReason = "invalid size";
+      return NULL;
+   }
+
+   int iFileSize = (int)statSnapshot.st_size;
+   u8* pBuffer = (u8*) malloc(iFileSize);
+   if ( NULL == pBuffer )
+   {
+      close(fdSnapshot);
+      *pszReason = "out of memory";
+      return NULL;
+   }
+   int iRead = read(fdSnapshot, pBuffer, iFileSize);
+   close(fdSnapshot);
+
+   int iPayloadSize = 0;
+   for( int i=0; i<iChunks; i++ )
+      iPayloadSize += pChunks[i].iSize;
+
+   type_model_snapshot_header* pHeader = (type_model_snapshot_header*)pBuffer;
+   u8* pPayload = pBuffer + sizeof(type_model_snapshot_header);
+
+   if ( iRead != iFileSize )
+      *pszReason = "read error";
+   else if ( (pHeader->uMagic != MODEL_SNAPSHOT_MAGIC) || (pHeader->uFormatVersion != MODEL_SNAPSHOT_FORMAT_VERSION) )
+      *pszReason = "invalid format";
+   else if ( (pHeader->uLayoutSignature != _model_get_snapshot_layout_signature(pChunks, iChunks)) || (pHeader->uSWVersion != (u32)SYSTEM_SW_BUILD_NUMBER) )
+      *pszReason = "different software version";
+   else if ( ((int)pHeader->uPayloadSize != iPayloadSize) || (iFileSize != (int)sizeof(type_model_snapshot_header) + iPayloadSize) )
+      *pszReason = "invalid size";
+   else if ( pHeader->uPayloadCRC != base_compute_crc32(pPayload, iPayloadSize) )
+      *pszReason = "invalid CRC";
+
+   if ( NULL != *pszReason )
+   {
+      free(pBuffer);
+      return NULL;
+   }
+   return pBuffer;
+}
+
+static type_model_changes_info* _model_changes_info_open()
+{
+   if ( NULL != s_pModelChangesInfo )
+      return s_pModelChangesInfo;
+
+   u32 uTimeNow = get_current_timestamp_ms();
+   if ( (0 != s_uTimeLastModelChangesInfoOpenAttempt) && (uTimeNow < s_uTimeLastModelChangesInfoOpenAttempt + 5000) )
+      return NULL;
+   s_uTimeLastModelChangesInfoOpenAttempt = uTimeNow;
+
+   // Any process can save the model, so all open it for read/write.
+   // Not using open_shared_mem_for_write() as it clears the content.
+   int fd = shm_open(SHARED_MEM_MODEL_CHANGES, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR);
+   if ( fd < 0 )
+   {
+      log_softerror_and_alarm("Model: Failed to open model changes shared memory, error: %d (%s)", errno, strerror(errno));
+      return NULL;
+   }
+   struct stat statMem;
+   if ( (0 != fstat(fd, &statMem)) ||
+        ((statMem.st_size < (int)sizeof(type_model_changes_info)) && (0 != ftruncate(fd, sizeof(type_model_changes_info)))) )
+   {
+      log_softerror_and_alarm("Model: Failed to init model changes shared memory, error: %d (%s)", errno, strerror(errno));
+      close(fd);
+      return NULL;
+   }
+   void* pMem = mmap(NULL, sizeof(type_model_changes_info), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+   close(fd);
+   if ( MAP_FAILED == pMem )
+   {
+      log_softerror_and_alarm("Model: Failed to map model changes shared memory.");
+      return NULL;
+   }
+   s_pModelChangesInfo = (type_model_changes_info*)pMem;
+   return s_pModelChangesInfo;
+}
+
+bool model_get_changes_info(type_model_changes_info* pOutput)
+{
+   type_model_changes_info* pInfo = _model_changes_info_open();
+   if ( (NULL == pInfo) || (NULL == pOutput) )
+      return false;
+
+   for( int i=0; i<100; i++ )
+   {
+      u32 uGeneration = pInfo->uGeneration;
+      if ( uGeneration & 1 )
+      {
+         hardware_sleep_micros(50);
+         continue;
+      }
+      __sync_synchronize();
+      memcpy((void*)pOutput, (const void*)pInfo, sizeof(type_model_changes_info));
+      __sync_synchronize();
+      if ( pInfo->uGeneration == uGeneration )
+      {
+         pOutput->uGeneration = uGeneration;
+         return true;
+      }
+   }
+   return false;
+}
+
+const char* model_get_sections_description(u32 uSections)
+{
+   static char s_szModelSectionsDescription[256];
+   static const char* s_szModelSectionsNames[] = { "general", "hardware", "processes", "radio interfaces", "radio links", "stats",
+      "camera", "video", "OSD", "RC", "telemetry", "audio", "functions", "relay", "alarms" };
+
+   if ( (uSections & MODEL_SECTIONS_ALL) == MODEL_SECTIONS_ALL )
+      return "all";
+   s_szModelSectionsDescription[0] = 0;
+   for( int i=0; i<(int)(sizeof(s_szModelSectionsNames)/sizeof(s_szModelSectionsNames[0])); i++ )
+   {
+      if ( ! (uSections & (((u32)1) << i)) )
+         continue;
+      if ( 0 != s_szModelSectionsDescription[0] )
+         strcat(s_szModelSectionsDescription, ", ");
+      strcat(s_szModelSectionsDescription, s_szModelSectionsNames[i]);
+   }
+   if ( 0 == s_szModelSectionsDescription[0] )
+      return "none";
+   return s_szModelSectionsDescription;
+}
+
+void Model::notifyChanges(const char* szFile, u32 uChangedSections, int iPreviousSaveCount)
+{
+   // Only the current vehicle model changes are notified
+   char szCurrentModelFile[MAX_FILE_PATH_SIZE];
+   strcpy(szCurrentModelFile, FOLDER_CONFIG);
+   strcat(szCurrentModelFile, FILE_CONFIG_CURRENT_VEHICLE_MODEL);
+   if ( 0 != strcmp(szFile, szCurrentModelFile) )
+      return;
+
+   type_model_changes_info* pInfo = _model_changes_info_open();
+   if ( NULL == pInfo )
+      return;
+
+   u32 uGeneration = 0;
+   int iRetries = 1000;
+   while ( true )
+   {
+      uGeneration = pInfo->uGeneration;
+      if ( (!(uGeneration & 1)) && __sync_bool_compare_and_swap(&(pInfo->uGeneration), uGeneration, uGeneration+1) )
+         break;
+      iRetries--;
+      if ( iRetries <= 0 )
+      {
+         // A process died while updating the info
+         uGeneration = pInfo->uGeneration & (~((u32)1));
+         pInfo->uGeneration = uGeneration + 1;
+         break;
+      }
+      hardware_sleep_micros(50);
+   }
+   __sync_synchronize();
+
+   pInfo->uVehicleId = uVehicleId;
+   pInfo->iSaveCount = iSaveCount;
+   pInfo->iPreviousSaveCount = iPreviousSaveCount;
+   pInfo->uChangedSections = uChangedSections;
+   pInfo->uTimeChanged = get_current_timestamp_ms();
+   pInfo->iChangedByPID = (int)getpid();
+   strncpy(pInfo->szChangedByProcess, log_get_component_name(), sizeof(pInfo->szChangedByProcess)-1);
+   pInfo->szChangedByProcess[sizeof(pInfo->szChangedByProcess)-1] = 0;
+
+   __sync_synchronize();
+   pInfo->uGeneration = uGeneration + 2;
+   uLastChangesGeneration = uGeneration + 2;
+   log_line("Model: notified model changes (generation %u, save count %d), changed sections: %s", uGeneration + 2, iSaveCount, model_get_sections_description(uChangedSections));
+}
+
+bool Model::loadSnapshot(const char* szTextFile, u32 uSections, int iExpectedSaveCount)
+{
+   if ( ! s_bModelUseSnapshotFiles )
+      return false;
+
+   char szSnapshotFile[MAX_FILE_PATH_SIZE];
+   _model_get_snapshot_file_name(szTextFile, szSnapshotFile);
+
+   struct stat statText;
+   if ( 0 != stat(szTextFile, &statText) )
+      return false;
+
+   Model* pChunksModel = this;
+   type_model_snapshot_chunk chunks[] = { MODEL_SNAPSHOT_MEMBERS(MODEL_SNAPSHOT_MEMBER_CHUNK) };
+   int iChunks = sizeof(chunks)/sizeof(chunks[0]);
+
+   const char* szReason = NULL;
+   u8* pBuffer = _model_read_snapshot_file(szSnapshotFile, chunks, iChunks, &szReason);
+   type_model_snapshot_header* pHeader = (type_model_snapshot_header*)pBuffer;
+
+   if ( NULL != pBuffer )
+   {
+      int iV = 0, iS = 0;
+      if ( (pHeader->uTextFileSize != (u32)statText.st_size) ||
+           (pHeader->uTextFileMTimeSec != (u32)statText.st_mtim.tv_sec) ||
+           (pHeader->uTextFileMTimeNSec != (u32)statText.st_mtim.tv_nsec) )
+         szReason = "text file changed";
+      else if ( (! _model_read_text_file_header(szTextFile, &iV, &iS)) || (iV != pHeader->iTextFileVersion) || (iS != pHeader->iTextFileSaveCount) )
+         szReason = "different save counter";
+      else if ( (iExpectedSaveCount >= 0) && (iExpectedSaveCount != pHeader->iTextFileSaveCount) )
+         szReason = "saved again since the change";
+   }
+
+   if ( (NULL == pBuffer) || (NULL != szReason) )
+   {
+      if ( NULL != szReason )
+         log_line("Model: snapshot %s not used (%s), loading text file.", szSnapshotFile, szReason);
+      if ( NULL != pBuffer )
+         free(pBuffer);
+      return false;
+   }
+
+   u8* pSrc = pBuffer + sizeof(type_model_snapshot_header);
+   for( int i=0; i<iChunks; i++ )
+   {
+      if ( chunks[i].uSection & uSections )
+         memcpy(chunks[i].pData, pSrc, chunks[i].iSize);
+      pSrc += chunks[i].iSize;
+   }
+   iSaveCount = pHeader->iTextFileSaveCount;
+   iLoadedFileVersion = pHeader->iTextFileVersion;
+   free(pBuffer);
+
+   // Same as the text loader
+   if ( hardware_is_vehicle() )
+      sw_version = (SYSTEM_SW_VERSION_MAJOR * 256 + SYSTEM_SW_VERSION_MINOR) | (SYSTEM_SW_BUILD_NUMBER<<16);
+   return true;
+}
+
+// Must be called right after loading the text file, so the model holds what the text loader produced
+bool Model::saveSnapshot(const char* szTextFile)
+{
+   if ( ! s_bModelUseSnapshotFiles )
+      return false;
+
+   struct stat statText;
+   if ( 0 != stat(szTextFile, &statText) )
+      return false;
+
+   Model* pChunksModel = this;
+   type_model_snapshot_chunk chunks[] = { MODEL_SNAPSHOT_MEMBERS(MODEL_SNAPSHOT_MEMBER_CHUNK) };
+   int iChunks = sizeof(chunks)/sizeof(chunks[0]);
+   int iPayloadSize = 0;
+   for( int i=0; i<iChunks; i++ )
+      iPayloadSize += chunks[i].iSize;
+
+   int iFileSize = sizeof(type_model_snapshot_header) + iPayloadSize;
+   u8* pBuffer = (u8*) malloc(iFileSize);
+   if ( NULL == pBuffer )
+      return false;
+
+   type_model_snapshot_header* pHeader = (type_model_snapshot_header*)pBuffer;
+   u8* pPayload = pBuffer + sizeof(type_model_snapshot_header);
+   u8* pDest = pPayload;
+   for( int i=0; i<iChunks; i++ )
+   {
+      memcpy(pDest, chunks[i].pData, chunks[i].iSize);
+      pDest += chunks[i].iSize;
+   }
+
+   memset(pHeader, 0, sizeof(type_model_snapshot_header));
+   pHeader->uMagic = MODEL_SNAPSHOT_MAGIC;
+   pHeader->uFormatVersion = MODEL_SNAPSHOT_FORMAT_VERSION;
+   pHeader->uLayoutSignature = _model_get_snapshot_layout_signature(chunks, iChunks);
+   pHeader->uSWVersion = SYSTEM_SW_BUILD_NUMBER;
+   pHeader->iTextFileVersion = iLoadedFileVersion;
+   pHeader->iTextFileSaveCount = iSaveCount;
+   pHeader->uTextFileSize = (u32)statText.st_size;
+   pHeader->uTextFileMTimeSec = (u32)statText.st_mtim.tv_sec;
+   pHeader->uTextFileMTimeNSec = (u32)statText.st_mtim.tv_nsec;
+   pHeader->uPayloadSize = iPayloadSize;
+   pHeader->uPayloadCRC = base_compute_crc32(pPayload, iPayloadSize);
+
+   // Write to a per process temp file and rename it, so readers never see a partial snapshot
+   char szSnapshotFile[MAX_FILE_PATH_SIZE];
+   char szTmpFile[MAX_FILE_PATH_SIZE+32];
+   _model_get_snapshot_file_name(szTextFile, szSnapshotFile);
+   snprintf(szTmpFile, sizeof(szTmpFile), "%s.%d.tmp", szSnapshotFile, (int)getpid());
+
+   bool bOk = false;
+   int fdSnapshot = open(szTmpFile, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if ( fdSnapshot >= 0 )
+   {
+      bOk = (iFileSize == write(fdSnapshot, pBuffer, iFileSize));
+      close(fdSnapshot);
+      if ( bOk )
+         bOk = (0 == rename(szTmpFile, szSnapshotFile));
+      if ( ! bOk )
+         unlink(szTmpFile);
+   }
+   free(pBuffer);
+
+   if ( ! bOk )
+   {
+      log_softerror_and_alarm("Model: Failed to write snapshot file %s, error: %d (%s)", szSnapshotFile, errno, strerror(errno));
+      unlink(szSnapshotFile);
+   }
+   return bOk;
+}
+
+// The in memory model can differ from what the text loader produces (validated and
+// runtime changed values), so the snapshot is built from the text file just saved.
+// Returns the model sections that changed compared to the previous snapshot
+// (all of them if unknown) and the save counter of the previous snapshot (-1 if unknown).
+u32 Model::updateSnapshotFromTextFile(const char* szTextFile, int* piPreviousSaveCount)
+{
+   if ( NULL != piPreviousSaveCount )
+      *piPreviousSaveCount = -1;
+   if ( ! s_bModelUseSnapshotFiles )
+      return MODEL_SECTIONS_ALL;
+
+   FILE* fd = fopen(szTextFile, "r");
+   if ( NULL == fd )
+      return MODEL_SECTIONS_ALL;
+
+   // Zeroed memory, so unused bytes (strings, padding) are the same in all snapshots
+   void* pMemory = calloc(1, sizeof(Model));
+   if ( NULL == pMemory )
+   {
+      fclose(fd);
+      return MODEL_SECTIONS_ALL;
+   }
+   Model* pParsedModel = new (pMemory) Model();
+   int iVersion = 0;
+   bool bOk = false;
+   if ( (1 == fscanf(fd, "%*s %d", &iVersion)) && (10 == iVersion) )
+      bOk = pParsedModel->loadVersion10(fd);
+   fclose(fd);
+
+   u32 uChangedSections = MODEL_SECTIONS_ALL;
+   if ( bOk )
+   {
+      pParsedModel->iLoadedFileVersion = iVersion;
+
+      char szSnapshotFile[MAX_FILE_PATH_SIZE];
+      _model_get_snapshot_file_name(szTextFile, szSnapshotFile);
+      Model* pChunksModel = pParsedModel;
+      type_model_snapshot_chunk chunks[] = { MODEL_SNAPSHOT_MEMBERS(MODEL_SNAPSHOT_MEMBER_CHUNK) };
+      int iChunks = sizeof(chunks)/sizeof(chunks[0]);
+      const char* szReason = NULL;
+      u8* pPrevious = _model_read_snapshot_file(szSnapshotFile, chunks, iChunks, &szReason);
+      if ( NULL != pPrevious )
+      {
+         if ( NULL != piPreviousSaveCount )
+            *piPreviousSaveCount = ((type_model_snapshot_header*)pPrevious)->iTextFileSaveCount;
+         uChangedSections = 0;
+         u8* pSrc = pPrevious + sizeof(type_model_snapshot_header);
+         for( int i=0; i<iChunks; i++ )
+         {
+            if ( 0 != memcmp(pSrc, chunks[i].pData, chunks[i].iSize) )
+               uChangedSections |= chunks[i].uSection;
+            pSrc += chunks[i].iSize;
+         }
+         free(pPrevious);
+      }
+      pParsedModel->saveSnapshot(szTextFile);
+   }
+   pParsedModel->~Model();
+   free(pMemory);
+   return uChangedSections;
+}
 
 bool Model::loadVersion10(FILE* fd)
 {
@@ -1244,6 +1795,10 @@ bool Model::saveToFile(const char* filename, bool isOnController)
    fflush(fd);
    fclose(fd);
 
+   int iPreviousSaveCount = -1;
+   u32 uChangedSections = updateSnapshotFromTextFile(filename, &iPreviousSaveCount);
+   notifyChanges(filename, uChangedSections, iPreviousSaveCount);
+
    /*
    timeStart = get_current_timestamp_ms() - timeStart;
    char szLog[512];
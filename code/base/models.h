@@ -568,6 +568,38 @@ typedef struct
    u32 dummyhwc2[3];
 } type_hardware_capabilities;
 
+// Model sections, used to tell which parts of the model changed on a save
+#define MODEL_SECTION_GENERAL          0x0001
+#define MODEL_SECTION_HARDWARE         0x0002
+#define MODEL_SECTION_PROCESSES        0x0004
+#define MODEL_SECTION_RADIO_INTERFACES 0x0008
+#define MODEL_SECTION_RADIO_LINKS      0x0010
+#define MODEL_SECTION_STATS            0x0020
+#define MODEL_SECTION_CAMERA           0x0040
+#define MODEL_SECTION_VIDEO            0x0080
+#define MODEL_SECTION_OSD              0x0100
+#define MODEL_SECTION_RC               0x0200
+#define MODEL_SECTION_TELEMETRY        0x0400
+#define MODEL_SECTION_AUDIO            0x0800
+#define MODEL_SECTION_FUNCTIONS        0x1000
+#define MODEL_SECTION_RELAY            0x2000
+#define MODEL_SECTION_ALARMS           0x4000
+#define MODEL_SECTIONS_ALL             0xFFFF
+
+// Shared memory (SHARED_MEM_MODEL_CHANGES) updated each time the current vehicle model file is saved.
+// Processes check it instead of reading the model file to find out if the model changed.
+typedef struct
+{
+   volatile u32 uGeneration; // Incremented by two on each change; odd while the info is being updated
+   u32 uVehicleId;
+   int iSaveCount;
+   int iPreviousSaveCount; // -1 if unknown
+   u32 uChangedSections; // MODEL_SECTION_* flags
+   u32 uTimeChanged;
+   int iChangedByPID;
+   char szChangedByProcess[32];
+} type_model_changes_info;
+
 class Model
 {
    public:
@@ -663,7 +695,9 @@ class Model
       type_alarms_parameters alarms_params;
 
       bool reloadIfChanged(bool bLoadStats);
+      bool reloadChanges(const char* szFile, const type_model_changes_info* pChangesInfo, bool bLoadStats);
       bool loadFromFile(const char* filename, bool bLoadStats = false);
+      bool loadFromFileReadOnly(const char* filename);
       bool saveToFile(const char* filename, bool isOnController);
       int  getLoadedFileVersion();
       bool isRunningOnOpenIPCHardware();
@@ -783,11 +817,22 @@ class Model
       void generateUID();
       bool loadVersion10(FILE* fd); // from 7.6
       bool saveVersion10(FILE* fd, bool isOnController); // from 7.6
+      u32 uLastChangesGeneration;
+
+      // iExpectedSaveCount: only load the snapshot if it is for this save of the text file (-1: any)
+      bool loadSnapshot(const char* szTextFile, u32 uSections = MODEL_SECTIONS_ALL, int iExpectedSaveCount = -1);
+      bool saveSnapshot(const char* szTextFile);
+      u32 updateSnapshotFromTextFile(const char* szTextFile, int* piPreviousSaveCount);
+      void notifyChanges(const char* szFile, u32 uChangedSections, int iPreviousSaveCount);
+      bool reloadSections(const char* szFile, u32 uSections, int iSaveCountAfterChanges, bool bLoadStats);
 };
 
 const char* model_getShortFlightMode(u8 mode);
 const char* model_getLongFlightMode(u8 mode);
 const char* model_getCameraProfileName(int profileIndex);
+void model_set_snapshot_files_enabled(bool bEnabled);
+bool model_get_changes_info(type_model_changes_info* pOutput);
+const char* model_get_sections_description(u32 uSections);
 
 bool IsModelRadioConfigChanged(type_radio_links_parameters* pRadioLinks1, type_radio_interfaces_parameters* pRadioInterfaces1, type_radio_links_parameters* pRadioLinks2, type_radio_interfaces_parameters* pRadioInterfaces2);
 
@@ -40,10 +40,16 @@
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/msg.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <fcntl.h>
 #include <errno.h>
+#include <pthread.h>
 
 //#define RUBY_USE_FIFO_PIPES 1
-#define RUBY_USES_MSGQUEUES 1
+//#define RUBY_USES_MSGQUEUES 1
+#define RUBY_USES_SHM_RINGS 1
 
 #define FIFO_RUBY_ROUTER_TO_CENTRAL "/tmp/ruby/fiforoutercentral"
 #define FIFO_RUBY_CENTRAL_TO_ROUTER "/tmp/ruby/fifocentralrouter"
@@ -72,6 +78,73 @@ int s_iRubyIPCChannelsCount = 0;
 
 static int s_iRubyIPCCountReadErrors = 0;
 
+// Index in the channels list of the last channel used, checked first when looking up a channel
+// (per thread, channels can be used from more than one thread of a process)
+static __thread int s_iRubyIPCLastChannelIndex = 0;
+
+#ifdef RUBY_USES_SHM_RINGS
+
+// Each channel is a single producer process/single consumer ring of fixed size slots in POSIX shared memory.
+// A zero filled (newly created) shared memory object is a valid empty ring.
+// The threads of the producer process take the channel write lock to claim, fill and publish a slot.
+// The consumer drops the pending messages when it opens or closes its endpoint (they are from a previous run).
+// The producer wakes up the consumer (futex on a shared word) only if the consumer is blocked in ruby_ipc_wait_for_message().
+
+#define IPC_SHM_RING_NAME_PREFIX "/SYSTEM_RUBY_IPC_RING_"
+#define IPC_SHM_RING_SLOTS 64
+#define IPC_SHM_RING_MAGIC 0x52424950
+
+typedef struct
+{
+   u32 uLength;
+   u8  uData[IPC_CHANNEL_MAX_MSG_SIZE];
+} ALIGN_STRUCT_SPEC_INFO type_ipc_shm_ring_slot;
+
+typedef struct
+{
+   u32 uMagic;
+   u32 uSlotsCount;
+   u32 uSlotSize;
+   u32 uDummy1[13];
+
+   // Written only by the producer
+   u32 uWriteIndex;
+   u32 uStatsMaxPending;
+   u32 uStatsDroppedMessages;
+   u32 uDummy2[13];
+
+   // Written only by the consumer
+   u32 uReadIndex;
+   u32 uConsumerWaiting;
+   u32 uDummy3[14];
+
+   // Futex word, incremented by the producer when it must wake up the consumer
+   u32 uWakeupCounter;
+   u32 uDummy4[15];
+
+   type_ipc_shm_ring_slot slots[IPC_SHM_RING_SLOTS];
+} ALIGN_STRUCT_SPEC_INFO type_ipc_shm_ring;
+
+type_ipc_shm_ring* s_pRubyIPCChannelsRings[MAX_CHANNELS];
+int s_iRubyIPCChannelsIsReadEndpoint[MAX_CHANNELS];
+
+// Write locks, one for each opened channel; channels keep the index of their lock when the channels list is compacted
+static pthread_mutex_t s_MutexRubyIPCRingsWrite[MAX_CHANNELS];
+static int s_iRubyIPCRingsWriteMutexUsed[MAX_CHANNELS];
+int s_iRubyIPCChannelsWriteMutexIndex[MAX_CHANNELS];
+static pthread_once_t s_RubyIPCRingsMutexInitOnce = PTHREAD_ONCE_INIT;
+
+static void _ruby_ipc_init_rings_mutexes()
+{
+   for( int i=0; i<MAX_CHANNELS; i++ )
+   {
+      pthread_mutex_init(&s_MutexRubyIPCRingsWrite[i], NULL);
+      s_iRubyIPCRingsWriteMutexUsed[i] = 0;
+   }
+}
+
+#endif
+
 typedef struct
 {
     long type;
@@ -164,6 +237,7 @@ void _ruby_ipc_log_channel_info(int iChannelType, int iChannelId, int iChannelFd
 {
    if ( iChannelFd < 0 )
       return;
+   #ifdef RUBY_USES_MSGQUEUES
    struct msqid_ds msg_stats;
    if ( 0 != msgctl(iChannelFd, IPC_STAT, &msg_stats) )
       log_softerror_and_alarm("[IPC] Failed to get statistics on ICP message queue %s, id %d, fd %d",
@@ -172,6 +246,14 @@ void _ruby_ipc_log_channel_info(int iChannelType, int iChannelId, int iChannelFd
       log_line("[IPC] Channel %s (id: %d, fd: %d) info: %u pending messages, %u used bytes, max bytes in the IPC channel: %u bytes",
          _ruby_ipc_get_channel_name(iChannelType), iChannelId,
          iChannelFd, (u32)msg_stats.msg_qnum, (u32)msg_stats.msg_cbytes, (u32)msg_stats.msg_qbytes);
+   #endif
+
+   #ifdef RUBY_USES_SHM_RINGS
+   u32 uPending = 0, uMaxPending = 0, uDropped = 0;
+   if ( ruby_ipc_get_channel_stats(iChannelId, &uPending, &uMaxPending, &uDropped) )
+      log_line("[IPC] Channel %s (id: %d, fd: %d) info: %u pending messages, max pending: %u, dropped: %u, ring slots: %d",
+         _ruby_ipc_get_channel_name(iChannelType), iChannelId, iChannelFd, uPending, uMaxPending, uDropped, IPC_SHM_RING_SLOTS);
+   #endif
 }
 
 void _check_ruby_ipc_consistency()
@@ -192,6 +274,112 @@ void _check_ruby_ipc_consistency()
    }
 }
 
+int _ruby_ipc_get_channel_index(int iChannelUniqueId)
+{
+   if ( (s_iRubyIPCLastChannelIndex < s_iRubyIPCChannelsCount) && (s_iRubyIPCChannelsUniqueIds[s_iRubyIPCLastChannelIndex] == iChannelUniqueId) )
+      return s_iRubyIPCLastChannelIndex;
+
+   for( int i=0; i<s_iRubyIPCChannelsCount; i++ )
+   {
+      if ( s_iRubyIPCChannelsUniqueIds[i] == iChannelUniqueId )
+      {
+         s_iRubyIPCLastChannelIndex = i;
+         return i;
+      }
+   }
+   return -1;
+}
+
+#ifdef RUBY_USES_SHM_RINGS
+
+// Drops the pending messages; done only by the consumer, it owns the read index
+void _ruby_ipc_reset_shm_ring(type_ipc_shm_ring* pRing, int nChannelType)
+{
+   u32 uWriteIndex = __atomic_load_n(&pRing->uWriteIndex, __ATOMIC_ACQUIRE);
+   u32 uPending = uWriteIndex - pRing->uReadIndex;
+   if ( uPending > 0 )
+      log_line("[IPC] Dropped %u stale pending messages on channel %s.", uPending, _ruby_ipc_get_channel_name(nChannelType));
+   __atomic_store_n(&pRing->uReadIndex, uWriteIndex, __ATOMIC_RELEASE);
+}
+
+// Opens (creates if needed) and maps the shared memory ring for the channel at the given index in the channels list
+int _ruby_ipc_open_shm_ring(int nChannelType, int iChannelIndex, int iIsReadEndpoint)
+{
+   char szName[64];
+   snprintf(szName, sizeof(szName)/sizeof(szName[0]), "%s%d", IPC_SHM_RING_NAME_PREFIX, nChannelType);
+
+   pthread_once(&s_RubyIPCRingsMutexInitOnce, _ruby_ipc_init_rings_mutexes);
+   s_pRubyIPCChannelsRings[iChannelIndex] = NULL;
+   s_iRubyIPCChannelsIsReadEndpoint[iChannelIndex] = iIsReadEndpoint;
+   s_iRubyIPCChannelsWriteMutexIndex[iChannelIndex] = -1;
+   s_iRubyIPCChannelsFd[iChannelIndex] = shm_open(szName, O_CREAT | O_RDWR, S_IRUSR | S_IWUSR | S_IRGRP | S_IWGRP | S_IROTH | S_IWOTH);
+   if ( s_iRubyIPCChannelsFd[iChannelIndex] < 0 )
+   {
+      log_softerror_and_alarm("[IPC] Failed to open shared memory ring %s for channel %s, error %d, %s",
+         szName, _ruby_ipc_get_channel_name(nChannelType), errno, strerror(errno));
+      return -1;
+   }
+
+   // Both ends truncate to the same size; a new object is zero filled, that is an empty ring
+   if ( 0 != ftruncate(s_iRubyIPCChannelsFd[iChannelIndex], sizeof(type_ipc_shm_ring)) )
+   {
+      log_softerror_and_alarm("[IPC] Failed to set size of shared memory ring %s for channel %s, error %d, %s",
+         szName, _ruby_ipc_get_channel_name(nChannelType), errno, strerror(errno));
+      close(s_iRubyIPCChannelsFd[iChannelIndex]);
+      s_iRubyIPCChannelsFd[iChannelIndex] = -1;
+      return -1;
+   }
+
+   void* pMem = mmap(NULL, sizeof(type_ipc_shm_ring), PROT_READ | PROT_WRITE, MAP_SHARED, s_iRubyIPCChannelsFd[iChannelIndex], 0);
+   if ( MAP_FAILED == pMem )
+   {
+      log_softerror_and_alarm("[IPC] Failed to map shared memory ring %s for channel %s, error %d, %s",
+         szName, _ruby_ipc_get_channel_name(nChannelType), errno, strerror(errno));
+      close(s_iRubyIPCChannelsFd[iChannelIndex]);
+      s_iRubyIPCChannelsFd[iChannelIndex] = -1;
+      return -1;
+   }
+
+   type_ipc_shm_ring* pRing = (type_ipc_shm_ring*)pMem;
+   pRing->uSlotsCount = IPC_SHM_RING_SLOTS;
+   pRing->uSlotSize = IPC_CHANNEL_MAX_MSG_SIZE;
+   __atomic_store_n(&pRing->uMagic, IPC_SHM_RING_MAGIC, __ATOMIC_RELEASE);
+   if ( iIsReadEndpoint )
+      _ruby_ipc_reset_shm_ring(pRing, nChannelType);
+   s_pRubyIPCChannelsRings[iChannelIndex] = pRing;
+
+   for( int i=0; i<MAX_CHANNELS; i++ )
+   {
+      if ( s_iRubyIPCRingsWriteMutexUsed[i] )
+         continue;
+      s_iRubyIPCRingsWriteMutexUsed[i] = 1;
+      s_iRubyIPCChannelsWriteMutexIndex[iChannelIndex] = i;
+      break;
+   }
+
+   log_line("[IPC] Mapped shared memory ring %s (%d slots, %d bytes) for channel %s, pending messages: %u",
+      szName, IPC_SHM_RING_SLOTS, (int)sizeof(type_ipc_shm_ring), _ruby_ipc_get_channel_name(nChannelType),
+      __atomic_load_n(&pRing->uWriteIndex, __ATOMIC_ACQUIRE) - __atomic_load_n(&pRing->uReadIndex, __ATOMIC_ACQUIRE));
+   return s_iRubyIPCChannelsFd[iChannelIndex];
+}
+
+void _ruby_ipc_close_shm_ring(int iChannelIndex)
+{
+   if ( NULL != s_pRubyIPCChannelsRings[iChannelIndex] )
+   {
+      if ( s_iRubyIPCChannelsIsReadEndpoint[iChannelIndex] )
+         _ruby_ipc_reset_shm_ring(s_pRubyIPCChannelsRings[iChannelIndex], s_iRubyIPCChannelsType[iChannelIndex]);
+      munmap(s_pRubyIPCChannelsRings[iChannelIndex], sizeof(type_ipc_shm_ring));
+   }
+   s_pRubyIPCChannelsRings[iChannelIndex] = NULL;
+   if ( s_iRubyIPCChannelsWriteMutexIndex[iChannelIndex] >= 0 )
+      s_iRubyIPCRingsWriteMutexUsed[s_iRubyIPCChannelsWriteMutexIndex[iChannelIndex]] = 0;
+   s_iRubyIPCChannelsWriteMutexIndex[iChannelIndex] = -1;
+   if ( s_iRubyIPCChannelsFd[iChannelIndex] >= 0 )
+      close(s_iRubyIPCChannelsFd[iChannelIndex]);
+}
+
+#endif
 
 int ruby_init_ipc_channels()
 {
@@ -267,6 +455,22 @@ void ruby_clear_all_ipc_channels()
 
    #endif
 
+   #ifdef RUBY_USES_SHM_RINGS
+
+   for( int i=0; i<s_iRubyIPCChannelsCount; i++ )
+   {
+      char szName[64];
+      snprintf(szName, sizeof(szName)/sizeof(szName[0]), "%s%d", IPC_SHM_RING_NAME_PREFIX, s_iRubyIPCChannelsType[i]);
+      _ruby_ipc_close_shm_ring(i);
+      if ( 0 != shm_unlink(szName) )
+      if ( errno != ENOENT )
+         log_softerror_and_alarm("[IPC] Failed to remove shared memory ring [%s], error code: %d, error: %s",
+          _ruby_ipc_get_channel_name(s_iRubyIPCChannelsType[i]), errno, strerror(errno));
+   }
+   s_iRubyIPCChannelsCount = 0;
+
+   #endif
+
    log_line("[IPC] Done clearing all IPC channels.");
 }
 
@@ -347,6 +551,11 @@ int ruby_open_ipc_channel_write_endpoint(int nChannelType)
 
    #endif
 
+   #ifdef RUBY_USES_SHM_RINGS
+   if ( _ruby_ipc_open_shm_ring(nChannelType, s_iRubyIPCChannelsCount, 0) < 0 )
+      return -1;
+   #endif
+
    s_iRubyIPCChannelsUniqueIds[s_iRubyIPCChannelsCount] = s_iRubyIPCChannelsUniqueIdCounter;
    s_iRubyIPCChannelsUniqueIdCounter++;
 
@@ -433,6 +642,11 @@ int ruby_open_ipc_channel_read_endpoint(int nChannelType)
    //   log_line("[IPC] IPC channels pools max: %u bytes, max msg size: %u bytes, max msg queue total size: %u bytes", (u32)msg_info.msgpool, (u32)msg_info.msgmax, (u32)msg_info.msgmnb);
    #endif
 
+   #ifdef RUBY_USES_SHM_RINGS
+   if ( _ruby_ipc_open_shm_ring(nChannelType, s_iRubyIPCChannelsCount, 1) < 0 )
+      return -1;
+   #endif
+
    s_iRubyIPCChannelsUniqueIds[s_iRubyIPCChannelsCount] = s_iRubyIPCChannelsUniqueIdCounter;
    s_iRubyIPCChannelsUniqueIdCounter++;
 
@@ -449,16 +663,9 @@ int ruby_open_ipc_channel_read_endpoint(int nChannelType)
 int ruby_close_ipc_channel(int iChannelUniqueId)
 {
    int fdToClose = 0;
-   int iChannelIndex = -1;
-   for( int i=0; i<s_iRubyIPCChannelsCount; i++ )
-   {
-      if ( s_iRubyIPCChannelsUniqueIds[i] == iChannelUniqueId )
-      {
-         fdToClose = s_iRubyIPCChannelsFd[i];
-         iChannelIndex = i;
-         break;
-      }
-   }
+   int iChannelIndex = _ruby_ipc_get_channel_index(iChannelUniqueId);
+   if ( -1 != iChannelIndex )
+      fdToClose = s_iRubyIPCChannelsFd[iChannelIndex];
 
    if ( (iChannelUniqueId < 0) || (fdToClose < 0) || (-1 == iChannelIndex) )
    {
@@ -478,6 +685,11 @@ int ruby_close_ipc_channel(int iChannelUniqueId)
    msgctl(fdToClose,IPC_RMID,NULL);
    #endif
 
+   // The ring itself stays, the other endpoint might still use it; a read endpoint drops the pending messages
+   #ifdef RUBY_USES_SHM_RINGS
+   _ruby_ipc_close_shm_ring(iChannelIndex);
+   #endif
+
 
    log_line("[IPC] Closed IPC channel %s, channel index %d, unique id %d, fd %d",
        _ruby_ipc_get_channel_name(s_iRubyIPCChannelsType[iChannelIndex]),
@@ -489,9 +701,14 @@ int ruby_close_ipc_channel(int iChannelUniqueId)
       s_iRubyIPCChannelsType[k] = s_iRubyIPCChannelsType[k+1];
       s_iRubyIPCChannelsUniqueIds[k] = s_iRubyIPCChannelsUniqueIds[k+1];
       s_uRubyIPCChannelsMsgId[k] = s_uRubyIPCChannelsMsgId[k+1];
-
+      #ifdef RUBY_USES_SHM_RINGS
+      s_pRubyIPCChannelsRings[k] = s_pRubyIPCChannelsRings[k+1];
+      s_iRubyIPCChannelsIsReadEndpoint[k] = s_iRubyIPCChannelsIsReadEndpoint[k+1];
+      s_iRubyIPCChannelsWriteMutexIndex[k] = s_iRubyIPCChannelsWriteMutexIndex[k+1];
+      #endif
    }
    s_iRubyIPCChannelsCount--;
+   s_iRubyIPCLastChannelIndex = 0;
   
    _ruby_ipc_log_channels();
    return 1;
@@ -505,21 +722,10 @@ int ruby_ipc_channel_send_message(int iChannelUniqueId, u8* pMessage, int iLengt
       return 0;
    }
 
-   int iFoundIndex = -1;
    int iChannelFd = 0;
-   //int iChannelType = 0;
-   //u8 uChannelMsgId = 0;
-   for( int i=0; i<s_iRubyIPCChannelsCount; i++ )
-   {
-      if ( s_iRubyIPCChannelsUniqueIds[i] == iChannelUniqueId )
-      {
-         iChannelFd = s_iRubyIPCChannelsFd[i];
-         //iChannelType = s_iRubyIPCChannelsType[i];
-         //uChannelMsgId = s_uRubyIPCChannelsMsgId[i];
-         iFoundIndex = i;
-         break;
-      }
-   }
+   int iFoundIndex = _ruby_ipc_get_channel_index(iChannelUniqueId);
+   if ( -1 != iFoundIndex )
+      iChannelFd = s_iRubyIPCChannelsFd[iFoundIndex];
 
    if ( iFoundIndex == -1 )
    {
@@ -545,11 +751,66 @@ int ruby_ipc_channel_send_message(int iChannelUniqueId, u8* pMessage, int iLengt
       return 0;
    }
 
+   int res = 0;
+
+   #ifdef RUBY_USES_SHM_RINGS
+
+   // Copy the message into the ring slot while computing its CRC, then publish it.
+   // Holds the channel write lock from claiming the slot to publishing it (more threads can write to the channel)
+   type_ipc_shm_ring* pRing = s_pRubyIPCChannelsRings[iFoundIndex];
+   int iMutexIndex = s_iRubyIPCChannelsWriteMutexIndex[iFoundIndex];
+   if ( (NULL == pRing) || (iMutexIndex < 0) )
+      return 0;
+
+   pthread_mutex_lock(&s_MutexRubyIPCRingsWrite[iMutexIndex]);
+   u32 uWriteIndex = pRing->uWriteIndex;
+   u32 uPending = uWriteIndex - __atomic_load_n(&pRing->uReadIndex, __ATOMIC_ACQUIRE);
+   if ( uPending >= IPC_SHM_RING_SLOTS )
+   {
+      static u32 s_uTimeLastLogIPCRingFull = 0;
+      pRing->uStatsDroppedMessages++;
+      u32 uTimeNow = get_current_timestamp_ms();
+      if ( uTimeNow > s_uTimeLastLogIPCRingFull + 1000 )
+      {
+         s_uTimeLastLogIPCRingFull = uTimeNow;
+         log_softerror_and_alarm("[IPC] Channel %s is full (%u pending messages), message dropped. Total dropped: %u",
+            _ruby_ipc_get_channel_name(s_iRubyIPCChannelsType[iFoundIndex]), uPending, pRing->uStatsDroppedMessages);
+      }
+      pthread_mutex_unlock(&s_MutexRubyIPCRingsWrite[iMutexIndex]);
+      // Still set the message CRC, callers might reuse the buffer
+      u32 crc = base_compute_crc32(pMessage + sizeof(u32), iLength-sizeof(u32));
+      memcpy(pMessage, (u8*)&crc, sizeof(u32));
+      return 0;
+   }
+
+   type_ipc_shm_ring_slot* pSlot = &(pRing->slots[uWriteIndex % IPC_SHM_RING_SLOTS]);
+   u32 crc = base_copy_and_compute_crc32(pSlot->uData + sizeof(u32), pMessage + sizeof(u32), iLength-sizeof(u32), 0);
+   memcpy(pMessage, (u8*)&crc, sizeof(u32));
+   memcpy(pSlot->uData, (u8*)&crc, sizeof(u32));
+   pSlot->uLength = (u32)iLength;
+   s_uRubyIPCChannelsMsgId[iFoundIndex]++;
+
+   __atomic_store_n(&pRing->uWriteIndex, uWriteIndex+1, __ATOMIC_RELEASE);
+   if ( uPending+1 > pRing->uStatsMaxPending )
+      pRing->uStatsMaxPending = uPending+1;
+   pthread_mutex_unlock(&s_MutexRubyIPCRingsWrite[iMutexIndex]);
+
+   // Pairs with the fence in ruby_ipc_wait_for_message(): either the consumer sees the new write index or we see it waiting
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if ( __atomic_load_n(&pRing->uConsumerWaiting, __ATOMIC_RELAXED) )
+   {
+      __atomic_add_fetch(&pRing->uWakeupCounter, 1, __ATOMIC_RELEASE);
+      syscall(SYS_futex, &pRing->uWakeupCounter, FUTEX_WAKE, 1, NULL, NULL, 0);
+   }
+   return iLength;
+
+   #else
+
    u32 crc = base_compute_crc32(pMessage + sizeof(u32), iLength-sizeof(u32)); 
    u32* pTmp = (u32*)pMessage;
    *pTmp = crc;
 
-   int res = 0;
+   #endif
    
    #ifdef PROFILE_IPC
    u32 uTimeStart = get_current_timestamp_ms();
@@ -569,8 +830,8 @@ int ruby_ipc_channel_send_message(int iChannelUniqueId, u8* pMessage, int iLengt
    msg.data[4] = s_uRubyIPCChannelsMsgId[iFoundIndex];
    msg.data[5] = ((u32)iLength) & 0xFF; 
    msg.data[6] = (((u32)iLength)>>8) & 0xFF;
-   memcpy((u8*)&(msg.data[7]), pMessage, iLength); 
-   u32 uCRC = base_compute_crc32((u8*)&(msg.data[4]), iLength+3);
+   u32 uCRC = base_compute_crc32((u8*)&(msg.data[4]), 3);
+   uCRC = base_copy_and_compute_crc32((u8*)&(msg.data[7]), pMessage, iLength, uCRC);
    memcpy((u8*)&(msg.data[0]), (u8*)&uCRC, sizeof(u32));
 
    int iRetryCounter = 2;
@@ -673,18 +934,13 @@ u8* ruby_ipc_try_read_message(int iChannelUniqueId, u8* pTempBuffer, int* pTempB
       return NULL;
    }
 
-   int iFoundIndex = -1;
    int iChannelFd = 0;
    int iChannelType = 0;
-   for( int i=0; i<s_iRubyIPCChannelsCount; i++ )
+   int iFoundIndex = _ruby_ipc_get_channel_index(iChannelUniqueId);
+   if ( -1 != iFoundIndex )
    {
-      if ( s_iRubyIPCChannelsUniqueIds[i] == iChannelUniqueId )
-      {
-         iChannelFd = s_iRubyIPCChannelsFd[i];
-         iChannelType = s_iRubyIPCChannelsType[i];
-         iFoundIndex = i;
-         break;
-      }
+      iChannelFd = s_iRubyIPCChannelsFd[iFoundIndex];
+      iChannelType = s_iRubyIPCChannelsType[iFoundIndex];
    }
 
    if ( iFoundIndex == -1 )
@@ -795,14 +1051,15 @@ u8* ruby_ipc_try_read_message(int iChannelUniqueId, u8* pTempBuffer, int* pTempB
          log_softerror_and_alarm("[IPC] Received invalid message on channel %s, id: %d, length: %d", _ruby_ipc_get_channel_name(iChannelType), ipcMessage.data[4], iMsgLen );
       else
       {
-         u32 uCRC = base_compute_crc32((u8*)&(ipcMessage.data[4]), iMsgLen+3);
+         // Copy the message out while computing the CRC; the output is only returned if the CRC matches
+         u32 uCRC = base_compute_crc32((u8*)&(ipcMessage.data[4]), 3);
+         uCRC = base_copy_and_compute_crc32(pOutputBuffer, (u8*)&(ipcMessage.data[7]), iMsgLen, uCRC);
          u32 uTmp = 0;
          memcpy((u8*)&uTmp, (u8*)&(ipcMessage.data[0]), sizeof(u32));
          if ( uCRC != uTmp )
             log_softerror_and_alarm("[IPC] Received invalid CRC on channel %s on message id: %d, CRC computed/received: %u / %u, msg length: %d", _ruby_ipc_get_channel_name(iChannelType), ipcMessage.data[4], uCRC, uTmp, iMsgLen );
          else
          {
-            memcpy(pOutputBuffer, (u8*)&(ipcMessage.data[7]), iMsgLen);
             pReturn = pOutputBuffer;
             //log_line("[IPC] Received message ok on channel %s, id: %d, length: %d", _ruby_ipc_get_channel_name(iChannelType), ipcMessage.data[4], iMsgLen );
          }
@@ -811,6 +1068,31 @@ u8* ruby_ipc_try_read_message(int iChannelUniqueId, u8* pTempBuffer, int* pTempB
 
    #endif
 
+   #ifdef RUBY_USES_SHM_RINGS
+
+   type_ipc_shm_ring* pRing = s_pRubyIPCChannelsRings[iFoundIndex];
+   if ( (NULL != pRing) && (iChannelFd >= 0) )
+   {
+      u32 uReadIndex = pRing->uReadIndex;
+      if ( uReadIndex != __atomic_load_n(&pRing->uWriteIndex, __ATOMIC_ACQUIRE) )
+      {
+         type_ipc_shm_ring_slot* pSlot = &(pRing->slots[uReadIndex % IPC_SHM_RING_SLOTS]);
+         lenReadIPCMsgQueue = (int)pSlot->uLength;
+         int iMsgLen = lenReadIPCMsgQueue;
+         if ( (iMsgLen <= 0) || (iMsgLen >= IPC_CHANNEL_MAX_MSG_SIZE - 6) )
+            log_softerror_and_alarm("[IPC] Received invalid message on channel %s, length: %d", _ruby_ipc_get_channel_name(iChannelType), iMsgLen );
+         else
+         {
+            memcpy(pOutputBuffer, pSlot->uData, iMsgLen);
+            pReturn = pOutputBuffer;
+         }
+         // Release the slot back to the producer
+         __atomic_store_n(&pRing->uReadIndex, uReadIndex+1, __ATOMIC_RELEASE);
+      }
+   }
+
+   #endif
+
    #ifdef PROFILE_IPC
    u32 uTimeTotal = get_current_timestamp_ms() - uTimeStart;
    if ( (uTimeTotal > PROFILE_IPC_MAX_TIME + timeoutMicrosec/1000) || uTimeTotal >= 50 )
@@ -831,4 +1113,61 @@ u8* ruby_ipc_try_read_message(int iChannelUniqueId, u8* pTempBuffer, int* pTempB
 int ruby_ipc_get_read_continous_error_count()
 {
    return s_iRubyIPCCountReadErrors;
-}
\ No newline at end of file
+}
+
+// Waits up to iTimeoutMs for a message to be available on the channel (read endpoint).
+// Returns 1 if there is a message to read, 0 on timeout.
+int ruby_ipc_wait_for_message(int iChannelUniqueId, int iTimeoutMs)
+{
+   #ifdef RUBY_USES_SHM_RINGS
+   int iIndex = _ruby_ipc_get_channel_index(iChannelUniqueId);
+   if ( (-1 == iIndex) || (NULL == s_pRubyIPCChannelsRings[iIndex]) )
+   {
+      if ( iTimeoutMs > 0 )
+         hardware_sleep_ms(iTimeoutMs);
+      return 0;
+   }
+   type_ipc_shm_ring* pRing = s_pRubyIPCChannelsRings[iIndex];
+
+   u32 uWakeupCounter = __atomic_load_n(&pRing->uWakeupCounter, __ATOMIC_ACQUIRE);
+   __atomic_store_n(&pRing->uConsumerWaiting, 1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+
+   if ( (pRing->uReadIndex == __atomic_load_n(&pRing->uWriteIndex, __ATOMIC_ACQUIRE)) && (iTimeoutMs > 0) )
+   {
+      struct timespec ts;
+      ts.tv_sec = iTimeoutMs/1000;
+      ts.tv_nsec = (long)(iTimeoutMs%1000) * 1000000L;
+      syscall(SYS_futex, &pRing->uWakeupCounter, FUTEX_WAIT, uWakeupCounter, &ts, NULL, 0);
+   }
+   __atomic_store_n(&pRing->uConsumerWaiting, 0, __ATOMIC_RELAXED);
+   return (pRing->uReadIndex != __atomic_load_n(&pRing->uWriteIndex, __ATOMIC_ACQUIRE))?1:0;
+
+   #else
+
+   if ( iTimeoutMs > 0 )
+      hardware_sleep_ms(iTimeoutMs);
+   return 0;
+
+   #endif
+}
+
+// Returns 0 if the stats are not available for the channel (or transport)
+int ruby_ipc_get_channel_stats(int iChannelUniqueId, u32* puPendingMessages, u32* puMaxPendingMessages, u32* puDroppedMessages)
+{
+   #ifdef RUBY_USES_SHM_RINGS
+   int iIndex = _ruby_ipc_get_channel_index(iChannelUniqueId);
+   if ( (-1 == iIndex) || (NULL == s_pRubyIPCChannelsRings[iIndex]) )
+      return 0;
+   type_ipc_shm_ring* pRing = s_pRubyIPCChannelsRings[iIndex];
+   if ( NULL != puPendingMessages )
+      *puPendingMessages = __atomic_load_n(&pRing->uWriteIndex, __ATOMIC_ACQUIRE) - __atomic_load_n(&pRing->uReadIndex, __ATOMIC_ACQUIRE);
+   if ( NULL != puMaxPendingMessages )
+      *puMaxPendingMessages = pRing->uStatsMaxPending;
+   if ( NULL != puDroppedMessages )
+      *puDroppedMessages = pRing->uStatsDroppedMessages;
+   return 1;
+   #else
+   return 0;
+   #endif
+}
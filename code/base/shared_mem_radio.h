@@ -108,6 +108,7 @@ typedef struct
    u32 hist_tmp_rxPacketsLostCountVideo;
    u32 hist_tmp_rxPacketsLostCountData;
 
+   u32 totalRxPacketsDuplicates; // rejected as duplicates before the CRC check, not in totalRxPackets
 } ALIGN_STRUCT_SPEC_INFO shared_mem_radio_stats_radio_interface;
 
 typedef struct
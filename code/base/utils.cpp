@@ -35,6 +35,7 @@
 #include "../base/config.h"
 #include "../base/models.h"
 #include "../base/hardware_procs.h"
+#include "../base/hardware_radio_ctrl.h"
 #include "../common/string_utils.h"
 #include "../radio/radioflags.h"
 
@@ -653,8 +654,6 @@ bool radio_utils_set_interface_frequency(Model* pModel, int iRadioIndex, int iAs
       iEndIndex = iRadioIndex;
    }
 
-   char cmd[128];
-   char szOutput[512];
    bool failed = false;
    bool anySucceeded = false;
 
@@ -696,90 +695,43 @@ bool radio_utils_set_interface_frequency(Model* pModel, int iRadioIndex, int iAs
       }
       else if ( hardware_radio_is_wifi_radio(pRadioInfo) )
       {
-         bool bTryHT40 = false;
-         bool bUsedHT40 = false;
-         szOutput[0] = 0;
-
+         // HT40 is used only on Raspberry, as before (other platforms always used iwconfig)
+         int iChannelType = RADIO_CTRL_CHANNEL_20MHZ;
+         #if defined(HW_PLATFORM_RASPBERRY)
          if ( (NULL != pModel) && (iAssignedModelRadioLink >= 0) && (iAssignedModelRadioLink < MAX_RADIO_INTERFACES) )
          {
             if ( hardware_is_station() )
             if ( pModel->radioLinksParams.link_radio_flags[iAssignedModelRadioLink] & RADIO_FLAG_HT40_CONTROLLER )
-                  bTryHT40 = true;
+                  iChannelType = RADIO_CTRL_CHANNEL_HT40_PLUS;
             if ( hardware_is_vehicle() )
             if ( pModel->radioLinksParams.link_radio_flags[iAssignedModelRadioLink] & RADIO_FLAG_HT40_VEHICLE )
-                  bTryHT40 = true;
+                  iChannelType = RADIO_CTRL_CHANNEL_HT40_PLUS;
          }
+         #endif
 
-         if ( bTryHT40 )
-         {
-            #if defined(HW_PLATFORM_RASPBERRY)
-            if ( pRadioInfo->iRadioType == RADIO_TYPE_ATHEROS )
-            {
-               sprintf(cmd, "iw dev %s set freq %u HT40+", pRadioInfo->szName, uFreqWifi);
-               bUsedHT40 = true;
-            }
-            else
-            {
-               sprintf(cmd, "iw dev %s set freq %u HT40+", pRadioInfo->szName, uFreqWifi);
-               bUsedHT40 = true;
-            }
-            #else
-               sprintf(cmd, "iwconfig %s freq %u000", pRadioInfo->szName, uFrequencyKhz);            
-            #endif
-         }
-         else if ( pRadioInfo->isHighCapacityInterface )
-         {
-            #if defined(HW_PLATFORM_RASPBERRY)
-            sprintf(cmd, "iw dev %s set freq %u", pRadioInfo->szName, uFreqWifi);
-            #else
-            sprintf(cmd, "iwconfig %s freq %u000", pRadioInfo->szName, uFrequencyKhz);            
-            #endif
-         }
-         hw_execute_process(cmd, 0, szOutput, sizeof(szOutput)/sizeof(szOutput[0]));
-         
-         if ( 5 < strlen(szOutput) )
-            log_softerror_and_alarm("Received a response from set freq command: [%s]", szOutput);
+         int iRes = radio_ctrl_set_frequency(pRadioInfo->szName, uFrequencyKhz, iChannelType);
            
-         if ( NULL != strstr( szOutput, "Invalid argument" ) )
-         if ( bUsedHT40 )
-         if ( pRadioInfo->isHighCapacityInterface )
+         if ( (-EINVAL == iRes) && (iChannelType == RADIO_CTRL_CHANNEL_HT40_PLUS) && pRadioInfo->isHighCapacityInterface )
          {
-            int len = strlen(szOutput);
-            for( int k=0; k<len; k++ )
-            {
-               if ( szOutput[k] == 10 || szOutput[k] == 13 )
-                  szOutput[k] = '.';
-            }
-            log_softerror_and_alarm("Failed to switch radio interface %d (%s, %s) to frequency %s in HT40 mode, returned error: [%s]. Retry operation.", i+1, pRadioInfo->szName, str_get_radio_driver_description(pRadioInfo->iRadioDriver), str_format_frequency(uFrequencyKhz), szOutput);
+            log_softerror_and_alarm("Failed to switch radio interface %d (%s, %s) to frequency %s in HT40 mode, returned error: %d. Retry operation.", i+1, pRadioInfo->szName, str_get_radio_driver_description(pRadioInfo->iRadioDriver), str_format_frequency(uFrequencyKhz), iRes);
             hardware_sleep_ms(delayMs);
-            szOutput[0] = 0;
-            #if defined(HW_PLATFORM_RASPBERRY)
-            sprintf(cmd, "iw dev %s set freq %u", pRadioInfo->szName, uFreqWifi);
-            #else
-            sprintf(cmd, "iwconfig %s freq %u000", pRadioInfo->szName, uFrequencyKhz);
-            #endif
-            hw_execute_bash_command_raw(cmd, szOutput);
+            iRes = radio_ctrl_set_frequency(pRadioInfo->szName, uFrequencyKhz, RADIO_CTRL_CHANNEL_20MHZ);
+            iChannelType = RADIO_CTRL_CHANNEL_20MHZ;
          }
 
-         if ( (NULL != strstr(szOutput, "busy")) || (NULL != strstr(szOutput, "such device")) )
+         if ( (-EBUSY == iRes) || (-ENODEV == iRes) )
          {
              hardware_initialize_radio_interface(i, delayMs);
              hardware_sleep_ms(delayMs);
-             hw_execute_process(cmd, 0, szOutput, sizeof(szOutput)/sizeof(szOutput[0]));
+             iRes = radio_ctrl_set_frequency(pRadioInfo->szName, uFrequencyKhz, iChannelType);
          }
-         if ( NULL != strstr(szOutput, "failed") )
+         if ( 0 != iRes )
          {
             pRadioInfo->lastFrequencySetFailed = 1;
             pRadioInfo->uFailedFrequencyKhz = uFrequencyKhz;
             pRadioInfo->uCurrentFrequencyKhz = 0;
             failed = true;
-            int len = strlen(szOutput);
-            for( int k=0; k<len; k++ )
-            {
-               if ( szOutput[k] == 10 || szOutput[k] == 13 )
-                  szOutput[k] = '.';
-            }
-            log_softerror_and_alarm("Failed to switch radio interface %d (%s, %s) to frequency %s, returned error: [%s]", i+1, pRadioInfo->szName, str_get_radio_driver_description(pRadioInfo->iRadioDriver), str_format_frequency(uFrequencyKhz), szOutput);
+            log_softerror_and_alarm("Failed to switch radio interface %d (%s, %s) to frequency %s, returned error: %d", i+1, pRadioInfo->szName, str_get_radio_driver_description(pRadioInfo->iRadioDriver), str_format_frequency(uFrequencyKhz), iRes);
             hardware_sleep_ms(delayMs);
             continue;
          }
@@ -838,45 +790,28 @@ bool radio_utils_set_datarate_atheros(Model* pModel, int iCard, int dataRate_bps
       return true;
    }
 
-   char cmd[1024];
-
-   //sprintf(cmd, "ifconfig %s down", pRadioHWInfo->szName );
-   sprintf(cmd, "ip link set dev %s down", pRadioHWInfo->szName);
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 0);
    hardware_sleep_ms(delayMs);
 
-   sprintf(cmd, "iw dev %s set type managed", pRadioHWInfo->szName );
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_type(pRadioHWInfo->szName, RADIO_CTRL_IFTYPE_MANAGED);
    hardware_sleep_ms(delayMs);
 
-   //sprintf(cmd, "ifconfig %s up", pRadioHWInfo->szName );
-   sprintf(cmd, "ip link set dev %s up", pRadioHWInfo->szName);
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(delayMs);
 
-   if ( dataRate_bps > 0 )
-      sprintf(cmd, "iw dev %s set bitrates legacy-2.4 %d", pRadioHWInfo->szName, dataRate_bps/1000/1000 );
-   else
-      sprintf(cmd, "iw dev %s set bitrates ht-mcs-2.4 %d", pRadioHWInfo->szName, -dataRate_bps-1 );
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_bitrate(pRadioHWInfo->szName, dataRate_bps, 0);
    hardware_sleep_ms(delayMs);
 
-   //sprintf(cmd, "ifconfig %s down", pRadioHWInfo->szName );
-   sprintf(cmd, "ip link set dev %s down", pRadioHWInfo->szName);
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 0);
    hardware_sleep_ms(delayMs);
 
-   sprintf(cmd, "iw dev %s set monitor none", pRadioHWInfo->szName );
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAGS_NONE);
    hardware_sleep_ms(delayMs);
 
-   sprintf(cmd, "iw dev %s set monitor fcsfail", pRadioHWInfo->szName );
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
    hardware_sleep_ms(delayMs);
 
-   //sprintf(cmd, "ifconfig %s up", pRadioHWInfo->szName );
-   sprintf(cmd, "ip link set dev %s up", pRadioHWInfo->szName);
-   hw_execute_bash_command(cmd, NULL);
+   radio_ctrl_set_link_up(pRadioHWInfo->szName, 1);
    hardware_sleep_ms(delayMs);
 
    pRadioHWInfo->iCurrentDataRateBPS = dataRate_bps;
@@ -0,0 +1,415 @@
+/*
+    Ruby Licence
+    Copyright (c) 2020-2025 Petru Soroaga
+    All rights reserved.
+
+    Redistribution and/or use in source and/or binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions and/or use of the source code (partially or complete) must retain
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Redistributions in binary form (partially or complete) must reproduce
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+         * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+       * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permitted.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE AUTHOR (PETRU SOROAGA) BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+#include "base.h"
+#include "video_sm_ring.h"
+
+// Max retries to get a consistent producer state while the producer is writing a chunk
+#define VIDEO_SM_RING_SNAPSHOT_RETRIES 1000
+
+static u32 _video_sm_ring_align(u32 uSize)
+{
+   return (uSize + VIDEO_SM_RING_ALIGN - 1) & (~((u32)VIDEO_SM_RING_ALIGN - 1));
+}
+
+static u32 _video_sm_ring_get_data_size(u32 uMemSize)
+{
+   if ( uMemSize < sizeof(type_video_sm_ring_header) + 4096 )
+      return 0;
+   return (uMemSize - sizeof(type_video_sm_ring_header)) & (~((u32)VIDEO_SM_RING_ALIGN - 1));
+}
+
+int video_sm_ring_writer_init(type_video_sm_ring_writer* pWriter, u8* pMem, u32 uMemSize)
+{
+   if ( NULL == pWriter )
+      return -1;
+   memset(pWriter, 0, sizeof(type_video_sm_ring_writer));
+   u32 uDataSize = _video_sm_ring_get_data_size(uMemSize);
+   if ( (NULL == pMem) || (0 == uDataSize) )
+      return -1;
+
+   pWriter->pHeader = (type_video_sm_ring_header*)pMem;
+   pWriter->pData = pMem + sizeof(type_video_sm_ring_header);
+   pWriter->uDataSize = uDataSize;
+
+   type_video_sm_ring_header* pHeader = pWriter->pHeader;
+   __atomic_store_n(&pHeader->uMagic, 0, __ATOMIC_RELEASE);
+   memset(pMem, 0, sizeof(type_video_sm_ring_header));
+   pHeader->uVersion = VIDEO_SM_RING_VERSION;
+   pHeader->uHeaderSize = sizeof(type_video_sm_ring_header);
+   pHeader->uDataSize = uDataSize;
+   pHeader->uSessionId = 1;
+   pHeader->uNextChunkSeq = 1;
+   __atomic_store_n(&pHeader->uMagic, VIDEO_SM_RING_MAGIC, __ATOMIC_RELEASE);
+   return 0;
+}
+
+void video_sm_ring_writer_reset(type_video_sm_ring_writer* pWriter)
+{
+   if ( (NULL == pWriter) || (NULL == pWriter->pHeader) )
+      return;
+   // Only the writing thread changes the producer fields, so the reset is done by the next write
+   __atomic_store_n(&pWriter->iResetPending, 1, __ATOMIC_RELEASE);
+}
+
+static void _video_sm_ring_writer_apply_reset(type_video_sm_ring_writer* pWriter)
+{
+   // Positions are kept, only the session changes so that readers drop what they
+   // were reading and wait for the next keyframe of the new stream.
+   type_video_sm_ring_header* pHeader = pWriter->pHeader;
+   u32 uSeq = pHeader->uWriteSeq;
+   __atomic_store_n(&pHeader->uWriteSeq, uSeq+1, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+   __atomic_store_n(&pHeader->uSessionId, pHeader->uSessionId+1, __ATOMIC_RELAXED);
+   __atomic_store_n(&pHeader->uWriteSeq, uSeq+2, __ATOMIC_RELEASE);
+
+   pWriter->bDroppingUntilKeyframe = 0;
+}
+
+int video_sm_ring_write(type_video_sm_ring_writer* pWriter, u8* pData, u32 uLength, int iKeyframeOffset, u32 uTimeNowMs)
+{
+   if ( (NULL == pWriter) || (NULL == pWriter->pHeader) || (NULL == pData) || (0 == uLength) )
+      return -1;
+
+   if ( __atomic_exchange_n(&pWriter->iResetPending, 0, __ATOMIC_ACQ_REL) )
+      _video_sm_ring_writer_apply_reset(pWriter);
+
+   type_video_sm_ring_header* pHeader = pWriter->pHeader;
+   u32 uRecordSize = _video_sm_ring_align(sizeof(type_video_sm_ring_chunk_header) + uLength);
+   if ( uRecordSize > pWriter->uDataSize/4 )
+      return -1;
+
+   int bKeyframe = ((iKeyframeOffset >= 0) && ((u32)iKeyframeOffset < uLength))?1:0;
+
+   // Producer owned fields, no need for atomic reads
+   u32 uWritePos = pHeader->uWritePos;
+   u32 uWriteTotal = pHeader->uWriteTotal;
+   u32 uSkip = 0;
+   if ( pWriter->uDataSize - uWritePos < uRecordSize )
+      uSkip = pWriter->uDataSize - uWritePos;
+
+   u32 uHeartbeat = __atomic_load_n(&pHeader->uReaderHeartbeat, __ATOMIC_ACQUIRE);
+   if ( uHeartbeat != pWriter->uLastReaderHeartbeat )
+   {
+      pWriter->uLastReaderHeartbeat = uHeartbeat;
+      pWriter->uTimeLastReaderHeartbeatChange = uTimeNowMs;
+   }
+   int bReaderAlive = ((0 != uHeartbeat) && (uTimeNowMs - pWriter->uTimeLastReaderHeartbeatChange < VIDEO_SM_RING_READER_TIMEOUT_MS))?1:0;
+
+   // Once a chunk was dropped, the decoder can only restart cleanly from a keyframe
+   int bDrop = (pWriter->bDroppingUntilKeyframe && (!bKeyframe))?1:0;
+
+   if ( (!bDrop) && bReaderAlive )
+   {
+      u32 uLag = uWriteTotal - __atomic_load_n(&pHeader->uReaderTotal, __ATOMIC_ACQUIRE);
+      // Reader already lapped: it will skip ahead on it's own, don't hold the stream for it
+      if ( uLag > pWriter->uDataSize )
+         uLag = 0;
+      u32 uNeeded = uLag + uSkip + uRecordSize;
+      if ( uNeeded > pWriter->uDataSize )
+         bDrop = 1;
+      else if ( (!bKeyframe) && (uNeeded > (pWriter->uDataSize/100) * VIDEO_SM_RING_HIGH_WATERMARK_PERCENT) )
+         bDrop = 1;
+   }
+
+   if ( bDrop )
+   {
+      pWriter->bDroppingUntilKeyframe = 1;
+      __atomic_store_n(&pHeader->uStatsDroppedChunks, pHeader->uStatsDroppedChunks+1, __ATOMIC_RELAXED);
+      return 0;
+   }
+
+   u32 uFlags = 0;
+   if ( bKeyframe )
+   {
+      uFlags |= VIDEO_SM_RING_CHUNK_FLAG_KEYFRAME;
+      if ( pWriter->bDroppingUntilKeyframe )
+         uFlags |= VIDEO_SM_RING_CHUNK_FLAG_DISCONTINUITY;
+      pWriter->bDroppingUntilKeyframe = 0;
+   }
+
+   // Open the write: make the reserved end visible before any chunk byte is changed
+   u32 uSeq = pHeader->uWriteSeq;
+   __atomic_store_n(&pHeader->uWriteSeq, uSeq+1, __ATOMIC_RELAXED);
+   __atomic_store_n(&pHeader->uReserveTotal, uWriteTotal + uSkip + uRecordSize, __ATOMIC_RELAXED);
+   __atomic_thread_fence(__ATOMIC_RELEASE);
+
+   u32 uChunkSeq = pHeader->uNextChunkSeq;
+   if ( uSkip > 0 )
+   {
+      // Tails smaller than a chunk header are skipped implicitly by the reader too
+      if ( uSkip >= sizeof(type_video_sm_ring_chunk_header) )
+      {
+         type_video_sm_ring_chunk_header* pWrap = (type_video_sm_ring_chunk_header*)(pWriter->pData + uWritePos);
+         pWrap->uChunkSeq = uChunkSeq++;
+         pWrap->uRecordSize = uSkip;
+         pWrap->uLength = 0;
+         pWrap->uFlags = VIDEO_SM_RING_CHUNK_FLAG_WRAP;
+         pWrap->uKeyframeOffset = 0;
+         pWrap->uTimestampMs = uTimeNowMs;
+      }
+      uWritePos = 0;
+   }
+
+   type_video_sm_ring_chunk_header* pChunk = (type_video_sm_ring_chunk_header*)(pWriter->pData + uWritePos);
+   pChunk->uChunkSeq = uChunkSeq++;
+   pChunk->uRecordSize = uRecordSize;
+   pChunk->uLength = uLength;
+   pChunk->uFlags = uFlags;
+   pChunk->uKeyframeOffset = bKeyframe?(u32)iKeyframeOffset:0;
+   pChunk->uTimestampMs = uTimeNowMs;
+   memcpy(pWriter->pData + uWritePos + sizeof(type_video_sm_ring_chunk_header), pData, uLength);
+
+   uWritePos += uRecordSize;
+   if ( uWritePos >= pWriter->uDataSize )
+      uWritePos = 0;
+
+   // Publish the chunk and close the write
+   __atomic_store_n(&pHeader->uWritePos, uWritePos, __ATOMIC_RELAXED);
+   __atomic_store_n(&pHeader->uNextChunkSeq, uChunkSeq, __ATOMIC_RELAXED);
+   __atomic_store_n(&pHeader->uStatsWrittenChunks, pHeader->uStatsWrittenChunks+1, __ATOMIC_RELAXED);
+   __atomic_store_n(&pHeader->uWriteTotal, uWriteTotal + uSkip + uRecordSize, __ATOMIC_RELEASE);
+   __atomic_store_n(&pHeader->uWriteSeq, uSeq+2, __ATOMIC_RELEASE);
+   return 1;
+}
+
+int video_sm_ring_find_keyframe_offset(u8* pData, u32 uLength, int bIsH265)
+{
+   if ( (NULL == pData) || (uLength < 4) )
+      return -1;
+
+   for( u32 i=0; i+3 < uLength; i++ )
+   {
+      if ( (0 != pData[i]) || (0 != pData[i+1]) || (1 != pData[i+2]) )
+         continue;
+
+      int bKey = 0;
+      if ( bIsH265 )
+      {
+         // VPS, SPS, IDR_W_RADL, IDR_N_LP
+         u8 uType = (pData[i+3] >> 1) & 0x3F;
+         bKey = ((32 == uType) || (33 == uType) || (19 == uType) || (20 == uType))?1:0;
+      }
+      else
+      {
+         // SPS, IDR
+         u8 uType = pData[i+3] & 0x1F;
+         bKey = ((7 == uType) || (5 == uType))?1:0;
+      }
+      if ( bKey )
+      {
+         // Include the leading zero of a 4 bytes start code
+         if ( (i > 0) && (0 == pData[i-1]) )
+            return (int)i-1;
+         return (int)i;
+      }
+      i += 2;
+   }
+   return -1;
+}
+
+int video_sm_ring_reader_init(type_video_sm_ring_reader* pReader, u8* pMem, u32 uMemSize)
+{
+   if ( NULL == pReader )
+      return -1;
+   memset(pReader, 0, sizeof(type_video_sm_ring_reader));
+   u32 uDataSize = _video_sm_ring_get_data_size(uMemSize);
+   if ( (NULL == pMem) || (0 == uDataSize) )
+      return -1;
+   pReader->pHeader = (type_video_sm_ring_header*)pMem;
+   pReader->pData = pMem + sizeof(type_video_sm_ring_header);
+   pReader->uDataSize = uDataSize;
+   return 0;
+}
+
+// Gets a consistent view of the producer state. Returns 0 if the producer is busy writing.
+static int _video_sm_ring_snapshot(type_video_sm_ring_header* pHeader, u32* puSessionId, u32* puWritePos, u32* puWriteTotal, u32* puNextChunkSeq)
+{
+   for( int i=0; i<VIDEO_SM_RING_SNAPSHOT_RETRIES; i++ )
+   {
+      u32 uSeq1 = __atomic_load_n(&pHeader->uWriteSeq, __ATOMIC_ACQUIRE);
+      if ( uSeq1 & 1 )
+         continue;
+      *puSessionId = __atomic_load_n(&pHeader->uSessionId, __ATOMIC_RELAXED);
+      *puWritePos = __atomic_load_n(&pHeader->uWritePos, __ATOMIC_RELAXED);
+      *puWriteTotal = __atomic_load_n(&pHeader->uWriteTotal, __ATOMIC_RELAXED);
+      *puNextChunkSeq = __atomic_load_n(&pHeader->uNextChunkSeq, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      if ( uSeq1 == __atomic_load_n(&pHeader->uWriteSeq, __ATOMIC_RELAXED) )
+         return 1;
+   }
+   return 0;
+}
+
+// Skip to the current producer position and wait for the next keyframe
+static void _video_sm_ring_resync(type_video_sm_ring_reader* pReader, u32 uSessionId, u32 uWritePos, u32 uWriteTotal, u32 uNextChunkSeq)
+{
+   pReader->bSynced = 1;
+   pReader->bWaitingForKeyframe = 1;
+   pReader->uSessionId = uSessionId;
+   pReader->uReadPos = uWritePos;
+   pReader->uReadTotal = uWriteTotal;
+   pReader->uExpectedChunkSeq = uNextChunkSeq;
+   pReader->uStatsResyncs++;
+   __atomic_store_n(&pReader->pHeader->uReaderResyncs, pReader->uStatsResyncs, __ATOMIC_RELAXED);
+   __atomic_store_n(&pReader->pHeader->uReaderTotal, uWriteTotal, __ATOMIC_RELEASE);
+}
+
+int video_sm_ring_read(type_video_sm_ring_reader* pReader, u8* pOutput, u32 uOutputSize)
+{
+   if ( (NULL == pReader) || (NULL == pReader->pHeader) || (NULL == pOutput) )
+      return -1;
+
+   type_video_sm_ring_header* pHeader = pReader->pHeader;
+   if ( VIDEO_SM_RING_MAGIC != __atomic_load_n(&pHeader->uMagic, __ATOMIC_ACQUIRE) )
+      return -1;
+   if ( (VIDEO_SM_RING_VERSION != pHeader->uVersion) || (pReader->uDataSize != pHeader->uDataSize) )
+      return -1;
+
+   // Lets the producer know the reader is alive, even if there is nothing to read
+   __atomic_store_n(&pHeader->uReaderHeartbeat, pHeader->uReaderHeartbeat+1, __ATOMIC_RELEASE);
+
+   u32 uSessionId = 0, uWritePos = 0, uWriteTotal = 0, uNextChunkSeq = 0;
+   if ( ! _video_sm_ring_snapshot(pHeader, &uSessionId, &uWritePos, &uWriteTotal, &uNextChunkSeq) )
+      return 0;
+
+   if ( (! pReader->bSynced) || (uSessionId != pReader->uSessionId) )
+   {
+      _video_sm_ring_resync(pReader, uSessionId, uWritePos, uWriteTotal, uNextChunkSeq);
+      return 0;
+   }
+
+   if ( uWriteTotal - pReader->uReadTotal > pReader->uDataSize )
+   {
+      pReader->uStatsOverruns++;
+      __atomic_store_n(&pHeader->uReaderOverruns, pReader->uStatsOverruns, __ATOMIC_RELAXED);
+      _video_sm_ring_resync(pReader, uSessionId, uWritePos, uWriteTotal, uNextChunkSeq);
+      return 0;
+   }
+
+   u32 uOutputPos = 0;
+   while ( pReader->uReadTotal != uWriteTotal )
+   {
+      u32 uTail = pReader->uDataSize - pReader->uReadPos;
+      if ( uTail < sizeof(type_video_sm_ring_chunk_header) )
+      {
+         pReader->uReadPos = 0;
+         pReader->uReadTotal += uTail;
+         continue;
+      }
+
+      type_video_sm_ring_chunk_header chunk;
+      memcpy(&chunk, pReader->pData + pReader->uReadPos, sizeof(type_video_sm_ring_chunk_header));
+
+      int bValid = 1;
+      if ( (chunk.uChunkSeq != pReader->uExpectedChunkSeq) ||
+           (chunk.uRecordSize < sizeof(type_video_sm_ring_chunk_header)) ||
+           (chunk.uRecordSize > uTail) ||
+           (0 != (chunk.uRecordSize % VIDEO_SM_RING_ALIGN)) ||
+           (chunk.uRecordSize > uWriteTotal - pReader->uReadTotal) ||
+           (chunk.uLength > chunk.uRecordSize - sizeof(type_video_sm_ring_chunk_header)) )
+         bValid = 0;
+
+      int bStartsStream = 0;
+      u32 uCopyFrom = 0;
+      u32 uCopyLength = 0;
+      if ( bValid && (!(chunk.uFlags & VIDEO_SM_RING_CHUNK_FLAG_WRAP)) )
+      {
+         if ( pReader->bWaitingForKeyframe || (chunk.uFlags & VIDEO_SM_RING_CHUNK_FLAG_DISCONTINUITY) )
+         {
+            if ( (chunk.uFlags & VIDEO_SM_RING_CHUNK_FLAG_KEYFRAME) && (chunk.uKeyframeOffset < chunk.uLength) )
+            {
+               bStartsStream = 1;
+               uCopyFrom = chunk.uKeyframeOffset;
+               uCopyLength = chunk.uLength - chunk.uKeyframeOffset;
+            }
+            else
+            {
+               pReader->bWaitingForKeyframe = 1;
+               pReader->uStatsSkippedChunks++;
+            }
+         }
+         else
+            uCopyLength = chunk.uLength;
+
+         if ( uCopyLength > uOutputSize - uOutputPos )
+         {
+            if ( uOutputPos > 0 )
+               break;
+            // Output buffer too small for this chunk: drop it and restart from a keyframe
+            bStartsStream = 0;
+            uCopyLength = 0;
+            pReader->bWaitingForKeyframe = 1;
+            pReader->uStatsSkippedChunks++;
+         }
+         if ( uCopyLength > 0 )
+            memcpy(pOutput + uOutputPos, pReader->pData + pReader->uReadPos + sizeof(type_video_sm_ring_chunk_header) + uCopyFrom, uCopyLength);
+      }
+
+      // Check that the producer did not start overwriting this chunk while it was copied
+      __atomic_thread_fence(__ATOMIC_ACQUIRE);
+      u32 uReserveTotal = __atomic_load_n(&pHeader->uReserveTotal, __ATOMIC_RELAXED);
+      if ( (!bValid) || (uReserveTotal - pReader->uReadTotal > pReader->uDataSize) )
+      {
+         pReader->uStatsOverruns++;
+         __atomic_store_n(&pHeader->uReaderOverruns, pReader->uStatsOverruns, __ATOMIC_RELAXED);
+         if ( _video_sm_ring_snapshot(pHeader, &uSessionId, &uWritePos, &uWriteTotal, &uNextChunkSeq) )
+            _video_sm_ring_resync(pReader, uSessionId, uWritePos, uWriteTotal, uNextChunkSeq);
+         else
+            pReader->bSynced = 0;
+         return (int)uOutputPos;
+      }
+
+      if ( bStartsStream )
+      {
+         if ( (! pReader->bWaitingForKeyframe) && (chunk.uFlags & VIDEO_SM_RING_CHUNK_FLAG_DISCONTINUITY) )
+            pReader->uStatsDiscontinuities++;
+         pReader->bWaitingForKeyframe = 0;
+      }
+      uOutputPos += uCopyLength;
+
+      pReader->uReadPos += chunk.uRecordSize;
+      if ( pReader->uReadPos >= pReader->uDataSize )
+         pReader->uReadPos = 0;
+      pReader->uReadTotal += chunk.uRecordSize;
+      pReader->uExpectedChunkSeq++;
+   }
+
+   __atomic_store_n(&pHeader->uReaderTotal, pReader->uReadTotal, __ATOMIC_RELEASE);
+   return (int)uOutputPos;
+}
+
+u32 video_sm_ring_get_reader_lag(type_video_sm_ring_reader* pReader)
+{
+   if ( (NULL == pReader) || (NULL == pReader->pHeader) || (! pReader->bSynced) )
+      return 0;
+   return __atomic_load_n(&pReader->pHeader->uWriteTotal, __ATOMIC_ACQUIRE) - pReader->uReadTotal;
+}
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "../base/base.h"
+
+// Layout of the SM_STREAMER shared memory used to pass the received video stream
+// from ruby_rt_station to the local video player (ruby_player_radxa).
+//
+// [ring header][chunk header + payload][chunk header + payload]...
+//
+// - The producer writes one chunk per video data block. Chunks never wrap: if a chunk
+//   does not fit at the end of the data area, a wrap chunk fills the tail and writing
+//   continues at the start of the data area.
+// - Write position and totals are published seqlock style (uWriteSeq is odd while a chunk
+//   is being written). uReserveTotal is published before any chunk byte is written, so
+//   a reader can check after copying a chunk that it was not overwritten meanwhile.
+// - Totals are monotonic byte counters (they wrap around u32 naturally); the difference
+//   between the producer total and the reader total is the reader lag in bytes.
+// - The reader publishes its position (watermark) and a heartbeat counter. While a reader
+//   is alive, the producer drops non keyframe chunks when the reader lags behind, instead
+//   of lapping it, and marks the next keyframe chunk as a discontinuity.
+// - If the reader gets lapped anyway or the producer restarts the stream, the reader
+//   discards chunks until the next chunk containing a keyframe (SPS/VPS/IDR) and restarts
+//   feeding the decoder from that keyframe.
+
+#define VIDEO_SM_RING_MAGIC 0x47525356
+#define VIDEO_SM_RING_VERSION 1
+
+#define VIDEO_SM_RING_CHUNK_FLAG_KEYFRAME 0x01
+#define VIDEO_SM_RING_CHUNK_FLAG_WRAP 0x02
+// Producer dropped chunks before this one
+#define VIDEO_SM_RING_CHUNK_FLAG_DISCONTINUITY 0x04
+
+// Producer stops writing non keyframe chunks above this reader lag (percent of the data area)
+#define VIDEO_SM_RING_HIGH_WATERMARK_PERCENT 75
+// Reader is considered gone if its heartbeat did not change for this long
+#define VIDEO_SM_RING_READER_TIMEOUT_MS 500
+
+typedef struct
+{
+   u32 uMagic;
+   u32 uVersion;
+   u32 uHeaderSize;
+   u32 uDataSize;
+   u32 uReserved[12];
+
+   // Written only by the producer
+   volatile u32 uWriteSeq;
+   volatile u32 uSessionId;
+   volatile u32 uWritePos;
+   volatile u32 uWriteTotal;
+   volatile u32 uReserveTotal;
+   volatile u32 uNextChunkSeq;
+   volatile u32 uStatsWrittenChunks;
+   volatile u32 uStatsDroppedChunks;
+   u32 uReserved2[8];
+
+   // Written only by the reader
+   volatile u32 uReaderTotal;
+   volatile u32 uReaderHeartbeat;
+   volatile u32 uReaderOverruns;
+   volatile u32 uReaderResyncs;
+   u32 uReserved3[12];
+} __attribute__((aligned(64))) type_video_sm_ring_header;
+
+typedef struct
+{
+   u32 uChunkSeq;
+   u32 uRecordSize; // header + payload, rounded up to VIDEO_SM_RING_ALIGN
+   u32 uLength;
+   u32 uFlags;
+   u32 uKeyframeOffset; // offset in payload of the keyframe start code, if VIDEO_SM_RING_CHUNK_FLAG_KEYFRAME
+   u32 uTimestampMs;
+} type_video_sm_ring_chunk_header;
+
+#define VIDEO_SM_RING_ALIGN 8
+
+typedef struct
+{
+   type_video_sm_ring_header* pHeader;
+   u8* pData;
+   u32 uDataSize;
+   int bDroppingUntilKeyframe;
+   int bMustMarkDiscontinuity;
+   u32 uLastReaderHeartbeat;
+   u32 uTimeLastReaderHeartbeatChange;
+   volatile int iResetPending; // Set by video_sm_ring_writer_reset(), applied by the next write
+} type_video_sm_ring_writer;
+
+typedef struct
+{
+   type_video_sm_ring_header* pHeader;
+   u8* pData;
+   u32 uDataSize;
+   int bSynced;
+   int bWaitingForKeyframe;
+   u32 uSessionId;
+   u32 uReadPos;
+   u32 uReadTotal;
+   u32 uExpectedChunkSeq;
+
+   u32 uStatsOverruns;
+   u32 uStatsResyncs;
+   u32 uStatsSkippedChunks;
+   u32 uStatsDiscontinuities;
+} type_video_sm_ring_reader;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Formats the ring header in the shared memory. Returns 0 on success.
+int video_sm_ring_writer_init(type_video_sm_ring_writer* pWriter, u8* pMem, u32 uMemSize);
+// Starts a new stream session: readers drop what they have and resync at the next keyframe.
+// Can be called from any thread: the new session starts with the next video_sm_ring_write().
+void video_sm_ring_writer_reset(type_video_sm_ring_writer* pWriter);
+// Returns 1 if written, 0 if dropped because the reader is lagging, -1 on error.
+int video_sm_ring_write(type_video_sm_ring_writer* pWriter, u8* pData, u32 uLength, int iKeyframeOffset, u32 uTimeNowMs);
+
+// Returns the offset of the first SPS/VPS/IDR start code in the buffer or -1 if none.
+int video_sm_ring_find_keyframe_offset(u8* pData, u32 uLength, int bIsH265);
+
+int video_sm_ring_reader_init(type_video_sm_ring_reader* pReader, u8* pMem, u32 uMemSize);
+// Copies as many whole chunks as fit into pOutput, starting from a keyframe after any resync.
+// Returns the number of bytes copied (0 if nothing new) or -1 if the ring is not formatted (yet).
+int video_sm_ring_read(type_video_sm_ring_reader* pReader, u8* pOutput, u32 uOutputSize);
+// Reader lag in bytes, as seen at the last read.
+u32 video_sm_ring_get_reader_lag(type_video_sm_ring_reader* pReader);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1092,6 +1092,38 @@ int radio_stats_update_on_new_radio_packet_received(shared_mem_radio_stats* pSMR
 }
 
 
+// Packets rejected as duplicates before they are decrypted and CRC checked: they are not known
+// to be good or bad, so they only go in the duplicates count. The interface still received them,
+// so the rx time and the radio link packet index are updated (no false lost packets).
+
+int radio_stats_update_on_duplicate_packet_received(shared_mem_radio_stats* pSMRS, u32 timeNow, int iInterfaceIndex, u8* pPacketBuffer, int iPacketLength)
+{
+   if ( (NULL == pSMRS) || (NULL == pPacketBuffer) || (iInterfaceIndex < 0) || (iInterfaceIndex >= MAX_RADIO_INTERFACES) )
+      return -1;
+
+   pSMRS->timeLastRxPacket = timeNow;
+
+   u32 uTimeGap = timeNow - pSMRS->radio_interfaces[iInterfaceIndex].timeLastRxPacket;
+   if ( 0 == pSMRS->radio_interfaces[iInterfaceIndex].timeLastRxPacket )
+      uTimeGap = 0;
+   if ( uTimeGap > 254 )
+      uTimeGap = 254;
+   if ( pSMRS->radio_interfaces[iInterfaceIndex].hist_rxGapMiliseconds[pSMRS->radio_interfaces[iInterfaceIndex].hist_rxPacketsCurrentIndex] == 0xFF )
+      pSMRS->radio_interfaces[iInterfaceIndex].hist_rxGapMiliseconds[pSMRS->radio_interfaces[iInterfaceIndex].hist_rxPacketsCurrentIndex] = uTimeGap;
+   else if ( uTimeGap > pSMRS->radio_interfaces[iInterfaceIndex].hist_rxGapMiliseconds[pSMRS->radio_interfaces[iInterfaceIndex].hist_rxPacketsCurrentIndex] )
+      pSMRS->radio_interfaces[iInterfaceIndex].hist_rxGapMiliseconds[pSMRS->radio_interfaces[iInterfaceIndex].hist_rxPacketsCurrentIndex] = uTimeGap;
+   pSMRS->radio_interfaces[iInterfaceIndex].timeLastRxPacket = timeNow;
+
+   pSMRS->radio_interfaces[iInterfaceIndex].totalRxBytes += iPacketLength;
+   pSMRS->radio_interfaces[iInterfaceIndex].tmpRxBytes += iPacketLength;
+   pSMRS->radio_interfaces[iInterfaceIndex].totalRxPacketsDuplicates++;
+
+   t_packet_header* pPH = (t_packet_header*)pPacketBuffer;
+   if ( 0 != pPH->radio_link_packet_index )
+      pSMRS->radio_interfaces[iInterfaceIndex].lastReceivedRadioLinkPacketIndex = pPH->radio_link_packet_index;
+   return 1;
+}
+
 // Returns 1 if ok, -1 for error
 
 int radio_stats_update_on_unique_packet_received(shared_mem_radio_stats* pSMRS, u32 timeNow, int iInterfaceIndex, u8* pPacketBuffer, int iPacketLength)
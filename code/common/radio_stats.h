@@ -27,6 +27,7 @@ void radio_stats_set_card_current_frequency(shared_mem_radio_stats* pSMRS, int i
 void radio_stats_set_bad_data_on_current_rx_interval(shared_mem_radio_stats* pSMRS, int iRadioInterface);
 
 int  radio_stats_update_on_new_radio_packet_received(shared_mem_radio_stats* pSMRS, u32 timeNow, int iInterfaceIndex, u8* pPacketBuffer, int iPacketLength, int iIsShortPacket, int iDataIsOk);
+int  radio_stats_update_on_duplicate_packet_received(shared_mem_radio_stats* pSMRS, u32 timeNow, int iInterfaceIndex, u8* pPacketBuffer, int iPacketLength);
 int  radio_stats_update_on_unique_packet_received(shared_mem_radio_stats* pSMRS, u32 timeNow, int iInterfaceIndex, u8* pPacketBuffer, int iPacketLength);
 void radio_stats_update_on_packet_sent_on_radio_interface(shared_mem_radio_stats* pSMRS, u32 timeNow, int interfaceIndex, int iPacketLength);
 void radio_stats_update_on_packet_sent_on_radio_link(shared_mem_radio_stats* pSMRS, u32 timeNow, int iLocalLinkIndex, int iStreamIndex, int iPacketLength);
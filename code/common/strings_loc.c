@@ -30,8 +30,14 @@
     SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include "../base/base.h"
 #include <ctype.h>
+#include <link.h>
+#include <pthread.h>
 #include "strings_loc.h"
 #include "strings_table.h"
 
@@ -41,8 +47,42 @@ static int s_iCountDynamicLocStrings = 0;
 
 #define STRINGS_HASH_SIZE 7137
 static u16 s_HashTableDynamicStrings[STRINGS_HASH_SIZE];
-static u16 s_HashTableLocStrings[STRINGS_HASH_SIZE];
 
+// Perfect hash of the strings table (English texts), built on init:
+// bucket = hash & mask, slot = mix(hash, bucket seed) & mask; each table string gets its own slot,
+// so a lookup is one hash of the string, one slot read and one strcmp (to reject strings not in the table).
+#define STRINGS_PHASH_MAX_SLOTS 16384
+#define STRINGS_PHASH_MAX_SEED 0xFFFF
+static u16 s_PerfectHashSlots[STRINGS_PHASH_MAX_SLOTS];
+static u16 s_PerfectHashSeeds[STRINGS_PHASH_MAX_SLOTS/4];
+static u32 s_uPerfectHashSlotsMask = 0;
+static u32 s_uPerfectHashBucketsMask = 0;
+static int s_iPerfectHashReady = 0;
+
+// Localized text of each strings table entry, for the active language
+static const char** s_pResolvedStrings = NULL;
+static int s_iCountResolvedStrings = 0;
+
+// Lookups memoized by the address of the string, only for strings in the read only segments of the
+// executable (string literals), as their content can't change. Entries are only added (under the mutex)
+// and hold the strings table index, so a language change does not invalidate them.
+#define STRINGS_MEMO_SIZE 4096
+#define STRINGS_MEMO_MAX_ENTRIES 3072
+#define STRINGS_MEMO_MAX_PROBES 16
+#define STRINGS_MEMO_NOT_IN_TABLE 0xFFFF
+typedef struct
+{
+   const char* pKey;
+   u16 uTableIndex;
+} type_loc_strings_memo;
+static type_loc_strings_memo s_LocStringsMemo[STRINGS_MEMO_SIZE];
+static int s_iCountLocStringsMemo = 0;
+static pthread_mutex_t s_MutexLocStringsMemo = PTHREAD_MUTEX_INITIALIZER;
+
+#define STRINGS_MAX_RO_RANGES 8
+static uintptr_t s_uReadOnlyRangesStart[STRINGS_MAX_RO_RANGES];
+static uintptr_t s_uReadOnlyRangesEnd[STRINGS_MAX_RO_RANGES];
+static int s_iCountReadOnlyRanges = 0;
 
 static const char* s_szLanguages[] = { "Chinese", "English", "French", "German", "Hindi", "Russian", "Spanish" };
 static const char* s_szStringTableEmptyText = "";
@@ -50,6 +90,8 @@ static const char* s_szStringTableMissingText = "missing text";
 static int s_iActiveLanguage = 1;
 static int s_iLocalizationInited = 0;
 
+static void _loc_strings_resolve_active_language();
+
 int getLanguagesCount()
 {
    return sizeof(s_szLanguages)/sizeof(s_szLanguages[0]);
@@ -65,6 +107,8 @@ const char* getLanguageName(int iIndex)
 void setActiveLanguage(int iLanguage)
 {
    s_iActiveLanguage = iLanguage;
+   if ( s_iLocalizationInited )
+      _loc_strings_resolve_active_language();
 }
 
 int getActiveLanguage()
@@ -128,105 +172,326 @@ const char* _check_add_dynamic_loc_string(const char* szString)
    return s_szDynamicLocStringsList[s_iCountDynamicLocStrings-1];
 }
 
-void initLocalizationData()
+// Hashes 8 bytes at a time, the length is known (strlen is fast)
+static u32 _loc_string_compute_full_hash(const char* szString, int iLen)
 {
-   for( int i=0; i<STRINGS_HASH_SIZE; i++ )
+   unsigned long long uHash = (unsigned long long)iLen * 0x9E3779B97F4A7C15ULL;
+   unsigned long long uWord = 0;
+   while ( iLen >= 8 )
    {
-      s_HashTableDynamicStrings[i] = 0xFFFF;
-      s_HashTableLocStrings[i] = 0xFFFF;
+      memcpy(&uWord, szString, 8);
+      uHash = (uHash ^ uWord) * 0xFF51AFD7ED558CCDULL;
+      uHash ^= uHash >> 32;
+      szString += 8;
+      iLen -= 8;
+   }
+   if ( iLen > 0 )
+   {
+      uWord = 0;
+      memcpy(&uWord, szString, iLen);
+      uHash = (uHash ^ uWord) * 0xFF51AFD7ED558CCDULL;
+      uHash ^= uHash >> 32;
    }
+   return (u32)uHash;
+}
 
+static u32 _loc_string_get_phash_slot(u32 uHash, u32 uSeed)
+{
+   u32 x = uHash ^ (uSeed * 0x9E3779B9u);
+   x ^= x >> 16;
+   x *= 0x85EBCA6Bu;
+   x ^= x >> 13;
+   x *= 0xC2B2AE35u;
+   x ^= x >> 16;
+   return x & s_uPerfectHashSlotsMask;
+}
+
+static int _loc_string_find_in_table(const char* szString)
+{
    type_localized_strings* pStringsTable = string_get_table();
-   for( int i=0; i<string_get_table_size(); i++ )
+   if ( ! s_iPerfectHashReady )
    {
-      if ( 0 == pStringsTable[i].szEnglish[0] )
-         continue;
-      u16 uHashIndex = _loc_string_compute_hash(pStringsTable[i].szEnglish);
-
-      int iColCount = 0;
-      while ( (s_HashTableLocStrings[uHashIndex] != 0xFFFF) && (iColCount < STRINGS_HASH_SIZE/2) )
+      // Perfect hash could not be built, search the whole table
+      for( int i=0; i<string_get_table_size(); i++ )
       {
-          uHashIndex++;
-          uHashIndex = uHashIndex % STRINGS_HASH_SIZE;
-          iColCount++;
+         if ( 0 == strcmp(pStringsTable[i].szEnglish, szString) )
+            return i;
       }
-      if ( iColCount < STRINGS_HASH_SIZE/2 )
-         s_HashTableLocStrings[uHashIndex] = (u16)i;
+      return -1;
    }
-   s_iLocalizationInited = 1;
-   log_line("Initializing localization data for %d strings for %d languages", string_get_table_size(), getLanguagesCount());
+   int iLen = strlen(szString);
+   u32 uHash = _loc_string_compute_full_hash(szString, iLen);
+   u32 uSlot = _loc_string_get_phash_slot(uHash, s_PerfectHashSeeds[uHash & s_uPerfectHashBucketsMask]);
+   u16 uIndex = s_PerfectHashSlots[uSlot];
+   if ( 0xFFFF == uIndex )
+      return -1;
+   if ( (pStringsTable[uIndex].uHash != uHash) || (0 != strcmp(pStringsTable[uIndex].szEnglish, szString)) )
+      return -1;
+   return uIndex;
 }
 
-const char* L(const char* szString)
+static int _loc_strings_build_perfect_hash(u32 uSlotsCount)
 {
-   if ( !s_iLocalizationInited )
-      initLocalizationData();
+   type_localized_strings* pStringsTable = string_get_table();
+   int iTableSize = string_get_table_size();
+   u32 uBucketsCount = uSlotsCount/4;
+   s_uPerfectHashSlotsMask = uSlotsCount - 1;
+   s_uPerfectHashBucketsMask = uBucketsCount - 1;
 
-   if ( (NULL == szString) || (0 == szString[0] ) )
-      return s_szStringTableEmptyText;
+   for( u32 u=0; u<uSlotsCount; u++ )
+      s_PerfectHashSlots[u] = 0xFFFF;
+   for( u32 u=0; u<uBucketsCount; u++ )
+      s_PerfectHashSeeds[u] = 0;
 
-   if ( (0 == szString[1]) || (0 == szString[2]) )
-   //   return _check_add_dynamic_loc_string(szString);
-      return szString;
+   // Bucket of each string; duplicated strings are skipped, the first one is used, as before
+   int* piBucketHead = (int*) malloc(uBucketsCount * sizeof(int));
+   int* piNext = (int*) malloc(iTableSize * sizeof(int));
+   int* piBucketSize = (int*) malloc(uBucketsCount * sizeof(int));
+   u32* puSlotsTried = (u32*) malloc(iTableSize * sizeof(u32));
+   if ( (NULL == piBucketHead) || (NULL == piNext) || (NULL == piBucketSize) || (NULL == puSlotsTried) )
+   {
+      free(piBucketHead);
+      free(piNext);
+      free(piBucketSize);
+      free(puSlotsTried);
+      return 0;
+   }
+   for( u32 u=0; u<uBucketsCount; u++ )
+   {
+      piBucketHead[u] = -1;
+      piBucketSize[u] = 0;
+   }
 
+   int iCountStrings = 0;
+   int iMaxBucketSize = 0;
+   for( int i=0; i<iTableSize; i++ )
+   {
+      piNext[i] = -1;
+      if ( 0 == pStringsTable[i].szEnglish[0] )
+         continue;
+      pStringsTable[i].uHash = _loc_string_compute_full_hash(pStringsTable[i].szEnglish, strlen(pStringsTable[i].szEnglish));
+      u32 uBucket = pStringsTable[i].uHash & s_uPerfectHashBucketsMask;
+      int iDuplicate = 0;
+      for( int k=piBucketHead[uBucket]; k != -1; k = piNext[k] )
+      {
+         if ( 0 == strcmp(pStringsTable[k].szEnglish, pStringsTable[i].szEnglish) )
+         {
+            iDuplicate = 1;
+            break;
+         }
+      }
+      if ( iDuplicate )
+         continue;
+      piNext[i] = piBucketHead[uBucket];
+      piBucketHead[uBucket] = i;
+      piBucketSize[uBucket]++;
+      if ( piBucketSize[uBucket] > iMaxBucketSize )
+         iMaxBucketSize = piBucketSize[uBucket];
+      iCountStrings++;
+   }
+
+   // Place the biggest buckets first, each one with the first seed that gives free, distinct slots to all its strings
+   int iResult = 1;
+   for( int iSize=iMaxBucketSize; (iSize > 0) && iResult; iSize-- )
+   for( u32 uBucket=0; (uBucket < uBucketsCount) && iResult; uBucket++ )
+   {
+      if ( piBucketSize[uBucket] != iSize )
+         continue;
+      int iPlaced = 0;
+      for( u32 uSeed=0; uSeed<=STRINGS_PHASH_MAX_SEED; uSeed++ )
+      {
+         int iCountTried = 0;
+         int iFits = 1;
+         for( int k=piBucketHead[uBucket]; k != -1; k = piNext[k] )
+         {
+            u32 uSlot = _loc_string_get_phash_slot(pStringsTable[k].uHash, uSeed);
+            if ( s_PerfectHashSlots[uSlot] != 0xFFFF )
+               iFits = 0;
+            for( int t=0; (t<iCountTried) && iFits; t++ )
+               if ( puSlotsTried[t] == uSlot )
+                  iFits = 0;
+            if ( ! iFits )
+               break;
+            puSlotsTried[iCountTried++] = uSlot;
+         }
+         if ( ! iFits )
+            continue;
+         for( int k=piBucketHead[uBucket]; k != -1; k = piNext[k] )
+            s_PerfectHashSlots[_loc_string_get_phash_slot(pStringsTable[k].uHash, uSeed)] = (u16)k;
+         s_PerfectHashSeeds[uBucket] = (u16)uSeed;
+         iPlaced = 1;
+         break;
+      }
+      if ( ! iPlaced )
+         iResult = 0;
+   }
+
+   free(piBucketHead);
+   free(piNext);
+   free(piBucketSize);
+   free(puSlotsTried);
+   if ( iResult )
+      log_line("Built localization strings perfect hash: %d strings, %u slots, %u buckets, max bucket size: %d", iCountStrings, uSlotsCount, uBucketsCount, iMaxBucketSize);
+   return iResult;
+}
+
+static void _loc_strings_resolve_active_language()
+{
    type_localized_strings* pStringsTable = string_get_table();
-   int iStringsTableSize = string_get_table_size();
-   const char* pLocalized = NULL;
-   const char* pEnglish = NULL;
+   for( int i=0; i<s_iCountResolvedStrings; i++ )
+   {
+      const char* pLocalized = pStringsTable[i].szEnglish;
+      if (0 == s_iActiveLanguage )
+         pLocalized = pStringsTable[i].szTranslatedCN;
+      if (2 == s_iActiveLanguage )
+         pLocalized = pStringsTable[i].szTranslatedFR;
+      if (3 == s_iActiveLanguage )
+         pLocalized = pStringsTable[i].szTranslatedDE;
+      if (4 == s_iActiveLanguage )
+         pLocalized = pStringsTable[i].szTranslatedHI;
+      if (5 == s_iActiveLanguage )
+         pLocalized = pStringsTable[i].szTranslatedRU;
+      if (6 == s_iActiveLanguage )
+         pLocalized = pStringsTable[i].szTranslatedSP;
 
-   u16 uHashIndex = _loc_string_compute_hash(szString);
-   int iColCount = 0;
-   int iStringTableIndex = -1;
+      if ( (NULL != pLocalized) && (0 != *pLocalized) )
+         s_pResolvedStrings[i] = pLocalized;
+      else if ( 0 != pStringsTable[i].szEnglish[0] )
+         s_pResolvedStrings[i] = pStringsTable[i].szEnglish;
+      else
+         s_pResolvedStrings[i] = s_szStringTableMissingText;
+   }
+}
 
-   while ( (s_HashTableLocStrings[uHashIndex] != 0xFFFF) && (iColCount < STRINGS_HASH_SIZE/2) )
+static int _loc_strings_add_read_only_ranges(struct dl_phdr_info* pInfo, size_t uSize, void* pData)
+{
+   // Only the executable (first object), shared libraries can be unloaded
+   for( int i=0; i<pInfo->dlpi_phnum; i++ )
    {
-       if ( s_HashTableLocStrings[uHashIndex] < iStringsTableSize )
-       if ( 0 == strcmp(pStringsTable[s_HashTableLocStrings[uHashIndex]].szEnglish, szString) )
-       {
-          iStringTableIndex = s_HashTableLocStrings[uHashIndex];
-          pEnglish = pStringsTable[s_HashTableLocStrings[uHashIndex]].szEnglish;
-          if (0 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szTranslatedCN;
-          if (1 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szEnglish;
-          if (2 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szTranslatedFR;
-          if (3 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szTranslatedDE;
-          if (4 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szTranslatedHI;
-          if (5 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szTranslatedRU;
-          if (6 == s_iActiveLanguage )
-             pLocalized = pStringsTable[s_HashTableLocStrings[uHashIndex]].szTranslatedSP;
-          break;
-       }
-       uHashIndex++;
-       uHashIndex = uHashIndex % STRINGS_HASH_SIZE;
-       iColCount++;
+      if ( (pInfo->dlpi_phdr[i].p_type != PT_LOAD) || (pInfo->dlpi_phdr[i].p_flags & PF_W) )
+         continue;
+      if ( s_iCountReadOnlyRanges >= STRINGS_MAX_RO_RANGES )
+         break;
+      s_uReadOnlyRangesStart[s_iCountReadOnlyRanges] = pInfo->dlpi_addr + pInfo->dlpi_phdr[i].p_vaddr;
+      s_uReadOnlyRangesEnd[s_iCountReadOnlyRanges] = s_uReadOnlyRangesStart[s_iCountReadOnlyRanges] + pInfo->dlpi_phdr[i].p_memsz;
+      s_iCountReadOnlyRanges++;
    }
-   
-   if ( (NULL == pLocalized) || (-1 == iStringTableIndex) || ( 0 != strcmp(pStringsTable[iStringTableIndex].szEnglish, szString)) ||
-      (strlen(szString) != strlen(pStringsTable[iStringTableIndex].szEnglish)) )
+   return 1;
+}
+
+static int _loc_string_is_read_only(const char* szString)
+{
+   uintptr_t uAddress = (uintptr_t)szString;
+   for( int i=0; i<s_iCountReadOnlyRanges; i++ )
    {
-      return szString;
+      if ( (uAddress >= s_uReadOnlyRangesStart[i]) && (uAddress < s_uReadOnlyRangesEnd[i]) )
+         return 1;
    }
+   return 0;
+}
 
-   if ( iColCount >= STRINGS_HASH_SIZE/2 )
-      return s_szStringTableMissingText;
+static u32 _loc_string_get_memo_index(const char* szString)
+{
+   uintptr_t uAddress = (uintptr_t)szString;
+   u32 x = (u32)(uAddress ^ (uAddress >> 13) ^ ((unsigned long long)uAddress >> 32));
+   x *= 0x9E3779B1u;
+   return (x >> 16) & (STRINGS_MEMO_SIZE-1);
+}
 
-   if ( (NULL != pLocalized) && (NULL != pEnglish) )
+static void _loc_string_add_memo(const char* szString, int iTableIndex)
+{
+   pthread_mutex_lock(&s_MutexLocStringsMemo);
+   if ( s_iCountLocStringsMemo < STRINGS_MEMO_MAX_ENTRIES )
    {
-      if ( 0 != *pLocalized )
+      u32 uIndex = _loc_string_get_memo_index(szString);
+      for( int i=0; i<STRINGS_MEMO_MAX_PROBES; i++ )
       {
-         return pLocalized;
+         const char* pKey = s_LocStringsMemo[uIndex].pKey;
+         if ( pKey == szString )
+            break;
+         if ( NULL == pKey )
+         {
+            s_LocStringsMemo[uIndex].uTableIndex = (iTableIndex < 0)?STRINGS_MEMO_NOT_IN_TABLE:(u16)iTableIndex;
+            __atomic_store_n(&s_LocStringsMemo[uIndex].pKey, szString, __ATOMIC_RELEASE);
+            s_iCountLocStringsMemo++;
+            break;
+         }
+         uIndex = (uIndex+1) & (STRINGS_MEMO_SIZE-1);
       }
-      if ( 0 != *pEnglish )
+   }
+   pthread_mutex_unlock(&s_MutexLocStringsMemo);
+}
+
+void initLocalizationData()
+{
+   for( int i=0; i<STRINGS_HASH_SIZE; i++ )
+      s_HashTableDynamicStrings[i] = 0xFFFF;
+
+   pthread_mutex_lock(&s_MutexLocStringsMemo);
+   for( int i=0; i<STRINGS_MEMO_SIZE; i++ )
+      __atomic_store_n(&s_LocStringsMemo[i].pKey, NULL, __ATOMIC_RELEASE);
+   s_iCountLocStringsMemo = 0;
+   pthread_mutex_unlock(&s_MutexLocStringsMemo);
+
+   if ( 0 == s_iCountReadOnlyRanges )
+      dl_iterate_phdr(_loc_strings_add_read_only_ranges, NULL);
+
+   int iTableSize = string_get_table_size();
+   u32 uSlotsCount = 64;
+   while ( uSlotsCount < (u32)iTableSize*2 )
+      uSlotsCount *= 2;
+   s_iPerfectHashReady = 0;
+   while ( (!s_iPerfectHashReady) && (uSlotsCount <= STRINGS_PHASH_MAX_SLOTS) && (iTableSize < 0xFFFF) )
+   {
+      s_iPerfectHashReady = _loc_strings_build_perfect_hash(uSlotsCount);
+      uSlotsCount *= 2;
+   }
+   if ( ! s_iPerfectHashReady )
+      log_softerror_and_alarm("Failed to build the localization strings perfect hash for %d strings. Using table search.", iTableSize);
+
+   if ( NULL != s_pResolvedStrings )
+      free((void*)s_pResolvedStrings);
+   s_pResolvedStrings = (const char**) malloc(iTableSize * sizeof(const char*));
+   s_iCountResolvedStrings = (NULL != s_pResolvedStrings)?iTableSize:0;
+   _loc_strings_resolve_active_language();
+
+   s_iLocalizationInited = 1;
+   log_line("Initializing localization data for %d strings for %d languages", string_get_table_size(), getLanguagesCount());
+}
+
+const char* L(const char* szString)
+{
+   if ( !s_iLocalizationInited )
+      initLocalizationData();
+
+   if ( (NULL == szString) || (0 == szString[0] ) )
+      return s_szStringTableEmptyText;
+
+   u32 uMemoIndex = _loc_string_get_memo_index(szString);
+   for( int i=0; i<STRINGS_MEMO_MAX_PROBES; i++ )
+   {
+      const char* pKey = __atomic_load_n(&s_LocStringsMemo[uMemoIndex].pKey, __ATOMIC_ACQUIRE);
+      if ( NULL == pKey )
+         break;
+      if ( pKey == szString )
       {
-         return pEnglish;
+         u16 uTableIndex = s_LocStringsMemo[uMemoIndex].uTableIndex;
+         if ( (uTableIndex == STRINGS_MEMO_NOT_IN_TABLE) || (uTableIndex >= s_iCountResolvedStrings) )
+            return szString;
+         return s_pResolvedStrings[uTableIndex];
       }
-      return s_szStringTableMissingText;
+      uMemoIndex = (uMemoIndex+1) & (STRINGS_MEMO_SIZE-1);
    }
-   return _check_add_dynamic_loc_string(szString);
-   //return szString;
+
+   if ( (0 == szString[1]) || (0 == szString[2]) )
+   //   return _check_add_dynamic_loc_string(szString);
+      return szString;
+
+   int iStringTableIndex = _loc_string_find_in_table(szString);
+   if ( _loc_string_is_read_only(szString) )
+      _loc_string_add_memo(szString, iStringTableIndex);
+
+   if ( (iStringTableIndex < 0) || (iStringTableIndex >= s_iCountResolvedStrings) )
+      return szString;
+   return s_pResolvedStrings[iStringTableIndex];
 }
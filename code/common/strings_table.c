@@ -34,7 +34,8 @@
 #include <ctype.h>
 #include "strings_table.h"
 
-#if defined (HW_PLATFORM_RADXA) || defined (HW_PLATFORM_RASPBERRY)
+// RUBY_BUILD_STRINGS_TABLE: full table on other builds too (tests)
+#if defined (HW_PLATFORM_RADXA) || defined (HW_PLATFORM_RASPBERRY) || defined (RUBY_BUILD_STRINGS_TABLE)
 
 type_localized_strings s_LocalizedStringsTable[] = 
 {
@@ -40,6 +40,7 @@
 #include "../../base/utils.h"
 #include "../pairing.h"
 #include "../link_watch.h"
+#include "../render_thread.h"
 
 
 
@@ -65,6 +66,9 @@ void MenuControllerDev::addItems()
    removeAllItems();
 
    m_IndexMPPBuffers = -1;
+   m_IndexOSDRenderMode = -1;
+   m_IndexOSDRenderThread = -1;
+   m_IndexOSDPluginsBudget = -1;
    if ( (NULL == pCS) || (NULL == pP) )
       return;
 
@@ -127,6 +131,42 @@ void MenuControllerDev::addItems()
    m_pItemsSelect[3]->setSelection( (pCS->iRenderFPS-10)/5 );
    m_IndexRenderOSDFSP = addMenuItem(m_pItemsSelect[3]);
 
+   m_IndexOSDRenderMode = -1;
+   m_IndexOSDRenderThread = -1;
+   if ( hardware_board_is_radxa(hardware_getBoardType()) )
+   {
+      m_pItemsSelect[15] = new MenuItemSelect("OSD Render Mode", "Redraw the whole screen on each frame or only the parts that changed. The debug mode shows the redrawn parts.");
+      m_pItemsSelect[15]->addSelection("Full Redraw");
+      m_pItemsSelect[15]->addSelection("Changed Parts");
+      m_pItemsSelect[15]->addSelection("Changed Parts (Debug)");
+      m_pItemsSelect[15]->setIsEditable();
+      m_pItemsSelect[15]->setSelectedIndex(pP->iOSDRenderMode);
+      m_IndexOSDRenderMode = addMenuItem(m_pItemsSelect[15]);
+
+      m_pItemsSelect[16] = new MenuItemSelect("OSD Render Thread", "Draw the OSD from a separate thread, at the display refresh, so that a slow frame does not delay the processing of input and telemetry.");
+      m_pItemsSelect[16]->addSelection("Off");
+      m_pItemsSelect[16]->addSelection("On");
+      m_pItemsSelect[16]->setIsEditable();
+      m_pItemsSelect[16]->setSelectedIndex(pP->iOSDRenderThread);
+      m_IndexOSDRenderThread = addMenuItem(m_pItemsSelect[16]);
+   }
+
+   m_pItemsSelect[17] = new MenuItemSelect("OSD Plugins Time Budget", "Max average render time of an OSD plugin for each frame. Slower plugins are rendered less often and their last drawing is shown in between.");
+   m_pItemsSelect[17]->addSelection("No Limit");
+   m_pItemsSelect[17]->addSelection("1 ms");
+   m_pItemsSelect[17]->addSelection("2 ms");
+   m_pItemsSelect[17]->addSelection("4 ms");
+   m_pItemsSelect[17]->addSelection("8 ms");
+   m_pItemsSelect[17]->addSelection("16 ms");
+   m_pItemsSelect[17]->setIsEditable();
+   m_pItemsSelect[17]->setSelectedIndex(0);
+   for( int i=1; i<6; i++ )
+   {
+      if ( pP->iOSDPluginsRenderBudget >= (1<<(i-1)) )
+         m_pItemsSelect[17]->setSelectedIndex(i);
+   }
+   m_IndexOSDPluginsBudget = addMenuItem(m_pItemsSelect[17]);
+
    m_pItemsSelect[13] = new MenuItemSelect("Show UI/OSD CPU Usage", "Shows the CPU resources used by the UI and OSD interface.");
    m_pItemsSelect[13]->addSelection("No");
    m_pItemsSelect[13]->addSelection("Yes");
@@ -282,6 +322,35 @@ void MenuControllerDev::onSelectItem()
       return;
    }
 
+   if ( (-1 != m_IndexOSDRenderMode) && (m_IndexOSDRenderMode == m_SelectedIndex) )
+   {
+      pP->iOSDRenderMode = m_pItemsSelect[15]->getSelectedIndex();
+      save_Preferences();
+      valuesToUI();
+      return;
+   }
+
+   if ( (-1 != m_IndexOSDRenderThread) && (m_IndexOSDRenderThread == m_SelectedIndex) )
+   {
+      pP->iOSDRenderThread = m_pItemsSelect[16]->getSelectedIndex();
+      save_Preferences();
+      if ( pP->iOSDRenderThread )
+         render_thread_start();
+      else
+         render_thread_stop();
+      valuesToUI();
+      return;
+   }
+
+   if ( m_IndexOSDPluginsBudget == m_SelectedIndex )
+   {
+      int iIndex = m_pItemsSelect[17]->getSelectedIndex();
+      pP->iOSDPluginsRenderBudget = (iIndex > 0)?(1<<(iIndex-1)):0;
+      save_Preferences();
+      valuesToUI();
+      return;
+   }
+
    if ( m_IndexCPULoad == m_SelectedIndex )
    {
       pP->iShowCPULoad = m_pItemsSelect[13]->getSelectedIndex();
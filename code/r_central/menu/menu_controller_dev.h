@@ -28,6 +28,9 @@ class MenuControllerDev: public Menu
       int m_IndexDebugRTStatsConfig;
       int m_IndexMPPBuffers;
       int m_IndexRenderOSDFSP;
+      int m_IndexOSDRenderMode;
+      int m_IndexOSDRenderThread;
+      int m_IndexOSDPluginsBudget;
       int m_IndexCPULoad;
       int m_IndexFreezeOSD;
       int m_IndexStreamerMode;
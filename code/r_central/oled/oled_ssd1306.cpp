@@ -11,7 +11,7 @@
 #if defined(HW_CAPABILITY_I2C) && defined(HW_PLATFORM_RASPBERRY)
 #include <wiringPiI2C.h>
 #endif
-#if defined(HW_CAPABILITY_I2C) && defined(HW_PLATFORM_RADXA)
+#if defined(HW_PLATFORM_RADXA)
 #include "../../base/wiringPiI2C_radxa.h"
 #endif
 
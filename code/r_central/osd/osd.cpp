@@ -71,6 +71,7 @@
 
 bool s_bDebugOSDShowAll = false;
 bool s_bOSDDisableRendering = false;
+bool s_bOSDRenderUnpaired = false;
 u32 s_RenderCount = 0;
 
 bool s_bShowOSDFlightEndStats = false;
@@ -94,6 +95,11 @@ void osd_enable_rendering()
    s_bOSDDisableRendering = false;
 }
 
+void osd_set_render_unpaired(bool bRenderUnpaired)
+{
+   s_bOSDRenderUnpaired = bRenderUnpaired;
+}
+
 
 void osd_add_stats_flight_end()
 {
@@ -2822,9 +2828,15 @@ void osd_render_all()
       Model* pModel = osd_get_current_data_source_vehicle_model();
       if ( (NULL == pModel) || (0 == g_uActiveControllerModelVID) )
          return;
+      g_pRenderEngine->beginLayer(OSD_LAYER_INSTRUMENTS);
       osd_render_instruments();
+      g_pRenderEngine->endLayer();
+      g_pRenderEngine->beginLayer(OSD_LAYER_WIDGETS);
       osd_widgets_render(pModel->uVehicleId, osd_get_current_layout_index());
+      g_pRenderEngine->endLayer();
+      g_pRenderEngine->beginLayer(OSD_LAYER_PLUGINS);
       osd_plugins_render();
+      g_pRenderEngine->endLayer();
       return;
    }
 
@@ -2836,7 +2848,7 @@ void osd_render_all()
    if ( ! (pModel->osd_params.osd_flags3[osd_get_current_layout_index()] & OSD_FLAG3_LAYOUT_ENABLED_PLUGINS_ONLY) )
       return;
 
-   if ( ! pairing_isStarted() )
+   if ( (! pairing_isStarted()) && (! s_bOSDRenderUnpaired) )
       return;
 
    Preferences* p = get_Preferences();
@@ -2845,13 +2857,17 @@ void osd_render_all()
 
    if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
    if ( (NULL != p) && (p->iShowProcessesMonitor) )
+   {
+      g_pRenderEngine->beginLayer(OSD_LAYER_MONITOR);
       osd_show_monitor();
+      g_pRenderEngine->endLayer();
+   }
 
 
    if ( pModel->is_spectator && (!(pModel->telemetry_params.flags & TELEMETRY_FLAGS_SPECTATOR_ENABLE)) )
       return;
 
-   if ( !pairing_isStarted() )
+   if ( (!pairing_isStarted()) && (! s_bOSDRenderUnpaired) )
       return;
 
    float fAlfaOrg = g_pRenderEngine->getGlobalAlfa();
@@ -2905,8 +2921,14 @@ void osd_render_all()
       if ( pModel->osd_params.osd_flags3[osd_get_current_layout_index()] & OSD_FLAG3_RENDER_MSP_OSD )
       if ( pModel->osd_params.osd_layout_preset[osd_get_current_layout_index()] != OSD_PRESET_NONE )
       if ( ! g_bDebugStats )
+      {
+         g_pRenderEngine->beginLayer(OSD_LAYER_MSP);
          _osd_render_msp(pModel);
+         g_pRenderEngine->endLayer();
+      }
+      g_pRenderEngine->beginLayer(OSD_LAYER_ELEMENTS);
       osd_render_elements();
+      g_pRenderEngine->endLayer();
    }
    // Set again default OSD colors as OSD elements might have just flashed (yellow)
 
@@ -2916,37 +2938,57 @@ void osd_render_all()
 
    if ( ! g_bDebugStats )
    {
+      g_pRenderEngine->beginLayer(OSD_LAYER_INSTRUMENTS);
       if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
          osd_render_instruments();
+      g_pRenderEngine->endLayer();
 
+      g_pRenderEngine->beginLayer(OSD_LAYER_WIDGETS);
       osd_widgets_render(pModel->uVehicleId, osd_get_current_layout_index());
+      g_pRenderEngine->endLayer();
+      g_pRenderEngine->beginLayer(OSD_LAYER_PLUGINS);
       osd_plugins_render();
+      g_pRenderEngine->endLayer();
    }
    g_pRenderEngine->drawBackgroundBoundingBoxes(false);
 
    if ( ! g_bDebugStats )
    {
+      g_pRenderEngine->beginLayer(OSD_LAYER_STATS);
       if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
          osd_render_stats();
+      g_pRenderEngine->endLayer();
 
+      g_pRenderEngine->beginLayer(OSD_LAYER_WARNINGS);
       osd_render_warnings();
+      g_pRenderEngine->endLayer();
    }
 
    if ( g_bDebugStats )
+   {
+      g_pRenderEngine->beginLayer(OSD_LAYER_DEBUG_STATS);
       osd_render_debug_stats();
+      g_pRenderEngine->endLayer();
+   }
 
    if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_ENABLED )
    if ( (NULL != p) && (p->iShowProcessesMonitor) )
+   {
+      g_pRenderEngine->beginLayer(OSD_LAYER_MONITOR);
       osd_show_monitor();
+      g_pRenderEngine->endLayer();
+   }
 
    if ( ! (g_bToglleAllOSDOff || g_bToglleOSDOff) )
    if ( g_pCurrentModel->relay_params.isRelayEnabledOnRadioLinkId >= 0 )
    {
       osd_set_colors();
+      g_pRenderEngine->beginLayer(OSD_LAYER_RELAY);
       if ( pModel->osd_params.osd_flags2[osd_get_current_layout_index()] & OSD_FLAG2_LAYOUT_LEFT_RIGHT )
          osd_render_relay( 0.5, 1.0 - osd_getMarginY(), true);
       else
          osd_render_relay( 0.5, 1.0 - osd_getMarginY() - osd_getBarHeight() - osd_getSecondBarHeight() - osd_getSpacingV(), true);
+      g_pRenderEngine->endLayer();
    }
 
    g_pRenderEngine->drawBackgroundBoundingBoxes(false);
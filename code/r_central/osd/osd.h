@@ -1,11 +1,27 @@
 #pragma once
 
+// Render layers of the OSD sections (for the retained rendering changes detection)
+#define OSD_LAYER_MSP 1
+#define OSD_LAYER_ELEMENTS 2
+#define OSD_LAYER_INSTRUMENTS 3
+#define OSD_LAYER_WIDGETS 4
+#define OSD_LAYER_PLUGINS 5
+#define OSD_LAYER_STATS 6
+#define OSD_LAYER_WARNINGS 7
+#define OSD_LAYER_DEBUG_STATS 8
+#define OSD_LAYER_MONITOR 9
+#define OSD_LAYER_RELAY 10
+// One layer for each OSD plugin: OSD_LAYER_PLUGIN_FIRST + plugin index
+#define OSD_LAYER_PLUGIN_FIRST 32
+
 bool osd_is_debug();
 float osd_show_home(float xPos, float yPos, bool showHeading, float fScale);
 float osd_render_radio_link_tag(float xPos, float yPos, int iRadioLink, bool bVehicle, bool bDraw);
 
 void osd_disable_rendering();
 void osd_enable_rendering();
+// Renders the OSD even if not paired with a vehicle (OSD benchmark)
+void osd_set_render_unpaired(bool bRenderUnpaired);
 void osd_render_all();
 
 void osd_add_stats_flight_end();
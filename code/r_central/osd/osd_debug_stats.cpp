@@ -1194,6 +1194,10 @@ void osd_render_debug_stats()
    
    //sprintf(szBuff, "%03d %03u ms", g_SMControllerRTInfo.iCurrentIndex, g_SMControllerRTInfo.uCurrentSliceStartTime%1000);
    sprintf(szBuff, "Avg: %.1f ms, Max: %.1f ms %s", fAverageSliceUpdateTime, fMaxSliceUpdateTime, szResolution);
+   // Lines this process dropped because its log queue was full
+   u32 uLogDropped = log_get_dropped_messages_count();
+   if ( 0 != uLogDropped )
+      sprintf(szBuff + strlen(szBuff), " Log dropped: %u", uLogDropped);
    g_pRenderEngine->drawTextLeft(rightMargin, yPos, s_idFontStatsSmall, szBuff);
    float y = yPos;
    y += 1.5*height_text*s_OSDStatsLineSpacing;
@@ -60,6 +60,9 @@ plugin_osd_t* g_pPluginsOSD[MAX_OSD_PLUGINS];
 int g_iPluginsOSDCount = 0;
 bool g_bOSDPluginsNeedTelemetryStreams = false;
 
+static u32 s_uOSDPluginsRenderTimeMicros = 0;
+static u32 s_uOSDPluginsPreferencesHash = 0;
+
 void _osd_plugins_populate_public_telemetry_info()
 {
    int iVehicleIndex = osd_get_current_data_source_vehicle_index();
@@ -298,6 +301,16 @@ void _osd_load_plugin(const char* szFile)
    strcpy(g_pPluginsOSD[g_iPluginsOSDCount]->szPluginFile, szFile);
    g_pPluginsOSD[g_iPluginsOSDCount]->bBoundingBox = false;
    g_pPluginsOSD[g_iPluginsOSDCount]->bHighlight = false;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uDrawCacheId = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uDrawCacheInputsHash = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uTimeLastRender = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uRenderTimeAvgMicros = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uRenderTimeMaxMicros = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uTimeLastMaxReset = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uCountRenders = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->uCountCachedFrames = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->iFramesToSkip = 0;
+   g_pPluginsOSD[g_iPluginsOSDCount]->bOverBudget = false;
    g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary = dlopen(szFile, RTLD_LAZY | RTLD_GLOBAL);
 
    if ( g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary == NULL)
@@ -339,6 +352,7 @@ void _osd_load_plugin(const char* szFile)
 
    g_pPluginsOSD[g_iPluginsOSDCount]->pFunctionRequestTelemetryStreams = (int (*)(void)) dlsym(g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary, "requestTelemetryStreams");
    g_pPluginsOSD[g_iPluginsOSDCount]->pFunctionOnTelemetryStreamData = (void (*)(u8*, int, int)) dlsym(g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary, "onTelemetryStreamData");
+   g_pPluginsOSD[g_iPluginsOSDCount]->pFunctionGetRenderCacheInterval = (int (*)(void)) dlsym(g_pPluginsOSD[g_iPluginsOSDCount]->pLibrary, "getRenderCacheInterval");
 
    char* szPluginName = (*(g_pPluginsOSD[g_iPluginsOSDCount]->pFunctionGetName))();
    char* szPluginUID = (*(g_pPluginsOSD[g_iPluginsOSDCount]->pFunctionGetUID))();
@@ -369,10 +383,16 @@ void _osd_load_plugin(const char* szFile)
 void osd_plugins_load()
 {
    for( int i=0; i<g_iPluginsOSDCount; i++ )
+   {
+      if ( (0 != g_pPluginsOSD[i]->uDrawCacheId) && (NULL != g_pRenderEngine) )
+         g_pRenderEngine->freeDrawCache(g_pPluginsOSD[i]->uDrawCacheId);
+      g_pPluginsOSD[i]->uDrawCacheId = 0;
       if ( NULL != g_pPluginsOSD[i]->pLibrary )
          dlclose(g_pPluginsOSD[i]->pLibrary);
+   }
       
    g_iPluginsOSDCount = 0;
+   s_uOSDPluginsRenderTimeMicros = 0;
    g_bOSDPluginsNeedTelemetryStreams = false;
 
    load_PluginsSettings();
@@ -404,6 +424,133 @@ void osd_plugins_load()
    log_line("Loaded %d OSD plugins.", g_iPluginsOSDCount);
 }
 
+// Hash of everything a plugin gets to draw a frame, except the current time
+u32 _osd_plugins_compute_inputs_hash(vehicle_and_telemetry_info_t* pTelemetryInfo, plugin_settings_info_t2* pSettings, float xPos, float yPos, float fWidth, float fHeight)
+{
+   vehicle_and_telemetry_info_t telemetryInfo;
+   vehicle_and_telemetry_info2_t telemetryInfo2;
+   plugin_settings_info_t2 settings;
+   plugin_settings_info_t2_extra settingsExtra;
+
+   memcpy(&telemetryInfo, pTelemetryInfo, sizeof(vehicle_and_telemetry_info_t));
+   memcpy(&telemetryInfo2, pTelemetryInfo->pExtraInfo, sizeof(vehicle_and_telemetry_info2_t));
+   memcpy(&settings, pSettings, sizeof(plugin_settings_info_t2));
+   memcpy(&settingsExtra, pSettings->pExtraInfo, sizeof(plugin_settings_info_t2_extra));
+   telemetryInfo.pExtraInfo = NULL;
+   telemetryInfo2.uTimeNow = 0;
+   telemetryInfo2.uTimeNowVehicle = 0;
+   settings.pExtraInfo = NULL;
+
+   float fPos[4] = { xPos, yPos, fWidth, fHeight };
+   u32 uHash = base_compute_crc32((u8*)&telemetryInfo, sizeof(vehicle_and_telemetry_info_t));
+   uHash = base_compute_crc32_continue(uHash, (u8*)&telemetryInfo2, sizeof(vehicle_and_telemetry_info2_t));
+   uHash = base_compute_crc32_continue(uHash, (u8*)&settings, sizeof(plugin_settings_info_t2));
+   uHash = base_compute_crc32_continue(uHash, (u8*)&settingsExtra, sizeof(plugin_settings_info_t2_extra));
+   uHash = base_compute_crc32_continue(uHash, (u8*)fPos, sizeof(fPos));
+   uHash = base_compute_crc32_continue(uHash, (u8*)&s_uOSDPluginsPreferencesHash, sizeof(u32));
+   return uHash;
+}
+
+// Renders a plugin, or adds the drawing it did last time (from the render engine draw cache) when:
+// - the plugin is over the render time budget: it's rendered only once every few frames;
+// - the plugin asked for cached rendering (getRenderCacheInterval) and its inputs did not change.
+// Returns the time spent in the plugin render function, in microseconds (0 if the cached drawing was used)
+u32 _osd_plugins_render_plugin(int iIndex, vehicle_and_telemetry_info_t* pTelemetryInfo, plugin_settings_info_t2* pSettings, float xPos, float yPos, float fWidth, float fHeight)
+{
+   plugin_osd_t* pPlugin = g_pPluginsOSD[iIndex];
+   Preferences* p = get_Preferences();
+
+   bool bCanCache = g_pRenderEngine->canUseDrawCaches();
+   if ( bCanCache && (0 == pPlugin->uDrawCacheId) )
+   {
+      pPlugin->uDrawCacheId = g_pRenderEngine->createDrawCache();
+      if ( 0 == pPlugin->uDrawCacheId )
+         bCanCache = false;
+   }
+   bool bHasCache = bCanCache && g_pRenderEngine->isDrawCacheValid(pPlugin->uDrawCacheId);
+
+   int iCacheIntervalMs = 0;
+   if ( NULL != pPlugin->pFunctionGetRenderCacheInterval )
+      iCacheIntervalMs = (*(pPlugin->pFunctionGetRenderCacheInterval))();
+
+   u32 uInputsHash = 0;
+   if ( iCacheIntervalMs > 0 )
+      uInputsHash = _osd_plugins_compute_inputs_hash(pTelemetryInfo, pSettings, xPos, yPos, fWidth, fHeight);
+
+   if ( bHasCache )
+   {
+      bool bUseCache = false;
+      if ( pPlugin->bOverBudget && (pPlugin->iFramesToSkip > 0) && (g_TimeNow < pPlugin->uTimeLastRender + 1000) )
+         bUseCache = true;
+      if ( (iCacheIntervalMs > 0) && (uInputsHash == pPlugin->uDrawCacheInputsHash) && (g_TimeNow < pPlugin->uTimeLastRender + (u32)iCacheIntervalMs) )
+         bUseCache = true;
+
+      if ( bUseCache && g_pRenderEngine->drawCache(pPlugin->uDrawCacheId) )
+      {
+         if ( pPlugin->iFramesToSkip > 0 )
+            pPlugin->iFramesToSkip--;
+         pPlugin->uCountCachedFrames++;
+         return 0;
+      }
+   }
+
+   bool bCapture = false;
+   if ( bCanCache )
+      bCapture = g_pRenderEngine->beginDrawCache(pPlugin->uDrawCacheId);
+
+   u32 uTimeStart = get_current_timestamp_micros();
+   (*(pPlugin->pFunctionRender))(pTelemetryInfo, pSettings, xPos, yPos, fWidth, fHeight);
+   u32 uTime = get_current_timestamp_micros() - uTimeStart;
+
+   if ( bCapture )
+      g_pRenderEngine->endDrawCache();
+   else if ( 0 != pPlugin->uDrawCacheId )
+      g_pRenderEngine->invalidateDrawCache(pPlugin->uDrawCacheId);
+
+   pPlugin->uDrawCacheInputsHash = uInputsHash;
+   pPlugin->uTimeLastRender = g_TimeNow;
+   pPlugin->uCountRenders++;
+
+   if ( 1 == pPlugin->uCountRenders )
+      pPlugin->uRenderTimeAvgMicros = uTime;
+   else
+      pPlugin->uRenderTimeAvgMicros = (pPlugin->uRenderTimeAvgMicros*7 + uTime)/8;
+
+   if ( g_TimeNow > pPlugin->uTimeLastMaxReset + 5000 )
+   {
+      pPlugin->uTimeLastMaxReset = g_TimeNow;
+      pPlugin->uRenderTimeMaxMicros = 0;
+   }
+   if ( uTime > pPlugin->uRenderTimeMaxMicros )
+      pPlugin->uRenderTimeMaxMicros = uTime;
+
+   // Render time budget: render a slow plugin once every (average time / budget) frames
+   u32 uBudgetMicros = (u32)p->iOSDPluginsRenderBudget * 1000;
+   bool bOverBudget = (uBudgetMicros > 0) && (pPlugin->uRenderTimeAvgMicros > uBudgetMicros);
+   if ( bOverBudget != pPlugin->bOverBudget )
+   {
+      char* szName = osd_plugins_get_short_name(iIndex);
+      if ( bOverBudget )
+         log_line("OSD plugin [%s] is over the render time budget (%u microsec/frame, budget: %d ms/frame)%s.", (NULL != szName)?szName:"N/A", pPlugin->uRenderTimeAvgMicros, p->iOSDPluginsRenderBudget, bCanCache?", it will be rendered less often":"");
+      else
+         log_line("OSD plugin [%s] is back within the render time budget (%u microsec/frame).", (NULL != szName)?szName:"N/A", pPlugin->uRenderTimeAvgMicros);
+   }
+   pPlugin->bOverBudget = bOverBudget;
+   pPlugin->iFramesToSkip = 0;
+   if ( bOverBudget && bCapture )
+   {
+      pPlugin->iFramesToSkip = (int)(pPlugin->uRenderTimeAvgMicros / uBudgetMicros);
+      if ( pPlugin->iFramesToSkip > 30 )
+         pPlugin->iFramesToSkip = 30;
+   }
+   return uTime;
+}
+
+u32 osd_plugins_get_render_time_micros()
+{
+   return s_uOSDPluginsRenderTimeMicros;
+}
+
 void osd_plugins_render()
 {
    if ( g_bToglleAllOSDOff || g_bToglleOSDOff )
@@ -451,6 +598,8 @@ void osd_plugins_render()
       send_control_message_to_router(PACKET_TYPE_LOCAL_CONTROL_OSD_PLUGINS_NEED_TELEMETRY, (u32)(g_bOSDPluginsNeedTelemetryStreams?1:0));
 
    osd_set_colors();
+   s_uOSDPluginsPreferencesHash = base_compute_crc32((u8*)p, sizeof(Preferences));
+   u32 uTotalRenderTime = 0;
 
    if ( bAnyHighlight )
    {
@@ -493,6 +642,7 @@ void osd_plugins_render()
       vehicle_and_telemetry_info_t telemetry_info;
       vehicle_and_telemetry_info2_t telemetry_info2;
 
+      memset(&telemetry_info2, 0, sizeof(vehicle_and_telemetry_info2_t));
       memcpy(&telemetry_info, &g_VehicleTelemetryInfo, sizeof(vehicle_and_telemetry_info_t));      
       telemetry_info.pExtraInfo = &telemetry_info2;
       telemetry_info2.uTimeNow = g_TimeNow;
@@ -524,6 +674,8 @@ void osd_plugins_render()
       plugin_settings_info_t2 plugin_settings;
       plugin_settings_info_t2_extra plugin_settings_extra_info;
 
+      memset(&plugin_settings, 0, sizeof(plugin_settings_info_t2));
+      memset(&plugin_settings_extra_info, 0, sizeof(plugin_settings_info_t2_extra));
       plugin_settings.uFlags = 0;
       plugin_settings.pExtraInfo = &plugin_settings_extra_info;
       plugin_settings.fLineThicknessPx = 2.0;
@@ -563,7 +715,8 @@ void osd_plugins_render()
       float xPos = osd_getMarginX() + (1.0-2.0*osd_getMarginX())*pPlugin->fXPos[iModelSettingsIndex][osdLayoutIndex];
       float yPos = osd_getMarginY() + (1.0-2.0*osd_getMarginY())*pPlugin->fYPos[iModelSettingsIndex][osdLayoutIndex];
 
-      (*(g_pPluginsOSD[i]->pFunctionRender))(&telemetry_info, &plugin_settings, xPos, yPos, pPlugin->fWidth[iModelSettingsIndex][osdLayoutIndex], pPlugin->fHeight[iModelSettingsIndex][osdLayoutIndex]);
+      g_pRenderEngine->beginLayer(OSD_LAYER_PLUGIN_FIRST + i);
+      uTotalRenderTime += _osd_plugins_render_plugin(i, &telemetry_info, &plugin_settings, xPos, yPos, pPlugin->fWidth[iModelSettingsIndex][osdLayoutIndex], pPlugin->fHeight[iModelSettingsIndex][osdLayoutIndex]);
 
       if ( g_pPluginsOSD[i]->bBoundingBox )
       {
@@ -576,7 +729,10 @@ void osd_plugins_render()
          g_pRenderEngine->setFill(0,0,0,0);
          g_pRenderEngine->drawRect(xPos, yPos, pPlugin->fWidth[iModelSettingsIndex][osdLayoutIndex], pPlugin->fHeight[iModelSettingsIndex][osdLayoutIndex]);
       }
+      g_pRenderEngine->endLayer();
    }
+
+   s_uOSDPluginsRenderTimeMicros = (s_uOSDPluginsRenderTimeMicros*7 + uTotalRenderTime)/8;
 }
 
 int osd_plugins_get_count()
@@ -644,6 +800,9 @@ void osd_plugins_delete(int index)
    if ( index < 0 || index >= g_iPluginsOSDCount )
       return;
 
+   if ( (0 != g_pPluginsOSD[index]->uDrawCacheId) && (NULL != g_pRenderEngine) )
+      g_pRenderEngine->freeDrawCache(g_pPluginsOSD[index]->uDrawCacheId);
+   g_pPluginsOSD[index]->uDrawCacheId = 0;
    if ( NULL != g_pPluginsOSD[index]->pLibrary )
       dlclose(g_pPluginsOSD[index]->pLibrary);
 
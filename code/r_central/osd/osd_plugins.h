@@ -31,9 +31,22 @@ typedef struct
    void (*pFunctionOnNewVehicle)(u32);
    int  (*pFunctionRequestTelemetryStreams)(void);
    void (*pFunctionOnTelemetryStreamData)(u8*, int, int);
+   int  (*pFunctionGetRenderCacheInterval)(void);
 
    bool bBoundingBox;
    bool bHighlight;
+
+   // Render time and cached drawing
+   u32 uDrawCacheId;
+   u32 uDrawCacheInputsHash;
+   u32 uTimeLastRender;
+   u32 uRenderTimeAvgMicros;
+   u32 uRenderTimeMaxMicros;
+   u32 uTimeLastMaxReset;
+   u32 uCountRenders;
+   u32 uCountCachedFrames;
+   int iFramesToSkip; // Over budget: frames left to show the cached drawing
+   bool bOverBudget;
 } ALIGN_STRUCT_SPEC_INFO plugin_osd_t;
 
 extern plugin_osd_t* g_pPluginsOSD[MAX_OSD_PLUGINS];
@@ -42,6 +55,8 @@ extern bool g_bOSDPluginsNeedTelemetryStreams;
 
 void osd_plugins_load();
 void osd_plugins_render();
+// Smoothed render time of all the plugins, in microseconds per frame (not counting the cached drawings)
+u32 osd_plugins_get_render_time_micros();
 
 int osd_plugins_get_count();
 plugin_osd_t* osd_plugins_get(int index);
@@ -535,9 +535,9 @@ float osd_render_stats_video_decode_get_height(int iDeveloperMode, bool bIsSnaps
    if ( pActiveModel->isAudioCapableAndEnabled() )
       height += height_text*s_OSDStatsLineSpacing;
 
-   // Bar for video blocks pressent in video rx buffers
+   // Bar for video blocks pressent in video rx buffers and EC decode matrix cache
    if ( iDeveloperMode && bIsExtended )
-      height += height_text*s_OSDStatsLineSpacing;
+      height += 2*height_text*s_OSDStatsLineSpacing;
 
    // Graph
    if ( ! bIsMinimal )
@@ -1073,6 +1073,12 @@ float osd_render_stats_video_decode(float xPos, float yPos, int iDeveloperMode,
       }
       g_pRenderEngine->setColors(get_Color_Dev());
       _osd_stats_draw_line(xPos, rightMargin, y, s_idFontStats, L("Video Buffers Use:"), szBuff);
+      y += height_text*s_OSDStatsLineSpacing;
+
+      strcpy(szBuff, "N/A");
+      if ( (NULL != pRTInfoVehicle) && (pRTInfoVehicle->uECDecodeCacheHits + pRTInfoVehicle->uECDecodeCacheMisses > 0) )
+         sprintf(szBuff, "%.1f%% (%u/%u)", 100.0*(float)pRTInfoVehicle->uECDecodeCacheHits/(float)(pRTInfoVehicle->uECDecodeCacheHits + pRTInfoVehicle->uECDecodeCacheMisses), pRTInfoVehicle->uECDecodeCacheHits, pRTInfoVehicle->uECDecodeCacheHits + pRTInfoVehicle->uECDecodeCacheMisses);
+      _osd_stats_draw_line(xPos, rightMargin, y, s_idFontStats, L("EC Matrix Cache Hits:"), szBuff);
       osd_set_colors();     
       y += height_text*s_OSDStatsLineSpacing;
    }
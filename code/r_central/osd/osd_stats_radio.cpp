@@ -213,7 +213,10 @@ void osd_render_stats_full_rx_port()
       g_pRenderEngine->drawLine(xPos + padding, y - 0.003, xPos + widthCol - 2.0*padding, y - 0.003 );
 
       g_pRenderEngine->drawText(xPos, y, fontId, "RX Recv Packets:");
-      sprintf(szBuff, "%d", g_SM_RadioStats.radio_interfaces[i].totalRxPackets);
+      if ( g_SM_RadioStats.radio_interfaces[i].totalRxPacketsDuplicates > 0 )
+         sprintf(szBuff, "%d (+%d dup)", g_SM_RadioStats.radio_interfaces[i].totalRxPackets, g_SM_RadioStats.radio_interfaces[i].totalRxPacketsDuplicates);
+      else
+         sprintf(szBuff, "%d", g_SM_RadioStats.radio_interfaces[i].totalRxPackets);
       g_pRenderEngine->drawTextLeft(xPos + widthCol - 2.0*padding, y, fontId, szBuff);
       y += lineHeight;
 
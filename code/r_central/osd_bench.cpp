@@ -0,0 +1,364 @@
+/*
+    Ruby Licence
+    Copyright (c) 2020-2025 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and/or use in source and/or binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions and/or use of the source code (partially or complete) must retain
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Redistributions in binary form (partially or complete) must reproduce
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permitted.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE AUTHOR (PETRU SOROAGA) BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "../base/base.h"
+#include "../base/models.h"
+#include "../base/ctrl_preferences.h"
+#include "../public/telemetry_info.h"
+#include "../renderer/render_engine.h"
+#include "osd_bench.h"
+#include "shared_vars.h"
+#include "ruby_central.h"
+#include "osd.h"
+#include "osd_common.h"
+#include "osd_plugins.h"
+#include "menu.h"
+#include "menu_root.h"
+#include "popup.h"
+#include "ui_alarms.h"
+
+#define BENCH_FRAME_TIME_MS 33
+
+typedef struct
+{
+   int iFrames;
+   int iWidth;
+   int iHeight;
+   int iRenderMode;
+   bool bMenus;
+   const char* szModelFile;
+   const char* szDumpFolder;
+   int iDumpEvery;
+   const char* szCSVFile;
+} type_osd_bench_options;
+
+static void _osd_bench_parse_options(int argc, char* argv[], type_osd_bench_options* pOptions)
+{
+   memset(pOptions, 0, sizeof(type_osd_bench_options));
+   pOptions->iFrames = 300;
+   pOptions->iWidth = 1920;
+   pOptions->iHeight = 1080;
+   pOptions->iRenderMode = -1;
+   pOptions->iDumpEvery = 30;
+
+   for( int i=1; i<argc; i++ )
+   {
+      bool bHasValue = (i+1 < argc);
+      if ( (0 == strcmp(argv[i], "-frames")) && bHasValue )
+         pOptions->iFrames = atoi(argv[++i]);
+      else if ( (0 == strcmp(argv[i], "-res")) && bHasValue )
+      {
+         int iWidth = 0, iHeight = 0;
+         if ( 2 == sscanf(argv[++i], "%dx%d", &iWidth, &iHeight) )
+         if ( (iWidth >= 320) && (iHeight >= 240) )
+         {
+            pOptions->iWidth = iWidth;
+            pOptions->iHeight = iHeight;
+         }
+      }
+      else if ( (0 == strcmp(argv[i], "-mode")) && bHasValue )
+         pOptions->iRenderMode = atoi(argv[++i]);
+      else if ( (0 == strcmp(argv[i], "-model")) && bHasValue )
+         pOptions->szModelFile = argv[++i];
+      else if ( 0 == strcmp(argv[i], "-menus") )
+         pOptions->bMenus = true;
+      else if ( (0 == strcmp(argv[i], "-dump")) && bHasValue )
+         pOptions->szDumpFolder = argv[++i];
+      else if ( (0 == strcmp(argv[i], "-dumpevery")) && bHasValue )
+         pOptions->iDumpEvery = atoi(argv[++i]);
+      else if ( (0 == strcmp(argv[i], "-csv")) && bHasValue )
+         pOptions->szCSVFile = argv[++i];
+   }
+   if ( pOptions->iFrames < 1 )
+      pOptions->iFrames = 1;
+   if ( pOptions->iDumpEvery < 1 )
+      pOptions->iDumpEvery = 1;
+}
+
+bool osd_bench_is_requested(int argc, char* argv[])
+{
+   for( int i=1; i<argc; i++ )
+   {
+      if ( 0 == strcmp(argv[i], "-bench-osd") )
+         return true;
+   }
+   return false;
+}
+
+void osd_bench_get_resolution(int argc, char* argv[], int* piWidth, int* piHeight)
+{
+   type_osd_bench_options options;
+   _osd_bench_parse_options(argc, argv, &options);
+   if ( NULL != piWidth )
+      *piWidth = options.iWidth;
+   if ( NULL != piHeight )
+      *piHeight = options.iHeight;
+}
+
+static const char* _osd_bench_get_layer_name(u32 uLayerId)
+{
+   switch ( uLayerId )
+   {
+      case OSD_LAYER_MSP: return "OSD MSP";
+      case OSD_LAYER_ELEMENTS: return "OSD elements";
+      case OSD_LAYER_INSTRUMENTS: return "OSD instruments";
+      case OSD_LAYER_WIDGETS: return "OSD widgets";
+      case OSD_LAYER_PLUGINS: return "OSD plugins";
+      case OSD_LAYER_STATS: return "OSD stats panels";
+      case OSD_LAYER_WARNINGS: return "OSD warnings";
+      case OSD_LAYER_DEBUG_STATS: return "OSD debug stats";
+      case OSD_LAYER_MONITOR: return "OSD monitor";
+      case OSD_LAYER_RELAY: return "OSD relay";
+      case CENTRAL_LAYER_ALARMS: return "Alarms";
+      case CENTRAL_LAYER_POPUPS: return "Popups";
+      case CENTRAL_LAYER_MENUS: return "Menus";
+      default: break;
+   }
+   if ( (uLayerId >= OSD_LAYER_PLUGIN_FIRST) && (uLayerId < OSD_LAYER_PLUGIN_FIRST + MAX_OSD_PLUGINS) )
+      return "OSD plugin";
+   return "Other";
+}
+
+// Vehicle flying a slow circle, attitude, speeds, battery and link quality changing over time
+static void _osd_bench_update_telemetry(t_structure_vehicle_info* pRuntimeInfo, int iFrame)
+{
+   float t = (float)iFrame * BENCH_FRAME_TIME_MS / 1000.0;
+   t_packet_header_fc_telemetry* pFC = &pRuntimeInfo->headerFCTelemetry;
+
+   pFC->uFCFlags = FC_TELE_FLAGS_ARMED | FC_TELE_FLAGS_POS_CURRENT | FC_TELE_FLAGS_HAS_GPS_FIX | FC_TELE_FLAGS_HAS_ATTITUDE;
+   pFC->flight_mode = FLIGHT_MODE_ARMED | FLIGHT_MODE_STAB;
+   pFC->arm_time = (u32)t;
+   pFC->throttle = 40 + (u8)(20.0*sinf(t*0.5));
+   pFC->voltage = (u16)(16800 - t*10.0);
+   pFC->current = (u16)(12000 + 4000.0*sinf(t*0.7));
+   pFC->mah = (u16)(t*3.3);
+   pFC->altitude = (u32)(100000 + 5000 + 2500.0*sinf(t*0.2));
+   pFC->altitude_abs = pFC->altitude + 20000;
+   pFC->distance = (u32)(20000 + 10000.0*sinf(t*0.1));
+   pFC->total_distance = (u32)(t*1500.0);
+   pFC->vspeed = (u32)(100000 + 250.0*cosf(t*0.2));
+   pFC->aspeed = (u32)(100000 + 1600 + 300.0*sinf(t*0.3));
+   pFC->hspeed = (u32)(100000 + 1500 + 300.0*sinf(t*0.3));
+   pFC->roll = (u32)(18000 + 2500.0*sinf(t*0.9));
+   pFC->pitch = (u32)(18000 + 800.0*sinf(t*1.3));
+   pFC->satelites = 14 + (iFrame/100)%4;
+   pFC->gps_fix_type = 3;
+   pFC->hdop = 90;
+   pFC->heading = (u16)((int)(t*12.0) % 360);
+   pFC->latitude = (int32_t)(472000000 + 20000.0*sinf(t*0.1));
+   pFC->longitude = (int32_t)(85000000 + 20000.0*cosf(t*0.1));
+   pFC->temperatureC = 100 + 35;
+   pFC->rc_rssi = 80 + (u8)(15.0*sinf(t*0.4));
+
+   pRuntimeInfo->bGotFCTelemetry = true;
+   pRuntimeInfo->bGotFCTelemetryShort = true;
+   pRuntimeInfo->bGotFCTelemetryFull = true;
+   pRuntimeInfo->bFCTelemetrySourcePresent = true;
+   pRuntimeInfo->uTimeLastRecvFCTelemetry = g_TimeNow;
+   pRuntimeInfo->uTimeLastRecvFCTelemetryFull = g_TimeNow;
+   pRuntimeInfo->uTimeLastRecvFCTelemetryShort = g_TimeNow;
+   pRuntimeInfo->uTimeLastRecvRubyTelemetry = g_TimeNow;
+   pRuntimeInfo->uTimeLastRecvAnyRubyTelemetry = g_TimeNow;
+   pRuntimeInfo->bIsArmed = true;
+   pRuntimeInfo->bHomeSet = true;
+   pRuntimeInfo->fHomeLat = 47.2;
+   pRuntimeInfo->fHomeLon = 8.5;
+   pRuntimeInfo->fHomeLastLat = pFC->latitude/10000000.0;
+   pRuntimeInfo->fHomeLastLon = pFC->longitude/10000000.0;
+}
+
+static int _osd_bench_compare_u32(const void* p1, const void* p2)
+{
+   u32 u1 = *(const u32*)p1;
+   u32 u2 = *(const u32*)p2;
+   return (u1 < u2)?-1:((u1 > u2)?1:0);
+}
+
+static void _osd_bench_print_times(const char* szName, u32* puTimes, int iCount)
+{
+   unsigned long long uSum = 0;
+   for( int i=0; i<iCount; i++ )
+      uSum += puTimes[i];
+   qsort(puTimes, iCount, sizeof(u32), _osd_bench_compare_u32);
+   printf("  %-22s avg %7.3f ms, p50 %7.3f ms, p95 %7.3f ms, p99 %7.3f ms, max %7.3f ms\n", szName,
+      (double)uSum/(double)iCount/1000.0,
+      puTimes[iCount/2]/1000.0, puTimes[(iCount*95)/100]/1000.0, puTimes[(iCount*99)/100]/1000.0, puTimes[iCount-1]/1000.0);
+   log_line("[OSDBench] %s: avg %.3f ms, p95 %.3f ms, max %.3f ms", szName, (double)uSum/(double)iCount/1000.0, puTimes[(iCount*95)/100]/1000.0, puTimes[iCount-1]/1000.0);
+}
+
+static void _osd_bench_release_model(Model* pModel)
+{
+   menu_discard_all();
+   osd_set_render_unpaired(false);
+   g_pCurrentModel = NULL;
+   g_VehiclesRuntimeInfo[0].pModel = NULL;
+   delete pModel;
+}
+
+int osd_bench_run(int argc, char* argv[])
+{
+   type_osd_bench_options options;
+   _osd_bench_parse_options(argc, argv, &options);
+
+   if ( NULL == g_pRenderEngine )
+   {
+      printf("OSD benchmark: no render engine.\n");
+      return -1;
+   }
+
+   // Never write model files (snapshot, main file restored from backup) from a benchmark run
+   model_set_snapshot_files_enabled(false);
+   Model* pModel = new Model();
+   if ( (NULL != options.szModelFile) && (! pModel->loadFromFileReadOnly(options.szModelFile)) )
+   {
+      printf("OSD benchmark: failed to load model file %s\n", options.szModelFile);
+      delete pModel;
+      return -1;
+   }
+   if ( NULL == options.szModelFile )
+      pModel->resetToDefaults(true);
+
+   g_pCurrentModel = pModel;
+   g_uActiveControllerModelVID = pModel->uVehicleId;
+   shared_vars_state_reset_all_vehicles_runtime_info();
+   g_VehiclesRuntimeInfo[0].uVehicleId = pModel->uVehicleId;
+   g_VehiclesRuntimeInfo[0].pModel = pModel;
+   osd_set_current_layout_index_and_source_model(pModel, pModel->osd_params.iCurrentOSDScreen);
+   osd_set_current_data_source_vehicle_index(0);
+   osd_set_render_unpaired(true);
+
+   if ( options.bMenus )
+      add_menu_to_stack(new MenuRoot());
+
+   Preferences* pP = get_Preferences();
+   int iRenderMode = options.iRenderMode;
+   if ( (iRenderMode < 0) || (iRenderMode > 2) )
+      iRenderMode = (NULL != pP)?pP->iOSDRenderMode:RENDER_RETAINED_MODE_OFF;
+   g_pRenderEngine->setRetainedRenderingMode(iRenderMode);
+
+   u32* puFrameTimes = (u32*) malloc(options.iFrames * sizeof(u32));
+   u32* puComposeTimes = (u32*) malloc(options.iFrames * sizeof(u32));
+   if ( (NULL == puFrameTimes) || (NULL == puComposeTimes) )
+   {
+      printf("OSD benchmark: out of memory.\n");
+      if ( NULL != puFrameTimes )
+         free(puFrameTimes);
+      if ( NULL != puComposeTimes )
+         free(puComposeTimes);
+      _osd_bench_release_model(pModel);
+      return -1;
+   }
+   FILE* fdCSV = NULL;
+   if ( NULL != options.szCSVFile )
+   {
+      fdCSV = fopen(options.szCSVFile, "w");
+      if ( NULL != fdCSV )
+         fprintf(fdCSV, "frame,compose_us,total_us\n");
+   }
+
+   printf("OSD benchmark: %d frames, %d x %d, render mode: %d, menus: %s, model: %s\n",
+      options.iFrames, options.iWidth, options.iHeight, g_pRenderEngine->getRetainedRenderingMode(),
+      options.bMenus?"yes":"no", (NULL != options.szModelFile)?options.szModelFile:"defaults");
+   log_line("[OSDBench] Start: %d frames, %d x %d, render mode %d", options.iFrames, options.iWidth, options.iHeight, g_pRenderEngine->getRetainedRenderingMode());
+
+   g_pRenderEngine->resetLayerTimings();
+   g_pRenderEngine->enableLayerTimings(true);
+
+   // Fixed simulated time between frames, so the same input gives the same frames
+   u32 uTimeStart = g_TimeNow;
+   int iCountDumped = 0;
+   for( int iFrame=0; iFrame<options.iFrames; iFrame++ )
+   {
+      g_TimeNow = uTimeStart + (u32)iFrame * BENCH_FRAME_TIME_MS;
+      _osd_bench_update_telemetry(&g_VehiclesRuntimeInfo[0], iFrame);
+
+      u32 uTime = get_current_timestamp_micros();
+      g_pRenderEngine->startFrame();
+      osd_render_all();
+
+      g_pRenderEngine->beginLayer(CENTRAL_LAYER_ALARMS);
+      alarms_render();
+      g_pRenderEngine->endLayer();
+      g_pRenderEngine->beginLayer(CENTRAL_LAYER_POPUPS);
+      popups_render();
+      g_pRenderEngine->endLayer();
+      g_pRenderEngine->beginLayer(CENTRAL_LAYER_MENUS);
+      menu_render();
+      g_pRenderEngine->endLayer();
+      puComposeTimes[iFrame] = get_current_timestamp_micros() - uTime;
+
+      g_pRenderEngine->endFrame();
+      puFrameTimes[iFrame] = get_current_timestamp_micros() - uTime;
+
+      if ( NULL != fdCSV )
+         fprintf(fdCSV, "%d,%u,%u\n", iFrame, puComposeTimes[iFrame], puFrameTimes[iFrame]);
+
+      if ( (NULL != options.szDumpFolder) && ((iFrame % options.iDumpEvery) == 0) )
+      {
+         char szFile[MAX_FILE_PATH_SIZE];
+         snprintf(szFile, sizeof(szFile)/sizeof(szFile[0]), "%s/osd_frame_%05d.png", options.szDumpFolder, iFrame);
+         if ( g_pRenderEngine->saveFrameToPNG(szFile) )
+            iCountDumped++;
+      }
+   }
+
+   g_pRenderEngine->enableLayerTimings(false);
+   if ( NULL != fdCSV )
+      fclose(fdCSV);
+
+   printf("Per frame times:\n");
+   _osd_bench_print_times("Compose", puComposeTimes, options.iFrames);
+   _osd_bench_print_times("Total (with endFrame)", puFrameTimes, options.iFrames);
+
+   u32 uLayerIds[RENDER_MAX_TIMED_LAYERS];
+   u32 uLayerMicros[RENDER_MAX_TIMED_LAYERS];
+   u32 uLayerCounts[RENDER_MAX_TIMED_LAYERS];
+   int iCountLayers = g_pRenderEngine->getLayerTimings(uLayerIds, uLayerMicros, uLayerCounts, RENDER_MAX_TIMED_LAYERS);
+   printf("Per layer times (avg per frame%s):\n", (g_pRenderEngine->getRetainedRenderingMode() != RENDER_RETAINED_MODE_OFF)?", recording only, drawing is done in endFrame":"");
+   for( int i=0; i<iCountLayers; i++ )
+   {
+      printf("  %-22s (id %3u) %7.3f ms\n", _osd_bench_get_layer_name(uLayerIds[i]), uLayerIds[i], (double)uLayerMicros[i]/(double)options.iFrames/1000.0);
+      log_line("[OSDBench] Layer %u (%s): %.3f ms/frame", uLayerIds[i], _osd_bench_get_layer_name(uLayerIds[i]), (double)uLayerMicros[i]/(double)options.iFrames/1000.0);
+   }
+   if ( NULL != options.szDumpFolder )
+      printf("Saved %d frames to %s\n", iCountDumped, options.szDumpFolder);
+
+   free(puFrameTimes);
+   free(puComposeTimes);
+
+   _osd_bench_release_model(pModel);
+   return 0;
+}
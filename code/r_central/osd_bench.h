@@ -0,0 +1,24 @@
+#pragma once
+#include "../base/base.h"
+
+// OSD render benchmark: ruby_central -bench-osd [options]
+// Draws the OSD, stats panels and (optionally) menus on an offscreen render target, using
+// synthetic vehicle telemetry at a fixed simulated frame rate, and reports the per-frame and
+// per-layer render times. Frames can be saved as PNG files (same input gives the same frames),
+// to compare the output of two builds.
+// Runs before any hardware or licences init and does not write config files. It can also be built
+// as a standalone binary, without the GPIO/I2C libraries: make ruby_osd_bench RUBY_BUILD_ENV=osdbench
+//
+// Options:
+//   -frames N        frames to render (default 300)
+//   -res WxH         offscreen resolution (default 1920x1080)
+//   -mode N          render mode: 0 full redraw, 1 changed areas, 2 changed areas debug (default: preferences)
+//   -model file      vehicle model file to use (default: a model with default settings)
+//   -menus           render the main menu on top of the OSD
+//   -dump folder     save frames as PNG files in the folder
+//   -dumpevery N     save each N-th frame (default 30)
+//   -csv file        save the per-frame times to a CSV file
+
+bool osd_bench_is_requested(int argc, char* argv[]);
+void osd_bench_get_resolution(int argc, char* argv[], int* piWidth, int* piHeight);
+int osd_bench_run(int argc, char* argv[]);
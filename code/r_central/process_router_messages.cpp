@@ -45,6 +45,7 @@
 #include "menu/menu_vehicle_radio_link.h"
 #include "menu/menu_negociate_radio.h"
 #include "process_router_messages.h"
+#include "render_thread.h"
 #include <pthread.h>
 #include "shared_vars.h"
 #include "timers.h"
@@ -1559,7 +1560,7 @@ int try_read_messages_from_router(u32 uMaxMiliseconds)
    u32 uTimeStart = g_TimeNow = get_current_timestamp_ms();
    if ( -1 == s_fIPCFromRouter )
    {
-       hardware_sleep_ms(uMaxMiliseconds/2+1);
+       render_thread_sleep_ms(uMaxMiliseconds/2+1);
        return 0;
    }
 
@@ -1572,6 +1573,9 @@ int try_read_messages_from_router(u32 uMaxMiliseconds)
 
    u8 uTmpMsg[MAX_PACKET_TOTAL_SIZE];
 
+   // Reading and checking the messages does not touch the UI state: let the render thread compose
+   // frames meanwhile. The UI lock is taken back only to process each message.
+   int iUILockDepth = render_thread_release_ui();
    int iCountMessagesProcessed = 0;
    while(true)
    {
@@ -1585,7 +1589,7 @@ int try_read_messages_from_router(u32 uMaxMiliseconds)
          {
             pthread_mutex_unlock(&s_pThreadIPCMutex);
             pResult = NULL;
-            hardware_sleep_ms(uMaxMiliseconds/4+1);
+            render_thread_sleep_ms(uMaxMiliseconds/4+1);
          }
          else
          {
@@ -1611,19 +1615,22 @@ int try_read_messages_from_router(u32 uMaxMiliseconds)
              log_softerror_and_alarm("[Router COMM] Received invalid message (invalid CRC) from router. Ignoring it.");
          else
          {
+             render_thread_reacquire_ui(iUILockDepth);
              _process_received_message_from_router(pResult);
+             iUILockDepth = render_thread_release_ui();
          }
          if ( iCountMessagesProcessed > MAX_ROUTER_MESSAGES/3 )
          {
             log_softerror_and_alarm("Processing too many messages from router (%d messages)", iCountMessagesProcessed);
-            return iCountMessagesProcessed;
+            break;
          }
       }
 
       g_TimeNow = get_current_timestamp_ms();
       if ( g_TimeNow >= uTimeStart + uMaxMiliseconds )
-         return iCountMessagesProcessed;
+         break;
    }
+   render_thread_reacquire_ui(iUILockDepth);
    return iCountMessagesProcessed;
 }
 
@@ -0,0 +1,241 @@
+/*
+    Ruby Licence
+    Copyright (c) 2020-2025 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and/or use in source and/or binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions and/or use of the source code (partially or complete) must retain
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Redistributions in binary form (partially or complete) must reproduce
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permitted.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE AUTHOR (PETRU SOROAGA) BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+#include "../base/hardware.h"
+#include "../base/ctrl_settings.h"
+#include "../base/ctrl_preferences.h"
+#include "../renderer/render_engine.h"
+#if defined (HW_PLATFORM_RADXA)
+#include "../renderer/drm_core.h"
+#endif
+#include <pthread.h>
+#include "render_thread.h"
+#include "shared_vars.h"
+#include "ruby_central.h"
+#include "rx_scope.h"
+
+static pthread_t s_pThreadRender;
+static volatile bool s_bRenderThreadRunning = false;
+static volatile bool s_bRenderThreadMustStop = false;
+static volatile bool s_bRenderThreadFrameRequested = false;
+
+static pthread_mutex_t s_MutexUI = PTHREAD_MUTEX_INITIALIZER;
+static volatile bool s_bUILocked = false;
+static pthread_t s_UILockOwner;
+static int s_iUILockDepth = 0;
+
+static bool _render_thread_owns_ui_lock()
+{
+   return s_bUILocked && pthread_equal(s_UILockOwner, pthread_self());
+}
+
+void render_thread_lock_ui()
+{
+   if ( _render_thread_owns_ui_lock() )
+   {
+      s_iUILockDepth++;
+      return;
+   }
+   pthread_mutex_lock(&s_MutexUI);
+   s_UILockOwner = pthread_self();
+   s_bUILocked = true;
+   s_iUILockDepth = 1;
+}
+
+void render_thread_unlock_ui()
+{
+   if ( ! _render_thread_owns_ui_lock() )
+      return;
+   s_iUILockDepth--;
+   if ( s_iUILockDepth > 0 )
+      return;
+   s_bUILocked = false;
+   pthread_mutex_unlock(&s_MutexUI);
+}
+
+// Fully releases the UI lock if held by the calling thread; returns the lock depth to restore
+int render_thread_release_ui()
+{
+   if ( ! _render_thread_owns_ui_lock() )
+      return 0;
+   int iDepth = s_iUILockDepth;
+   s_iUILockDepth = 0;
+   s_bUILocked = false;
+   pthread_mutex_unlock(&s_MutexUI);
+   return iDepth;
+}
+
+void render_thread_reacquire_ui(int iDepth)
+{
+   if ( iDepth <= 0 )
+      return;
+   pthread_mutex_lock(&s_MutexUI);
+   s_UILockOwner = pthread_self();
+   s_bUILocked = true;
+   s_iUILockDepth = iDepth;
+}
+
+void render_thread_sleep_ms(u32 uMiliseconds)
+{
+   int iDepth = render_thread_release_ui();
+   hardware_sleep_ms(uMiliseconds);
+   render_thread_reacquire_ui(iDepth);
+}
+
+void render_thread_request_frame()
+{
+   s_bRenderThreadFrameRequested = true;
+}
+
+// Waits on the display vertical blank (or sleeps if not available) until the next frame is due
+static void _render_thread_wait_next_frame(u32 uTimeLastFrame)
+{
+   ControllerSettings* pCS = get_ControllerSettings();
+   int iIntervalMs = 1000/15;
+   if ( (NULL != pCS) && (0 != pCS->iRenderFPS) )
+      iIntervalMs = 1000/pCS->iRenderFPS;
+
+   while ( ! s_bRenderThreadMustStop )
+   {
+      u32 uTimeNow = get_current_timestamp_ms();
+      if ( uTimeNow >= uTimeLastFrame + (u32)iIntervalMs )
+         return;
+      if ( s_bRenderThreadFrameRequested )
+         return;
+
+      #if defined (HW_PLATFORM_RADXA)
+      if ( 0 == ruby_drm_core_wait_vblank() )
+         continue;
+      #endif
+      u32 uWait = uTimeLastFrame + (u32)iIntervalMs - uTimeNow;
+      if ( uWait > 5 )
+         uWait = 5;
+      hardware_sleep_ms(uWait);
+   }
+}
+
+static void* _render_thread_func(void* pArgument)
+{
+   log_line("[RenderThread] Started.");
+   u32 uTimeLastFrame = 0;
+   u32 uCountFrames = 0;
+   u32 uSumComposeMs = 0;
+   u32 uSumRasterizeMs = 0;
+   u32 uTimeLastLog = get_current_timestamp_ms();
+
+   while ( ! s_bRenderThreadMustStop )
+   {
+      _render_thread_wait_next_frame(uTimeLastFrame);
+      if ( s_bRenderThreadMustStop )
+         break;
+      s_bRenderThreadFrameRequested = false;
+      uTimeLastFrame = get_current_timestamp_ms();
+
+      // Lock order: UI state, then the render engine
+      render_thread_lock_ui();
+      RenderEngine* pRenderEngine = g_pRenderEngine;
+      // The RX scope draws its own frames from the main loop
+      if ( (NULL == pRenderEngine) || rx_scope_is_started() )
+      {
+         render_thread_unlock_ui();
+         continue;
+      }
+      pRenderEngine->lockFrames();
+      pRenderEngine->setDeferredFrames(true);
+      render_all(uTimeLastFrame, false, false);
+      pRenderEngine->setDeferredFrames(false);
+      render_thread_unlock_ui();
+
+      u32 uTime = get_current_timestamp_ms();
+      uSumComposeMs += uTime - uTimeLastFrame;
+      pRenderEngine->rasterizeDeferredFrame();
+      pRenderEngine->unlockFrames();
+      uSumRasterizeMs += get_current_timestamp_ms() - uTime;
+
+      uCountFrames++;
+      if ( uTimeLastFrame >= uTimeLastLog + 20000 )
+      {
+         log_line("[RenderThread] %u frames in the last %u ms, avg compose: %u ms, avg rasterize: %u ms",
+            uCountFrames, uTimeLastFrame - uTimeLastLog, uSumComposeMs/uCountFrames, uSumRasterizeMs/uCountFrames);
+         uTimeLastLog = uTimeLastFrame;
+         uCountFrames = 0;
+         uSumComposeMs = 0;
+         uSumRasterizeMs = 0;
+      }
+   }
+   log_line("[RenderThread] Stopped.");
+   return NULL;
+}
+
+void render_thread_start()
+{
+   if ( s_bRenderThreadRunning )
+      return;
+   Preferences* pP = get_Preferences();
+   if ( (NULL == pP) || (0 == pP->iOSDRenderThread) )
+      return;
+   if ( (NULL == g_pRenderEngine) || (! g_pRenderEngine->supportsDeferredFrames()) )
+   {
+      log_line("[RenderThread] Render engine can't defer frames. OSD is drawn from the main loop.");
+      return;
+   }
+
+   s_bRenderThreadMustStop = false;
+   s_bRenderThreadFrameRequested = true;
+   if ( 0 != pthread_create(&s_pThreadRender, NULL, &_render_thread_func, NULL) )
+   {
+      log_softerror_and_alarm("[RenderThread] Failed to create the render thread. OSD is drawn from the main loop.");
+      return;
+   }
+   s_bRenderThreadRunning = true;
+   log_line("[RenderThread] Created render thread.");
+}
+
+void render_thread_stop()
+{
+   if ( ! s_bRenderThreadRunning )
+      return;
+
+   log_line("[RenderThread] Stopping render thread...");
+   s_bRenderThreadMustStop = true;
+   // The render thread might be waiting for the UI lock
+   int iDepth = render_thread_release_ui();
+   pthread_join(s_pThreadRender, NULL);
+   render_thread_reacquire_ui(iDepth);
+   s_bRenderThreadRunning = false;
+   log_line("[RenderThread] Stopped render thread.");
+}
+
+bool render_thread_is_running()
+{
+   return s_bRenderThreadRunning;
+}
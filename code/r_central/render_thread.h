@@ -0,0 +1,26 @@
+#pragma once
+#include "../base/base.h"
+
+// OSD/UI render thread.
+// The processing loop (input, IPC, telemetry, menus logic) runs holding the UI lock and releases it
+// only while it sleeps. The render thread wakes up on the display vertical blank, at the configured
+// render FPS, composes the frame (records the draw calls) holding the UI lock, then releases it and
+// rasterizes and shows the recorded frame, so the processing loop is not blocked by the drawing.
+// Works only with render engines that support deferred frames; otherwise the frames are drawn from
+// the processing loop, as before.
+
+void render_thread_start();
+void render_thread_stop();
+bool render_thread_is_running();
+
+// Wakes up the render thread to draw a new frame on the next vertical blank (i.e. after input events)
+void render_thread_request_frame();
+
+// Recursive lock of the UI state (menus, popups, OSD state, models)
+void render_thread_lock_ui();
+void render_thread_unlock_ui();
+// Fully releases the UI lock (if it's held by the calling thread); returns the depth to pass to render_thread_reacquire_ui
+int render_thread_release_ui();
+void render_thread_reacquire_ui(int iDepth);
+// Sleeps with the UI lock released (if it's held by the calling thread)
+void render_thread_sleep_ms(u32 uMiliseconds);
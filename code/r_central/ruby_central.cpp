@@ -96,6 +96,8 @@
 #include "fonts.h"
 #include "popup.h"
 #include "shared_vars.h"
+#include "render_thread.h"
+#include "osd_bench.h"
 #include "pairing.h"
 #include "link_watch.h"
 #include "warnings.h"
@@ -583,6 +585,7 @@ void render_all_with_menus(u32 timeNow, bool bRenderMenus, bool bForceBackground
       return;
    }
 
+   g_pRenderEngine->setRetainedRenderingMode(p->iOSDRenderMode);
    g_pRenderEngine->startFrame();
    
    _render_background_and_paddings(bForceBackground);
@@ -603,7 +606,11 @@ void render_all_with_menus(u32 timeNow, bool bRenderMenus, bool bForceBackground
             s_iMicroTimeOSDRender = s_iMicroTimeOSDRender*0.8 + t*0.2;
       }
       if ( g_bIsRouterReady )
+      {
+         g_pRenderEngine->beginLayer(CENTRAL_LAYER_ALARMS);
          alarms_render();
+         g_pRenderEngine->endLayer();
+      }
    }
 
    bool bDevMode = false;
@@ -617,6 +624,7 @@ void render_all_with_menus(u32 timeNow, bool bRenderMenus, bool bForceBackground
    if ( ! g_bDebugStats )
    //if ( g_bIsRouterReady )
    {
+      g_pRenderEngine->beginLayer(CENTRAL_LAYER_DEV_INFO);
       char szBuff[64];
       float yPos = osd_getMarginY() + osd_getBarHeight() + osd_getSecondBarHeight() + 0.01*osd_getScaleOSD();
       float xPos = osd_getMarginX() + 0.02*osd_getScaleOSD();
@@ -654,6 +662,7 @@ void render_all_with_menus(u32 timeNow, bool bRenderMenus, bool bForceBackground
       {
          xPos += 0.02*osd_getScaleOSD();
          yPos += 0.003;
+         float xPosLineStart = xPos;
          sprintf(szBuff, "UI FPS: %d", s_iRubyFPS);
          osd_show_value(xPos, yPos, szBuff, g_idFontOSDSmall );
 
@@ -668,22 +677,69 @@ void render_all_with_menus(u32 timeNow, bool bRenderMenus, bool bForceBackground
          xPos += 0.095*osd_getScaleOSD();
          sprintf(szBuff, "OSD: %d ms/sec", (int)(s_iMicroTimeOSDRender*s_iRubyFPS/1000.0));
          osd_show_value(xPos, yPos, szBuff, g_idFontOSDSmall );
+
+         if ( g_pRenderEngine->getRetainedRenderingMode() != RENDER_RETAINED_MODE_OFF )
+         {
+            xPos += 0.095*osd_getScaleOSD();
+            sprintf(szBuff, "Redraw: %d%%", (int)g_pRenderEngine->getRetainedRepaintPercent());
+            osd_show_value(xPos, yPos, szBuff, g_idFontOSDSmall );
+         }
+
+         // Render time of each OSD plugin (average/max), and how often the cached drawing was used
+         if ( g_iPluginsOSDCount > 0 )
+         {
+            xPos += 0.095*osd_getScaleOSD();
+            sprintf(szBuff, "Plugins: %.1f ms/frame", osd_plugins_get_render_time_micros()/1000.0);
+            osd_show_value(xPos, yPos, szBuff, g_idFontOSDSmall );
+
+            float fLineHeight = g_pRenderEngine->textHeight(g_idFontOSDSmall)*1.2;
+            float yPosPlugins = yPos + 0.03;
+            for( int i=0; i<g_iPluginsOSDCount; i++ )
+            {
+               plugin_osd_t* pPlugin = g_pPluginsOSD[i];
+               if ( (NULL == pPlugin) || (0 == pPlugin->uCountRenders + pPlugin->uCountCachedFrames) )
+                  continue;
+               char* szName = osd_plugins_get_short_name(i);
+               snprintf(szBuff, sizeof(szBuff)/sizeof(szBuff[0]), "%.20s: %.1f/%.1f ms, cached: %d%%%s",
+                  (NULL != szName)?szName:"N/A",
+                  pPlugin->uRenderTimeAvgMicros/1000.0, pPlugin->uRenderTimeMaxMicros/1000.0,
+                  (int)(pPlugin->uCountCachedFrames*100.0/(pPlugin->uCountRenders + pPlugin->uCountCachedFrames)),
+                  pPlugin->bOverBudget?", over budget":"");
+               g_pRenderEngine->setFill(0,0,0,0.5);
+               g_pRenderEngine->setStroke(0,0,0,0);
+               g_pRenderEngine->drawRect(xPosLineStart-0.02*osd_getScaleOSD(), yPosPlugins-0.003, 0.3, fLineHeight);
+               osd_set_colors_text(get_Color_Dev());
+               osd_show_value(xPosLineStart, yPosPlugins, szBuff, g_idFontOSDSmall );
+               yPosPlugins += fLineHeight;
+            }
+         }
       }
       g_pRenderEngine->enableRectBlending();
+      g_pRenderEngine->endLayer();
    }
 
    u32 t = get_current_timestamp_micros();
+   g_pRenderEngine->beginLayer(CENTRAL_LAYER_POPUPS);
    popups_render();
+   g_pRenderEngine->endLayer();
+   g_pRenderEngine->beginLayer(CENTRAL_LAYER_MENUS);
    if ( bRenderMenus )
       menu_render();
+   g_pRenderEngine->endLayer();
+   g_pRenderEngine->beginLayer(CENTRAL_LAYER_POPUPS_TOPMOST);
    popups_render_topmost();
+   g_pRenderEngine->endLayer();
 
    t = get_current_timestamp_micros() - t;
    if ( t < 300000 )
       s_iMicroTimeMenuRender = (s_iMicroTimeMenuRender*8 + t*2)/10;
   
    if ( handle_commands_is_command_in_progress() )
+   {
+      g_pRenderEngine->beginLayer(CENTRAL_LAYER_COMMANDS);
       render_commands();
+      g_pRenderEngine->endLayer();
+   }
 
    s_iFPSCount++;
    if ( timeNow >= s_iFPSLastTimeCheck + 1000 )
@@ -2046,7 +2102,7 @@ void ruby_processing_loop(bool bNoKeys)
 {
    ControllerSettings* pCS = get_ControllerSettings();
 
-   hardware_sleep_ms(10);
+   render_thread_sleep_ms(10);
 
    u32 uTimeStart = get_current_timestamp_ms();
 
@@ -2054,6 +2110,8 @@ void ruby_processing_loop(bool bNoKeys)
 
    keyboard_consume_input_events();
    u32 uSumEvent = keyboard_get_triggered_input_events();
+   if ( 0 != uSumEvent )
+      render_thread_request_frame();
 
    if ( uSumEvent & 0xFF0000 )
       warnings_add_input_device_unknown_key((int)((uSumEvent >> 16) & 0xFF));
@@ -2113,19 +2171,21 @@ void main_loop_r_central()
 {
    ControllerSettings* pCS = get_ControllerSettings();
 
-   hardware_sleep_ms(2);
+   render_thread_sleep_ms(2);
 
    ruby_processing_loop(false);
 
    if ( s_StartSequence != START_SEQ_COMPLETED && s_StartSequence != START_SEQ_FAILED )
    {
-      hardware_sleep_ms(5);
+      render_thread_sleep_ms(5);
       start_loop();
       log_line("Startup sequence now after executing a step: %d", s_StartSequence);
       render_all(g_TimeNow, false, false);
       if ( NULL != g_pProcessStatsCentral )
          g_pProcessStatsCentral->lastActiveTime = g_TimeNow;
       log_line("Startup sequence now after rendering a step: %d", s_StartSequence);
+      if ( s_StartSequence == START_SEQ_COMPLETED )
+         render_thread_start();
       return;
    }
 
@@ -2151,7 +2211,9 @@ void main_loop_r_central()
    {
       ruby_signal_alive();
       s_TimeLastRender = g_TimeNow;
-      render_all(g_TimeNow, false, false);
+      // Otherwise the render thread draws the frames
+      if ( ! render_thread_is_running() )
+         render_all(g_TimeNow, false, false);
       if ( NULL != g_pProcessStatsCentral )
          g_pProcessStatsCentral->lastActiveTime = g_TimeNow;
 
@@ -2279,6 +2341,18 @@ int main(int argc, char *argv[])
    g_bDebugState = false;
    g_bDebugStats = false;
 
+   bool bBenchOSD = osd_bench_is_requested(argc, argv);
+   #if defined (RUBY_BUILD_OSD_BENCH)
+   bBenchOSD = true;
+   #endif
+   #if ! defined (HW_PLATFORM_RADXA)
+   if ( bBenchOSD )
+   {
+      printf("OSD benchmark is supported only on Radxa builds.\n");
+      return -1;
+   }
+   #endif
+
    if ( argc >= 1 )
    if ( strcmp(argv[argc-1], "-ds") == 0 )
    {
@@ -2311,6 +2385,36 @@ int main(int argc, char *argv[])
 
    log_init("Central");
 
+   #if defined (HW_PLATFORM_RADXA)
+   // The OSD benchmark only needs the render engine on an offscreen target: it skips the
+   // hardware detection and init, the licences check, and never writes the config files.
+   if ( bBenchOSD )
+   {
+      initLocalizationData();
+      load_Preferences();
+      reset_ControllerSettings();
+      Preferences* pBenchP = get_Preferences();
+      setActiveLanguage((pBenchP->iLanguage == 4)?1:pBenchP->iLanguage);
+
+      int iBenchWidth = 0, iBenchHeight = 0;
+      osd_bench_get_resolution(argc, argv, &iBenchWidth, &iBenchHeight);
+      if ( 0 != ruby_drm_core_init_offscreen(iBenchWidth, iBenchHeight) )
+      {
+         printf("OSD benchmark: failed to create the offscreen render target.\n");
+         return -1;
+      }
+      g_pRenderEngine = render_init_engine();
+      load_resources();
+      osd_apply_preferences();
+      menu_init();
+      Menu::setRenderMode(pBenchP->iMenuStyle);
+      int iBenchResult = osd_bench_run(argc, argv);
+      render_free_engine();
+      ruby_drm_core_uninit();
+      return iBenchResult;
+   }
+   #endif
+
    int iSelfId = 0;
    #if defined(HW_PLATFORM_RADXA)
    iSelfId = gettid();
@@ -2522,6 +2626,8 @@ int main(int argc, char *argv[])
 
    while (!g_bQuit) 
    {
+      // Released only while sleeping, so the render thread can compose frames
+      render_thread_lock_ui();
       g_uLoopCounter++;
       g_TimeNow = get_current_timestamp_ms();
       g_TimeNowMicros = get_current_timestamp_micros();
@@ -2544,8 +2650,10 @@ int main(int argc, char *argv[])
                log_only_errors();
          }
       }
+      render_thread_unlock_ui();
    }
-   
+
+   render_thread_stop();
    keyboard_uninit();
    
    if ( ! g_bIsReinit )
@@ -2620,6 +2728,7 @@ void ruby_reinit_hdmi_display()
 {
    log_line("Reinit HDMI display...");
 
+   render_thread_stop();
    pairing_stop();
 
    free_all_fonts();
@@ -2646,6 +2755,7 @@ void ruby_reinit_hdmi_display()
    load_resources();
    osd_apply_preferences();
    menu_init();
+   render_thread_start();
 
    log_line("Done reinit HDMI display.");
 
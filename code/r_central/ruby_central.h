@@ -28,6 +28,14 @@
 #define START_SEQ_COMPLETED 200
 #define START_SEQ_FAILED 201
 
+// Render layers of the UI parts drawn on top of the OSD (see osd.h for the OSD ones)
+#define CENTRAL_LAYER_ALARMS 100
+#define CENTRAL_LAYER_DEV_INFO 101
+#define CENTRAL_LAYER_POPUPS 102
+#define CENTRAL_LAYER_MENUS 103
+#define CENTRAL_LAYER_POPUPS_TOPMOST 104
+#define CENTRAL_LAYER_COMMANDS 105
+
 Popup* ruby_get_startup_popup();
 
 void ruby_processing_loop(bool bNoKeys);
@@ -55,6 +55,7 @@
 #include "../base/hardware.h"
 #include "../base/hardware_procs.h"
 #include "../base/hdmi.h"
+#include "../base/video_sm_ring.h"
 #include "../renderer/drm_core.h"
 #include <ctype.h>
 #include <pthread.h>
@@ -576,9 +577,9 @@ void _do_stream_mode_sm()
 
    int fdSMem = -1;
    unsigned char* pSMem = NULL;
-   uint32_t uSharedMemReadPos = 0;
 
-   fdSMem = shm_open(SM_STREAMER_NAME, O_RDONLY, S_IRUSR | S_IWUSR);
+   // Read-write: the player publishes its read position and heartbeat in the video ring header
+   fdSMem = shm_open(SM_STREAMER_NAME, O_RDWR, S_IRUSR | S_IWUSR);
 
    if( fdSMem < 0 )
    {
@@ -592,7 +593,7 @@ void _do_stream_mode_sm()
       return;
    }
    
-   pSMem = (unsigned char*) mmap(NULL, SM_STREAMER_SIZE, PROT_READ, MAP_SHARED, fdSMem, 0);
+   pSMem = (unsigned char*) mmap(NULL, SM_STREAMER_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fdSMem, 0);
    if ( (pSMem == MAP_FAILED) || (pSMem == NULL) )
    {
       log_softerror_and_alarm("Failed to map shared memory: %s, error: %d %s", SM_STREAMER_NAME, errno, strerror(errno));
@@ -614,6 +615,11 @@ void _do_stream_mode_sm()
    mpp_enable_vsync(pCS->iHDMIVSync?true:false);
    mpp_start_decoding_thread();
 
+   type_video_sm_ring_reader smRingReader;
+   video_sm_ring_reader_init(&smRingReader, pSMem, SM_STREAMER_SIZE);
+   u32 uLastOverruns = 0;
+   u32 uLastResyncs = 0;
+
    u32 uTimeLastCheck = get_current_timestamp_ms();
    int nRead = 1;
    int iCount =0;
@@ -623,71 +629,35 @@ void _do_stream_mode_sm()
   
    while ( !g_bQuit )
    {
-      u32* pTmp1 = (u32*)pSMem;
-      u32* pTmp2 = (u32*)(&(pSMem[sizeof(u32)]));
-      u32 uWritePos1 = 0;
-      u32 uWritePos2 = 0;
-      u32 uBytesToRead = 0;
+      int iBytesRead = 0;
 
-      while ((uBytesToRead == 0) && (!g_bQuit))
+      while ((iBytesRead <= 0) && (!g_bQuit))
       {
          g_pSMProcessStats->lastActiveTime = get_current_timestamp_ms();
-         uWritePos1 = *pTmp1;
-         uWritePos2 = *pTmp2;
-         if ( (uSharedMemReadPos == uWritePos1) || (uWritePos1 != uWritePos2) )
-         {
-            struct timespec ts;
-            clock_gettime(CLOCK_REALTIME, &ts);
-            ts.tv_nsec += 1000LL*(long long)10000; // 10 milisec
-            int iResSem = sem_timedwait(s_pSemaphoreSMData, &ts);
-            if ( 0 != iResSem )
-               continue;
-            if ( 0 == sem_getvalue(s_pSemaphoreSMData, &iSemVal) )
-            {
-               if ( iSemVal > 0 )
-               {
-                  for( int i=0; i<iSemVal; i++ )
-                     sem_trywait(s_pSemaphoreSMData);
-               }
-            }
+         iBytesRead = video_sm_ring_read(&smRingReader, g_uPipeBuffer, PIPE_BUFFER_SIZE);
+         if ( iBytesRead > 0 )
+            break;
 
-            uWritePos1 = *pTmp1;
-            uWritePos2 = *pTmp2;
-            if ( (uSharedMemReadPos == uWritePos1) || (uWritePos1 != uWritePos2) )
-               continue;
-         }
-         if ( uWritePos1 > uSharedMemReadPos )
+         struct timespec ts;
+         clock_gettime(CLOCK_REALTIME, &ts);
+         ts.tv_nsec += 1000LL*(long long)10000; // 10 milisec
+         if ( ts.tv_nsec >= 1000000000LL )
          {
-            uBytesToRead = uWritePos1 - uSharedMemReadPos;
-            if ( uBytesToRead > PIPE_BUFFER_SIZE )
-               uBytesToRead = PIPE_BUFFER_SIZE;
-            memcpy(g_uPipeBuffer, &pSMem[uSharedMemReadPos], uBytesToRead);
-            uSharedMemReadPos += uBytesToRead;
-            if ( uSharedMemReadPos >= SM_STREAMER_SIZE )
-               uSharedMemReadPos = 2*sizeof(u32);
+            ts.tv_sec++;
+            ts.tv_nsec -= 1000000000LL;
          }
-         else
+         int iResSem = sem_timedwait(s_pSemaphoreSMData, &ts);
+         if ( 0 != iResSem )
+            continue;
+         if ( 0 == sem_getvalue(s_pSemaphoreSMData, &iSemVal) )
          {
-            uBytesToRead = (SM_STREAMER_SIZE - uSharedMemReadPos);
-            if ( uBytesToRead > PIPE_BUFFER_SIZE )
-               uBytesToRead = PIPE_BUFFER_SIZE;
-            memcpy(g_uPipeBuffer, &pSMem[uSharedMemReadPos], uBytesToRead);
-            uSharedMemReadPos += uBytesToRead;
-            if ( uSharedMemReadPos >= SM_STREAMER_SIZE )
-               uSharedMemReadPos = 2*sizeof(u32);
-            if ( (PIPE_BUFFER_SIZE- uBytesToRead > 0) && (uWritePos1 > 0) )
+            if ( iSemVal > 0 )
             {
-               unsigned char* pTmpB = &(g_uPipeBuffer[0]) + uBytesToRead;
-
-               u32 uBytesToRead2 = uWritePos1 - 2*sizeof(u32);
-               if ( uBytesToRead2 + uBytesToRead > PIPE_BUFFER_SIZE )
-                  uBytesToRead2 = PIPE_BUFFER_SIZE - uBytesToRead;
-               memcpy(pTmpB, &pSMem[uSharedMemReadPos], uBytesToRead2);
-               uSharedMemReadPos += uBytesToRead2;
-               uBytesToRead += uBytesToRead2;
+               for( int i=0; i<iSemVal; i++ )
+                  sem_trywait(s_pSemaphoreSMData);
             }
          }
-      } 
+      }
       if ( g_bQuit )
          break;
 
@@ -700,7 +670,7 @@ void _do_stream_mode_sm()
          uTimeStartReceivingStream = get_current_timestamp_ms();
       }
 
-      nRead = uBytesToRead;
+      nRead = iBytesRead;
       iCount++;
       iTotalRead += nRead;
       if ( (iCount % 10) == 0 )
@@ -709,8 +679,15 @@ void _do_stream_mode_sm()
          if ( uTime >= uTimeLastCheck + 4000 )
          {
             uTimeLastCheck = uTime;
-            log_line("Video player alive, reading %d kbits/sec", iTotalRead*8/4/1000);
+            log_line("Video player alive, reading %d kbits/sec, lag: %u bytes", iTotalRead*8/4/1000, video_sm_ring_get_reader_lag(&smRingReader));
             iTotalRead = 0;
+            if ( (smRingReader.uStatsOverruns != uLastOverruns) || (smRingReader.uStatsResyncs != uLastResyncs) )
+            {
+               log_line("Video player fell behind: %u overruns, %u resyncs to keyframe, %u skipped chunks total",
+                  smRingReader.uStatsOverruns, smRingReader.uStatsResyncs, smRingReader.uStatsSkippedChunks);
+               uLastOverruns = smRingReader.uStatsOverruns;
+               uLastResyncs = smRingReader.uStatsResyncs;
+            }
          }
       }
 
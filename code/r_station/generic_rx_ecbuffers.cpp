@@ -52,11 +52,14 @@ GenericRxECBuffers::GenericRxECBuffers()
    m_iTopBufferIndex = 0;
    m_iBottomBufferIndexToOutput = 0;
    m_iBottomPacketIndexToOutput = 0;
+   m_pFECContext = fec_context_create();
 }
 
 GenericRxECBuffers::~GenericRxECBuffers()
 {
    _deleteBuffers();
+   fec_context_destroy(m_pFECContext);
+   m_pFECContext = NULL;
 }
 
 void GenericRxECBuffers::init(int iMaxBlocks, bool bEnableCRC, u32 uDataPackets, u32 uECPackets, int iPacketLength)
@@ -223,7 +226,7 @@ void GenericRxECBuffers::_computeECDataOnBlock(int iBufferIndex)
       }
    }
 
-   int iRes = fec_decode(m_iBlockPacketLength, m_p_ec_decode_data_packets, (unsigned int)m_uBlockDataPackets, m_p_ec_decode_ec_packets, m_ec_decode_ec_indexes, m_ec_decode_missing_packets_indexes, m_missing_packets_count_for_ec );
+   int iRes = fec_decode_ctx(m_pFECContext, m_iBlockPacketLength, m_p_ec_decode_data_packets, (unsigned int)m_uBlockDataPackets, m_p_ec_decode_ec_packets, m_ec_decode_ec_indexes, m_ec_decode_missing_packets_indexes, m_missing_packets_count_for_ec );
    if ( iRes < 0 )
    {
       log_softerror_and_alarm("[GenericRxEcBuffer] Failed to decode block type %u/%u/%d bytes; recv: %d/%d packets, missing count: %d",
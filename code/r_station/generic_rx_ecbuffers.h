@@ -1,5 +1,6 @@
 #pragma once
 
+#include "../radio/fec.h"
 
 typedef struct
 {
@@ -56,4 +57,5 @@ class GenericRxECBuffers
       u8* m_p_ec_decode_data_packets[MAX_TOTAL_PACKETS_IN_BLOCK];
       u8* m_p_ec_decode_ec_packets[MAX_TOTAL_PACKETS_IN_BLOCK];
       unsigned int m_missing_packets_count_for_ec;
+      fec_context_t* m_pFECContext;
 };
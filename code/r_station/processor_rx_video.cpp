@@ -431,7 +431,10 @@ int ProcessorRxVideo::periodicLoop(u32 uTimeNow, bool bForceSyncNow)
      
    controller_runtime_info_vehicle* pCtrlRTInfo = controller_rt_info_get_vehicle_info(&g_SMControllerRTInfo, m_uVehicleId);
    if ( (NULL != pCtrlRTInfo) && (NULL != m_pVideoRxBuffer) )
+   {
       pCtrlRTInfo->iCountBlocksInVideoRxBuffers = m_pVideoRxBuffer->getCountBlocksInBuffer();
+      m_pVideoRxBuffer->getECDecodeCacheStats(&pCtrlRTInfo->uECDecodeCacheHits, &pCtrlRTInfo->uECDecodeCacheMisses);
+   }
 
    checkUpdateRetransmissionsState();
    return checkAndRequestMissingPackets(bForceSyncNow);
@@ -39,6 +39,7 @@
 #include "../base/hardware_radio_sik.h"
 #include "../base/hardware_radio_serial.h"
 #include "../base/hardware_procs.h"
+#include "../base/hardware_radio_ctrl.h"
 #include "../base/radio_utils.h"
 #include "../common/string_utils.h"
 #include "../common/radio_stats.h"
@@ -629,29 +630,11 @@ void radio_links_set_monitor_mode()
       if ( ! hardware_radio_is_wifi_radio(pRadioHWInfo) )
          continue;
 
-      #ifdef HW_PLATFORM_RADXA
-      char szComm[128];
-      //sprintf(szComm, "iwconfig %s mode monitor 2>&1", pRadioHWInfo->szName );
-      //hw_execute_bash_command(szComm, NULL);
-      //hardware_sleep_ms(uDelayMS);
-
-      sprintf(szComm, "iw dev %s set monitor none 2>&1", pRadioHWInfo->szName);
-      hw_execute_bash_command(szComm, NULL);
-      hardware_sleep_ms(uDelayMS);
-
-      sprintf(szComm, "iw dev %s set monitor fcsfail 2>&1", pRadioHWInfo->szName);
-      hw_execute_bash_command(szComm, NULL);
-      hardware_sleep_ms(uDelayMS);
-      #endif
-
-      #ifdef HW_PLATFORM_RASPBERRY
-      char szComm[128];
-      sprintf(szComm, "iw dev %s set monitor none 2>&1", pRadioHWInfo->szName);
-      hw_execute_bash_command(szComm, NULL);
+      #if defined(HW_PLATFORM_RADXA) || defined(HW_PLATFORM_RASPBERRY)
+      radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAGS_NONE);
       hardware_sleep_ms(uDelayMS);
 
-      sprintf(szComm, "iw dev %s set monitor fcsfail 2>&1", pRadioHWInfo->szName);
-      hw_execute_bash_command(szComm, NULL);
+      radio_ctrl_set_monitor_flags(pRadioHWInfo->szName, RADIO_CTRL_MONITOR_FLAG_FCSFAIL);
       hardware_sleep_ms(uDelayMS);
       #endif
    }
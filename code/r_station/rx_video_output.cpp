@@ -58,6 +58,7 @@
 #include "../base/ruby_ipc.h"
 #include "../base/parser_h264.h"
 #include "../base/camera_utils.h"
+#include "../base/video_sm_ring.h"
 #include "../common/string_utils.h"
 #include "../radio/radiolink.h"
 #include "../radio/radiopackets2.h"
@@ -86,7 +87,8 @@ int s_fPipeVideoOutToStreamer = -1;
 shared_mem_process_stats* s_pSMProcessStatsMPPPlayer = NULL;
 sem_t* s_pSemaphoreSMData = NULL;
 u8* s_pSMVideoStreamerWrite = NULL;
-u32 s_uSMVideoStreamWritePosition = 0;
+type_video_sm_ring_writer s_SMVideoRingWriter;
+u32 s_uTimeLastSMVideoRingStatsLog = 0;
 bool s_bEnableVideoStreamerOutput = false;
 bool s_bDidSentAnyDataToVideoStreamerSM = false;
 bool s_bDidSentAnyDataToVideoStreamerPipe = false;
@@ -392,16 +394,10 @@ static void * _thread_rx_video_output_streamer_watchdog(void *argument)
       rx_video_output_stop_video_streamer();
       if ( s_bRxVideoOutputUseSM )
       {
-         s_uSMVideoStreamWritePosition = 2*sizeof(u32);
          if ( NULL != s_pSMVideoStreamerWrite )
-         {
-            u32* pTmp1 = (u32*)(&(s_pSMVideoStreamerWrite[0]));
-            u32* pTmp2 = (u32*)(&(s_pSMVideoStreamerWrite[sizeof(u32)]));
-            *pTmp1 = s_uSMVideoStreamWritePosition;
-            *pTmp2 = s_uSMVideoStreamWritePosition;
-         }
+            video_sm_ring_writer_reset(&s_SMVideoRingWriter);
          s_bDidSentAnyDataToVideoStreamerSM = false;
-         log_line("[VideoOutputThread] Reseted SM video output position.");
+         log_line("[VideoOutputThread] Started new SM video output session.");
       }
 
       if ( ! s_bRxVideoOutputStreamerThreadMustStop )
@@ -575,8 +571,8 @@ void rx_video_output_init()
    s_ParserH264StreamOutput.init();
    s_ParserH264VideoOutput.init();
    
-   s_uSMVideoStreamWritePosition = 2*sizeof(u32);
    s_pSMVideoStreamerWrite = NULL;
+   memset(&s_SMVideoRingWriter, 0, sizeof(type_video_sm_ring_writer));
 
    if ( s_bRxVideoOutputUseSM )
    {
@@ -604,12 +600,14 @@ void rx_video_output_init()
             {
                memset(s_pSMVideoStreamerWrite, 0, SM_STREAMER_SIZE);
                close(fdSM);
-               s_uSMVideoStreamWritePosition = 2*sizeof(u32);
-               u32* pTmp1 = (u32*)(&(s_pSMVideoStreamerWrite[0]));
-               u32* pTmp2 = (u32*)(&(s_pSMVideoStreamerWrite[sizeof(u32)]));
-               *pTmp1 = s_uSMVideoStreamWritePosition;
-               *pTmp2 = s_uSMVideoStreamWritePosition;
-               log_line("[VideoOutput] Successfully opened and cleared SM for video output: %s", SM_STREAMER_NAME);
+               if ( 0 != video_sm_ring_writer_init(&s_SMVideoRingWriter, s_pSMVideoStreamerWrite, SM_STREAMER_SIZE) )
+               {
+                  log_softerror_and_alarm("[VideoOutput] Failed to init video ring in shared memory %s", SM_STREAMER_NAME);
+                  munmap(s_pSMVideoStreamerWrite, SM_STREAMER_SIZE);
+                  s_pSMVideoStreamerWrite = NULL;
+               }
+               else
+                  log_line("[VideoOutput] Successfully opened and cleared SM for video output: %s (video ring v%d, %u bytes)", SM_STREAMER_NAME, VIDEO_SM_RING_VERSION, s_SMVideoRingWriter.uDataSize);
             }
          }
       }
@@ -745,7 +743,7 @@ void rx_video_output_uninit()
    {
       munmap(s_pSMVideoStreamerWrite, SM_STREAMER_SIZE);
       s_pSMVideoStreamerWrite = NULL;
-      s_uSMVideoStreamWritePosition = 2*sizeof(u32);
+      memset(&s_SMVideoRingWriter, 0, sizeof(type_video_sm_ring_writer));
       log_line("[VideoOutput] Closes streamer SM for video output: %S", SM_STREAMER_NAME);
    }
    log_line("[VideoOutput] Uninit complete.");
@@ -755,14 +753,10 @@ void rx_video_output_enable_streamer_output()
 {
    log_line("[VideoOutput] Enable video output to streamer.");
 
-   if ( s_bRxVideoOutputUseSM )
+   if ( s_bRxVideoOutputUseSM && (NULL != s_pSMVideoStreamerWrite) )
    {
-      s_uSMVideoStreamWritePosition = 2*sizeof(u32);
-      u32* pTmp1 = (u32*)(&(s_pSMVideoStreamerWrite[0]));
-      u32* pTmp2 = (u32*)(&(s_pSMVideoStreamerWrite[sizeof(u32)]));
-      *pTmp1 = s_uSMVideoStreamWritePosition;
-      *pTmp2 = s_uSMVideoStreamWritePosition;
-      log_line("[VideoOutput] Reseted SM video output position.");
+      video_sm_ring_writer_reset(&s_SMVideoRingWriter);
+      log_line("[VideoOutput] Started new SM video output session.");
    }
 
    _rx_video_output_check_start_streamer();
@@ -891,29 +885,19 @@ void _rx_video_output_to_sharedmem(u8* pBuffer, u32 uLength)
       s_bDidSentAnyDataToVideoStreamerSM = true;
    }
 
-   if ( uLength <= (SM_STREAMER_SIZE-s_uSMVideoStreamWritePosition) )
+   // The player can only (re)start decoding cleanly from a SPS/VPS/IDR, so chunks that contain one are marked as keyframes
+   int iKeyframeOffset = video_sm_ring_find_keyframe_offset(pBuffer, uLength, (s_uCurrentReceivedVideoStreamType == VIDEO_TYPE_H265)?1:0);
+   int iRes = video_sm_ring_write(&s_SMVideoRingWriter, pBuffer, uLength, iKeyframeOffset, g_TimeNow);
+   if ( g_TimeNow >= s_uTimeLastSMVideoRingStatsLog + 10000 )
    {
-      memcpy(&(s_pSMVideoStreamerWrite[s_uSMVideoStreamWritePosition]), pBuffer, uLength);
-      s_uSMVideoStreamWritePosition += uLength;
-      if ( s_uSMVideoStreamWritePosition >= SM_STREAMER_SIZE )
-         s_uSMVideoStreamWritePosition = 2*sizeof(u32);
+      s_uTimeLastSMVideoRingStatsLog = g_TimeNow;
+      type_video_sm_ring_header* pHeader = s_SMVideoRingWriter.pHeader;
+      if ( (NULL != pHeader) && ((0 != pHeader->uStatsDroppedChunks) || (0 != pHeader->uReaderOverruns)) )
+         log_line("[VideoOutput] SM video ring: %u chunks written, %u dropped (player lagging), player overruns: %u, player resyncs: %u",
+            pHeader->uStatsWrittenChunks, pHeader->uStatsDroppedChunks, pHeader->uReaderOverruns, pHeader->uReaderResyncs);
    }
-   else
-   {
-      u32 uLeft = SM_STREAMER_SIZE-s_uSMVideoStreamWritePosition;
-      memcpy(&(s_pSMVideoStreamerWrite[s_uSMVideoStreamWritePosition]), pBuffer, uLeft);
-      u8* pTmp = pBuffer + uLeft;
-      s_uSMVideoStreamWritePosition = 2*sizeof(u32);
-
-      memcpy(&(s_pSMVideoStreamerWrite[s_uSMVideoStreamWritePosition]), pTmp, uLength-uLeft);
-      s_uSMVideoStreamWritePosition += uLength-uLeft;
-      if ( s_uSMVideoStreamWritePosition >= SM_STREAMER_SIZE )
-         s_uSMVideoStreamWritePosition = 2*sizeof(u32);
-   }
-   u32* pTmp1 = (u32*)(&(s_pSMVideoStreamerWrite[0]));
-   u32* pTmp2 = (u32*)(&(s_pSMVideoStreamerWrite[sizeof(u32)]));
-   *pTmp1 = s_uSMVideoStreamWritePosition;
-   *pTmp2 = s_uSMVideoStreamWritePosition;
+   if ( iRes <= 0 )
+      return;
 
    if ( NULL != s_pSemaphoreSMData )
    {
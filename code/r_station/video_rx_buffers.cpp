@@ -63,11 +63,14 @@ VideoRxPacketsBuffer::VideoRxPacketsBuffer(int iVideoStreamIndex, int iCameraInd
    m_iTopBufferIndex = 0;
    m_iBottomBufferIndex = 0;
    m_iBottomBufferPacketIndex = 0;
+   m_ECRxInfo.pFECContext = fec_context_create();
 }
 
 VideoRxPacketsBuffer::~VideoRxPacketsBuffer()
 {
    uninit();
+   fec_context_destroy(m_ECRxInfo.pFECContext);
+   m_ECRxInfo.pFECContext = NULL;
 
    for( int i=0; i<MAX_RXTX_BLOCKS_BUFFER; i++ )
    for( int k=0; k<MAX_TOTAL_PACKETS_IN_BLOCK; k++ )
@@ -108,11 +111,25 @@ bool VideoRxPacketsBuffer::uninit()
       return true;
 
    log_line("[VideoRXBuffer] Uninitialize video Tx buffer instance number %d.", m_iInstanceIndex+1);
+   u32 uHits = 0, uMisses = 0;
+   getECDecodeCacheStats(&uHits, &uMisses);
+   log_line("[VideoRXBuffer] EC decode matrix cache: %u hits, %u misses.", uHits, uMisses);
    
    m_bInitialized = false;
    return true;
 }
 
+void VideoRxPacketsBuffer::getECDecodeCacheStats(u32* puHits, u32* puMisses)
+{
+   unsigned int uHits = 0, uMisses = 0;
+   if ( NULL != m_ECRxInfo.pFECContext )
+      fec_context_get_cache_stats(m_ECRxInfo.pFECContext, &uHits, &uMisses);
+   if ( NULL != puHits )
+      *puHits = uHits;
+   if ( NULL != puMisses )
+      *puMisses = uMisses;
+}
+
 void VideoRxPacketsBuffer::emptyBuffers(const char* szReason)
 {
    _empty_buffers(szReason, NULL, NULL);
@@ -295,7 +312,7 @@ void VideoRxPacketsBuffer::_check_do_ec_for_video_block(int iBufferIndex)
          bHasDataAfterEOF = true;
    }
 
-   int iRes = fec_decode(m_VideoBlocks[iBufferIndex].iBlockDataSize, m_ECRxInfo.p_decode_data_packets_pointers, m_VideoBlocks[iBufferIndex].iBlockDataPackets, m_ECRxInfo.p_decode_ec_packets_pointers, m_ECRxInfo.decode_ec_packets_indexes, m_ECRxInfo.decode_missing_packets_indexes, m_ECRxInfo.missing_packets_count);
+   int iRes = fec_decode_ctx(m_ECRxInfo.pFECContext, m_VideoBlocks[iBufferIndex].iBlockDataSize, m_ECRxInfo.p_decode_data_packets_pointers, m_VideoBlocks[iBufferIndex].iBlockDataPackets, m_ECRxInfo.p_decode_ec_packets_pointers, m_ECRxInfo.decode_ec_packets_indexes, m_ECRxInfo.decode_missing_packets_indexes, m_ECRxInfo.missing_packets_count);
    if ( iRes < 0 )
    {
       log_softerror_and_alarm("[VideoRXBuffer] Failed to decode video block [%u], type %d/%d/%d bytes; max data recv index: %d, max data/ec received index: %d, eoframe-index: %d; recv: %d/%d packets, missing count: %d",
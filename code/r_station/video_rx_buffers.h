@@ -4,6 +4,7 @@
 #include "../base/config.h"
 #include "../base/models.h"
 #include "../radio/radiopackets2.h"
+#include "../radio/fec.h"
 
 
 //  [packet header][video segment header][video seg header important][video data][000]
@@ -50,6 +51,7 @@ typedef struct
    u8* p_decode_data_packets_pointers[MAX_TOTAL_PACKETS_IN_BLOCK];
    u8* p_decode_ec_packets_pointers[MAX_TOTAL_PACKETS_IN_BLOCK];
    unsigned int missing_packets_count;
+   fec_context_t* pFECContext;
 } type_fec_info;
 
 
@@ -82,6 +84,7 @@ class VideoRxPacketsBuffer
       void resetFrameEndDetectedFlag();
       bool isFrameEndDetected();
       u32 getFrameEndDetectionTime();
+      void getECDecodeCacheStats(u32* puHits, u32* puMisses);
 
    protected:
 
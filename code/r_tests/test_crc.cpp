@@ -0,0 +1,167 @@
+/*
+    CRC32 engines conformance and benchmark tool.
+
+    Runs headless, only needs base.c:
+    - conformance: for each CRC32 engine supported by the CPU (slice-by-8, ARMv8 CRC, x86 PCLMUL),
+      random buffer lengths and alignments, checks that base_compute_crc32, base_compute_crc32_continue
+      over random splits and the fused base_copy_and_compute_crc32 (copy included) give the same values
+      as the bitwise reference CRC-32 (poly 0xEDB88320), so they stay compatible with the other end of the link.
+    - benchmark: throughput (MB/s) of each engine and of the fused copy on radio packet sized buffers.
+
+    Usage: test_crc [-quick] [-conformance] [-bench] [-seed n] [-iterations n]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../radio/radiopackets2.h"
+#include "test_utils.h"
+
+#define TEST_CRC_MAX_LENGTH 4096
+
+static type_test_options s_Options;
+static const int s_iEngines[] = { CRC32_ENGINE_SLICE8, CRC32_ENGINE_ARMV8, CRC32_ENGINE_PCLMUL };
+
+// Bit by bit CRC-32, used as reference
+static u32 _ref_crc32(const u8* pBuffer, int iLength)
+{
+   u32 uCRC = 0xFFFFFFFF;
+   for( int i=0; i<iLength; i++ )
+   {
+      uCRC ^= pBuffer[i];
+      for( int k=0; k<8; k++ )
+         uCRC = (uCRC >> 1) ^ (0xEDB88320 & (0 - (uCRC & 1)));
+   }
+   return uCRC ^ 0xFFFFFFFF;
+}
+
+static void _test_engine()
+{
+   static u8 s_uBuffer[TEST_CRC_MAX_LENGTH + 16];
+   static u8 s_uCopy[TEST_CRC_MAX_LENGTH + 16];
+   u32 uRand = s_Options.uSeed;
+   const char* szEngine = base_get_crc32_engine_name();
+
+   // Known value
+   TEST_CHECK(0xCBF43926 == base_compute_crc32((u8*)"123456789", 9), "%s: CRC of \"123456789\" is 0x%08X", szEngine, base_compute_crc32((u8*)"123456789", 9));
+
+   for( int iIteration=0; iIteration<s_Options.iIterations; iIteration++ )
+   {
+      // Mostly radio packet sized buffers, all short lengths (engine tails/thresholds) show up often
+      int iLength = 1 + (test_rand_next(&uRand) % MAX_PACKET_TOTAL_SIZE);
+      if ( 0 == (iIteration % 16) )
+         iLength = 1 + (test_rand_next(&uRand) % TEST_CRC_MAX_LENGTH);
+      else if ( 0 == (iIteration % 4) )
+         iLength = 1 + (test_rand_next(&uRand) % 130);
+      int iOffset = test_rand_next(&uRand) % 16;
+      u8* pData = s_uBuffer + iOffset;
+      for( int i=0; i<iLength; i++ )
+         pData[i] = (u8)test_rand_next(&uRand);
+
+      u32 uRef = _ref_crc32(pData, iLength);
+      u32 uCRC = base_compute_crc32(pData, iLength);
+      TEST_CHECK(uCRC == uRef, "%s: CRC 0x%08X, expected 0x%08X (length %d, offset %d)", szEngine, uCRC, uRef, iLength, iOffset);
+
+      // Continued over up to 3 random splits
+      int iSplit1 = test_rand_next(&uRand) % (iLength+1);
+      int iSplit2 = iSplit1 + (test_rand_next(&uRand) % (iLength - iSplit1 + 1));
+      uCRC = base_compute_crc32_continue(0, pData, iSplit1);
+      uCRC = base_compute_crc32_continue(uCRC, pData + iSplit1, iSplit2 - iSplit1);
+      uCRC = base_compute_crc32_continue(uCRC, pData + iSplit2, iLength - iSplit2);
+      TEST_CHECK(uCRC == uRef, "%s: continued CRC 0x%08X, expected 0x%08X (length %d, splits %d %d)", szEngine, uCRC, uRef, iLength, iSplit1, iSplit2);
+
+      // Fused copy, to a different alignment, also continued
+      int iCopyOffset = test_rand_next(&uRand) % 16;
+      memset(s_uCopy, 0, sizeof(s_uCopy));
+      uCRC = base_copy_and_compute_crc32(s_uCopy + iCopyOffset, pData, iSplit1, 0);
+      uCRC = base_copy_and_compute_crc32(s_uCopy + iCopyOffset + iSplit1, pData + iSplit1, iLength - iSplit1, uCRC);
+      TEST_CHECK(uCRC == uRef, "%s: fused copy CRC 0x%08X, expected 0x%08X (length %d, split %d)", szEngine, uCRC, uRef, iLength, iSplit1);
+      TEST_CHECK(0 == memcmp(s_uCopy + iCopyOffset, pData, iLength), "%s: fused copy data differs (length %d)", szEngine, iLength);
+   }
+
+   // Empty buffers leave the CRC unchanged
+   TEST_CHECK(0 == base_compute_crc32(s_uBuffer, 0), "%s: CRC of an empty buffer", szEngine);
+   TEST_CHECK(0x12345678 == base_compute_crc32_continue(0x12345678, s_uBuffer, 0), "%s: continue on an empty buffer", szEngine);
+}
+
+static void _test_conformance()
+{
+   printf("\nConformance, %d iterations per engine...\n", s_Options.iIterations);
+   for( int k=0; k<(int)(sizeof(s_iEngines)/sizeof(s_iEngines[0])); k++ )
+   {
+      if ( base_set_crc32_engine(s_iEngines[k]) != s_iEngines[k] )
+         continue;
+      printf("  %s\n", base_get_crc32_engine_name());
+      _test_engine();
+   }
+   printf("Conformance done, %d failures.\n", s_iTestFailures);
+}
+
+static void _test_bench()
+{
+   static const int s_iLengths[] = { 64, 256, 1024, MAX_PACKET_TOTAL_SIZE - (int)sizeof(t_packet_header) };
+   static u8 s_uBuffer[MAX_PACKET_TOTAL_SIZE];
+   static u8 s_uCopy[MAX_PACKET_TOTAL_SIZE];
+
+   u32 uRand = s_Options.uSeed;
+   for( int i=0; i<MAX_PACKET_TOTAL_SIZE; i++ )
+      s_uBuffer[i] = (u8)test_rand_next(&uRand);
+
+   long long lTotalBytes = s_Options.bQuick?(50LL*1000*1000):(500LL*1000*1000);
+   printf("\nBenchmark, %lld MB per test (MB/s):\n", lTotalBytes/1000/1000);
+   printf("  Engine      | Buffer size |   CRC | memcpy + CRC | fused copy + CRC\n");
+
+   u32 uCheck = 0;
+   for( int k=0; k<(int)(sizeof(s_iEngines)/sizeof(s_iEngines[0])); k++ )
+   {
+      if ( base_set_crc32_engine(s_iEngines[k]) != s_iEngines[k] )
+         continue;
+      for( int l=0; l<(int)(sizeof(s_iLengths)/sizeof(s_iLengths[0])); l++ )
+      {
+         int iLength = s_iLengths[l];
+         int iCount = (int)(lTotalBytes / iLength);
+         unsigned long long uTimes[3];
+
+         unsigned long long uStart = test_now_nanos();
+         for( int i=0; i<iCount; i++ )
+            uCheck += base_compute_crc32(s_uBuffer, iLength);
+         uTimes[0] = test_now_nanos() - uStart;
+
+         uStart = test_now_nanos();
+         for( int i=0; i<iCount; i++ )
+         {
+            memcpy(s_uCopy, s_uBuffer, iLength);
+            uCheck += base_compute_crc32(s_uCopy, iLength);
+         }
+         uTimes[1] = test_now_nanos() - uStart;
+
+         uStart = test_now_nanos();
+         for( int i=0; i<iCount; i++ )
+            uCheck += base_copy_and_compute_crc32(s_uCopy, s_uBuffer, iLength, 0);
+         uTimes[2] = test_now_nanos() - uStart;
+
+         double dMB[3];
+         for( int i=0; i<3; i++ )
+            dMB[i] = ((double)iCount * iLength) * 1000.0 / (double)((uTimes[i] > 0)?uTimes[i]:1);
+         printf("  %-11s | %11d | %5.0f | %12.0f | %16.0f\n", base_get_crc32_engine_name(), iLength, dMB[0], dMB[1], dMB[2]);
+      }
+   }
+   // Keep the results alive so the loops are not optimized out
+   printf("  (check value: %u)\n", uCheck);
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 20000, 2000, NULL, NULL) )
+      return -1;
+
+   base_set_crc32_engine(CRC32_ENGINE_AUTO);
+   printf("\nTesting CRC32 engines. Engine used by this build: %s\n", base_get_crc32_engine_name());
+
+   if ( s_Options.bConformance )
+      _test_conformance();
+   if ( s_Options.bBench )
+      _test_bench();
+
+   base_set_crc32_engine(CRC32_ENGINE_AUTO);
+   return test_report_result("CRC32");
+}
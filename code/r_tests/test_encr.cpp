@@ -0,0 +1,145 @@
+/*
+    Payload encryption (epp/dpp) conformance and benchmark tool.
+
+    Runs headless, no radio hardware needed:
+    - conformance: random pass phrases (1 to MAX_PASS_LENGTH bytes) and random buffer lengths/offsets,
+      checks that epp/dpp output is identical to the original per byte pass phrase XOR (so it stays
+      compatible with other firmware versions on the other end of the link) and that dpp(epp(x)) == x.
+    - benchmark: epp throughput (MB/s) on radio packet sized buffers, compared to the per byte XOR.
+
+    Usage: test_encr [-quick] [-conformance] [-bench] [-seed n] [-iterations n]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../base/encr.h"
+#include "../radio/radiopackets2.h"
+#include "test_utils.h"
+
+static type_test_options s_Options;
+
+// The original epp/dpp implementation, used as reference
+static void _ref_xor(u8* pData, int len, u8* pPass, int iPassLength)
+{
+   for( int pos=0; pos < len; pos++ )
+   {
+      *pData = (*pData) ^ pPass[pos%iPassLength];
+      pData++;
+   }
+}
+
+static void _test_conformance()
+{
+   printf("\nConformance, %d iterations...\n", s_Options.iIterations);
+
+   u32 uRand = s_Options.uSeed;
+   static u8 s_uBuffer[3*MAX_PACKET_TOTAL_SIZE + 16];
+   static u8 s_uBufferRef[3*MAX_PACKET_TOTAL_SIZE + 16];
+   static u8 s_uBufferOrig[3*MAX_PACKET_TOTAL_SIZE + 16];
+   u8 uPass[MAX_PASS_LENGTH];
+
+   for( int iIteration=0; iIteration<s_Options.iIterations; iIteration++ )
+   {
+      int iPassLength = 1 + (test_rand_next(&uRand) % MAX_PASS_LENGTH);
+      for( int i=0; i<iPassLength; i++ )
+         uPass[i] = 1 + (test_rand_next(&uRand) % 255);
+      upp(uPass, iPassLength);
+
+      // Mostly radio packet sized buffers, sometimes longer than the precomputed key stream
+      int iLength = 1 + (test_rand_next(&uRand) % MAX_PACKET_TOTAL_SIZE);
+      if ( 0 == (iIteration % 16) )
+         iLength = 1 + (test_rand_next(&uRand) % (3*MAX_PACKET_TOTAL_SIZE));
+      int iOffset = test_rand_next(&uRand) % 16;
+
+      for( int i=0; i<iLength; i++ )
+         s_uBufferOrig[iOffset+i] = (u8)test_rand_next(&uRand);
+      memcpy(s_uBuffer + iOffset, s_uBufferOrig + iOffset, iLength);
+      memcpy(s_uBufferRef + iOffset, s_uBufferOrig + iOffset, iLength);
+
+      epp(s_uBuffer + iOffset, iLength);
+      _ref_xor(s_uBufferRef + iOffset, iLength, uPass, iPassLength);
+      if ( 0 != memcmp(s_uBuffer + iOffset, s_uBufferRef + iOffset, iLength) )
+      {
+         printf("FAILED: epp output differs from reference (pass length %d, buffer length %d, offset %d)\n", iPassLength, iLength, iOffset);
+         s_iTestFailures++;
+         continue;
+      }
+
+      dpp(s_uBuffer + iOffset, iLength);
+      if ( 0 != memcmp(s_uBuffer + iOffset, s_uBufferOrig + iOffset, iLength) )
+      {
+         printf("FAILED: dpp did not restore the data (pass length %d, buffer length %d, offset %d)\n", iPassLength, iLength, iOffset);
+         s_iTestFailures++;
+      }
+   }
+
+   // No pass phrase: data must be left untouched
+   rpp();
+   memcpy(s_uBuffer, s_uBufferOrig, MAX_PACKET_TOTAL_SIZE);
+   epp(s_uBuffer, MAX_PACKET_TOTAL_SIZE);
+   if ( (0 != hpp()) || (0 != memcmp(s_uBuffer, s_uBufferOrig, MAX_PACKET_TOTAL_SIZE)) )
+   {
+      printf("FAILED: epp changed the data with no pass phrase set\n");
+      s_iTestFailures++;
+   }
+   printf("Conformance done, %d failures.\n", s_iTestFailures);
+}
+
+static void _test_bench()
+{
+   static const int s_iLengths[] = { 64, 256, 1024, MAX_PACKET_TOTAL_SIZE - (int)sizeof(t_packet_header) };
+   static u8 s_uBuffer[MAX_PACKET_TOTAL_SIZE];
+   u8 uPass[] = "benchmark-pass-phrase-23";
+   int iPassLength = (int)strlen((char*)uPass);
+   upp(uPass, iPassLength);
+
+   u32 uRand = s_Options.uSeed;
+   for( int i=0; i<MAX_PACKET_TOTAL_SIZE; i++ )
+      s_uBuffer[i] = (u8)test_rand_next(&uRand);
+
+   long long lTotalBytes = s_Options.bQuick?(50LL*1000*1000):(500LL*1000*1000);
+   printf("\nBenchmark, pass phrase length %d, %lld MB per test:\n", iPassLength, lTotalBytes/1000/1000);
+   printf("  Buffer size | per byte XOR (MB/s) | epp (MB/s) | speedup\n");
+
+   for( int k=0; k<(int)(sizeof(s_iLengths)/sizeof(s_iLengths[0])); k++ )
+   {
+      int iLength = s_iLengths[k];
+      int iCount = (int)(lTotalBytes / iLength);
+
+      unsigned long long uStart = test_now_nanos();
+      for( int i=0; i<iCount; i++ )
+         _ref_xor(s_uBuffer, iLength, uPass, iPassLength);
+      unsigned long long uTimeRef = test_now_nanos() - uStart;
+
+      uStart = test_now_nanos();
+      for( int i=0; i<iCount; i++ )
+         epp(s_uBuffer, iLength);
+      unsigned long long uTimeNew = test_now_nanos() - uStart;
+
+      if ( 0 == uTimeRef )
+         uTimeRef = 1;
+      if ( 0 == uTimeNew )
+         uTimeNew = 1;
+      double dMBRef = ((double)iCount * iLength) * 1000.0 / (double)uTimeRef;
+      double dMBNew = ((double)iCount * iLength) * 1000.0 / (double)uTimeNew;
+      printf("  %11d | %19.1f | %10.1f | %.1fx\n", iLength, dMBRef, dMBNew, dMBNew/dMBRef);
+   }
+   // Keep the buffer alive so the loops are not optimized out
+   printf("  (check byte: %d)\n", (int)s_uBuffer[7]);
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 20000, 2000, NULL, NULL) )
+      return -1;
+
+   printf("\nTesting payload encryption (epp/dpp).\n");
+
+   if ( s_Options.bConformance )
+      _test_conformance();
+   if ( s_Options.bBench )
+      _test_bench();
+
+   rpp();
+   return test_report_result("encryption");
+}
@@ -1,95 +1,364 @@
+/*
+    FEC conformance and benchmark tool.
+
+    Runs headless, no radio hardware needed:
+    - conformance: random block sizes, data/EC ratios (up to MAX_DATA_PACKETS_IN_BLOCK/MAX_FECS_PACKETS_IN_BLOCK)
+      and random erasure patterns, for every FEC kernel supported by the CPU.
+      Checks that all kernels produce the same EC packets as the generic one and that decode restores the data.
+    - threads: concurrent decode on separate FEC contexts.
+    - benchmark: encode/decode throughput (MB/s of data) and per block latency.
+
+    Usage: test_fec [-quick] [-conformance] [-bench] [-seed n] [-iterations n] [-accel generic|ssse3|avx2|neon]
+    Returns 0 if all checks passed.
+*/
+
 #include "../base/base.h"
-#include "../base/config.h"
-#include "../base/shared_mem.h"
-#include "../radio/radiolink.h"
 #include "../radio/radiopackets2.h"
-
 #include "../radio/fec.h"
+#include "test_utils.h"
+
+#include <pthread.h>
 
-int packet_length = 32;
-int packets_per_block = 6;
-int fecs_per_block = 3;
+#define TEST_FEC_THREADS 4
 
-#define MAX_PACKETS 64
+static const int s_iBlockSizes[] = { 1, 15, 16, 17, 31, 32, 33, 64, 100, 255, 512, 1024, 1100, MAX_PACKET_PAYLOAD };
+static const int s_iAccels[] = { FEC_ACCEL_NONE, FEC_ACCEL_SSSE3, FEC_ACCEL_AVX2, FEC_ACCEL_NEON };
 
+static type_test_options s_Options;
+static int s_iForcedAccel = -1;
 
-u8* packetsArray[MAX_PACKETS];
-u8* fecsArray[MAX_PACKETS];
-u8* fecsForDecode[MAX_PACKETS];
+typedef struct
+{
+   int iDataPackets;
+   int iECPackets;
+   int iBlockSize;
+   u8* pData[MAX_DATA_PACKETS_IN_BLOCK];
+   u8* pDataRef[MAX_DATA_PACKETS_IN_BLOCK];
+   u8* pEC[MAX_FECS_PACKETS_IN_BLOCK];
+   u8* pECRef[MAX_FECS_PACKETS_IN_BLOCK];
+   u8* pECWork[MAX_FECS_PACKETS_IN_BLOCK];
+   u8* pECDecode[MAX_FECS_PACKETS_IN_BLOCK];
+   unsigned int uECIndexes[MAX_FECS_PACKETS_IN_BLOCK];
+   unsigned int uMissingIndexes[MAX_FECS_PACKETS_IN_BLOCK];
+   int iMissingCount;
+} type_test_fec_block;
 
-void print_all()
+static void _block_alloc(type_test_fec_block* pBlock)
 {
-   for( int i=0; i<packets_per_block; i++ )
+   memset(pBlock, 0, sizeof(type_test_fec_block));
+   for( int i=0; i<MAX_DATA_PACKETS_IN_BLOCK; i++ )
    {
-      printf("\nPacket %d: ", i);
-      for( int j=0; j<packet_length; j++ )
-         printf("%d,", packetsArray[i][j]); 
+      pBlock->pData[i] = (u8*)malloc(MAX_PACKET_PAYLOAD);
+      pBlock->pDataRef[i] = (u8*)malloc(MAX_PACKET_PAYLOAD);
    }
-   printf("\n");
-   for( int i=0; i<fecs_per_block; i++ )
+   for( int i=0; i<MAX_FECS_PACKETS_IN_BLOCK; i++ )
    {
-      printf("\nFEC %d: ", i);
-      for( int j=0; j<packet_length; j++ )
-         printf("%d,", fecsArray[i][j]); 
+      pBlock->pEC[i] = (u8*)malloc(MAX_PACKET_PAYLOAD);
+      pBlock->pECRef[i] = (u8*)malloc(MAX_PACKET_PAYLOAD);
+      pBlock->pECWork[i] = (u8*)malloc(MAX_PACKET_PAYLOAD);
    }
-   printf("\n");
 }
 
-int main(int argc, char *argv[])
+static void _block_free(type_test_fec_block* pBlock)
 {
-   printf("\nTesting FEC encode/decode\n");
+   for( int i=0; i<MAX_DATA_PACKETS_IN_BLOCK; i++ )
+   {
+      free(pBlock->pData[i]);
+      free(pBlock->pDataRef[i]);
+   }
+   for( int i=0; i<MAX_FECS_PACKETS_IN_BLOCK; i++ )
+   {
+      free(pBlock->pEC[i]);
+      free(pBlock->pECRef[i]);
+      free(pBlock->pECWork[i]);
+   }
+}
 
-   fec_init();
+static void _block_fill_random(type_test_fec_block* pBlock, u32* pRandState)
+{
+   for( int i=0; i<pBlock->iDataPackets; i++ )
+   {
+      for( int k=0; k<pBlock->iBlockSize; k++ )
+         pBlock->pDataRef[i][k] = (u8)test_rand_next(pRandState);
+      memcpy(pBlock->pData[i], pBlock->pDataRef[i], pBlock->iBlockSize);
+   }
+}
+
+// Erases iMissing random data packets and picks iMissing random EC packets to recover them.
+// Decoding overwrites the EC packets it uses, so they are copied to work buffers.
+static void _block_erase_random(type_test_fec_block* pBlock, int iMissing, u32* pRandState)
+{
+   bool bUsed[MAX_FECS_PACKETS_IN_BLOCK];
+   bool bMissing[MAX_DATA_PACKETS_IN_BLOCK];
+   memset(bUsed, 0, sizeof(bUsed));
+   memset(bMissing, 0, sizeof(bMissing));
 
-   for( int i=0; i<packets_per_block; i++ )
+   for( int i=0; i<iMissing; i++ )
    {
-      packetsArray[i] = (u8*)malloc(packet_length);
-      for( int j=0; j<packet_length; j++ )
-         packetsArray[i][j] = 32 + i + j;
+      int iIndex = test_rand_next(pRandState) % pBlock->iDataPackets;
+      while ( bMissing[iIndex] )
+         iIndex = (iIndex+1) % pBlock->iDataPackets;
+      bMissing[iIndex] = true;
    }
-   for( int i=0; i<fecs_per_block; i++ )
+   // Missing indexes must be in increasing order
+   pBlock->iMissingCount = 0;
+   for( int i=0; i<pBlock->iDataPackets; i++ )
    {
-      fecsArray[i] = (u8*)malloc(packet_length);
+      if ( ! bMissing[i] )
+         continue;
+      memset(pBlock->pData[i], 0, pBlock->iBlockSize);
+      pBlock->uMissingIndexes[pBlock->iMissingCount] = i;
+      pBlock->iMissingCount++;
    }
 
-   print_all();
+   for( int i=0; i<iMissing; i++ )
+   {
+      int iIndex = test_rand_next(pRandState) % pBlock->iECPackets;
+      while ( bUsed[iIndex] )
+         iIndex = (iIndex+1) % pBlock->iECPackets;
+      bUsed[iIndex] = true;
+      pBlock->uECIndexes[i] = iIndex;
+      memcpy(pBlock->pECWork[i], pBlock->pEC[iIndex], pBlock->iBlockSize);
+      pBlock->pECDecode[i] = pBlock->pECWork[i];
+   }
+}
 
-   fec_encode(packet_length, packetsArray, packets_per_block, fecsArray, fecs_per_block);
+static bool _block_check_data(type_test_fec_block* pBlock)
+{
+   for( int i=0; i<pBlock->iDataPackets; i++ )
+   {
+      if ( 0 != memcmp(pBlock->pData[i], pBlock->pDataRef[i], pBlock->iBlockSize) )
+         return false;
+   }
+   return true;
+}
+
+static void _fail(const char* szTest, type_test_fec_block* pBlock, int iAccel, const char* szReason)
+{
+   s_iTestFailures++;
+   printf("FAIL [%s] kernel %s, block %d/%d, %d bytes, %d missing: %s\n",
+      szTest, fec_get_accel_name(iAccel), pBlock->iDataPackets, pBlock->iECPackets, pBlock->iBlockSize, pBlock->iMissingCount, szReason);
+}
 
-   printf("\nEncode result:\n");
-   print_all();
+static void _test_conformance()
+{
+   printf("\nConformance (%d iterations, seed %u, max block %d/%d):\n", s_Options.iIterations, s_Options.uSeed, MAX_DATA_PACKETS_IN_BLOCK, MAX_FECS_PACKETS_IN_BLOCK);
 
+   type_test_fec_block block;
+   _block_alloc(&block);
+   fec_context_t* pContext = fec_context_create();
+   u32 uRandState = s_Options.uSeed;
+   int iFailuresBefore = s_iTestFailures;
 
-   for( int j=0; j<packet_length; j++ )
-    {
-      packetsArray[2][j] = 0;
-      packetsArray[4][j] = 0;
-      fecsArray[1][j] = 0;
-    }
+   for( int iIter=0; iIter<s_Options.iIterations; iIter++ )
+   {
+      block.iDataPackets = 1 + test_rand_next(&uRandState) % MAX_DATA_PACKETS_IN_BLOCK;
+      block.iECPackets = 1 + test_rand_next(&uRandState) % MAX_FECS_PACKETS_IN_BLOCK;
+      block.iBlockSize = s_iBlockSizes[test_rand_next(&uRandState) % (sizeof(s_iBlockSizes)/sizeof(s_iBlockSizes[0]))];
+      int iMaxMissing = (block.iDataPackets < block.iECPackets)?block.iDataPackets:block.iECPackets;
+      int iMissing = test_rand_next(&uRandState) % (iMaxMissing+1);
+      u32 uBlockSeed = test_rand_next(&uRandState);
 
-   printf("\nRandomised data:\n");
-   print_all();
+      // Reference EC packets, generic kernel
+      fec_set_accel(FEC_ACCEL_NONE);
+      u32 uState = uBlockSeed;
+      _block_fill_random(&block, &uState);
+      fec_encode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pECRef, block.iECPackets);
 
-   //the following three fields are infos for fec_decode
-    unsigned int fec_block_nos[MAX_PACKETS];
-    unsigned int erased_blocks[MAX_PACKETS];
-    unsigned int nr_fec_blocks = 0;
+      for( int a=0; a<(int)(sizeof(s_iAccels)/sizeof(s_iAccels[0])); a++ )
+      {
+         if ( fec_set_accel(s_iAccels[a]) != s_iAccels[a] )
+            continue;
 
-    erased_blocks[0] = 2;
-    fec_block_nos[0] = 0;
-    fecsForDecode[0] = fecsArray[0];
+         uState = uBlockSeed;
+         _block_fill_random(&block, &uState);
+         fec_encode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pEC, block.iECPackets);
+         for( int i=0; i<block.iECPackets; i++ )
+         {
+            if ( 0 != memcmp(block.pEC[i], block.pECRef[i], block.iBlockSize) )
+            {
+               _fail("encode", &block, s_iAccels[a], "EC packets differ from the generic kernel");
+               break;
+            }
+         }
 
-    erased_blocks[1] = 4;
-    fec_block_nos[1] = 2;
-    fecsForDecode[1] = fecsArray[2];
+         // Decode twice with the same pattern: first time fills the matrix cache, second time uses it
+         for( int iPass=0; iPass<2; iPass++ )
+         {
+            u32 uEraseState = uBlockSeed ^ 0x5A5A5A5A;
+            uState = uBlockSeed;
+            _block_fill_random(&block, &uState);
+            _block_erase_random(&block, iMissing, &uEraseState);
+            if ( 0 == block.iMissingCount )
+               break;
+            int iRes = fec_decode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pECDecode, block.uECIndexes, block.uMissingIndexes, block.iMissingCount);
+            if ( iRes < 0 )
+               _fail("decode", &block, s_iAccels[a], "decode returned an error");
+            else if ( ! _block_check_data(&block) )
+               _fail("decode", &block, s_iAccels[a], (iPass == 0)?"recovered data is wrong":"recovered data is wrong (cached matrix)");
+         }
+      }
+   }
 
-    nr_fec_blocks = 2;
+   unsigned int uHits = 0, uMisses = 0;
+   fec_context_get_cache_stats(pContext, &uHits, &uMisses);
+   printf("   %s, decode matrix cache: %u hits, %u misses\n", (s_iTestFailures == iFailuresBefore)?"passed":"FAILED", uHits, uMisses);
 
-   fec_decode(packet_length, packetsArray, packets_per_block, fecsForDecode, fec_block_nos, erased_blocks, nr_fec_blocks );
+   fec_context_destroy(pContext);
+   _block_free(&block);
+}
 
-   printf("\nDecoded data:\n");
-   print_all();
+typedef struct
+{
+   int iThreadIndex;
+   int iFailures;
+} type_test_fec_thread;
 
+static void* _thread_decode(void* pArg)
+{
+   type_test_fec_thread* pInfo = (type_test_fec_thread*)pArg;
+   type_test_fec_block block;
+   _block_alloc(&block);
+   fec_context_t* pContext = fec_context_create();
+   u32 uRandState = s_Options.uSeed + 7919 * (u32)(pInfo->iThreadIndex+1);
 
-   return (0);
-} 
+   for( int iIter=0; iIter<s_Options.iIterations/2; iIter++ )
+   {
+      block.iDataPackets = 1 + test_rand_next(&uRandState) % MAX_DATA_PACKETS_IN_BLOCK;
+      block.iECPackets = 1 + test_rand_next(&uRandState) % MAX_FECS_PACKETS_IN_BLOCK;
+      block.iBlockSize = s_iBlockSizes[test_rand_next(&uRandState) % (sizeof(s_iBlockSizes)/sizeof(s_iBlockSizes[0]))];
+      int iMaxMissing = (block.iDataPackets < block.iECPackets)?block.iDataPackets:block.iECPackets;
+      _block_fill_random(&block, &uRandState);
+      fec_encode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pEC, block.iECPackets);
+      _block_erase_random(&block, 1 + test_rand_next(&uRandState) % iMaxMissing, &uRandState);
+      int iRes = fec_decode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pECDecode, block.uECIndexes, block.uMissingIndexes, block.iMissingCount);
+      if ( (iRes < 0) || (! _block_check_data(&block)) )
+         pInfo->iFailures++;
+   }
+   fec_context_destroy(pContext);
+   _block_free(&block);
+   return NULL;
+}
+
+static void _test_threads()
+{
+   printf("\nConcurrent decode on %d threads, %s kernel:\n", TEST_FEC_THREADS, fec_get_accel_name(fec_get_accel()));
+   pthread_t threads[TEST_FEC_THREADS];
+   type_test_fec_thread info[TEST_FEC_THREADS];
+   for( int i=0; i<TEST_FEC_THREADS; i++ )
+   {
+      info[i].iThreadIndex = i;
+      info[i].iFailures = 0;
+      pthread_create(&threads[i], NULL, &_thread_decode, &info[i]);
+   }
+   int iFailures = 0;
+   for( int i=0; i<TEST_FEC_THREADS; i++ )
+   {
+      pthread_join(threads[i], NULL);
+      iFailures += info[i].iFailures;
+   }
+   s_iTestFailures += iFailures;
+   if ( 0 == iFailures )
+      printf("   passed\n");
+   else
+      printf("FAIL [threads] %d blocks decoded wrong\n", iFailures);
+}
+
+static void _bench_kernel(int iAccel, int iDataPackets, int iECPackets, int iBlockSize)
+{
+   type_test_fec_block block;
+   _block_alloc(&block);
+   block.iDataPackets = iDataPackets;
+   block.iECPackets = iECPackets;
+   block.iBlockSize = iBlockSize;
+   fec_context_t* pContext = fec_context_create();
+   u32 uRandState = s_Options.uSeed;
+   _block_fill_random(&block, &uRandState);
+
+   int iRounds = s_Options.bQuick?200:2000;
+   unsigned long long uStart = test_now_nanos();
+   for( int i=0; i<iRounds; i++ )
+      fec_encode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pEC, block.iECPackets);
+   unsigned long long uEncodeTime = test_now_nanos() - uStart;
+
+   // Decode with as many data packets missing as EC packets, same pattern each time (matrix cache hit)
+   unsigned long long uDecodeTime = 0;
+   unsigned long long uDecodeTimeNoCache = 0;
+   u32 uEraseState = s_Options.uSeed;
+   for( int iPass=0; iPass<2; iPass++ )
+   {
+      for( int i=0; i<iRounds; i++ )
+      {
+         uEraseState = s_Options.uSeed;
+         _block_erase_random(&block, (iDataPackets<iECPackets)?iDataPackets:iECPackets, &uEraseState);
+         if ( 1 == iPass )
+            fec_context_reset_cache(pContext);
+         uStart = test_now_nanos();
+         fec_decode_ctx(pContext, block.iBlockSize, block.pData, block.iDataPackets, block.pECDecode, block.uECIndexes, block.uMissingIndexes, block.iMissingCount);
+         if ( 0 == iPass )
+            uDecodeTime += test_now_nanos() - uStart;
+         else
+            uDecodeTimeNoCache += test_now_nanos() - uStart;
+      }
+   }
+   if ( ! _block_check_data(&block) )
+      _fail("bench", &block, iAccel, "recovered data is wrong");
+
+   double fDataMB = (double)iRounds * iDataPackets * iBlockSize / (1024.0*1024.0);
+   printf("   %-8s %2d/%-2d %5d bytes: encode %8.1f MB/s %7.2f us/block; decode %8.1f MB/s %7.2f us/block (no cache: %7.2f us/block)\n",
+      fec_get_accel_name(iAccel), iDataPackets, iECPackets, iBlockSize,
+      fDataMB / ((double)uEncodeTime/1e9), (double)uEncodeTime/1000.0/iRounds,
+      fDataMB / ((double)uDecodeTime/1e9), (double)uDecodeTime/1000.0/iRounds,
+      (double)uDecodeTimeNoCache/1000.0/iRounds);
+
+   fec_context_destroy(pContext);
+   _block_free(&block);
+}
+
+static void _test_benchmark()
+{
+   static const int s_iRatios[][2] = { {4,2}, {8,4}, {12,6}, {16,8}, {MAX_DATA_PACKETS_IN_BLOCK, MAX_FECS_PACKETS_IN_BLOCK} };
+   static const int s_iBenchSizes[] = { 256, 1024, MAX_PACKET_PAYLOAD };
+
+   printf("\nBenchmark (data MB/s, per block latency):\n");
+   for( int a=0; a<(int)(sizeof(s_iAccels)/sizeof(s_iAccels[0])); a++ )
+   {
+      if ( (s_iForcedAccel >= 0) && (s_iForcedAccel != s_iAccels[a]) )
+         continue;
+      if ( fec_set_accel(s_iAccels[a]) != s_iAccels[a] )
+         continue;
+      for( int r=0; r<(int)(sizeof(s_iRatios)/sizeof(s_iRatios[0])); r++ )
+      for( int s=0; s<(int)(sizeof(s_iBenchSizes)/sizeof(s_iBenchSizes[0])); s++ )
+         _bench_kernel(s_iAccels[a], s_iRatios[r][0], s_iRatios[r][1], s_iBenchSizes[s]);
+   }
+}
+
+static int _parse_accel_option(int argc, char* argv[], int iIndex)
+{
+   if ( (0 != strcmp(argv[iIndex], "-accel")) || (iIndex >= argc-1) )
+      return 0;
+   for( int a=0; a<(int)(sizeof(s_iAccels)/sizeof(s_iAccels[0])); a++ )
+      if ( 0 == strcmp(argv[iIndex+1], fec_get_accel_name(s_iAccels[a])) )
+         s_iForcedAccel = s_iAccels[a];
+   return 2;
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 2000, 200, "[-accel generic|ssse3|avx2|neon]", &_parse_accel_option) )
+      return -1;
+
+   fec_init();
+   printf("\nTesting FEC encode/decode. Best kernel on this CPU: %s\n", fec_get_accel_name(fec_get_accel()));
+
+   if ( s_Options.bConformance )
+   {
+      _test_conformance();
+      fec_set_accel((s_iForcedAccel >= 0)?s_iForcedAccel:FEC_ACCEL_AUTO);
+      _test_threads();
+   }
+   if ( s_Options.bBench )
+      _test_benchmark();
+
+   return test_report_result("FEC");
+}
@@ -0,0 +1,253 @@
+/*
+    Vehicle model load test and benchmark: text model file vs binary snapshot (*.snp).
+
+    Runs headless, in a temp folder:
+    - a default model is saved (text file, backup and snapshot);
+    - loading it from the snapshot must give the same model as loading the text file;
+    - a text file changed without updating the snapshot, or a corrupted snapshot,
+      must fall back to the text file (and the snapshot gets rewritten);
+    - a process reloading the model on changes notifications gets all the changes,
+      also when the file was saved again before it handled the first one;
+    - benchmark: average time to load the model from the text file and from the snapshot.
+
+    Usage: test_model_load [-quick] [-conformance] [-bench] [-iterations n] [-folder path]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../base/models.h"
+#include "test_utils.h"
+
+#include <sys/stat.h>
+
+static type_test_options s_Options;
+static const char* s_szFolder = "/tmp/ruby_test_model";
+
+static long _read_file(const char* szFile, char* pBuffer, long lMaxSize)
+{
+   FILE* fd = fopen(szFile, "rb");
+   if ( NULL == fd )
+      return -1;
+   long lSize = (long)fread(pBuffer, 1, lMaxSize, fd);
+   fclose(fd);
+   return lSize;
+}
+
+// Models are the same if they save to the same text file
+// (structures can't be compared directly, strings and unused fields are not initialized).
+// Both models get their save counter incremented.
+static void _compare_models(Model* pModel1, Model* pModel2, const char* szFolder)
+{
+   static char s_szText1[200000];
+   static char s_szText2[200000];
+   char szFile1[MAX_FILE_PATH_SIZE];
+   char szFile2[MAX_FILE_PATH_SIZE];
+   snprintf(szFile1, sizeof(szFile1), "%s/compare1.mdl", szFolder);
+   snprintf(szFile2, sizeof(szFile2), "%s/compare2.mdl", szFolder);
+
+   TEST_CHECK(pModel1->getSaveCount() == pModel2->getSaveCount(), "different save count: %d, %d", pModel1->getSaveCount(), pModel2->getSaveCount());
+   TEST_CHECK(pModel1->getLoadedFileVersion() == pModel2->getLoadedFileVersion(), "different file version");
+   TEST_CHECK(pModel1->uVehicleId == pModel2->uVehicleId, "different vehicle id");
+
+   model_set_snapshot_files_enabled(false);
+   pModel1->saveToFile(szFile1, false);
+   pModel2->saveToFile(szFile2, false);
+   model_set_snapshot_files_enabled(true);
+
+   long lSize1 = _read_file(szFile1, s_szText1, sizeof(s_szText1));
+   long lSize2 = _read_file(szFile2, s_szText2, sizeof(s_szText2));
+   TEST_CHECK((lSize1 > 0) && (lSize1 == lSize2) && (0 == memcmp(s_szText1, s_szText2, lSize1)), "models differ, compare %s and %s", szFile1, szFile2);
+}
+
+static void _load_from_text(const char* szFile, Model* pModel)
+{
+   model_set_snapshot_files_enabled(false);
+   TEST_CHECK(pModel->loadFromFile(szFile, true), "load text file %s", szFile);
+   model_set_snapshot_files_enabled(true);
+}
+
+static void _test_conformance(const char* szFolder, const char* szFile, const char* szSnapshotFile)
+{
+   printf("\nSnapshot conformance...\n");
+
+   Model* pModelText = new Model();
+   Model* pModelSnapshot = new Model();
+
+   _load_from_text(szFile, pModelText);
+   TEST_CHECK(pModelSnapshot->loadFromFile(szFile, true), "load from snapshot");
+   _compare_models(pModelText, pModelSnapshot, szFolder);
+
+   // Text file saved by a process not writing snapshots: snapshot is stale
+   strcpy(pModelText->vehicle_name, "Changed");
+   pModelText->uDeveloperFlags ^= 0x01;
+   u32 uDeveloperFlags = pModelText->uDeveloperFlags;
+   model_set_snapshot_files_enabled(false);
+   pModelText->saveToFile(szFile, false);
+   model_set_snapshot_files_enabled(true);
+
+   Model* pModelReloaded = new Model();
+   TEST_CHECK(pModelReloaded->loadFromFile(szFile, true), "load after text changed");
+   TEST_CHECK(0 == strcmp(pModelReloaded->vehicle_name, "Changed"), "stale snapshot used, name: [%s]", pModelReloaded->vehicle_name);
+   TEST_CHECK(pModelReloaded->uDeveloperFlags == uDeveloperFlags, "stale snapshot used, developer flags: %u", pModelReloaded->uDeveloperFlags);
+   delete pModelReloaded;
+
+   // The text load above rewrote the snapshot
+   _load_from_text(szFile, pModelText);
+   pModelReloaded = new Model();
+   TEST_CHECK(pModelReloaded->loadFromFile(szFile, true), "load from rewritten snapshot");
+   _compare_models(pModelText, pModelReloaded, szFolder);
+   delete pModelReloaded;
+
+   // Corrupted snapshot
+   FILE* fd = fopen(szSnapshotFile, "r+b");
+   TEST_CHECK(NULL != fd, "open snapshot %s", szSnapshotFile);
+   if ( NULL != fd )
+   {
+      fseek(fd, 200, SEEK_SET);
+      u8 uByte = 0;
+      if ( 1 == fread(&uByte, 1, 1, fd) )
+      {
+         uByte ^= 0x5A;
+         fseek(fd, 200, SEEK_SET);
+         fwrite(&uByte, 1, 1, fd);
+      }
+      fclose(fd);
+   }
+   pModelReloaded = new Model();
+   TEST_CHECK(pModelReloaded->loadFromFile(szFile, true), "load with corrupted snapshot");
+   _load_from_text(szFile, pModelText);
+   _compare_models(pModelText, pModelReloaded, szFolder);
+   delete pModelReloaded;
+
+   // Missing snapshot
+   unlink(szSnapshotFile);
+   pModelReloaded = new Model();
+   TEST_CHECK(pModelReloaded->loadFromFile(szFile, true), "load with missing snapshot");
+   _load_from_text(szFile, pModelText);
+   _compare_models(pModelText, pModelReloaded, szFolder);
+   TEST_CHECK(0 == access(szSnapshotFile, R_OK), "snapshot not rewritten");
+   delete pModelReloaded;
+
+   delete pModelText;
+   delete pModelSnapshot;
+}
+
+static void _set_changes_info(type_model_changes_info* pInfo, Model* pModel, u32 uGeneration, int iPreviousSaveCount, u32 uChangedSections)
+{
+   memset(pInfo, 0, sizeof(type_model_changes_info));
+   pInfo->uGeneration = uGeneration;
+   pInfo->uVehicleId = pModel->uVehicleId;
+   pInfo->iSaveCount = pModel->getSaveCount();
+   pInfo->iPreviousSaveCount = iPreviousSaveCount;
+   pInfo->uChangedSections = uChangedSections;
+   strcpy(pInfo->szChangedByProcess, "test");
+}
+
+// What reloadIfChanged does with the changes notified by an other process
+static void _test_changes_reload(const char* szFolder, const char* szFile)
+{
+   printf("\nReload on model changes notifications...\n");
+
+   Model* pWriter = new Model();
+   Model* pReader = new Model();
+   TEST_CHECK(pWriter->loadFromFile(szFile, true), "writer load");
+   TEST_CHECK(pReader->loadFromFile(szFile, true), "reader load");
+
+   // One change: only the changed section is reloaded
+   type_model_changes_info changesA, changesB, changesC;
+   int iSaveCount = pWriter->getSaveCount();
+   strcpy(pWriter->vehicle_name, "ChangeA");
+   pWriter->saveToFile(szFile, false);
+   _set_changes_info(&changesA, pWriter, 2, iSaveCount, MODEL_SECTION_GENERAL);
+   TEST_CHECK(pReader->reloadChanges(szFile, &changesA, true), "reload change A");
+   TEST_CHECK(0 == strcmp(pReader->vehicle_name, "ChangeA"), "change A not reloaded, name: [%s]", pReader->vehicle_name);
+   TEST_CHECK(pReader->getSaveCount() == pWriter->getSaveCount(), "save count after change A: %d, expected %d", pReader->getSaveCount(), pWriter->getSaveCount());
+
+   // Back to back saves: the file is already saved again when the reader gets the first change
+   iSaveCount = pWriter->getSaveCount();
+   strcpy(pWriter->vehicle_name, "ChangeB");
+   pWriter->saveToFile(szFile, false);
+   _set_changes_info(&changesB, pWriter, 4, iSaveCount, MODEL_SECTION_GENERAL);
+   iSaveCount = pWriter->getSaveCount();
+   pWriter->video_params.iVideoWidth += 16;
+   pWriter->saveToFile(szFile, false);
+   _set_changes_info(&changesC, pWriter, 6, iSaveCount, MODEL_SECTION_VIDEO);
+
+   TEST_CHECK(pReader->reloadChanges(szFile, &changesB, true), "reload change B");
+   TEST_CHECK(pReader->reloadChanges(szFile, &changesC, true), "reload change C");
+   TEST_CHECK(0 == strcmp(pReader->vehicle_name, "ChangeB"), "change B not reloaded, name: [%s]", pReader->vehicle_name);
+   TEST_CHECK(pReader->video_params.iVideoWidth == pWriter->video_params.iVideoWidth, "change C lost, video width: %d, expected %d", pReader->video_params.iVideoWidth, pWriter->video_params.iVideoWidth);
+   _compare_models(pWriter, pReader, szFolder);
+
+   delete pWriter;
+   delete pReader;
+}
+
+static void _test_bench(const char* szFile, int iCount)
+{
+   printf("\nLoading the model %d times...\n", iCount);
+   Model* pModel = new Model();
+
+   model_set_snapshot_files_enabled(false);
+   unsigned long long uStart = test_now_micros();
+   for( int i=0; i<iCount; i++ )
+      pModel->loadFromFile(szFile, true);
+   unsigned long long uTimeText = test_now_micros() - uStart;
+   model_set_snapshot_files_enabled(true);
+
+   uStart = test_now_micros();
+   for( int i=0; i<iCount; i++ )
+      pModel->loadFromFile(szFile, true);
+   unsigned long long uTimeSnapshot = test_now_micros() - uStart;
+
+   delete pModel;
+
+   struct stat statFile;
+   long lTextSize = (0 == stat(szFile, &statFile))?(long)statFile.st_size:0;
+   printf("  text file (%ld bytes): %.1f us per load\n", lTextSize, (double)uTimeText/(double)iCount);
+   printf("  snapshot: %.1f us per load (%.1fx)\n", (double)uTimeSnapshot/(double)iCount,
+      (uTimeSnapshot > 0)?((double)uTimeText/(double)uTimeSnapshot):0.0);
+}
+
+static int _parse_folder_option(int argc, char* argv[], int iIndex)
+{
+   if ( (0 != strcmp(argv[iIndex], "-folder")) || (iIndex >= argc-1) )
+      return 0;
+   s_szFolder = argv[iIndex+1];
+   return 2;
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 1000, 100, "[-folder path]", _parse_folder_option) )
+      return -1;
+   const char* szFolder = s_szFolder;
+
+   log_init_local_only("TestModelLoad");
+   log_disable();
+
+   char szFile[MAX_FILE_PATH_SIZE];
+   char szSnapshotFile[MAX_FILE_PATH_SIZE];
+   mkdir(szFolder, 0755);
+   snprintf(szFile, sizeof(szFile), "%s/test_model.mdl", szFolder);
+   snprintf(szSnapshotFile, sizeof(szSnapshotFile), "%s/test_model.snp", szFolder);
+
+   printf("\nTesting model load, files in %s\n", szFolder);
+
+   Model* pModel = new Model();
+   pModel->resetToDefaults(true);
+   strcpy(pModel->vehicle_name, "TestModel");
+   TEST_CHECK(pModel->saveToFile(szFile, false), "save model to %s", szFile);
+   TEST_CHECK(0 == access(szSnapshotFile, R_OK), "snapshot not written on save");
+   delete pModel;
+
+   if ( s_Options.bConformance )
+   {
+      _test_conformance(szFolder, szFile, szSnapshotFile);
+      _test_changes_reload(szFolder, szFile);
+   }
+   if ( s_Options.bBench )
+      _test_bench(szFile, s_Options.iIterations);
+
+   return test_report_result("model load");
+}
@@ -0,0 +1,204 @@
+/*
+    Radio interfaces control (hardware_radio_ctrl) test tool.
+
+    - Default: runs headless against the mock backend, no radio hardware needed: interface setup,
+      frequency switching (valid/invalid/HT40 frequencies), datarate changes, error injection and
+      the retry path used when switching frequencies.
+    - -hw ifname freqMHz: on a real wifi interface, compares the time taken to switch the
+      frequency using the netlink backend and using the iw/iwconfig commands.
+
+    Usage: test_radio_ctrl [-quick] [-hw ifname freqMHz]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../base/hardware_radio_ctrl.h"
+#include "test_utils.h"
+
+#include <errno.h>
+
+static type_test_options s_Options;
+static const char* s_szHwInterface = NULL;
+static u32 s_uHwFreqMhz = 0;
+
+static void _add_mock_interfaces()
+{
+   u32 uFreqs24[32];
+   int iCount = 0;
+   // 2.3 GHz extended channels + regular 2.4 GHz channels
+   for( u32 uFreq = 2312; uFreq <= 2392; uFreq += 5 )
+      uFreqs24[iCount++] = uFreq;
+   for( u32 uFreq = 2412; uFreq <= 2472; uFreq += 5 )
+      uFreqs24[iCount++] = uFreq;
+   radio_ctrl_mock_remove_all_interfaces();
+   TEST_CHECK(0 == radio_ctrl_mock_add_interface("wlan0", 0, "00:c0:ca:11:22:33", uFreqs24, iCount), "add wlan0");
+
+   u32 uFreqs58[] = { 5180, 5200, 5220, 5240, 5745, 5765, 5785, 5805, 5825 };
+   TEST_CHECK(0 == radio_ctrl_mock_add_interface("wlan1", 1, "00:c0:ca:44:55:66", uFreqs58, sizeof(uFreqs58)/sizeof(uFreqs58[0])), "add wlan1");
+
+   // Patched driver: 2.3-2.7 GHz, 4.9 GHz and 5 GHz in 5 MHz steps, more than RADIO_CTRL_MAX_PHY_FREQUENCIES
+   u32 uFreqsExt[RADIO_CTRL_MAX_MOCK_FREQUENCIES];
+   iCount = 0;
+   for( u32 uFreq = 2312; uFreq <= 2732; uFreq += 5 )
+      uFreqsExt[iCount++] = uFreq;
+   for( u32 uFreq = 4910; uFreq <= 4990; uFreq += 5 )
+      uFreqsExt[iCount++] = uFreq;
+   for( u32 uFreq = 5170; uFreq <= 5885; uFreq += 5 )
+      uFreqsExt[iCount++] = uFreq;
+   TEST_CHECK(0 == radio_ctrl_mock_add_interface("wlan2", 2, "00:c0:ca:77:88:99", uFreqsExt, iCount), "add wlan2");
+}
+
+static void _test_setup()
+{
+   printf("\nMock interface setup...\n");
+   type_radio_ctrl_mock_interface mockInfo;
+
+   // Same sequence as hardware_initialize_radio_interface for Realtek cards
+   TEST_CHECK(0 == radio_ctrl_set_mtu("wlan1", 1400), "set mtu");
+   TEST_CHECK(0 == radio_ctrl_set_link_up("wlan1", 0), "link down");
+   TEST_CHECK(0 == radio_ctrl_set_monitor_flags("wlan1", RADIO_CTRL_MONITOR_FLAGS_NONE), "monitor none");
+   TEST_CHECK(0 == radio_ctrl_set_monitor_flags("wlan1", RADIO_CTRL_MONITOR_FLAG_FCSFAIL), "monitor fcsfail");
+   TEST_CHECK(0 == radio_ctrl_set_link_up("wlan1", 1), "link up");
+   TEST_CHECK(0 == radio_ctrl_set_rts_threshold("wlan1", RADIO_CTRL_RTS_OFF), "rts off");
+   TEST_CHECK(0 == radio_ctrl_set_txpower("wlan1", 20*40), "tx power");
+
+   TEST_CHECK(0 == radio_ctrl_mock_get_interface("wlan1", &mockInfo), "get mock state");
+   TEST_CHECK(mockInfo.bUp && (mockInfo.iMTU == 1400) && (mockInfo.iIfType == RADIO_CTRL_IFTYPE_MONITOR), "state after setup: up %d, mtu %d, type %d", mockInfo.bUp, mockInfo.iMTU, mockInfo.iIfType);
+   TEST_CHECK((mockInfo.uMonitorFlags == RADIO_CTRL_MONITOR_FLAG_FCSFAIL) && (mockInfo.iRTSThreshold == RADIO_CTRL_RTS_OFF) && (mockInfo.iTxPowerMbm == 800), "monitor flags/rts/tx power");
+
+   // Type can't change while up
+   TEST_CHECK(-EBUSY == radio_ctrl_set_type("wlan1", RADIO_CTRL_IFTYPE_MANAGED), "set type while up must fail");
+   TEST_CHECK(-EINVAL == radio_ctrl_set_mtu("wlan1", 10), "invalid mtu");
+   TEST_CHECK(-ENODEV == radio_ctrl_set_link_up("wlan9", 1), "unknown interface");
+
+   // Detection
+   char szMAC[32];
+   TEST_CHECK((0 == radio_ctrl_get_mac_address("wlan0", szMAC, sizeof(szMAC))) && (0 == strcmp(szMAC, "00:c0:ca:11:22:33")), "mac address: %s", szMAC);
+   TEST_CHECK(1 == radio_ctrl_get_phy_index("wlan1"), "phy index");
+   TEST_CHECK(radio_ctrl_phy_supports_frequency(0, 2377) && radio_ctrl_phy_supports_frequency(0, 2427), "phy0 supports 2377/2427");
+   TEST_CHECK((! radio_ctrl_phy_supports_frequency(0, 5745)) && radio_ctrl_phy_supports_frequency(1, 5745), "5745 only on phy1");
+   TEST_CHECK(! radio_ctrl_phy_supports_frequency(7, 2412), "unknown phy");
+
+   // Frequencies lists longer than the caller's buffer: total count returned, end of the list still found
+   u32 uFreqs[RADIO_CTRL_MAX_PHY_FREQUENCIES];
+   int iCount = radio_ctrl_get_phy_frequencies(2, uFreqs, RADIO_CTRL_MAX_PHY_FREQUENCIES);
+   TEST_CHECK(iCount == 246, "phy2 frequencies count: %d, expected 246", iCount);
+   TEST_CHECK(radio_ctrl_phy_supports_frequency(2, 2512) && radio_ctrl_phy_supports_frequency(2, 5745) && radio_ctrl_phy_supports_frequency(2, 5885), "phy2 supports 2512/5745/5885");
+   TEST_CHECK(! radio_ctrl_phy_supports_frequency(2, 5890), "phy2 does not support 5890");
+}
+
+static void _test_frequency_switching()
+{
+   printf("\nFrequency switching...\n");
+   type_radio_ctrl_mock_interface mockInfo;
+
+   u32 uFreqs[] = { 5745, 5805, 5180, 5825, 5200 };
+   for( int i=0; i<(int)(sizeof(uFreqs)/sizeof(uFreqs[0])); i++ )
+   {
+      TEST_CHECK(0 == radio_ctrl_set_frequency("wlan1", uFreqs[i]*1000, RADIO_CTRL_CHANNEL_20MHZ), "set %u MHz", uFreqs[i]);
+      radio_ctrl_mock_get_interface("wlan1", &mockInfo);
+      TEST_CHECK(mockInfo.uFreqKhz == uFreqs[i]*1000, "current frequency %u, expected %u", mockInfo.uFreqKhz, uFreqs[i]*1000);
+   }
+
+   // Unsupported frequency: fails, current frequency unchanged
+   TEST_CHECK(-EINVAL == radio_ctrl_set_frequency("wlan1", 2412000, RADIO_CTRL_CHANNEL_20MHZ), "unsupported frequency");
+   radio_ctrl_mock_get_interface("wlan1", &mockInfo);
+   TEST_CHECK(mockInfo.uFreqKhz == 5200000, "frequency changed after a failed switch: %u", mockInfo.uFreqKhz);
+
+   // HT40+ needs the secondary channel: fails on the last channel, works below it
+   TEST_CHECK(-EINVAL == radio_ctrl_set_frequency("wlan1", 5825000, RADIO_CTRL_CHANNEL_HT40_PLUS), "HT40+ on the last channel");
+   TEST_CHECK(0 == radio_ctrl_set_frequency("wlan1", 5805000, RADIO_CTRL_CHANNEL_HT40_PLUS), "HT40+ with a secondary channel");
+   radio_ctrl_mock_get_interface("wlan1", &mockInfo);
+   TEST_CHECK(mockInfo.iChannelType == RADIO_CTRL_CHANNEL_HT40_PLUS, "channel type");
+
+   // Busy interface: first try fails, retry (as radio_utils_set_interface_frequency does) works
+   radio_ctrl_mock_fail_next_operations("wlan1", -EBUSY, 1);
+   int iRes = radio_ctrl_set_frequency("wlan1", 5745000, RADIO_CTRL_CHANNEL_20MHZ);
+   TEST_CHECK(-EBUSY == iRes, "injected busy error, got %d", iRes);
+   if ( -EBUSY == iRes )
+      iRes = radio_ctrl_set_frequency("wlan1", 5745000, RADIO_CTRL_CHANNEL_20MHZ);
+   TEST_CHECK(0 == iRes, "retry after busy");
+
+   // 2.3 GHz extended channels on the other interface
+   TEST_CHECK(0 == radio_ctrl_set_frequency("wlan0", 2377000, RADIO_CTRL_CHANNEL_20MHZ), "2377 MHz");
+   radio_ctrl_mock_get_interface("wlan0", &mockInfo);
+   TEST_CHECK((mockInfo.uFreqKhz == 2377000) && (mockInfo.uFrequencyChangesCount == 1), "wlan0 state: %u, %u changes", mockInfo.uFreqKhz, mockInfo.uFrequencyChangesCount);
+}
+
+static void _test_datarates()
+{
+   printf("\nDatarates...\n");
+   type_radio_ctrl_mock_interface mockInfo;
+
+   TEST_CHECK(0 == radio_ctrl_set_bitrate("wlan1", 18000000, 1), "legacy 18 Mbps lgi");
+   radio_ctrl_mock_get_interface("wlan1", &mockInfo);
+   TEST_CHECK((mockInfo.iDataRate == 18000000) && mockInfo.bLongGuardInterval, "legacy state");
+
+   // Adaptive video style MCS steps down and up
+   for( int iMCS=7; iMCS>=0; iMCS-- )
+   {
+      TEST_CHECK(0 == radio_ctrl_set_bitrate("wlan1", -iMCS-1, 0), "MCS %d", iMCS);
+      radio_ctrl_mock_get_interface("wlan1", &mockInfo);
+      TEST_CHECK(mockInfo.iDataRate == -iMCS-1, "MCS state %d", mockInfo.iDataRate);
+   }
+   TEST_CHECK(-EINVAL == radio_ctrl_set_bitrate("wlan1", 0, 0), "auto is not a bitrate mask");
+   TEST_CHECK(-EINVAL == radio_ctrl_set_bitrate("wlan1", -40, 0), "invalid MCS");
+   radio_ctrl_mock_get_interface("wlan1", &mockInfo);
+   TEST_CHECK(mockInfo.uDataRateChangesCount == 9, "datarate changes: %u", mockInfo.uDataRateChangesCount);
+}
+
+static void _test_hardware(const char* szIfName, u32 uFreqMhz)
+{
+   printf("\nSwitching %s to %u MHz, netlink vs commands...\n", szIfName, uFreqMhz);
+   for( int iBackend = RADIO_CTRL_BACKEND_SHELL; iBackend <= RADIO_CTRL_BACKEND_NETLINK; iBackend++ )
+   {
+      radio_ctrl_set_backend(iBackend);
+      unsigned long long uMin = 0xFFFFFFFF, uMax = 0, uTotal = 0;
+      int iErrors = 0;
+      for( int i=0; i<10; i++ )
+      {
+         unsigned long long uStart = test_now_micros();
+         if ( 0 != radio_ctrl_set_frequency(szIfName, uFreqMhz*1000, RADIO_CTRL_CHANNEL_20MHZ) )
+            iErrors++;
+         unsigned long long uTime = test_now_micros() - uStart;
+         uTotal += uTime;
+         if ( uTime < uMin ) uMin = uTime;
+         if ( uTime > uMax ) uMax = uTime;
+      }
+      printf("  %-8s: avg %llu us, min %llu us, max %llu us, errors: %d\n", radio_ctrl_get_backend_name(iBackend), uTotal/10, uMin, uMax, iErrors);
+      TEST_CHECK(0 == iErrors, "%s backend failed to set the frequency", radio_ctrl_get_backend_name(iBackend));
+   }
+}
+
+static int _parse_hw_option(int argc, char* argv[], int iIndex)
+{
+   if ( (0 != strcmp(argv[iIndex], "-hw")) || (iIndex >= argc-2) )
+      return 0;
+   s_szHwInterface = argv[iIndex+1];
+   s_uHwFreqMhz = (u32)atoi(argv[iIndex+2]);
+   return 3;
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 1, 1, "[-hw ifname freqMHz]", _parse_hw_option) )
+      return -1;
+
+   log_init_local_only("TestRadioCtrl");
+   if ( NULL == s_szHwInterface )
+      log_disable();
+
+   if ( NULL != s_szHwInterface )
+      _test_hardware(s_szHwInterface, s_uHwFreqMhz);
+   else
+   {
+      printf("\nTesting radio interfaces control, mock backend.\n");
+      radio_ctrl_set_backend(RADIO_CTRL_BACKEND_MOCK);
+      _add_mock_interfaces();
+      _test_setup();
+      _test_frequency_switching();
+      _test_datarates();
+   }
+
+   return test_report_result("radio control");
+}
@@ -0,0 +1,305 @@
+/*
+    Renderer span (row) pixel routines conformance and benchmark tool.
+
+    Runs headless, no display needed:
+    - conformance: random spans (lengths, alignments, colors, alpha edge values) for every
+      implementation built in (generic, SSE2, NEON). Checks that each one gives exactly the same
+      pixels as the per pixel code the Cairo renderer used before (fill, blend, sprite, icon, text mask blits).
+    - benchmark: Mpixels/s for each routine and implementation, on 1920 pixels rows.
+
+    Usage: test_render_spans [-quick] [-conformance] [-bench] [-seed n] [-iterations n]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../renderer/render_spans.h"
+#include "test_utils.h"
+
+#define TEST_SPANS_MAX_PIXELS 1920
+
+static const int s_iAccels[] = { RENDER_SPAN_ACCEL_NONE, RENDER_SPAN_ACCEL_SSE2, RENDER_SPAN_ACCEL_NEON };
+static const char* s_szRoutines[] = { "fill", "blend color", "blend tinted", "blend alpha", "blend mask" };
+
+static type_test_options s_Options;
+
+// Mostly random bytes, with the values the blend code treats differently showing up often
+static u8 _rand_byte(u32* pState)
+{
+   static const u8 s_uEdgeValues[] = { 0, 0, 1, 3, 4, 5, 127, 128, 254, 255, 255 };
+   u32 uValue = test_rand_next(pState);
+   if ( (uValue & 0x300) == 0 )
+      return s_uEdgeValues[(uValue >> 12) % sizeof(s_uEdgeValues)];
+   return (u8)uValue;
+}
+
+//-------------------------------------------------------
+// Reference: per pixel code, as in the Cairo render engine before span routines
+
+static u32 _ref_mul_un8(u32 a, u32 b)
+{
+   u32 t = a * b + 0x80;
+   return (t + (t >> 8)) >> 8;
+}
+
+static void _ref_fill(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   for( int x=0; x<iCount; x++ )
+   {
+      *pDest++ = b;
+      *pDest++ = g;
+      *pDest++ = r;
+      *pDest++ = a;
+   }
+}
+
+static void _ref_blend_color(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   for( int x=0; x<iCount; x++ )
+   {
+      unsigned char* pixel = pDest + x*4;
+      if ( *(pixel+3) == 0 )
+      {
+         *pixel++ = b;
+         *pixel++ = g;
+         *pixel++ = r;
+         *pixel++ = a;
+      }
+      else if ( *(pixel+3) == 255 )
+      {
+         *pixel = ((a * b + (255 - a) * (*pixel)) >> 8);
+         pixel++;
+         *pixel = ((a * g + (255 - a) * (*pixel)) >> 8);
+         pixel++;
+         *pixel = ((a * r + (255 - a) * (*pixel)) >> 8);
+      }
+      else
+      {
+         *pixel = ((a * b + (255 - a) * (*pixel)) >> 8);
+         pixel++;
+         *pixel = ((a * g + (255 - a) * (*pixel)) >> 8);
+         pixel++;
+         *pixel = ((a * r + (255 - a) * (*pixel)) >> 8);
+         pixel++;
+         *pixel = (*pixel) + (((255-(*pixel))*a) >> 8);
+      }
+   }
+}
+
+static void _ref_blend_tinted(u8* pDestPixel, const u8* pSrcPixel, int iCount, const u8* pColorFill)
+{
+   for( int sx=0; sx<iCount; sx++ )
+   {
+      u8 b = *pSrcPixel++;
+      u8 g = *pSrcPixel++;
+      u8 r = *pSrcPixel++;
+      u8 a = *pSrcPixel++;
+      if ( a > 4 )
+      {
+         b = (((b*pColorFill[2])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
+         *pDestPixel++ = b;
+         g = (((g*pColorFill[1])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
+         *pDestPixel++ = g;
+         r = (((r*pColorFill[0])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
+         *pDestPixel++ = r;
+         a = (((a*pColorFill[3])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
+         *pDestPixel++ = a;
+      }
+      else
+         pDestPixel += 4;
+   }
+}
+
+static void _ref_blend_alpha(u8* pDestLine, const u8* pSrcLine, int iCount)
+{
+   for( int x=0; x<iCount; x++ )
+   {
+      u8 uAlpha = *(pSrcLine+3);
+      for( int k=0; k<3; k++ )
+      {
+         *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
+         pDestLine++;
+         pSrcLine++;
+      }
+      pDestLine++;
+      pSrcLine++;
+   }
+}
+
+static void _ref_blend_mask(u8* pDest, const u8* pMask, int iCount, u8 uR, u8 uG, u8 uB, u8 uAlpha)
+{
+   for( int x=0; x<iCount; x++, pDest += 4 )
+   {
+      u32 uCoverage = pMask[x];
+      if ( 0 == uCoverage )
+         continue;
+      u32 uSrcAlpha = _ref_mul_un8(uAlpha, uCoverage);
+      u32 uInv = 255 - uSrcAlpha;
+      u32 uValue = _ref_mul_un8(uB, uCoverage) + _ref_mul_un8(pDest[0], uInv);
+      pDest[0] = (uValue > 255)?255:(u8)uValue;
+      uValue = _ref_mul_un8(uG, uCoverage) + _ref_mul_un8(pDest[1], uInv);
+      pDest[1] = (uValue > 255)?255:(u8)uValue;
+      uValue = _ref_mul_un8(uR, uCoverage) + _ref_mul_un8(pDest[2], uInv);
+      pDest[2] = (uValue > 255)?255:(u8)uValue;
+      uValue = uSrcAlpha + _ref_mul_un8(pDest[3], uInv);
+      pDest[3] = (uValue > 255)?255:(u8)uValue;
+   }
+}
+
+//-------------------------------------------------------
+
+static void _run_routine(int iRoutine, bool bReference, u8* pDest, const u8* pSrc, const u8* pMask, int iCount, const u8* pColor)
+{
+   switch ( iRoutine )
+   {
+      case 0:
+         if ( bReference ) _ref_fill(pDest, iCount, pColor[0], pColor[1], pColor[2], pColor[3]);
+         else render_span_fill(pDest, iCount, pColor[0], pColor[1], pColor[2], pColor[3]);
+         break;
+      case 1:
+         if ( bReference ) _ref_blend_color(pDest, iCount, pColor[0], pColor[1], pColor[2], pColor[3]);
+         else render_span_blend_color(pDest, iCount, pColor[0], pColor[1], pColor[2], pColor[3]);
+         break;
+      case 2:
+         if ( bReference ) _ref_blend_tinted(pDest, pSrc, iCount, pColor);
+         else render_span_blend_tinted(pDest, pSrc, iCount, pColor);
+         break;
+      case 3:
+         if ( bReference ) _ref_blend_alpha(pDest, pSrc, iCount);
+         else render_span_blend_alpha(pDest, pSrc, iCount);
+         break;
+      default:
+         if ( bReference ) _ref_blend_mask(pDest, pMask, iCount, pColor[0], pColor[1], pColor[2], pColor[3]);
+         else render_span_blend_mask(pDest, pMask, iCount, pColor[0], pColor[1], pColor[2], pColor[3]);
+         break;
+   }
+}
+
+static void _test_conformance()
+{
+   static u8 s_uDest[(TEST_SPANS_MAX_PIXELS+16)*4];
+   static u8 s_uDestRef[(TEST_SPANS_MAX_PIXELS+16)*4];
+   static u8 s_uSrc[(TEST_SPANS_MAX_PIXELS+16)*4];
+   static u8 s_uMask[TEST_SPANS_MAX_PIXELS+16];
+   const int iRoutines = (int)(sizeof(s_szRoutines)/sizeof(s_szRoutines[0]));
+
+   printf("\nConformance, %d random spans per routine and implementation...\n", s_Options.iIterations);
+   for( int a=0; a<(int)(sizeof(s_iAccels)/sizeof(s_iAccels[0])); a++ )
+   {
+      if ( render_span_set_accel(s_iAccels[a]) != s_iAccels[a] )
+      {
+         printf("  %s: not available on this build\n", render_span_get_accel_name(s_iAccels[a]));
+         continue;
+      }
+      int iFailuresBefore = s_iTestFailures;
+      for( int iRoutine=0; iRoutine<iRoutines; iRoutine++ )
+      {
+         u32 uState = s_Options.uSeed;
+         for( int it=0; it<s_Options.iIterations; it++ )
+         {
+            int iCount = (int)(test_rand_next(&uState) % 70);
+            if ( 0 == (it % 64) )
+               iCount = (int)(test_rand_next(&uState) % TEST_SPANS_MAX_PIXELS);
+            // Unaligned starts on purpose (whole pixels only, as in the renderer)
+            int iDestOffset = (int)(test_rand_next(&uState) % 8) * 4;
+            int iSrcOffset = (int)(test_rand_next(&uState) % 8) * 4;
+            int iMaskOffset = (int)(test_rand_next(&uState) % 8);
+            u8 uColor[4];
+            for( int i=0; i<4; i++ )
+               uColor[i] = _rand_byte(&uState);
+            bool bSparseMask = (0 == (test_rand_next(&uState) & 3));
+            for( int i=0; i<(iCount+8)*4; i++ )
+            {
+               s_uDestRef[i] = s_uDest[i] = _rand_byte(&uState);
+               s_uSrc[i] = _rand_byte(&uState);
+            }
+            for( int i=0; i<iCount+8; i++ )
+            {
+               s_uMask[i] = _rand_byte(&uState);
+               if ( bSparseMask && (test_rand_next(&uState) & 1) )
+                  s_uMask[i] = 0;
+            }
+            // Premultiplied text color for the mask blit
+            if ( 4 == iRoutine )
+            for( int i=0; i<3; i++ )
+               uColor[i] = (u8)_ref_mul_un8(uColor[i], uColor[3]);
+
+            _run_routine(iRoutine, true, s_uDestRef + iDestOffset, s_uSrc + iSrcOffset, s_uMask + iMaskOffset, iCount, uColor);
+            _run_routine(iRoutine, false, s_uDest + iDestOffset, s_uSrc + iSrcOffset, s_uMask + iMaskOffset, iCount, uColor);
+
+            if ( 0 != memcmp(s_uDest, s_uDestRef, (iCount+8)*4) )
+            {
+               int iPos = 0;
+               while ( s_uDest[iPos] == s_uDestRef[iPos] )
+                  iPos++;
+               printf("FAILED: %s, %s, iteration %d, %d pixels, dest offset %d: byte %d is %d, expected %d\n",
+                  render_span_get_accel_name(s_iAccels[a]), s_szRoutines[iRoutine], it, iCount, iDestOffset,
+                  iPos, s_uDest[iPos], s_uDestRef[iPos]);
+               s_iTestFailures++;
+               break;
+            }
+         }
+      }
+      printf("  %s: %s\n", render_span_get_accel_name(s_iAccels[a]), (s_iTestFailures == iFailuresBefore)?"ok":"FAILED");
+   }
+}
+
+static void _test_benchmark()
+{
+   static u8 s_uDest[TEST_SPANS_MAX_PIXELS*4];
+   static u8 s_uSrc[TEST_SPANS_MAX_PIXELS*4];
+   static u8 s_uMask[TEST_SPANS_MAX_PIXELS];
+   const int iRows = s_Options.bQuick?2000:20000;
+   const int iRoutines = (int)(sizeof(s_szRoutines)/sizeof(s_szRoutines[0]));
+   const u8 uColor[4] = { 200, 120, 40, 180 };
+
+   u32 uState = s_Options.uSeed;
+   for( int i=0; i<TEST_SPANS_MAX_PIXELS*4; i++ )
+   {
+      s_uDest[i] = _rand_byte(&uState);
+      s_uSrc[i] = _rand_byte(&uState);
+   }
+   for( int i=0; i<TEST_SPANS_MAX_PIXELS; i++ )
+      s_uMask[i] = _rand_byte(&uState);
+
+   printf("\nBenchmark (Mpixels/s, %d pixels rows):\n", TEST_SPANS_MAX_PIXELS);
+   printf("  %-14s %10s", "", "per pixel");
+   for( int a=0; a<(int)(sizeof(s_iAccels)/sizeof(s_iAccels[0])); a++ )
+      if ( render_span_set_accel(s_iAccels[a]) == s_iAccels[a] )
+         printf(" %10s", render_span_get_accel_name(s_iAccels[a]));
+   printf("\n");
+
+   for( int iRoutine=0; iRoutine<iRoutines; iRoutine++ )
+   {
+      printf("  %-14s", s_szRoutines[iRoutine]);
+      for( int a=-1; a<(int)(sizeof(s_iAccels)/sizeof(s_iAccels[0])); a++ )
+      {
+         if ( (a >= 0) && (render_span_set_accel(s_iAccels[a]) != s_iAccels[a]) )
+            continue;
+         unsigned long long uStart = test_now_nanos();
+         for( int r=0; r<iRows; r++ )
+            _run_routine(iRoutine, (a < 0), s_uDest, s_uSrc, s_uMask, TEST_SPANS_MAX_PIXELS, uColor);
+         unsigned long long uTime = test_now_nanos() - uStart;
+         if ( 0 == uTime )
+            uTime = 1;
+         printf(" %10.1f", (double)iRows * TEST_SPANS_MAX_PIXELS * 1000.0 / (double)uTime);
+      }
+      printf("\n");
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 20000, 2000, NULL, NULL) )
+      return -1;
+
+   int iBestAccel = render_span_set_accel(RENDER_SPAN_ACCEL_AUTO);
+   printf("\nTesting renderer span routines. Implementation used by this build: %s\n", render_span_get_accel_name(iBestAccel));
+
+   if ( s_Options.bConformance )
+      _test_conformance();
+   if ( s_Options.bBench )
+      _test_benchmark();
+   render_span_set_accel(RENDER_SPAN_ACCEL_AUTO);
+
+   return test_report_result("span");
+}
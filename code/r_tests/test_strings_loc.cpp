@@ -0,0 +1,161 @@
+/*
+    Localized strings lookup (L()) conformance and benchmark tool.
+
+    Runs headless, no display needed:
+    - conformance: every strings table text, for every language, looked up twice (so the second
+      lookup uses the memoized result), from the table and from a reused buffer whose content changes
+      on each call; results must match a plain table search. Unknown and short strings are returned as is.
+    - benchmark: ns per lookup for string literals (memoized by address) and for buffers (perfect hash).
+
+    Usage: test_strings_loc [-quick] [-conformance] [-bench] [-iterations n]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../common/strings_loc.h"
+#include "../common/strings_table.h"
+#include "test_utils.h"
+
+#define TEST_STRINGS_MIN_TABLE_SIZE 100
+
+static type_test_options s_Options;
+
+//-------------------------------------------------------
+// Reference: first matching table entry, language column, fallback to English.
+// One and two characters strings are not translated.
+
+static const char* _ref_L(const char* szString, int iLanguage)
+{
+   if ( (NULL == szString) || (0 == szString[0]) )
+      return "";
+   if ( (0 == szString[1]) || (0 == szString[2]) )
+      return szString;
+   type_localized_strings* pTable = string_get_table();
+   for( int i=0; i<string_get_table_size(); i++ )
+   {
+      if ( (0 == pTable[i].szEnglish[0]) || (0 != strcmp(pTable[i].szEnglish, szString)) )
+         continue;
+      const char* pLocalized = pTable[i].szEnglish;
+      if ( 0 == iLanguage ) pLocalized = pTable[i].szTranslatedCN;
+      if ( 2 == iLanguage ) pLocalized = pTable[i].szTranslatedFR;
+      if ( 3 == iLanguage ) pLocalized = pTable[i].szTranslatedDE;
+      if ( 4 == iLanguage ) pLocalized = pTable[i].szTranslatedHI;
+      if ( 5 == iLanguage ) pLocalized = pTable[i].szTranslatedRU;
+      if ( 6 == iLanguage ) pLocalized = pTable[i].szTranslatedSP;
+      if ( 0 != pLocalized[0] )
+         return pLocalized;
+      return pTable[i].szEnglish;
+   }
+   return szString;
+}
+
+static void _check(const char* szString, const char* szResult, int iLanguage, const char* szCase)
+{
+   const char* szExpected = _ref_L(szString, iLanguage);
+   if ( 0 == strcmp(szExpected, szResult) )
+      return;
+   s_iTestFailures++;
+   if ( s_iTestFailures < 20 )
+      printf("  FAILED (%s, language %d): [%s] -> [%s], expected [%s]\n", szCase, iLanguage, szString, szResult, szExpected);
+}
+
+static void _test_conformance()
+{
+   type_localized_strings* pTable = string_get_table();
+   int iTableSize = string_get_table_size();
+   char szBuffer[1024];
+
+   printf("\nConformance, %d table strings, %d languages:\n", iTableSize, getLanguagesCount());
+   // A build with the placeholder table (not the full one) would test nothing
+   if ( iTableSize < TEST_STRINGS_MIN_TABLE_SIZE )
+   {
+      s_iTestFailures++;
+      printf("  FAILED: only %d strings in the table, expected at least %d. Not the full strings table?\n", iTableSize, TEST_STRINGS_MIN_TABLE_SIZE);
+      return;
+   }
+   for( int iLanguage=0; iLanguage<getLanguagesCount(); iLanguage++ )
+   {
+      setActiveLanguage(iLanguage);
+      // Twice: first lookup fills the memo, second one uses it
+      for( int iPass=0; iPass<2; iPass++ )
+      for( int i=0; i<iTableSize; i++ )
+         _check(pTable[i].szEnglish, L(pTable[i].szEnglish), iLanguage, "table string");
+
+      // Same buffer, different content each call: must not be memoized by its address
+      for( int iPass=0; iPass<2; iPass++ )
+      for( int i=0; i<iTableSize; i++ )
+      {
+         strncpy(szBuffer, pTable[(i*7)%iTableSize].szEnglish, sizeof(szBuffer)-1);
+         szBuffer[sizeof(szBuffer)-1] = 0;
+         _check(szBuffer, L(szBuffer), iLanguage, "buffer");
+      }
+
+      const char* szUnknown = "This text is not in the strings table 123";
+      if ( (L(szUnknown) != szUnknown) || (L(szUnknown) != szUnknown) )
+      {
+         s_iTestFailures++;
+         printf("  FAILED (language %d): unknown string not returned as is\n", iLanguage);
+      }
+      if ( (L("Ok") == NULL) || (0 != strcmp(L("Ok"), "Ok")) || (0 != L("")[0]) || (0 != L(NULL)[0]) )
+      {
+         s_iTestFailures++;
+         printf("  FAILED (language %d): short/empty strings\n", iLanguage);
+      }
+   }
+   setActiveLanguage(1);
+   printf("  Done, %d failures.\n", s_iTestFailures);
+}
+
+static void _test_benchmark()
+{
+   type_localized_strings* pTable = string_get_table();
+   int iTableSize = string_get_table_size();
+   unsigned long long uCheck = 0;
+
+   setActiveLanguage(2);
+   printf("\nBenchmark, %d lookups each:\n", s_Options.iIterations);
+
+   unsigned long long uStart = test_now_nanos();
+   for( int i=0; i<s_Options.iIterations; i++ )
+      uCheck += (unsigned long long)(uintptr_t)L(pTable[i % iTableSize].szEnglish);
+   unsigned long long uTime = test_now_nanos() - uStart;
+   printf("  String literals (memoized):      %6.1f ns/call\n", (double)uTime/(double)s_Options.iIterations);
+
+   // Table texts copied to buffers up front, so only the lookups are timed
+   char* pBuffers = (char*) malloc(iTableSize * 128);
+   if ( NULL == pBuffers )
+      return;
+   for( int i=0; i<iTableSize; i++ )
+   {
+      strncpy(pBuffers + i*128, pTable[i].szEnglish, 127);
+      pBuffers[i*128 + 127] = 0;
+   }
+   uStart = test_now_nanos();
+   for( int i=0; i<s_Options.iIterations; i++ )
+      uCheck += (unsigned long long)(uintptr_t)L(pBuffers + (i % iTableSize)*128);
+   uTime = test_now_nanos() - uStart;
+   free(pBuffers);
+   printf("  Buffers (perfect hash + strcmp): %6.1f ns/call\n", (double)uTime/(double)s_Options.iIterations);
+
+   setActiveLanguage(1);
+   if ( 0 == uCheck )
+      printf("\n");
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 2000000, 200000, NULL, NULL) )
+      return -1;
+
+   log_init_local_only("TestStringsLoc");
+   log_disable();
+   initLocalizationData();
+   printf("\nTesting localized strings lookup.\n");
+
+   if ( s_Options.bConformance )
+      _test_conformance();
+   if ( s_Options.bBench )
+      _test_benchmark();
+
+   return test_report_result("localized strings");
+}
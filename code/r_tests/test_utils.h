@@ -0,0 +1,112 @@
+#pragma once
+#include "../base/base.h"
+
+#include <time.h>
+
+// Small helpers shared by the headless conformance/benchmark tests:
+// command line options, timing, reproducible random numbers and failures count.
+//
+// Common options: -quick -conformance -bench -seed n -iterations n
+// With neither -conformance nor -bench, both are run. -quick caps the iterations count.
+
+typedef struct
+{
+   bool bQuick;
+   bool bConformance;
+   bool bBench;
+   u32 uSeed;
+   int iIterations;
+} type_test_options;
+
+static int s_iTestFailures = 0;
+
+#define TEST_CHECK(cond, ...) \
+   if ( ! (cond) ) \
+   { \
+      printf("FAILED (line %d): ", __LINE__); \
+      printf(__VA_ARGS__); \
+      printf("\n"); \
+      s_iTestFailures++; \
+   }
+
+static inline unsigned long long test_now_nanos()
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ((unsigned long long)ts.tv_sec)*1000000000LL + (unsigned long long)ts.tv_nsec;
+}
+
+static inline unsigned long long test_now_micros()
+{
+   return test_now_nanos()/1000;
+}
+
+static inline u32 test_now_ms()
+{
+   return (u32)(test_now_nanos()/1000000);
+}
+
+// xorshift32, so runs are reproducible for a given seed
+static inline u32 test_rand_next(u32* pState)
+{
+   u32 x = *pState;
+   x ^= x << 13;
+   x ^= x >> 17;
+   x ^= x << 5;
+   *pState = x;
+   return x;
+}
+
+// Test specific options: returns how many arguments it used starting at argv[iIndex], 0 if unknown
+typedef int (*test_extra_option_parser)(int argc, char* argv[], int iIndex);
+
+// Returns false (after printing the usage) on invalid arguments
+static inline bool test_parse_options(int argc, char* argv[], type_test_options* pOptions, int iIterations, int iQuickIterations, const char* szExtraUsage, test_extra_option_parser pfExtraOption)
+{
+   memset(pOptions, 0, sizeof(type_test_options));
+   pOptions->uSeed = 1;
+   pOptions->iIterations = iIterations;
+
+   for( int i=1; i<argc; i++ )
+   {
+      int iUsed = 0;
+      if ( 0 == strcmp(argv[i], "-quick") )
+         pOptions->bQuick = true;
+      else if ( 0 == strcmp(argv[i], "-conformance") )
+         pOptions->bConformance = true;
+      else if ( 0 == strcmp(argv[i], "-bench") )
+         pOptions->bBench = true;
+      else if ( (0 == strcmp(argv[i], "-seed")) && (i < argc-1) )
+         pOptions->uSeed = (u32)atoi(argv[++i]);
+      else if ( (0 == strcmp(argv[i], "-iterations")) && (i < argc-1) )
+         pOptions->iIterations = atoi(argv[++i]);
+      else if ( (NULL != pfExtraOption) && ((iUsed = pfExtraOption(argc, argv, i)) > 0) )
+         i += iUsed-1;
+      else
+      {
+         printf("Usage: %s [-quick] [-conformance] [-bench] [-seed n] [-iterations n]%s%s\n", argv[0], (NULL != szExtraUsage)?" ":"", (NULL != szExtraUsage)?szExtraUsage:"");
+         return false;
+      }
+   }
+   if ( (! pOptions->bConformance) && (! pOptions->bBench) )
+      pOptions->bConformance = pOptions->bBench = true;
+   if ( 0 == pOptions->uSeed )
+      pOptions->uSeed = 1;
+   if ( pOptions->bQuick && (pOptions->iIterations > iQuickIterations) )
+      pOptions->iIterations = iQuickIterations;
+   if ( pOptions->iIterations < 1 )
+      pOptions->iIterations = 1;
+   return true;
+}
+
+// Prints the result and returns the process exit code
+static inline int test_report_result(const char* szName)
+{
+   if ( s_iTestFailures > 0 )
+   {
+      printf("\n%d %s checks FAILED.\n", s_iTestFailures, szName);
+      return 1;
+   }
+   printf("\nAll %s checks passed.\n", szName);
+   return 0;
+}
@@ -0,0 +1,430 @@
+/*
+    Shared memory video ring (SM_STREAMER) producer/consumer stress test.
+
+    Runs headless, no decoder or radio hardware needed. A producer process writes a synthetic
+    H.264 like stream (keyframe every KEYFRAME_INTERVAL frames, random chunk sizes) into the ring,
+    a consumer process reads it like ruby_player_radxa does, with random stalls, and checks
+    the output byte by byte:
+    - every byte must be the byte the producer generated for that frame (no torn/lapped data);
+    - a frame may only be followed by the next frame, or by a keyframe after a skip/resync;
+    - after a resync the output restarts exactly at a keyframe start code.
+
+    Phases:
+    - backpressure: full size ring, consumer stalls for short periods; the producer must drop
+      up to the next keyframe instead of lapping the consumer.
+    - lapping: small ring, producer ignores the consumer (considered gone); the consumer gets
+      lapped, sometimes while copying, and must detect it and resync at the next keyframe.
+    - session: producer restarts the stream session from time to time.
+
+    Usage: test_video_ring [-quick] [-seed n] [-seconds n]
+    Returns 0 if all checks passed.
+*/
+
+#include "../base/base.h"
+#include "../base/video_sm_ring.h"
+#include "test_utils.h"
+
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#define KEYFRAME_INTERVAL 30
+#define MAX_FRAME_SIZE 20000
+#define CONSUMER_BUFFER_SIZE 200000
+
+#define PHASE_BACKPRESSURE 0
+#define PHASE_LAPPING 1
+#define PHASE_SESSION 2
+
+static type_test_options s_Options;
+static int s_iSeconds = 3;
+
+typedef struct
+{
+   volatile u32 uProducerDone;
+   volatile u32 uProducerFrames;
+   volatile u32 uProducerBytes;
+   volatile u32 uProducerDropped;
+   volatile u32 uConsumerBytes;
+   volatile u32 uConsumerFrames;
+   volatile u32 uConsumerTruncatedFrames;
+   volatile u32 uConsumerErrors;
+   volatile u32 uConsumerOverruns;
+   volatile u32 uConsumerResyncs;
+} type_test_control;
+
+static int _is_keyframe(u32 uFrame)
+{
+   return (0 == (uFrame % KEYFRAME_INTERVAL))?1:0;
+}
+
+static u32 _frame_payload_length(u32 uFrame)
+{
+   if ( _is_keyframe(uFrame) )
+      return 6000 + (uFrame*7919) % 8000;
+   return 200 + (uFrame*7919) % 3000;
+}
+
+// Payload bytes never contain 0, so there are no start codes inside a frame
+static u8 _frame_payload_byte(u32 uFrame, u32 uPos)
+{
+   return (u8)(0x80 | ((uFrame*31 + uPos) & 0x7F));
+}
+
+// Start code, NAL type (SPS for keyframes), frame index on 4 bytes (7 bits each), payload
+static int _build_frame(u32 uFrame, u8* pBuffer)
+{
+   int iPos = 0;
+   pBuffer[iPos++] = 0;
+   pBuffer[iPos++] = 0;
+   pBuffer[iPos++] = 0;
+   pBuffer[iPos++] = 1;
+   pBuffer[iPos++] = _is_keyframe(uFrame)?0x67:0x41;
+   for( int i=0; i<4; i++ )
+      pBuffer[iPos++] = (u8)(0x80 | ((uFrame >> (7*i)) & 0x7F));
+   u32 uLength = _frame_payload_length(uFrame);
+   for( u32 i=0; i<uLength; i++ )
+      pBuffer[iPos++] = _frame_payload_byte(uFrame, i);
+   return iPos;
+}
+
+// Streaming checker for the consumer output
+
+typedef struct
+{
+   int iState; // 0: expect start code, 1: NAL type, 2: frame index, 3: payload, 4: skip to next start code after an error
+   int iZeros;
+   int bAnyFrame;
+   int bLastTruncated;
+   int bCurrentKeyframe;
+   int iIndexBytes;
+   u32 uFrame;
+   u32 uLastFrame;
+   u32 uPayloadPos;
+   u32 uPayloadLength;
+   u32 uFrames;
+   u32 uTruncated;
+   u32 uErrors;
+} type_stream_checker;
+
+static void _checker_error(type_stream_checker* pChecker, const char* szError)
+{
+   if ( pChecker->uErrors < 10 )
+      printf("  consumer: %s (frame %u, payload pos %u)\n", szError, pChecker->uFrame, pChecker->uPayloadPos);
+   pChecker->uErrors++;
+   pChecker->iState = 4;
+   pChecker->iZeros = 0;
+}
+
+static void _checker_end_of_frame(type_stream_checker* pChecker)
+{
+   if ( 3 != pChecker->iState )
+      return;
+   pChecker->bLastTruncated = (pChecker->uPayloadPos != pChecker->uPayloadLength)?1:0;
+   if ( pChecker->bLastTruncated )
+      pChecker->uTruncated++;
+   pChecker->uFrames++;
+   pChecker->uLastFrame = pChecker->uFrame;
+   pChecker->bAnyFrame = 1;
+}
+
+static void _checker_feed(type_stream_checker* pChecker, u8* pData, int iLength)
+{
+   for( int k=0; k<iLength; k++ )
+   {
+      u8 b = pData[k];
+      if ( 0 == b )
+      {
+         pChecker->iZeros++;
+         continue;
+      }
+      if ( pChecker->iZeros > 0 )
+      {
+         // 3 or 4 bytes start codes
+         if ( (1 != b) || (pChecker->iZeros < 2) )
+         {
+            _checker_error(pChecker, "invalid start code");
+            continue;
+         }
+         _checker_end_of_frame(pChecker);
+         pChecker->iZeros = 0;
+         pChecker->iState = 1;
+         continue;
+      }
+
+      switch ( pChecker->iState )
+      {
+         case 0:
+            _checker_error(pChecker, "data outside of a frame");
+            break;
+
+         case 1:
+            if ( (0x67 != b) && (0x41 != b) )
+            {
+               _checker_error(pChecker, "invalid NAL type");
+               break;
+            }
+            pChecker->bCurrentKeyframe = (0x67 == b)?1:0;
+            pChecker->uFrame = 0;
+            pChecker->iIndexBytes = 0;
+            pChecker->iState = 2;
+            break;
+
+         case 2:
+            pChecker->uFrame |= ((u32)(b & 0x7F)) << (7*pChecker->iIndexBytes);
+            pChecker->iIndexBytes++;
+            if ( pChecker->iIndexBytes < 4 )
+               break;
+            if ( pChecker->bCurrentKeyframe != _is_keyframe(pChecker->uFrame) )
+            {
+               _checker_error(pChecker, "invalid keyframe flag");
+               break;
+            }
+            if ( pChecker->bAnyFrame )
+            {
+               if ( pChecker->bCurrentKeyframe )
+               {
+                  if ( pChecker->uFrame <= pChecker->uLastFrame )
+                  {
+                     _checker_error(pChecker, "keyframe going back in time");
+                     break;
+                  }
+               }
+               else if ( (pChecker->uFrame != pChecker->uLastFrame + 1) || pChecker->bLastTruncated )
+               {
+                  _checker_error(pChecker, "non keyframe after a skip");
+                  break;
+               }
+            }
+            else if ( ! pChecker->bCurrentKeyframe )
+            {
+               _checker_error(pChecker, "stream does not start with a keyframe");
+               break;
+            }
+            pChecker->uPayloadPos = 0;
+            pChecker->uPayloadLength = _frame_payload_length(pChecker->uFrame);
+            pChecker->iState = 3;
+            break;
+
+         case 4:
+            break;
+
+         case 3:
+            if ( (pChecker->uPayloadPos >= pChecker->uPayloadLength) || (b != _frame_payload_byte(pChecker->uFrame, pChecker->uPayloadPos)) )
+            {
+               _checker_error(pChecker, "corrupted payload");
+               break;
+            }
+            pChecker->uPayloadPos++;
+            break;
+      }
+   }
+}
+
+static int _run_consumer(u8* pMem, u32 uMemSize, type_test_control* pControl, int iPhase, u32 uSeed)
+{
+   type_video_sm_ring_reader reader;
+   if ( 0 != video_sm_ring_reader_init(&reader, pMem, uMemSize) )
+      return 1;
+
+   static u8 s_uBuffer[CONSUMER_BUFFER_SIZE];
+   type_stream_checker checker;
+   memset(&checker, 0, sizeof(checker));
+   u32 uRand = uSeed * 7 + 3;
+   u32 uBytes = 0;
+
+   while ( 1 )
+   {
+      int bDone = __atomic_load_n(&pControl->uProducerDone, __ATOMIC_ACQUIRE)?1:0;
+      int iRead = video_sm_ring_read(&reader, s_uBuffer, sizeof(s_uBuffer));
+      if ( iRead > 0 )
+      {
+         _checker_feed(&checker, s_uBuffer, iRead);
+         uBytes += (u32)iRead;
+      }
+      else if ( bDone )
+         break;
+      else
+         usleep(200);
+
+      // Simulated decoder stalls
+      u32 r = test_rand_next(&uRand);
+      if ( PHASE_LAPPING == iPhase )
+      {
+         if ( 0 == (r % 4) )
+            usleep(r % 2000);
+      }
+      else if ( 0 == (r % 200) )
+         usleep(20000 + (r/200) % 80000);
+   }
+   _checker_end_of_frame(&checker);
+
+   pControl->uConsumerBytes = uBytes;
+   pControl->uConsumerFrames = checker.uFrames;
+   pControl->uConsumerTruncatedFrames = checker.uTruncated;
+   pControl->uConsumerErrors = checker.uErrors;
+   pControl->uConsumerOverruns = reader.uStatsOverruns;
+   pControl->uConsumerResyncs = reader.uStatsResyncs;
+   fflush(stdout);
+   return (0 == checker.uErrors)?0:1;
+}
+
+static void _run_producer(u8* pMem, u32 uMemSize, type_test_control* pControl, int iPhase, u32 uSeed)
+{
+   type_video_sm_ring_writer writer;
+   video_sm_ring_writer_init(&writer, pMem, uMemSize);
+
+   static u8 s_uFrame[MAX_FRAME_SIZE];
+   u32 uFrame = 0;
+   int iFrameLength = _build_frame(uFrame, s_uFrame);
+   int iFramePos = 0;
+   u32 uRand = uSeed;
+   u32 uTimeEnd = test_now_ms() + (u32)s_iSeconds*1000;
+   u32 uFakeTime = 1;
+   u32 uChunks = 0;
+   u32 uBytes = 0;
+
+   while ( test_now_ms() < uTimeEnd )
+   {
+      // Random chunk sizes, like video blocks coming from the radio
+      u8 uChunk[1500];
+      int iChunkLength = 100 + (int)(test_rand_next(&uRand) % 1300);
+      int iPos = 0;
+      while ( iPos < iChunkLength )
+      {
+         if ( iFramePos >= iFrameLength )
+         {
+            uFrame++;
+            iFrameLength = _build_frame(uFrame, s_uFrame);
+            iFramePos = 0;
+         }
+         int iCopy = iFrameLength - iFramePos;
+         if ( iCopy > iChunkLength - iPos )
+            iCopy = iChunkLength - iPos;
+         memcpy(uChunk + iPos, s_uFrame + iFramePos, iCopy);
+         iPos += iCopy;
+         iFramePos += iCopy;
+      }
+
+      u32 uTime = test_now_ms();
+      // Time jumps on each write: consumer is never seen alive, gets lapped
+      if ( PHASE_LAPPING == iPhase )
+      {
+         uFakeTime += 1000;
+         uTime = uFakeTime;
+      }
+      int iKeyframeOffset = video_sm_ring_find_keyframe_offset(uChunk, iChunkLength, 0);
+      video_sm_ring_write(&writer, uChunk, iChunkLength, iKeyframeOffset, uTime);
+      uChunks++;
+      uBytes += iChunkLength;
+
+      if ( (PHASE_SESSION == iPhase) && (0 == (uChunks % 5000)) )
+         video_sm_ring_writer_reset(&writer);
+
+      // About 40 MB/s in bursts, well above a video stream. Full speed when lapping, to
+      // get the consumer overwritten while it copies chunks out.
+      if ( (PHASE_LAPPING != iPhase) && (0 == (uChunks % 32)) )
+         usleep(500);
+      if ( (PHASE_LAPPING == iPhase) && (0 == (uChunks % 8)) )
+         usleep(20);
+   }
+   pControl->uProducerFrames = uFrame;
+   pControl->uProducerBytes = uBytes;
+   pControl->uProducerDropped = writer.pHeader->uStatsDroppedChunks;
+   __atomic_store_n(&pControl->uProducerDone, 1, __ATOMIC_RELEASE);
+}
+
+static void _run_phase(int iPhase, const char* szName, u32 uMemSize)
+{
+   printf("\nPhase %s: ring of %u bytes, %d seconds...\n", szName, uMemSize, s_iSeconds);
+   u8* pMem = (u8*)mmap(NULL, uMemSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   type_test_control* pControl = (type_test_control*)mmap(NULL, sizeof(type_test_control), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+   if ( (MAP_FAILED == pMem) || (MAP_FAILED == pControl) )
+   {
+      printf("FAILED: can't map shared memory\n");
+      s_iTestFailures++;
+      return;
+   }
+   memset(pControl, 0, sizeof(type_test_control));
+
+   // Format the ring before the consumer starts, like ruby_rt_station does before launching the player
+   type_video_sm_ring_writer writer;
+   video_sm_ring_writer_init(&writer, pMem, uMemSize);
+
+   fflush(stdout);
+   pid_t pid = fork();
+   if ( 0 == pid )
+      _exit(_run_consumer(pMem, uMemSize, pControl, iPhase, s_Options.uSeed + iPhase));
+
+   _run_producer(pMem, uMemSize, pControl, iPhase, s_Options.uSeed + iPhase);
+   int iStatus = 0;
+   waitpid(pid, &iStatus, 0);
+
+   printf("  producer: %u frames, %u bytes, %u chunks dropped for backpressure\n",
+      pControl->uProducerFrames, pControl->uProducerBytes, pControl->uProducerDropped);
+   printf("  consumer: %u frames (%u truncated), %u bytes, %u overruns, %u resyncs, %u errors\n",
+      pControl->uConsumerFrames, pControl->uConsumerTruncatedFrames, pControl->uConsumerBytes,
+      pControl->uConsumerOverruns, pControl->uConsumerResyncs, pControl->uConsumerErrors);
+
+   if ( (!WIFEXITED(iStatus)) || (0 != WEXITSTATUS(iStatus)) || (0 != pControl->uConsumerErrors) )
+   {
+      printf("FAILED: consumer got invalid data\n");
+      s_iTestFailures++;
+   }
+   if ( 0 == pControl->uConsumerFrames )
+   {
+      printf("FAILED: consumer got no frames\n");
+      s_iTestFailures++;
+   }
+   if ( (0 != pControl->uConsumerTruncatedFrames) && (0 == pControl->uProducerDropped) && (0 == pControl->uConsumerResyncs) )
+   {
+      printf("FAILED: frames truncated without producer drops or overruns\n");
+      s_iTestFailures++;
+   }
+   munmap(pMem, uMemSize);
+   munmap(pControl, sizeof(type_test_control));
+}
+
+static void _test_keyframe_detection()
+{
+   printf("\nKeyframe detection...\n");
+   u8 uH264[] = { 0x80, 0x81, 0, 0, 0, 1, 0x41, 0x82, 0, 0, 0, 1, 0x67, 0x42 };
+   u8 uH264Short[] = { 0x80, 0, 0, 1, 0x65, 0x88 };
+   u8 uH265[] = { 0x80, 0, 0, 0, 1, 0x02, 0x01, 0x83, 0, 0, 0, 1, 0x40, 0x01 };
+   u8 uNone[] = { 0x80, 0, 0, 0, 1, 0x41, 0x9a, 0, 0, 1 };
+   int iRes1 = video_sm_ring_find_keyframe_offset(uH264, sizeof(uH264), 0);
+   int iRes2 = video_sm_ring_find_keyframe_offset(uH264Short, sizeof(uH264Short), 0);
+   int iRes3 = video_sm_ring_find_keyframe_offset(uH265, sizeof(uH265), 1);
+   int iRes4 = video_sm_ring_find_keyframe_offset(uNone, sizeof(uNone), 0);
+   if ( (8 != iRes1) || (1 != iRes2) || (8 != iRes3) || (-1 != iRes4) )
+   {
+      printf("FAILED: keyframe offsets %d %d %d %d, expected 8 1 8 -1\n", iRes1, iRes2, iRes3, iRes4);
+      s_iTestFailures++;
+   }
+}
+
+static int _parse_seconds_option(int argc, char* argv[], int iIndex)
+{
+   if ( (0 != strcmp(argv[iIndex], "-seconds")) || (iIndex >= argc-1) )
+      return 0;
+   s_iSeconds = atoi(argv[iIndex+1]);
+   return 2;
+}
+
+int main(int argc, char *argv[])
+{
+   if ( ! test_parse_options(argc, argv, &s_Options, 1, 1, "[-seconds n]", _parse_seconds_option) )
+      return -1;
+   if ( s_Options.bQuick )
+      s_iSeconds = 1;
+   if ( s_iSeconds < 1 )
+      s_iSeconds = 1;
+
+   printf("\nTesting shared memory video ring (v%d).\n", VIDEO_SM_RING_VERSION);
+
+   _test_keyframe_detection();
+   _run_phase(PHASE_BACKPRESSURE, "backpressure", SM_STREAMER_SIZE);
+   _run_phase(PHASE_LAPPING, "lapping", 32*1024);
+   _run_phase(PHASE_SESSION, "session restarts", SM_STREAMER_SIZE);
+
+   return test_report_result("video ring");
+}
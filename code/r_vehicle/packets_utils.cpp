@@ -66,6 +66,29 @@ int s_iLastRawTxPowerPerRadioInterface[MAX_RADIO_INTERFACES];
 
 u32 s_VehicleLogSegmentIndex = 0;
 
+// Tx batching: while a batch is open, wifi radio frames are built into per interface buffers
+// and submitted together (one syscall per interface) when the batch is flushed.
+
+typedef struct
+{
+   u8* pFramesBuffer; // MAX_RADIO_TX_BATCH_PACKETS frames of MAX_PACKET_TOTAL_SIZE each, allocated on first use
+   u8* pFrames[MAX_RADIO_TX_BATCH_PACKETS];
+   int iFramesLengths[MAX_RADIO_TX_BATCH_PACKETS];
+   int iResults[MAX_RADIO_TX_BATCH_PACKETS];
+   int iPacketsLengths[MAX_RADIO_TX_BATCH_PACKETS];
+   int iLocalRadioLinkIds[MAX_RADIO_TX_BATCH_PACKETS];
+   int iStreamIds[MAX_RADIO_TX_BATCH_PACKETS];
+   int iDataRates[MAX_RADIO_TX_BATCH_PACKETS];
+   bool bIsVideoOrAudio[MAX_RADIO_TX_BATCH_PACKETS];
+   bool bIsVideo[MAX_RADIO_TX_BATCH_PACKETS];
+   int iCount;
+} ALIGN_STRUCT_SPEC_INFO t_tx_batch_interface;
+
+t_tx_batch_interface s_TxBatches[MAX_RADIO_INTERFACES];
+bool s_bTxBatchOpen = false;
+
+void _flush_tx_batch_for_interface(int iRadioInterfaceIndex);
+
 
 typedef struct
 {
@@ -94,7 +117,10 @@ void packet_utils_init()
       s_LastTxDataRatesData[i] = 0;
       s_LastSetAtherosCardsDatarates[i] = 5000;
       s_iLastRawTxPowerPerRadioInterface[i] = 0;
+      s_TxBatches[i].pFramesBuffer = NULL;
+      s_TxBatches[i].iCount = 0;
    }
+   s_bTxBatchOpen = false;
 }
 
 void packet_utils_set_adaptive_video_bitrate(u32 uBitrate)
@@ -336,6 +362,8 @@ void _compute_packet_tx_power_on_ieee(int iVehicleRadioLinkId, int iRadioInterfa
 
    s_iLastRawTxPowerPerRadioInterface[iRadioInterfaceIndex] = iRadioInterfaceRawTxPowerToUse;
 
+   // Frames queued so far must go out at the tx power they were queued with
+   _flush_tx_batch_for_interface(iRadioInterfaceIndex);
 
    s_bThreadSetTxPowerRunning = true;
    s_iThreadSetTxPowerInterfaceIndex = iRadioInterfaceIndex;
@@ -509,6 +537,8 @@ int _compute_packet_downlink_datarate_radioflags_tx_power(u8* pPacketData, int i
    {
       if ( s_LastSetAtherosCardsDatarates[iRadioInterfaceIndex] != iDataRateTx )
       {
+         // Frames queued so far must go out at the card datarate they were queued with
+         _flush_tx_batch_for_interface(iRadioInterfaceIndex);
          s_LastSetAtherosCardsDatarates[iRadioInterfaceIndex] = iDataRateTx;
          update_atheros_card_datarate(g_pCurrentModel, iRadioInterfaceIndex, iDataRateTx, g_pProcessStats);
       }
@@ -629,6 +659,74 @@ bool _send_packet_to_serial_radio_interface(int iLocalRadioLinkId, int iRadioInt
    return false;
 }
 
+void _flush_tx_batch_for_interface(int iRadioInterfaceIndex)
+{
+   if ( (iRadioInterfaceIndex < 0) || (iRadioInterfaceIndex >= MAX_RADIO_INTERFACES) )
+      return;
+   t_tx_batch_interface* pBatch = &s_TxBatches[iRadioInterfaceIndex];
+   if ( pBatch->iCount <= 0 )
+      return;
+
+   u32 microT1 = get_current_timestamp_micros();
+   radio_write_raw_ieee_packets_batch(iRadioInterfaceIndex, pBatch->pFrames, pBatch->iFramesLengths, pBatch->iCount, pBatch->iResults);
+   u32 microT2 = get_current_timestamp_micros();
+
+   bool bHasVideo = false;
+   for( int i=0; i<pBatch->iCount; i++ )
+   {
+      if ( ! pBatch->iResults[i] )
+         continue;
+      if ( pBatch->bIsVideo[i] )
+         bHasVideo = true;
+      radio_stats_update_on_packet_sent_on_radio_interface(&g_SM_RadioStats, g_TimeNow, iRadioInterfaceIndex, pBatch->iPacketsLengths[i]);
+      radio_stats_set_tx_radio_datarate_for_packet(&g_SM_RadioStats, iRadioInterfaceIndex, pBatch->iLocalRadioLinkIds[i], pBatch->iDataRates[i], pBatch->bIsVideoOrAudio[i]?1:0);
+      radio_stats_update_on_packet_sent_on_radio_link(&g_SM_RadioStats, g_TimeNow, pBatch->iLocalRadioLinkIds[i], pBatch->iStreamIds[i], pBatch->iPacketsLengths[i]);
+   }
+
+   if ( microT2 > microT1 )
+   {
+      g_RadioTxTimers.aTmpInterfacesTxTotalTimeMicros[iRadioInterfaceIndex] += microT2 - microT1;
+      if ( bHasVideo )
+         g_RadioTxTimers.aTmpInterfacesTxVideoTimeMicros[iRadioInterfaceIndex] += microT2 - microT1;
+   }
+   pBatch->iCount = 0;
+}
+
+// Returns false if the frame can't be batched and must be sent right away
+
+bool _add_frame_to_tx_batch(int iRadioInterfaceIndex, int iLocalRadioLinkId, u8* pFrame, int iFrameLength, int nPacketLength, int iStreamId, int iDataRateTx, bool bIsVideo, bool bIsVideoOrAudio)
+{
+   if ( (iRadioInterfaceIndex < 0) || (iRadioInterfaceIndex >= MAX_RADIO_INTERFACES) || (iFrameLength > MAX_PACKET_TOTAL_SIZE) )
+      return false;
+
+   t_tx_batch_interface* pBatch = &s_TxBatches[iRadioInterfaceIndex];
+   if ( NULL == pBatch->pFramesBuffer )
+   {
+      pBatch->pFramesBuffer = (u8*) malloc(MAX_RADIO_TX_BATCH_PACKETS * MAX_PACKET_TOTAL_SIZE);
+      if ( NULL == pBatch->pFramesBuffer )
+         return false;
+      for( int i=0; i<MAX_RADIO_TX_BATCH_PACKETS; i++ )
+         pBatch->pFrames[i] = pBatch->pFramesBuffer + i * MAX_PACKET_TOTAL_SIZE;
+      pBatch->iCount = 0;
+   }
+
+   // Card datarate and tx power changes already flushed the batch (before changing the card settings)
+   if ( pBatch->iCount >= MAX_RADIO_TX_BATCH_PACKETS )
+      _flush_tx_batch_for_interface(iRadioInterfaceIndex);
+
+   int i = pBatch->iCount;
+   memcpy(pBatch->pFrames[i], pFrame, iFrameLength);
+   pBatch->iFramesLengths[i] = iFrameLength;
+   pBatch->iPacketsLengths[i] = nPacketLength;
+   pBatch->iLocalRadioLinkIds[i] = iLocalRadioLinkId;
+   pBatch->iStreamIds[i] = iStreamId;
+   pBatch->iDataRates[i] = iDataRateTx;
+   pBatch->bIsVideoOrAudio[i] = bIsVideoOrAudio;
+   pBatch->bIsVideo[i] = bIsVideo;
+   pBatch->iCount++;
+   return true;
+}
+
 bool _send_packet_to_wifi_radio_interface(int iLocalRadioLinkId, int iRadioInterfaceIndex, u8* pPacketData, int nPacketLength)
 {
    if ( (NULL == pPacketData) || (nPacketLength <= 0) || (NULL == g_pCurrentModel) )
@@ -691,6 +789,16 @@ bool _send_packet_to_wifi_radio_interface(int iLocalRadioLinkId, int iRadioInter
    if ( pPH->packet_type == PACKET_TYPE_VIDEO_ADAPTIVE_VIDEO_PARAMS_ACK )
       iRepeatCount++;
 
+   if ( s_bTxBatchOpen )
+   {
+      if ( 0 == iRepeatCount )
+      if ( _add_frame_to_tx_batch(iRadioInterfaceIndex, iLocalRadioLinkId, s_RadioRawPacket, totalLength, nPacketLength, (int)uStreamId, iDataRateTx, bIsVideoPacket, bIsVideoPacket || bIsAudioPacket) )
+         return true;
+      // Keep the frames order on the interface
+      if ( (iRadioInterfaceIndex >= 0) && (iRadioInterfaceIndex < MAX_RADIO_INTERFACES) )
+         _flush_tx_batch_for_interface(iRadioInterfaceIndex);
+   }
+
    /*
    t_packet_header* pPHTmp = (t_packet_header*)(((u8*)&s_RadioRawPacket[0]) + totalLength - nPacketLength);
    if ( pPHTmp->packet_type == PACKET_TYPE_VIDEO_DATA )
@@ -731,6 +839,20 @@ bool _send_packet_to_wifi_radio_interface(int iLocalRadioLinkId, int iRadioInter
    return false;
 }
 
+// Packets sent on wifi radio interfaces after this call are queued and submitted in batches, on flush
+
+void send_packets_to_radio_interfaces_begin_batch()
+{
+   s_bTxBatchOpen = true;
+}
+
+void send_packets_to_radio_interfaces_flush_batch()
+{
+   s_bTxBatchOpen = false;
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+      _flush_tx_batch_for_interface(i);
+}
+
 // Sends a radio packet to all posible radio interfaces or just to a single radio link
 
 int send_packet_to_radio_interfaces(u8* pPacketData, int nPacketLength, int iSendToSingleRadioLink)
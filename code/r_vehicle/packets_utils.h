@@ -10,6 +10,8 @@ int get_last_tx_used_datarate_bps_data(int iInterface);
 int get_last_tx_minimum_video_radio_datarate_bps();
 
 int send_packet_to_radio_interfaces(u8* pPacketData, int nPacketLength, int iSendToSingleRadioLink);
+void send_packets_to_radio_interfaces_begin_batch();
+void send_packets_to_radio_interfaces_flush_batch();
 void send_packet_vehicle_log(u8* pBuffer, int length);
 
 void send_alarm_to_controller(u32 uAlarm, u32 uFlags1, u32 uFlags2, u32 uRepeatCount);
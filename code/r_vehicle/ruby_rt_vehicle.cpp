@@ -57,6 +57,7 @@
 #include "../base/config.h"
 #include "../base/commands.h"
 #include "../base/hardware_procs.h"
+#include "../base/hardware_radio_ctrl.h"
 #include "../base/models.h"
 #include "../base/models_list.h"
 #include "../base/radio_utils.h"
@@ -154,12 +155,11 @@ static bool set_wifi_mcs_rate(int interface_index, int mcs_rate) {
         }
     }
     
-    // Method 3: Generic iw command
+    // Method 3: Generic nl80211 bitrate mask (same as iw set bitrates)
     if (!success) {
-        sprintf(szComm, "iw dev wlan%d set bitrates ht-mcs-2.4 %d 2>/dev/null", interface_index, mcs_rate);
-        if (hw_execute_bash_command(szComm, NULL) == 0) {
+        if (radio_ctrl_set_bitrate(pRadioHWInfo->szName, -mcs_rate-1, 0) == 0) {
             success = true;
-            log_line("[RubALink] Set MCS rate %d for WiFi interface %d (iw)", mcs_rate, interface_index);
+            log_line("[RubALink] Set MCS rate %d for WiFi interface %d (%s)", mcs_rate, interface_index, radio_ctrl_get_backend_name(radio_ctrl_get_backend()));
         }
     }
     
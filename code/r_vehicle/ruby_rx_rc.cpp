@@ -215,7 +215,8 @@ int r_start_rx_rc(int argc, char *argv[])
    while (!g_bQuit) 
    {
       g_uLoopCounter++;
-      hardware_sleep_ms(iSleepIntervalMS);
+      // Returns as soon as the router sends a RC message
+      ruby_ipc_wait_for_message(s_fIPC_FromRouter, iSleepIntervalMS);
       if ( iSleepIntervalMS < 50 )
          iSleepIntervalMS += 10;
 
@@ -900,6 +900,9 @@ int VideoTxPacketsBuffer::sendAvailablePackets(int iMaxCountToSend)
    if ( iToSend > iMaxCountToSend )
       iToSend = iMaxCountToSend;
 
+   // Submit the packets to the radio interfaces in batches instead of one syscall per packet
+   send_packets_to_radio_interfaces_begin_batch();
+
    int iCountSent = 0;
    for( int i=0; i<iToSend; i++ )
    {
@@ -939,6 +942,7 @@ int VideoTxPacketsBuffer::sendAvailablePackets(int iMaxCountToSend)
       if ( m_iCurrentBufferPacketIndexToSend == m_iNextBufferPacketIndexToFill )
          break;
    }
+   send_packets_to_radio_interfaces_flush_batch();
    return iCountSent;
 }
 
@@ -80,8 +80,31 @@
 #include <string.h>
 
 #include <assert.h>
+#include <pthread.h>
 #include "fec.h"
 
+/*
+ * Vector kernels for the addmul/mul primitives. They all use the
+ * split-nibble method: c*x = c*(x & 0x0f) ^ c*(x & 0xf0), each half
+ * being a 16 entry table lookup done with PSHUFB (x86) or VTBL/TBL (ARM).
+ * Which one is used is decided at runtime in fec_init().
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define FEC_HAS_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+#if defined(__aarch64__) || defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define FEC_HAS_NEON 1
+#include <arm_neon.h>
+#if !defined(__aarch64__)
+#include <sys/auxv.h>
+#ifndef HWCAP_NEON
+#define HWCAP_NEON (1 << 12)
+#endif
+#endif
+#endif
+
 /*
  * stuff used for testing purposes only
  */
@@ -169,8 +192,6 @@ static char *allPp[] = {    /* GF_BITS	polynomial		*/
  * In any case the macro gf_mul(x,y) takes care of multiplications.
  */
 
-static int s_iAssertion = 0;
-
 static gf gf_exp[2*GF_SIZE];	/* index->poly form conversion table	*/
 static int gf_log[GF_SIZE + 1];	/* Poly->index form conversion table	*/
 static gf inverse[GF_SIZE+1];	/* inverse of field elem.		*/
@@ -217,6 +238,13 @@ __attribute__((aligned (256)))
 #define GF_ADDMULC(dst, x) dst ^= __gf_mulc_[x]
 #define GF_MULC(dst, x) dst = __gf_mulc_[x]
 
+/*
+ * Split nibble tables used by the vector kernels:
+ * gf_mul_lo[c][x] = c * x and gf_mul_hi[c][x] = c * (x << 4), for x < 16
+ */
+static gf gf_mul_lo[GF_SIZE + 1][16] __attribute__((aligned (32)));
+static gf gf_mul_hi[GF_SIZE + 1][16] __attribute__((aligned (32)));
+
 static void
 init_mul_table(void)
 {
@@ -227,6 +255,12 @@ init_mul_table(void)
 
     for (j=0; j< GF_SIZE+1; j++)
 	gf_mul_table[j] = gf_mul_table[j<<8] = 0;
+
+    for (i=0; i< GF_SIZE+1; i++)
+	for (j=0; j< 16; j++) {
+	    gf_mul_lo[i][j] = gf_mul_table[(i<<8) + j];
+	    gf_mul_hi[i][j] = gf_mul_table[(i<<8) + (j<<4)];
+	}
 }
 
 /*
@@ -435,10 +469,6 @@ addmul1(gf *dst1, gf *src1, gf c, int sz)
 # define addmul1 slow_addmul1
 #endif
 
-static void addmul(gf *dst, gf *src, gf c, int sz) {
-    // fprintf(stderr, "Dst=%p Src=%p, gf=%02x sz=%d\n", dst, src, c, sz);
-    if (c != 0) addmul1(dst, src, c, sz);
-}
 
 /*
  * mul() computes dst[] = c * src[]
@@ -561,9 +591,279 @@ mul1(gf *dst1, gf *src1, gf c, int sz)
 # define mul1 slow_mul1
 #endif
 
+/*
+ * Vector implementations of addmul1()/mul1(). Each one handles the
+ * largest multiple of its vector width and leaves the tail to the
+ * scalar code, so any block size (and alignment) is accepted.
+ * The AVX2 ones must not call into the SSSE3 ones (legacy SSE encoding
+ * with dirty upper registers stalls on AVX/SSE transitions), so they
+ * do their 16 byte step themselves.
+ */
+#if defined FEC_HAS_X86_SIMD
+
+__attribute__((target("ssse3")))
+static void
+addmul1_ssse3(gf *dst, gf *src, gf c, int sz)
+{
+    const __m128i tlo = _mm_load_si128((const __m128i *)gf_mul_lo[c]);
+    const __m128i thi = _mm_load_si128((const __m128i *)gf_mul_hi[c]);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+	__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+	__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+	__m128i l = _mm_shuffle_epi8(tlo, _mm_and_si128(s, mask));
+	__m128i h = _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+	_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+    }
+    if (i < sz)
+	slow_addmul1(dst + i, src + i, c, sz - i);
+}
+
+__attribute__((target("ssse3")))
+static void
+mul1_ssse3(gf *dst, gf *src, gf c, int sz)
+{
+    const __m128i tlo = _mm_load_si128((const __m128i *)gf_mul_lo[c]);
+    const __m128i thi = _mm_load_si128((const __m128i *)gf_mul_hi[c]);
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+	__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+	__m128i l = _mm_shuffle_epi8(tlo, _mm_and_si128(s, mask));
+	__m128i h = _mm_shuffle_epi8(thi, _mm_and_si128(_mm_srli_epi64(s, 4), mask));
+	_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(l, h));
+    }
+    if (i < sz)
+	slow_mul1(dst + i, src + i, c, sz - i);
+}
+
+__attribute__((target("avx2")))
+static void
+addmul1_avx2(gf *dst, gf *src, gf c, int sz)
+{
+    const __m256i tlo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)gf_mul_lo[c]));
+    const __m256i thi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)gf_mul_hi[c]));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    int i;
+
+    for (i = 0; i + 32 <= sz; i += 32) {
+	__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+	__m256i d = _mm256_loadu_si256((const __m256i *)(dst + i));
+	__m256i l = _mm256_shuffle_epi8(tlo, _mm256_and_si256(s, mask));
+	__m256i h = _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+	_mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(d, _mm256_xor_si256(l, h)));
+    }
+    if (i + 16 <= sz) {
+	__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+	__m128i d = _mm_loadu_si128((const __m128i *)(dst + i));
+	__m128i l = _mm_shuffle_epi8(_mm256_castsi256_si128(tlo), _mm_and_si128(s, _mm256_castsi256_si128(mask)));
+	__m128i h = _mm_shuffle_epi8(_mm256_castsi256_si128(thi), _mm_and_si128(_mm_srli_epi64(s, 4), _mm256_castsi256_si128(mask)));
+	_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(d, _mm_xor_si128(l, h)));
+	i += 16;
+    }
+    if (i < sz)
+	slow_addmul1(dst + i, src + i, c, sz - i);
+}
+
+__attribute__((target("avx2")))
+static void
+mul1_avx2(gf *dst, gf *src, gf c, int sz)
+{
+    const __m256i tlo = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)gf_mul_lo[c]));
+    const __m256i thi = _mm256_broadcastsi128_si256(_mm_load_si128((const __m128i *)gf_mul_hi[c]));
+    const __m256i mask = _mm256_set1_epi8(0x0f);
+    int i;
+
+    for (i = 0; i + 32 <= sz; i += 32) {
+	__m256i s = _mm256_loadu_si256((const __m256i *)(src + i));
+	__m256i l = _mm256_shuffle_epi8(tlo, _mm256_and_si256(s, mask));
+	__m256i h = _mm256_shuffle_epi8(thi, _mm256_and_si256(_mm256_srli_epi64(s, 4), mask));
+	_mm256_storeu_si256((__m256i *)(dst + i), _mm256_xor_si256(l, h));
+    }
+    if (i + 16 <= sz) {
+	__m128i s = _mm_loadu_si128((const __m128i *)(src + i));
+	__m128i l = _mm_shuffle_epi8(_mm256_castsi256_si128(tlo), _mm_and_si128(s, _mm256_castsi256_si128(mask)));
+	__m128i h = _mm_shuffle_epi8(_mm256_castsi256_si128(thi), _mm_and_si128(_mm_srli_epi64(s, 4), _mm256_castsi256_si128(mask)));
+	_mm_storeu_si128((__m128i *)(dst + i), _mm_xor_si128(l, h));
+	i += 16;
+    }
+    if (i < sz)
+	slow_mul1(dst + i, src + i, c, sz - i);
+}
+
+#endif /* FEC_HAS_X86_SIMD */
+
+#if defined FEC_HAS_NEON
+
+static inline uint8x16_t
+neon_lookup16(uint8x16_t table, uint8x16_t idx)
+{
+#if defined(__aarch64__)
+    return vqtbl1q_u8(table, idx);
+#else
+    uint8x8x2_t t;
+    t.val[0] = vget_low_u8(table);
+    t.val[1] = vget_high_u8(table);
+    return vcombine_u8(vtbl2_u8(t, vget_low_u8(idx)), vtbl2_u8(t, vget_high_u8(idx)));
+#endif
+}
+
+static void
+addmul1_neon(gf *dst, gf *src, gf c, int sz)
+{
+    const uint8x16_t tlo = vld1q_u8(gf_mul_lo[c]);
+    const uint8x16_t thi = vld1q_u8(gf_mul_hi[c]);
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+	uint8x16_t s = vld1q_u8(src + i);
+	uint8x16_t d = vld1q_u8(dst + i);
+	uint8x16_t l = neon_lookup16(tlo, vandq_u8(s, mask));
+	uint8x16_t h = neon_lookup16(thi, vshrq_n_u8(s, 4));
+	vst1q_u8(dst + i, veorq_u8(d, veorq_u8(l, h)));
+    }
+    if (i < sz)
+	slow_addmul1(dst + i, src + i, c, sz - i);
+}
+
+static void
+mul1_neon(gf *dst, gf *src, gf c, int sz)
+{
+    const uint8x16_t tlo = vld1q_u8(gf_mul_lo[c]);
+    const uint8x16_t thi = vld1q_u8(gf_mul_hi[c]);
+    const uint8x16_t mask = vdupq_n_u8(0x0f);
+    int i;
+
+    for (i = 0; i + 16 <= sz; i += 16) {
+	uint8x16_t s = vld1q_u8(src + i);
+	uint8x16_t l = neon_lookup16(tlo, vandq_u8(s, mask));
+	uint8x16_t h = neon_lookup16(thi, vshrq_n_u8(s, 4));
+	vst1q_u8(dst + i, veorq_u8(l, h));
+    }
+    if (i < sz)
+	slow_mul1(dst + i, src + i, c, sz - i);
+}
+
+#endif /* FEC_HAS_NEON */
+
+/*
+ * Runtime dispatch. Defaults to the generic code until fec_init()
+ * has probed the CPU.
+ */
+typedef void (*gf_kernel_t)(gf *dst, gf *src, gf c, int sz);
+
+static int s_iFECAccel = FEC_ACCEL_NONE;
+static gf_kernel_t s_pfnAddMul1 = addmul1;
+static gf_kernel_t s_pfnMul1 = mul1;
+
+static int
+fec_accel_supported(int accel)
+{
+    switch (accel) {
+    case FEC_ACCEL_NONE:
+	return 1;
+#if defined FEC_HAS_X86_SIMD
+    case FEC_ACCEL_SSSE3:
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("ssse3");
+    case FEC_ACCEL_AVX2:
+	__builtin_cpu_init();
+	return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("ssse3");
+#endif
+#if defined FEC_HAS_NEON
+    case FEC_ACCEL_NEON:
+#if defined(__aarch64__)
+	return 1;
+#else
+	return (getauxval(AT_HWCAP) & HWCAP_NEON) ? 1 : 0;
+#endif
+#endif
+    default:
+	return 0;
+    }
+}
+
+static int
+fec_accel_best(void)
+{
+    if (fec_accel_supported(FEC_ACCEL_AVX2))
+	return FEC_ACCEL_AVX2;
+    if (fec_accel_supported(FEC_ACCEL_SSSE3))
+	return FEC_ACCEL_SSSE3;
+    if (fec_accel_supported(FEC_ACCEL_NEON))
+	return FEC_ACCEL_NEON;
+    return FEC_ACCEL_NONE;
+}
+
+static int
+fec_select_accel(int accel)
+{
+    if (accel == FEC_ACCEL_AUTO)
+	accel = fec_accel_best();
+    if (!fec_accel_supported(accel))
+	accel = FEC_ACCEL_NONE;
+
+    switch (accel) {
+#if defined FEC_HAS_X86_SIMD
+    case FEC_ACCEL_SSSE3:
+	s_pfnAddMul1 = addmul1_ssse3;
+	s_pfnMul1 = mul1_ssse3;
+	break;
+    case FEC_ACCEL_AVX2:
+	s_pfnAddMul1 = addmul1_avx2;
+	s_pfnMul1 = mul1_avx2;
+	break;
+#endif
+#if defined FEC_HAS_NEON
+    case FEC_ACCEL_NEON:
+	s_pfnAddMul1 = addmul1_neon;
+	s_pfnMul1 = mul1_neon;
+	break;
+#endif
+    default:
+	s_pfnAddMul1 = addmul1;
+	s_pfnMul1 = mul1;
+	break;
+    }
+    s_iFECAccel = accel;
+    return accel;
+}
+
+int fec_set_accel(int accel)
+{
+    fec_init();
+    return fec_select_accel(accel);
+}
+
+int fec_get_accel(void)
+{
+    return s_iFECAccel;
+}
+
+const char* fec_get_accel_name(int accel)
+{
+    switch (accel) {
+    case FEC_ACCEL_NONE:  return "generic";
+    case FEC_ACCEL_SSSE3: return "ssse3";
+    case FEC_ACCEL_AVX2:  return "avx2";
+    case FEC_ACCEL_NEON:  return "neon";
+    case FEC_ACCEL_AUTO:  return "auto";
+    default:              return "unknown";
+    }
+}
+
+static inline void addmul(gf *dst, gf *src, gf c, int sz) {
+    // fprintf(stderr, "Dst=%p Src=%p, gf=%02x sz=%d\n", dst, src, c, sz);
+    if (c != 0) s_pfnAddMul1(dst, src, c, sz);
+}
+
 static inline void mul(gf *dst, gf *src, gf c, int sz) {
     /*fprintf(stderr, "%p = %02x * %p\n", dst, c, src);*/
-    if (c != 0) mul1(dst, src, c, sz); else memset(dst, 0, sz);
+    if (c != 0) s_pfnMul1(dst, src, c, sz); else memset(dst, 0, sz);
 }
 
 /*
@@ -694,9 +994,47 @@ invert_mat(gf *src, int k)
 }
 
 
+/*
+ * Small LRU cache of inverted decode matrices. The matrix only depends on
+ * which data blocks are missing and which FEC blocks are used to recover
+ * them, and real links repeat the same few loss patterns, so this skips
+ * the O(k^3) inversion for most decodes.
+ */
+#define FEC_MATRIX_CACHE_SIZE 16
+#define FEC_MATRIX_CACHE_MAX_DIM 32
+
+typedef struct
+{
+    int nr;			/* 0 if the slot is empty */
+    unsigned int uLastUse;
+    unsigned int uMissingBitmap[FEC_MAX_BLOCKS/32];
+    unsigned char erased[FEC_MATRIX_CACHE_MAX_DIM];
+    unsigned char fec_nos[FEC_MATRIX_CACHE_MAX_DIM];
+    gf matrix[FEC_MATRIX_CACHE_MAX_DIM * FEC_MATRIX_CACHE_MAX_DIM];
+} fec_matrix_cache_entry_t;
+
+/*
+ * Per codec state. The GF tables are global but read-only once built,
+ * everything a decode writes to lives here, so different contexts can
+ * be used concurrently from different threads.
+ */
+struct fec_context
+{
+    int iAssertion;
+    gf decode_matrix[FEC_MAX_BLOCKS * FEC_MAX_BLOCKS];
+
+    unsigned int uCacheUseCounter;
+    unsigned int uCacheHits;
+    unsigned int uCacheMisses;
+    fec_matrix_cache_entry_t cache[FEC_MATRIX_CACHE_SIZE];
+};
+
+static pthread_once_t s_FECInitOnce = PTHREAD_ONCE_INIT;
 static int fec_initialized = 0;
+static fec_context_t s_FECDefaultContext;
 
-void fec_init(void)
+static void
+fec_init_tables(void)
 {
     TICK(ticks[0]);
     generate_gf();
@@ -706,9 +1044,119 @@ void fec_init(void)
     init_mul_table();
     TOCK(ticks[0]);
     DDB(fprintf(stderr, "init_mul_table took %ldus\n", ticks[0]);)
+    fec_select_accel(FEC_ACCEL_AUTO);
    	fec_initialized = 1 ;
 }
 
+void fec_init(void)
+{
+    pthread_once(&s_FECInitOnce, fec_init_tables);
+}
+
+fec_context_t* fec_context_create(void)
+{
+    fec_context_t* ctx;
+
+    fec_init();
+    ctx = (fec_context_t*) malloc(sizeof(fec_context_t));
+    if (NULL == ctx)
+	return NULL;
+    memset(ctx, 0, sizeof(fec_context_t));
+    return ctx;
+}
+
+void fec_context_destroy(fec_context_t* ctx)
+{
+    if ((NULL == ctx) || (ctx == &s_FECDefaultContext))
+	return;
+    free(ctx);
+}
+
+void fec_context_get_cache_stats(fec_context_t* ctx, unsigned int* puHits, unsigned int* puMisses)
+{
+    if (NULL == ctx)
+	ctx = &s_FECDefaultContext;
+    if (NULL != puHits)
+	*puHits = ctx->uCacheHits;
+    if (NULL != puMisses)
+	*puMisses = ctx->uCacheMisses;
+}
+
+void fec_context_reset_cache(fec_context_t* ctx)
+{
+    if (NULL == ctx)
+	ctx = &s_FECDefaultContext;
+    memset(ctx->cache, 0, sizeof(ctx->cache));
+    ctx->uCacheUseCounter = 0;
+    ctx->uCacheHits = 0;
+    ctx->uCacheMisses = 0;
+}
+
+static void
+fec_cache_make_key(fec_matrix_cache_entry_t *key,
+		   unsigned int *fec_block_nos,
+		   unsigned int *erased_blocks,
+		   int nr)
+{
+    int i;
+    key->nr = nr;
+    memset(key->uMissingBitmap, 0, sizeof(key->uMissingBitmap));
+    for (i = 0; i < nr; i++) {
+	key->uMissingBitmap[erased_blocks[i] >> 5] |= 1u << (erased_blocks[i] & 0x1f);
+	key->erased[i] = (unsigned char) erased_blocks[i];
+	key->fec_nos[i] = (unsigned char) fec_block_nos[i];
+    }
+}
+
+/*
+ * Returns the cached inverted matrix for this erasure pattern or NULL.
+ */
+static gf *
+fec_cache_lookup(fec_context_t *ctx, fec_matrix_cache_entry_t *key)
+{
+    int i;
+    for (i = 0; i < FEC_MATRIX_CACHE_SIZE; i++) {
+	fec_matrix_cache_entry_t *e = &ctx->cache[i];
+	if (e->nr != key->nr)
+	    continue;
+	if (memcmp(e->uMissingBitmap, key->uMissingBitmap, sizeof(e->uMissingBitmap)) ||
+	    memcmp(e->erased, key->erased, key->nr) ||
+	    memcmp(e->fec_nos, key->fec_nos, key->nr))
+	    continue;
+	ctx->uCacheUseCounter++;
+	e->uLastUse = ctx->uCacheUseCounter;
+	ctx->uCacheHits++;
+	return e->matrix;
+    }
+    ctx->uCacheMisses++;
+    return NULL;
+}
+
+/*
+ * Stores an inverted matrix, evicting the least recently used entry.
+ */
+static void
+fec_cache_store(fec_context_t *ctx, fec_matrix_cache_entry_t *key, gf *matrix)
+{
+    int i, iSlot = 0;
+    for (i = 0; i < FEC_MATRIX_CACHE_SIZE; i++) {
+	if (0 == ctx->cache[i].nr) {
+	    iSlot = i;
+	    break;
+	}
+	if (ctx->cache[i].uLastUse < ctx->cache[iSlot].uLastUse)
+	    iSlot = i;
+    }
+    fec_matrix_cache_entry_t *e = &ctx->cache[iSlot];
+    ctx->uCacheUseCounter++;
+    e->nr = key->nr;
+    e->uLastUse = ctx->uCacheUseCounter;
+    memcpy(e->uMissingBitmap, key->uMissingBitmap, sizeof(e->uMissingBitmap));
+    memcpy(e->erased, key->erased, key->nr);
+    memcpy(e->fec_nos, key->fec_nos, key->nr);
+    memcpy(e->matrix, matrix, key->nr * key->nr);
+}
+
 
 /**
  * Simplified re-implementation of Fec-Bourbon
@@ -805,7 +1253,8 @@ void fec_init(void)
  * few (typically, 4 or 8) that they will fit easily in the cache (even
  * in the L2 cache...)
  */
-void fec_encode(unsigned int blockSize,
+void fec_encode_ctx(fec_context_t* ctx,
+		unsigned int blockSize,
 		unsigned char **data_blocks,
 		unsigned int nrDataBlocks,
 		unsigned char **fec_blocks,
@@ -814,11 +1263,11 @@ void fec_encode(unsigned int blockSize,
     unsigned int blockNo; /* loop for block counter */
     unsigned int row, col;
 
-    if ( 0 == fec_initialized )
-       fec_init();
+    (void)ctx; /* encoding only reads the shared tables */
+    fec_init();
     assert(fec_initialized);    
-    assert(nrDataBlocks <= 128);    
-    assert(nrFecBlocks <= 128);
+    assert(nrDataBlocks <= FEC_MAX_BLOCKS);    
+    assert(nrFecBlocks <= FEC_MAX_BLOCKS);
 
     if(!nrDataBlocks)
 	return;
@@ -840,7 +1289,8 @@ void fec_encode(unsigned int blockSize,
  * (with size being number of blocks lost, rather than number of data blocks
  * + fec)
  */
-static inline void reduce(unsigned int blockSize,
+static inline void reduce(fec_context_t* ctx,
+			  unsigned int blockSize,
 			  unsigned char **data_blocks,
 			  unsigned int nr_data_blocks,
 			  unsigned char **fec_blocks,
@@ -868,14 +1318,15 @@ static inline void reduce(unsigned int blockSize,
 
     assert(nr_fec_blocks == erasedIdx);
     if ( nr_fec_blocks != erasedIdx )
-       s_iAssertion = -2;
+       ctx->iAssertion = -2;
 }
 
 /**
  * Resolves reduced system. Constructs "mini" encoding matrix, inverts
  * it, and multiply reduced vector by it.
  */
-static inline void resolve(int blockSize,
+static inline void resolve(fec_context_t* ctx,
+			   int blockSize,
 			   unsigned char **data_blocks,
 			   unsigned char **fec_blocks,
 			   unsigned int *fec_block_nos,
@@ -884,9 +1335,19 @@ static inline void resolve(int blockSize,
 {
     /* construct matrix */
     int row;
-    unsigned char matrix[nr_fec_blocks*nr_fec_blocks];
+    unsigned char *matrix = NULL;
     int ptr;
     int r;
+    int bUseCache = (nr_fec_blocks > 0) && (nr_fec_blocks <= FEC_MATRIX_CACHE_MAX_DIM);
+    fec_matrix_cache_entry_t key;
+
+    if (bUseCache) {
+	fec_cache_make_key(&key, fec_block_nos, erased_blocks, nr_fec_blocks);
+	matrix = fec_cache_lookup(ctx, &key);
+    }
+    if (NULL != matrix)
+	goto multiply;
+    matrix = ctx->decode_matrix;
 
     /* we pick the submatrix of code that keeps colums corresponding to
      * the erased data blocks, and rows corresponding to the present FEC
@@ -905,8 +1366,11 @@ static inline void resolve(int blockSize,
     r=invert_mat(matrix, nr_fec_blocks);
 
     if(r)
-	      s_iAssertion = -1;
+	      ctx->iAssertion = -1;
+    else if (bUseCache)
+	fec_cache_store(ctx, &key, matrix);
 
+ multiply:
     /* do the multiplication with the reduced code vector */
     for(row = 0, ptr=0; row < nr_fec_blocks; row++) {
 	int col;
@@ -918,7 +1382,8 @@ static inline void resolve(int blockSize,
     }
 }
 
-int fec_decode(unsigned int blockSize,
+int fec_decode_ctx(fec_context_t* ctx,
+		unsigned int blockSize,
 		unsigned char **data_blocks,
 		unsigned int nr_data_blocks,
 		unsigned char **fec_blocks,
@@ -926,16 +1391,44 @@ int fec_decode(unsigned int blockSize,
 		unsigned int *erased_blocks,
 		unsigned short nr_fec_blocks)
 {
-   if ( 0 == fec_initialized )
-      fec_init();
-   s_iAssertion = 0;
+   fec_init();
+   if ( NULL == ctx )
+      ctx = &s_FECDefaultContext;
+   ctx->iAssertion = 0;
+
+   if ( nr_fec_blocks > FEC_MAX_BLOCKS )
+      return -3;
 
-    reduce(blockSize, data_blocks, nr_data_blocks,
+    reduce(ctx, blockSize, data_blocks, nr_data_blocks,
 	   fec_blocks, fec_block_nos,  erased_blocks, nr_fec_blocks);
 
-    resolve(blockSize, data_blocks,
+    resolve(ctx, blockSize, data_blocks,
 	    fec_blocks, fec_block_nos, erased_blocks,
 	    nr_fec_blocks);
-    return s_iAssertion;
+    return ctx->iAssertion;
+}
+
+/*
+ * Default context wrappers, kept for the existing single threaded users.
+ */
+void fec_encode(unsigned int blockSize,
+		unsigned char **data_blocks,
+		unsigned int nrDataBlocks,
+		unsigned char **fec_blocks,
+		unsigned int nrFecBlocks)
+{
+    fec_encode_ctx(&s_FECDefaultContext, blockSize, data_blocks, nrDataBlocks, fec_blocks, nrFecBlocks);
+}
+
+int fec_decode(unsigned int blockSize,
+		unsigned char **data_blocks,
+		unsigned int nr_data_blocks,
+		unsigned char **fec_blocks,
+		unsigned int *fec_block_nos,
+		unsigned int *erased_blocks,
+		unsigned short nr_fec_blocks)
+{
+    return fec_decode_ctx(&s_FECDefaultContext, blockSize, data_blocks, nr_data_blocks,
+           fec_blocks, fec_block_nos, erased_blocks, nr_fec_blocks);
 }
 
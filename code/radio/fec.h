@@ -4,6 +4,19 @@ extern "C" {
 #endif 
 typedef struct fec_parms *fec_code_t;
 
+/*
+ * Max number of data blocks and of FEC blocks in a stripe
+ */
+#define FEC_MAX_BLOCKS 128
+
+/*
+ * Codec context: holds all the state written during a decode.
+ * Different contexts can be used at the same time from different threads.
+ * fec_encode()/fec_decode() use a shared default context, so they must
+ * only be called from one thread at a time.
+ */
+typedef struct fec_context fec_context_t;
+
 /*
  * create a new encoder, returning a descriptor. This contains k,n and
  * the encoding matrix.
@@ -12,6 +25,32 @@ typedef struct fec_parms *fec_code_t;
  */
 void fec_init(void);
 
+fec_context_t* fec_context_create(void);
+void fec_context_destroy(fec_context_t* ctx);
+
+/*
+ * Decoding keeps a small LRU cache of inverted decode matrices, keyed by
+ * the erasure pattern. A NULL context means the default context.
+ */
+void fec_context_get_cache_stats(fec_context_t* ctx, unsigned int* puHits, unsigned int* puMisses);
+void fec_context_reset_cache(fec_context_t* ctx);
+
+void fec_encode_ctx(fec_context_t* ctx,
+		unsigned int blockSize,
+		unsigned char **data_blocks,
+		unsigned int nrDataBlocks,
+		unsigned char **fec_blocks,
+		unsigned int nrFecBlocks);
+
+int fec_decode_ctx(fec_context_t* ctx,
+		unsigned int blockSize,
+		unsigned char **data_blocks,
+		unsigned int nr_data_blocks,
+		unsigned char **fec_blocks,
+		unsigned int *fec_block_nos,
+		unsigned int *erased_blocks,
+		unsigned short nr_fec_blocks);
+
 void fec_encode(unsigned int blockSize,
 		unsigned char **data_blocks,
 		unsigned int nrDataBlocks,
@@ -26,6 +65,23 @@ int fec_decode(unsigned int blockSize,
 		unsigned int *erased_blocks,
 		unsigned short nr_fec_blocks  /* how many blocks per stripe */);
 
+/*
+ * Kernels used for the GF(2^8) multiply-accumulate work.
+ * fec_init() selects the best one supported by the CPU (FEC_ACCEL_AUTO).
+ * fec_set_accel() can force a specific one (for tests/benchmarks); it
+ * falls back to FEC_ACCEL_NONE if the requested one is not supported
+ * and returns the kernel that was actually selected.
+ */
+#define FEC_ACCEL_NONE  0
+#define FEC_ACCEL_SSSE3 1
+#define FEC_ACCEL_AVX2  2
+#define FEC_ACCEL_NEON  3
+#define FEC_ACCEL_AUTO  0xFF
+
+int fec_set_accel(int accel);
+int fec_get_accel(void);
+const char* fec_get_accel_name(int accel);
+
 void fec_print(fec_code_t code, int width);
 
 void fec_license(void);
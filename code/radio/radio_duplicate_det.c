@@ -196,6 +196,74 @@ int _radio_dup_detection_get_runtime_index_for_vid(u32 uVehicleId, u8* pPacketBu
    return iStatsIndex;
 }
 
+// Returns 1 if the received stream packet index means the stream was restarted on the other end of the link
+
+int _radio_dup_detection_is_stream_restarted(t_vehicle_history_packets_indexes* pDupInfo, int iRadioInterfaceIndex, u32 uStreamIndex, u32 uStreamPacketIndex, u32 uTimeNow)
+{
+   u32 uMaxDeltaForVideoStream = 2000;
+   u32 uMaxDeltaForDataStream = 50;
+   if ( hardware_radio_index_is_serial_radio(iRadioInterfaceIndex) )
+      uMaxDeltaForDataStream = 200;
+
+   if ( uStreamIndex >= STREAM_ID_VIDEO_1 )
+   if ( pDupInfo->streamsPacketsHistory[uStreamIndex].uMaxReceivedPacketIndex > uStreamPacketIndex + uMaxDeltaForVideoStream )
+      return 1;
+
+   if ( uStreamIndex < STREAM_ID_VIDEO_1 )
+   if ( pDupInfo->streamsPacketsHistory[uStreamIndex].uMaxReceivedPacketIndex > uStreamPacketIndex + uMaxDeltaForDataStream )
+      return 1;
+
+   if ( 0 != pDupInfo->streamsPacketsHistory[uStreamIndex].uLastTimeReceivedPacket )
+   if ( pDupInfo->streamsPacketsHistory[uStreamIndex].uLastTimeReceivedPacket < uTimeNow - 8000 )
+   if ( uStreamPacketIndex+10 < pDupInfo->streamsPacketsHistory[uStreamIndex].uMaxReceivedPacketIndex )
+      return 1;
+
+   return 0;
+}
+
+// Cheap pre-filter, done on the cleartext header fields before the packet is decrypted and CRC checked.
+// It does not change any state: a packet is a likely duplicate only if its stream packet index is
+// already in the received window of its stream and it would not trigger a stream restart.
+// Returns 1 if the packet is a likely duplicate
+
+int radio_dup_detection_is_likely_duplicate(int iRadioInterfaceIndex, u8* pPacketBuffer, int iPacketLength, u32 uTimeNow)
+{
+   if ( (NULL == pPacketBuffer) || (iPacketLength < (int)sizeof(t_packet_header)) )
+      return 0;
+
+   t_packet_header* pPH = (t_packet_header*)pPacketBuffer;
+   if ( (pPH->total_length < sizeof(t_packet_header)) || ((int)pPH->total_length > iPacketLength) )
+      return 0;
+   if ( (pPH->packet_type == PACKET_TYPE_RUBY_PING_CLOCK) || (pPH->packet_type == PACKET_TYPE_RUBY_PING_CLOCK_REPLY) )
+      return 0;
+
+   u32 uStreamPacketIndex = (pPH->stream_packet_idx) & PACKET_FLAGS_MASK_STREAM_PACKET_IDX;
+   u32 uStreamIndex = (pPH->stream_packet_idx)>>PACKET_FLAGS_MASK_SHIFT_STREAM_INDEX;
+   if ( uStreamIndex >= MAX_RADIO_STREAMS )
+      return 0;
+
+   t_vehicle_history_packets_indexes* pDupInfo = NULL;
+   for( int i=0; i<MAX_CONCURENT_VEHICLES; i++ )
+   {
+      if ( pPH->vehicle_id_src == s_ListHistoryRxPacketsVehicles[i].uVehicleId )
+      {
+         pDupInfo = &s_ListHistoryRxPacketsVehicles[i];
+         break;
+      }
+   }
+   if ( (NULL == pDupInfo) || (0 == pDupInfo->uVehicleId) )
+      return 0;
+
+   t_stream_history_packets_indexes* pStreamInfo = &(pDupInfo->streamsPacketsHistory[uStreamIndex]);
+   if ( uStreamPacketIndex != pStreamInfo->packetsHashIndexes[uStreamPacketIndex & PACKETS_INDEX_HASH_MASK] )
+      return 0;
+   if ( uStreamPacketIndex + PACKETS_INDEX_HASH_SIZE <= pStreamInfo->uMaxReceivedPacketIndex )
+      return 0;
+   if ( _radio_dup_detection_is_stream_restarted(pDupInfo, iRadioInterfaceIndex, uStreamIndex, uStreamPacketIndex, uTimeNow) )
+      return 0;
+   return 1;
+}
+
 // return 1 if packet is duplicate, 0 if it's not duplicate
 
 int radio_dup_detection_is_duplicate_on_stream(int iRadioInterfaceIndex, u8* pPacketBuffer, int iPacketLength, u32 uTimeNow)
@@ -220,7 +288,6 @@ int radio_dup_detection_is_duplicate_on_stream(int iRadioInterfaceIndex, u8* pPa
    
    static u32 s_TimeLastLogAlarmStreamPacketsVariation = 0;
 
-   u32 uMaxDeltaForVideoStream = 2000;
    u32 uMaxDeltaForDataStream = 50;
    if ( hardware_radio_index_is_serial_radio(iRadioInterfaceIndex) )
       uMaxDeltaForDataStream = 200;
@@ -241,20 +308,7 @@ int radio_dup_detection_is_duplicate_on_stream(int iRadioInterfaceIndex, u8* pPa
    // --------------------------------------------------------
    // Begin: Detect if stream restarted
 
-   int iStreamRestarted = 0;
-
-   if ( uStreamIndex >= STREAM_ID_VIDEO_1 )
-   if ( pDupInfo->streamsPacketsHistory[uStreamIndex].uMaxReceivedPacketIndex > uStreamPacketIndex + uMaxDeltaForVideoStream )
-      iStreamRestarted = 1;
-
-   if ( uStreamIndex < STREAM_ID_VIDEO_1 )
-   if ( pDupInfo->streamsPacketsHistory[uStreamIndex].uMaxReceivedPacketIndex > uStreamPacketIndex + uMaxDeltaForDataStream )
-      iStreamRestarted = 1;
-
-   if ( 0 != pDupInfo->streamsPacketsHistory[uStreamIndex].uLastTimeReceivedPacket )
-   if ( pDupInfo->streamsPacketsHistory[uStreamIndex].uLastTimeReceivedPacket < uTimeNow - 8000 )
-   if ( uStreamPacketIndex+10 < pDupInfo->streamsPacketsHistory[uStreamIndex].uMaxReceivedPacketIndex )
-      iStreamRestarted = 1;
+   int iStreamRestarted = _radio_dup_detection_is_stream_restarted(pDupInfo, iRadioInterfaceIndex, uStreamIndex, uStreamPacketIndex, uTimeNow);
 
    if ( iStreamRestarted )
    {
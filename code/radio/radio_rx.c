@@ -39,7 +39,8 @@
 #include "radio_rx.h"
 #include "radiolink.h"
 #include "radio_duplicate_det.h"
-#include <poll.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 
 int s_iRadioRxInitialized = 0;
 int s_iRadioRxSingalStop = 0;
@@ -79,8 +80,6 @@ int s_iRadioRxCountFDs = 0;
 int s_iRadioRxMaxFD = 0;
 struct timeval s_iRadioRxReadTimeInterval;
 
-u8 s_tmpLastProcessedRadioRxPacket[MAX_PACKET_TOTAL_SIZE];
-
 u32 s_uLastRxShortPacketsVehicleIds[MAX_RADIO_INTERFACES];
 
 // Pointers to array of int-s (max radio cards, for each card)
@@ -96,6 +95,19 @@ extern int s_iMutexRadioSyncRxTxThreadsInitialized;
 volatile int s_bHasPendingOperation = 0;
 volatile int s_bCanDoOperations = 0;
 
+// Persistent epoll set used by the rx thread. Interfaces are registered once, with their
+// interface index as the event data, and the set is only modified when an interface is
+// opened, paused, resumed or marked as broken. Registrations are keyed by fd and open id,
+// as a reopened interface can get back the same fd number. The eventfd wakes up the rx thread for
+// control operations (pause/resume, stop, broken state reset).
+#define RADIO_RX_EPOLL_ID_CONTROL 0xFFFF
+int s_iRadioRxEpollFd = -1;
+int s_iRadioRxEventFd = -1;
+int s_iRadioRxEpollRegisteredFds[MAX_RADIO_INTERFACES];
+u32 s_uRadioRxEpollRegisteredOpenIds[MAX_RADIO_INTERFACES];
+int s_iRadioRxEpollRegisteredCount = 0;
+volatile int s_iRadioRxEpollSetChanged = 1;
+
 extern u32 s_uLastRadioPingSentTime;
 extern u8 s_uLastRadioPingId;
 
@@ -219,6 +231,14 @@ int _radio_rx_update_local_stats_on_new_radio_packet(int iInterface, int iIsShor
    return nReturnLost;
 }
 
+// Early rejected duplicates are not counted as received, just keep the lost packets detection in sync
+void _radio_rx_update_local_stats_on_duplicate_radio_packet(int iInterface, u32 uVehicleId, u8* pPacket)
+{
+   t_radio_rx_state_vehicle* pStatsVehicle = _radio_rx_get_stats_structure_for_vehicle(uVehicleId);
+   t_packet_header* pPH = (t_packet_header*)pPacket;
+   pStatsVehicle->uLastRxRadioLinkPacketIndex[iInterface] = pPH->radio_link_packet_index;
+}
+
 void _radio_rx_update_fd_sets()
 {
    FD_ZERO(&s_RadioRxReadSet);
@@ -251,48 +271,126 @@ void _radio_rx_update_fd_sets()
 
 
 
+int _radio_rx_queue_get_count_packets(t_radio_rx_state_packets_queue* pQueue)
+{
+   int iWrite = __atomic_load_n(&pQueue->iCurrentPacketIndexToWrite, __ATOMIC_ACQUIRE);
+   int iConsume = __atomic_load_n(&pQueue->iCurrentPacketIndexToConsume, __ATOMIC_ACQUIRE);
+   int iCountPackets = iWrite - iConsume;
+   if ( iWrite < iConsume )
+      iCountPackets = iWrite + (pQueue->iQueueSize - iConsume);
+   return iCountPackets;
+}
+
+// Producer side. Returns the free slot the next packet will be added to, or NULL if the queue is full.
+// The slot can be filled in place and then published using _radio_rx_queue_commit_write_slot.
+u8* _radio_rx_queue_get_write_slot(t_radio_rx_state_packets_queue* pQueue)
+{
+   int iWrite = pQueue->iCurrentPacketIndexToWrite;
+   int iNext = iWrite + 1;
+   if ( iNext >= pQueue->iQueueSize )
+      iNext = 0;
+   if ( iNext == __atomic_load_n(&pQueue->iCurrentPacketIndexToConsume, __ATOMIC_ACQUIRE) )
+      return NULL;
+   return pQueue->pPacketsBuffers[iWrite];
+}
+
+void _radio_rx_queue_commit_write_slot(t_radio_rx_state_packets_queue* pQueue, int iLength, int iIsShort, int iRadioInterface)
+{
+   int iWrite = pQueue->iCurrentPacketIndexToWrite;
+   pQueue->uPacketsRxInterface[iWrite] = iRadioInterface;
+   pQueue->uPacketsAreShort[iWrite] = iIsShort;
+   pQueue->iPacketsLengths[iWrite] = iLength;
+
+   iWrite++;
+   if ( iWrite >= pQueue->iQueueSize )
+      iWrite = 0;
+
+   // Publish the slot to the consumer; the release store orders the slot content before the new index
+   __atomic_store_n(&pQueue->iCurrentPacketIndexToWrite, iWrite, __ATOMIC_RELEASE);
+
+   int iCountPackets = _radio_rx_queue_get_count_packets(pQueue);
+   if ( iCountPackets > pQueue->iStatsMaxPacketsInQueueLastMinute )
+      pQueue->iStatsMaxPacketsInQueueLastMinute = iCountPackets;
+   if ( iCountPackets > pQueue->iStatsMaxPacketsInQueue )
+      pQueue->iStatsMaxPacketsInQueue = iCountPackets;
+
+   // Wake up the consumer only if it is blocked waiting for packets (pairs with the fence in _radio_rx_wait_get_queue_packet)
+   __atomic_thread_fence(__ATOMIC_SEQ_CST);
+   if ( __atomic_load_n(&pQueue->iConsumerWaiting, __ATOMIC_RELAXED) )
+   {
+      pthread_mutex_lock(&pQueue->mutexWait);
+      pthread_cond_signal(&pQueue->condWait);
+      pthread_mutex_unlock(&pQueue->mutexWait);
+   }
+}
+
+// Consumer side. The returned buffer is the queue slot itself and stays valid until the next read from the same queue.
 u8* _radio_rx_wait_get_queue_packet(t_radio_rx_state_packets_queue* pQueue, int iHighPriorityQueue, u32 uTimeoutMicroSec, int* pLength, int* pIsShortPacket, int* pRadioInterfaceIndex)
 {
-   int iRes = -1;
+   int iIndexToConsume = pQueue->iCurrentPacketIndexToConsume;
 
-   if ( 0 == uTimeoutMicroSec )
+   // Give back to the producer the slot returned on the previous read
+   if ( pQueue->iPacketIndexHeldByConsumer >= 0 )
    {
-      iRes = sem_trywait(pQueue->pSemaphoreRead);
+      pQueue->iPacketIndexHeldByConsumer = -1;
+      iIndexToConsume++;
+      if ( iIndexToConsume >= pQueue->iQueueSize )
+         iIndexToConsume = 0;
+      __atomic_store_n(&pQueue->iCurrentPacketIndexToConsume, iIndexToConsume, __ATOMIC_RELEASE);
    }
-   else
+
+   if ( iIndexToConsume == __atomic_load_n(&pQueue->iCurrentPacketIndexToWrite, __ATOMIC_ACQUIRE) )
    {
+      if ( 0 == uTimeoutMicroSec )
+         return NULL;
+
       struct timespec ts;
-      clock_gettime(CLOCK_REALTIME, &ts);
-      ts.tv_nsec += 1000LL*(long long)uTimeoutMicroSec;
-      iRes = sem_timedwait(pQueue->pSemaphoreRead, &ts);
-   }
-   if ( 0 != iRes )
-      return NULL;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      ts.tv_sec += uTimeoutMicroSec / 1000000;
+      ts.tv_nsec += 1000L * (long)(uTimeoutMicroSec % 1000000);
+      if ( ts.tv_nsec >= 1000000000L )
+      {
+         ts.tv_sec++;
+         ts.tv_nsec -= 1000000000L;
+      }
 
-   int iIndexToCopy = 0;
+      pthread_mutex_lock(&pQueue->mutexWait);
+      __atomic_store_n(&pQueue->iConsumerWaiting, 1, __ATOMIC_RELAXED);
+      __atomic_thread_fence(__ATOMIC_SEQ_CST);
+      while ( iIndexToConsume == __atomic_load_n(&pQueue->iCurrentPacketIndexToWrite, __ATOMIC_ACQUIRE) )
+      {
+         if ( 0 != pthread_cond_timedwait(&pQueue->condWait, &pQueue->mutexWait, &ts) )
+            break;
+      }
+      __atomic_store_n(&pQueue->iConsumerWaiting, 0, __ATOMIC_RELAXED);
+      pthread_mutex_unlock(&pQueue->mutexWait);
 
-   iIndexToCopy = pQueue->iCurrentPacketIndexToConsume;
-   if ( (iIndexToCopy < 0) || (iIndexToCopy >= pQueue->iQueueSize) )
-      return NULL;
-   if ( (pQueue->iPacketsLengths[iIndexToCopy] <= 0) || (pQueue->iPacketsLengths[iIndexToCopy] > MAX_PACKET_TOTAL_SIZE) )
+      if ( iIndexToConsume == __atomic_load_n(&pQueue->iCurrentPacketIndexToWrite, __ATOMIC_ACQUIRE) )
+         return NULL;
+   }
+
+   if ( (iIndexToConsume < 0) || (iIndexToConsume >= pQueue->iQueueSize) )
       return NULL;
-   if ( NULL == pQueue->pPacketsBuffers[iIndexToCopy] )
+
+   // Skip invalid slots, they are never handed to the consumer
+   if ( (pQueue->iPacketsLengths[iIndexToConsume] <= 0) || (pQueue->iPacketsLengths[iIndexToConsume] > MAX_PACKET_TOTAL_SIZE) || (NULL == pQueue->pPacketsBuffers[iIndexToConsume]) )
+   {
+      iIndexToConsume++;
+      if ( iIndexToConsume >= pQueue->iQueueSize )
+         iIndexToConsume = 0;
+      __atomic_store_n(&pQueue->iCurrentPacketIndexToConsume, iIndexToConsume, __ATOMIC_RELEASE);
       return NULL;
+   }
 
    if ( NULL != pLength )
-      *pLength = pQueue->iPacketsLengths[iIndexToCopy];
+      *pLength = pQueue->iPacketsLengths[iIndexToConsume];
    if ( NULL != pIsShortPacket )
-      *pIsShortPacket = pQueue->uPacketsAreShort[iIndexToCopy];
+      *pIsShortPacket = pQueue->uPacketsAreShort[iIndexToConsume];
    if ( NULL != pRadioInterfaceIndex )
-      *pRadioInterfaceIndex = pQueue->uPacketsRxInterface[iIndexToCopy];
-
-   memcpy(s_tmpLastProcessedRadioRxPacket, pQueue->pPacketsBuffers[iIndexToCopy], pQueue->iPacketsLengths[iIndexToCopy]);
+      *pRadioInterfaceIndex = pQueue->uPacketsRxInterface[iIndexToConsume];
 
-   pQueue->iCurrentPacketIndexToConsume++;
-   if ( pQueue->iCurrentPacketIndexToConsume >= pQueue->iQueueSize )
-      pQueue->iCurrentPacketIndexToConsume = 0;
-
-   return s_tmpLastProcessedRadioRxPacket;
+   pQueue->iPacketIndexHeldByConsumer = iIndexToConsume;
+   return pQueue->pPacketsBuffers[iIndexToConsume];
 }
 
 u8* radio_rx_wait_get_next_received_high_prio_packet(u32 uTimeoutMicroSec, int* pLength, int* pIsShortPacket, int* pRadioInterfaceIndex)
@@ -323,6 +421,8 @@ u8* radio_rx_wait_get_next_received_reg_prio_packet(u32 uTimeoutMicroSec, int* p
    return _radio_rx_wait_get_queue_packet(&(s_RadioRxState.queue_reg_priority), 0, uTimeoutMicroSec, pLength, pIsShortPacket, pRadioInterfaceIndex);
 }
 
+// If pPacket is the free write slot of the destination queue (it was received in place), the packet is just published, without any copy
+
 void _radio_rx_add_packet_to_rx_queue(u8* pPacket, int iLength, int iRadioInterface)
 {
    if ( (NULL == pPacket) || (iLength <= 0) || s_iRadioRxMarkedForQuit )
@@ -330,7 +430,6 @@ void _radio_rx_add_packet_to_rx_queue(u8* pPacket, int iLength, int iRadioInterf
 
    t_packet_header* pPH = (t_packet_header*)pPacket;
    u8 uPacketFlags = pPH->packet_flags;
-   u8 uPacketType = pPH->packet_type;
 
    pPH->uCRC = s_uRadioRxTimeNow;
 
@@ -339,48 +438,42 @@ void _radio_rx_add_packet_to_rx_queue(u8* pPacket, int iLength, int iRadioInterf
       pQueue = &s_RadioRxState.queue_high_priority;
 
    // No more room? Discard it
-   if ( ((pQueue->iCurrentPacketIndexToWrite+1) % pQueue->iQueueSize) == (pQueue->iCurrentPacketIndexToConsume % pQueue->iQueueSize) )
+   u8* pSlot = _radio_rx_queue_get_write_slot(pQueue);
+   if ( NULL == pSlot )
    {
+      pQueue->uStatsDroppedPackets++;
       //s_uRadioRxLastTimeQueue += get_current_timestamp_ms() - s_uRadioRxTimeNow;
       return;
    }
 
-   // Add the packet to the queue
-   pQueue->uPacketsRxInterface[pQueue->iCurrentPacketIndexToWrite] = iRadioInterface;
-   pQueue->uPacketsAreShort[pQueue->iCurrentPacketIndexToWrite] = 0;
-   pQueue->iPacketsLengths[pQueue->iCurrentPacketIndexToWrite] = iLength;
-   memcpy(pQueue->pPacketsBuffers[pQueue->iCurrentPacketIndexToWrite], pPacket, iLength);
-      
-   pQueue->iCurrentPacketIndexToWrite++;
-   if ( pQueue->iCurrentPacketIndexToWrite >= pQueue->iQueueSize )
-      pQueue->iCurrentPacketIndexToWrite = 0;
-
-   int iCountPackets = pQueue->iCurrentPacketIndexToWrite - pQueue->iCurrentPacketIndexToConsume;
-   if ( pQueue->iCurrentPacketIndexToWrite < pQueue->iCurrentPacketIndexToConsume )
-      iCountPackets = pQueue->iCurrentPacketIndexToWrite + (pQueue->iQueueSize - pQueue->iCurrentPacketIndexToConsume);
-
-   if ( iCountPackets > pQueue->iStatsMaxPacketsInQueueLastMinute )
-      pQueue->iStatsMaxPacketsInQueueLastMinute = iCountPackets;
-   if ( iCountPackets > pQueue->iStatsMaxPacketsInQueue )
-      pQueue->iStatsMaxPacketsInQueue = iCountPackets;
-
-   if ( NULL != pQueue->pSemaphoreWrite )
+   if ( pSlot != pPacket )
    {
-      if ( 0 != sem_post(pQueue->pSemaphoreWrite) )
-         log_softerror_and_alarm("Failed to set semaphore for packet ready.");
+      if ( iLength > MAX_PACKET_TOTAL_SIZE )
+      {
+         pQueue->uStatsDroppedPackets++;
+         return;
+      }
+      memcpy(pSlot, pPacket, iLength);
    }
+   _radio_rx_queue_commit_write_slot(pQueue, iLength, 0, iRadioInterface);
    //s_uRadioRxLastTimeQueue += get_current_timestamp_ms() - s_uRadioRxTimeNow;
 }
 
-void _radio_rx_check_add_packet_to_rx_queue(u8* pPacket, int iLength, int iRadioInterfaceIndex)
+// Returns 1 if the packet is unique and must be added to the rx queue
+int _radio_rx_check_unique_packet(u8* pPacket, int iLength, int iRadioInterfaceIndex)
 {
    if ( radio_dup_detection_is_duplicate_on_stream(iRadioInterfaceIndex, pPacket, iLength, s_uRadioRxTimeNow) )
-      return;
+      return 0;
 
    if ( NULL != s_pSMRadioStats )
      radio_stats_update_on_unique_packet_received(s_pSMRadioStats, s_uRadioRxTimeNow, iRadioInterfaceIndex, pPacket, iLength);
+   return 1;
+}
 
-   _radio_rx_add_packet_to_rx_queue(pPacket, iLength, iRadioInterfaceIndex);
+void _radio_rx_check_add_packet_to_rx_queue(u8* pPacket, int iLength, int iRadioInterfaceIndex)
+{
+   if ( _radio_rx_check_unique_packet(pPacket, iLength, iRadioInterfaceIndex) )
+      _radio_rx_add_packet_to_rx_queue(pPacket, iLength, iRadioInterfaceIndex);
 }
 
 
@@ -584,8 +677,11 @@ int _radio_rx_parse_received_wifi_radio_data(int iInterfaceIndex, int iMaxReads)
 
    for( int iCountReads=0; iCountReads<iMaxReads; iCountReads++ )
    {
+      // Receive directly into the next free slot of the regular priority queue (most of the traffic);
+      // if the queue is full, or it's a high priority packet, it gets copied or discarded when added to the queues.
       iBufferLength = 0;
-      pPacketBuffer = radio_process_wlan_data_in(iInterfaceIndex, &iBufferLength, s_uRadioRxTimeNow);
+      u8* pFreeSlot = _radio_rx_queue_get_write_slot(&s_RadioRxState.queue_reg_priority);
+      pPacketBuffer = radio_process_wlan_data_in_to_buffer(iInterfaceIndex, &iBufferLength, s_uRadioRxTimeNow, pFreeSlot, (NULL != pFreeSlot)?MAX_PACKET_TOTAL_SIZE:0);
       if ( NULL == pPacketBuffer )
          break;
 
@@ -638,6 +734,18 @@ int _radio_rx_parse_received_wifi_radio_data(int iInterfaceIndex, int iMaxReads)
          }
       }
       */
+      // With several rx cards most packets are received more than once. Reject the copies of
+      // packets already received using just the cleartext header, before decrypting and checking the CRC.
+      // They are not validated, so they are not counted as good rx packets, only as duplicates.
+      if ( radio_dup_detection_is_likely_duplicate(iInterfaceIndex, pPacketBuffer, iBufferLength, s_uRadioRxTimeNow) )
+      {
+         s_RadioRxState.uStatsEarlyRejectedDuplicates++;
+         _radio_rx_update_local_stats_on_duplicate_radio_packet(iInterfaceIndex, uVehicleId, pPacketBuffer);
+         if ( NULL != s_pSMRadioStats )
+            radio_stats_update_on_duplicate_packet_received(s_pSMRadioStats, s_uRadioRxTimeNow, iInterfaceIndex, pPacketBuffer, iBufferLength);
+         continue;
+      }
+
       int bCRCOk = 0;
       int iPacketLength = packet_process_and_check(iInterfaceIndex, pPacketBuffer, iBufferLength, &bCRCOk);
 
@@ -657,7 +765,7 @@ int _radio_rx_parse_received_wifi_radio_data(int iInterfaceIndex, int iMaxReads)
          continue;
       }
 
-      _radio_rx_check_add_packet_to_rx_queue(pPacketBuffer, iPacketLength, iInterfaceIndex);
+      int bIsUniquePacket = _radio_rx_check_unique_packet(pPacketBuffer, iPacketLength, iInterfaceIndex);
 
       if ( NULL != s_pRxAirGapTracking )
       {
@@ -681,6 +789,10 @@ int _radio_rx_parse_received_wifi_radio_data(int iInterfaceIndex, int iMaxReads)
       }
       if ( NULL != s_pSMRadioStats )
          radio_stats_update_on_new_radio_packet_received(s_pSMRadioStats, s_uRadioRxTimeNow, iInterfaceIndex, pPacketBuffer, iBufferLength, 0, iDataIsOk);
+
+      // Add it to the rx queues last: once added, the buffer belongs to the consumer
+      if ( bIsUniquePacket )
+         _radio_rx_add_packet_to_rx_queue(pPacketBuffer, iPacketLength, iInterfaceIndex);
    }
 
    if ( iReturn < 0 )
@@ -749,16 +861,14 @@ void _radio_rx_update_stats(u32 uTimeNow)
       s_RadioRxState.queue_high_priority.iStatsMaxPacketsInQueueLastMinute = 0;
       s_RadioRxState.queue_reg_priority.iStatsMaxPacketsInQueueLastMinute = 0;
 
-      int iCountPacketsHigh = s_RadioRxState.queue_high_priority.iCurrentPacketIndexToWrite - s_RadioRxState.queue_high_priority.iCurrentPacketIndexToConsume;
-      if ( s_RadioRxState.queue_high_priority.iCurrentPacketIndexToWrite < s_RadioRxState.queue_high_priority.iCurrentPacketIndexToConsume )
-         iCountPacketsHigh = s_RadioRxState.queue_high_priority.iCurrentPacketIndexToWrite + (s_RadioRxState.queue_high_priority.iQueueSize - s_RadioRxState.queue_high_priority.iCurrentPacketIndexToConsume);
+      int iCountPacketsHigh = _radio_rx_queue_get_count_packets(&s_RadioRxState.queue_high_priority);
+      int iCountPacketsReg = _radio_rx_queue_get_count_packets(&s_RadioRxState.queue_reg_priority);
 
-      int iCountPacketsReg = s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToWrite - s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToConsume;
-      if ( s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToWrite < s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToConsume )
-         iCountPacketsReg = s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToWrite + (s_RadioRxState.queue_reg_priority.iQueueSize - s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToConsume);
-
-      log_line("[RadioRxThread] Packets in queues now pending consumption (high/reg prio): %d/%d",
-         iCountPacketsHigh, iCountPacketsReg);
+      log_line("[RadioRxThread] Packets in queues now pending consumption (high/reg prio): %d/%d, total dropped on full queues: %u/%u",
+         iCountPacketsHigh, iCountPacketsReg,
+         s_RadioRxState.queue_high_priority.uStatsDroppedPackets,
+         s_RadioRxState.queue_reg_priority.uStatsDroppedPackets);
+      log_line("[RadioRxThread] Total duplicate packets rejected before decryption/CRC check: %u", s_RadioRxState.uStatsEarlyRejectedDuplicates);
 
       if ( (s_iCounterRadioRxStatsUpdate2 % 10) == 0 )
       {
@@ -788,6 +898,131 @@ void _radio_rx_update_stats(u32 uTimeNow)
    }
 }
 
+void _radio_rx_signal_control_event()
+{
+   if ( s_iRadioRxEventFd < 0 )
+      return;
+   eventfd_t uValue = 1;
+   if ( sizeof(uValue) != write(s_iRadioRxEventFd, &uValue, sizeof(uValue)) )
+   {
+      // Counter is already signaled, rx thread will wake up anyway
+   }
+}
+
+void _radio_rx_mark_interface_broken(int iInterfaceIndex)
+{
+   s_RadioRxState.iRadioInterfacesBroken[iInterfaceIndex] = 1;
+   s_iRadioRxEpollSetChanged = 1;
+}
+
+int _radio_rx_epoll_init()
+{
+   if ( s_iRadioRxEpollFd < 0 )
+   {
+      s_iRadioRxEpollFd = epoll_create1(EPOLL_CLOEXEC);
+      if ( s_iRadioRxEpollFd < 0 )
+      {
+         log_error_and_alarm("[RadioRx] Failed to create epoll set, error: %d (%s)", errno, strerror(errno));
+         return 0;
+      }
+   }
+   else
+   {
+      // Restarted rx thread: drop any registrations left over from the previous run
+      for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+      {
+         if ( s_iRadioRxEpollRegisteredFds[i] >= 0 )
+            epoll_ctl(s_iRadioRxEpollFd, EPOLL_CTL_DEL, s_iRadioRxEpollRegisteredFds[i], NULL);
+      }
+   }
+
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+   {
+      s_iRadioRxEpollRegisteredFds[i] = -1;
+      s_uRadioRxEpollRegisteredOpenIds[i] = 0;
+   }
+   s_iRadioRxEpollRegisteredCount = 0;
+   s_iRadioRxEpollSetChanged = 1;
+
+   if ( s_iRadioRxEventFd < 0 )
+   {
+      s_iRadioRxEventFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+      if ( s_iRadioRxEventFd < 0 )
+      {
+         log_error_and_alarm("[RadioRx] Failed to create control eventfd, error: %d (%s)", errno, strerror(errno));
+         return 0;
+      }
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.u32 = RADIO_RX_EPOLL_ID_CONTROL;
+      if ( 0 != epoll_ctl(s_iRadioRxEpollFd, EPOLL_CTL_ADD, s_iRadioRxEventFd, &event) )
+      {
+         log_error_and_alarm("[RadioRx] Failed to add control eventfd to epoll set, error: %d (%s)", errno, strerror(errno));
+         close(s_iRadioRxEventFd);
+         s_iRadioRxEventFd = -1;
+         return 0;
+      }
+   }
+   return 1;
+}
+
+// Brings the epoll set in sync with the current opened/paused/broken state of the interfaces.
+// Only issues epoll_ctl calls for interfaces whose state changed.
+void _radio_rx_epoll_update_set()
+{
+   s_iRadioRxEpollSetChanged = 0;
+   s_iRadioRxEpollRegisteredCount = 0;
+
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+   {
+      int iFd = -1;
+      u32 uOpenId = 0;
+      radio_hw_info_t* pRadioHWInfo = NULL;
+      if ( i < hardware_get_radio_interfaces_count() )
+         pRadioHWInfo = hardware_get_radio_info(i);
+      if ( (NULL != pRadioHWInfo) && pRadioHWInfo->openedForRead )
+      if ( (! s_RadioRxState.iRadioInterfacesBroken[i]) && (! s_iRadioRxPausedInterfaces[i]) )
+      {
+         iFd = pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd;
+         uOpenId = pRadioHWInfo->runtimeInterfaceInfoRx.uOpenId;
+      }
+
+      if ( (iFd == s_iRadioRxEpollRegisteredFds[i]) && ((iFd < 0) || (uOpenId == s_uRadioRxEpollRegisteredOpenIds[i])) )
+      {
+         if ( iFd >= 0 )
+            s_iRadioRxEpollRegisteredCount++;
+         continue;
+      }
+
+      // Fd might be already closed (and so auto removed from the set), ignore errors
+      if ( s_iRadioRxEpollRegisteredFds[i] >= 0 )
+         epoll_ctl(s_iRadioRxEpollFd, EPOLL_CTL_DEL, s_iRadioRxEpollRegisteredFds[i], NULL);
+      s_iRadioRxEpollRegisteredFds[i] = -1;
+      s_uRadioRxEpollRegisteredOpenIds[i] = 0;
+
+      if ( iFd < 0 )
+         continue;
+
+      struct epoll_event event;
+      memset(&event, 0, sizeof(event));
+      event.events = EPOLLIN;
+      event.data.u32 = (u32)i;
+      int iRes = epoll_ctl(s_iRadioRxEpollFd, EPOLL_CTL_ADD, iFd, &event);
+      if ( (0 != iRes) && (errno == EEXIST) )
+         iRes = epoll_ctl(s_iRadioRxEpollFd, EPOLL_CTL_MOD, iFd, &event);
+      if ( 0 != iRes )
+      {
+         log_softerror_and_alarm("[RadioRxThread] Failed to add radio interface %d (fd %d) to epoll set, error: %d (%s). Mark it as broken.", i+1, iFd, errno, strerror(errno));
+         s_RadioRxState.iRadioInterfacesBroken[i] = 1;
+         continue;
+      }
+      s_iRadioRxEpollRegisteredFds[i] = iFd;
+      s_uRadioRxEpollRegisteredOpenIds[i] = uOpenId;
+      s_iRadioRxEpollRegisteredCount++;
+   }
+}
+
 void * _thread_radio_rx(void *argument)
 {
    log_line("[RadioRxThread] Started.");
@@ -901,55 +1136,59 @@ void * _thread_radio_rx(void *argument)
          }
       }
 
-      iLoopParsedPackets = 0;
-      struct pollfd fds[MAX_RADIO_INTERFACES];
-      s_iRadioRxCountFDs = 0;
-      for( int i=0; i<hardware_get_radio_interfaces_count(); i++ )
-      {
-         radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(i);
-         if ( (NULL == pRadioHWInfo) || (! pRadioHWInfo->openedForRead) )
-            continue;
-         if ( s_RadioRxState.iRadioInterfacesBroken[i] )
-            continue;
-         if ( s_iRadioRxPausedInterfaces[i] )
-            continue;
-         fds[s_iRadioRxCountFDs].fd = pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd;
-         fds[s_iRadioRxCountFDs].revents = 0;
-         fds[s_iRadioRxCountFDs].events = POLLIN;
-         s_iRadioRxCountFDs++;
-      }
-
-      if ( s_iRadioRxCountFDs <= 0 )
-      {
-         hardware_sleep_ms(5);
-         s_uRadioRxTimeNow = get_current_timestamp_ms();
-         uTimeReadSignaled = s_uRadioRxTimeNow;
-         continue;
-      }
+      if ( s_iRadioRxEpollSetChanged || (0 == (iLoopCounter % 20)) )
+         _radio_rx_epoll_update_set();
 
-      //int nResult = select(s_iRadioRxMaxFD, &s_RadioRxReadSet, NULL, NULL, &s_iRadioRxReadTimeInterval);
-      int nResult = poll(fds, s_iRadioRxCountFDs, iPollTimeoutMs);
+      iLoopParsedPackets = 0;
+      struct epoll_event events[MAX_RADIO_INTERFACES+1];
+      int nResult = epoll_wait(s_iRadioRxEpollFd, events, MAX_RADIO_INTERFACES+1, (s_iRadioRxEpollRegisteredCount > 0)?iPollTimeoutMs:5);
       s_uRadioRxTimeNow = get_current_timestamp_ms();
       uTimeReadSignaled = s_uRadioRxTimeNow;
       s_uRadioRxLastTimeQueue = 0;
 
       if ( nResult < 0 )
       {
-         log_line("[RadioRxThread] Radio interfaces have broken up. Exception on select read radio handle.");
+         if ( errno == EINTR )
+            continue;
+         log_line("[RadioRxThread] Radio interfaces have broken up. Exception on epoll wait, error: %d (%s).", errno, strerror(errno));
          for( int i=0; i<hardware_get_radio_interfaces_count(); i++ )
          {
             radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(i);
             if ( (NULL != pRadioHWInfo) && pRadioHWInfo->openedForRead )
-               s_RadioRxState.iRadioInterfacesBroken[i] = 1;
+               _radio_rx_mark_interface_broken(i);
          }
+         continue;
       }
 
-      if ( nResult <= 0 )
+      // Map the ready events to interfaces, the interface index is the event data
+      int iReadyInterfaces[MAX_RADIO_INTERFACES];
+      int iCountReadyInterfaces = 0;
+      for( int i=0; i<nResult; i++ )
       {
-         hardware_sleep_micros(500);
-         continue;
+         u32 uId = events[i].data.u32;
+         if ( uId == RADIO_RX_EPOLL_ID_CONTROL )
+         {
+            eventfd_t uValue = 0;
+            if ( sizeof(uValue) != read(s_iRadioRxEventFd, &uValue, sizeof(uValue)) )
+            {
+               // Nothing pending anymore
+            }
+            continue;
+         }
+         if ( uId >= MAX_RADIO_INTERFACES )
+            continue;
+         if ( events[i].events & EPOLLIN )
+            iReadyInterfaces[iCountReadyInterfaces++] = (int)uId;
+         else if ( events[i].events & (EPOLLERR | EPOLLHUP) )
+         {
+            log_line("[RadioRx] Mark radio interface %d as broken (error/hangup on its fd)", uId+1);
+            _radio_rx_mark_interface_broken((int)uId);
+         }
       }
 
+      if ( 0 == iCountReadyInterfaces )
+         continue;
+
       // Received data, process it
       int iMaxRepeatCount = 3;
       int iMaxedInterface = -1;
@@ -980,29 +1219,10 @@ void * _thread_radio_rx(void *argument)
       {
          iMaxRepeatCount--;
          iMaxedInterface = -1;
-         for(int iPollIndex=0; iPollIndex < s_iRadioRxCountFDs; iPollIndex++)
+         for(int iReadyIndex=0; iReadyIndex < iCountReadyInterfaces; iReadyIndex++)
          {
-            if ( 0 == (fds[iPollIndex].revents & POLLIN) )
-               continue;
-
-            int iInterfaceIndex = -1;
-            for( int i=0; i<hardware_get_radio_interfaces_count(); i++ )
-            {
-               radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(i);
-               if ( (NULL == pRadioHWInfo) || (! pRadioHWInfo->openedForRead) )
-                  continue;
-               if ( s_RadioRxState.iRadioInterfacesBroken[i] )
-                  continue;
-               if ( s_iRadioRxPausedInterfaces[i] )
-                  continue;
-               if ( fds[iPollIndex].fd == pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd )
-               {
-                  iInterfaceIndex = i;
-                  break;
-               }
-            }
-
-            if ( iInterfaceIndex == -1 )
+            int iInterfaceIndex = iReadyInterfaces[iReadyIndex];
+            if ( (iInterfaceIndex < 0) || (iInterfaceIndex >= iInterfacesCount) )
                continue;
 
             radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(iInterfaceIndex);
@@ -1012,9 +1232,6 @@ void * _thread_radio_rx(void *argument)
                continue;
             if ( s_iRadioRxPausedInterfaces[iInterfaceIndex] )
                continue;
-            //if( 0 == FD_ISSET(pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd, &s_RadioRxReadSet) )
-            //   continue;
-
             if ( iParsedPackets[iInterfaceIndex] <= 0 )
                continue;
 
@@ -1024,16 +1241,21 @@ void * _thread_radio_rx(void *argument)
                if ( iParsedPackets[iInterfaceIndex] < 0 )
                {
                   log_line("[RadioRx] Mark serial radio interface %d as broken", iInterfaceIndex+1);
-                  s_RadioRxState.iRadioInterfacesBroken[iInterfaceIndex] = 1;
+                  _radio_rx_mark_interface_broken(iInterfaceIndex);
                }
             }
             else
             {
-               iParsedPackets[iInterfaceIndex] = _radio_rx_parse_received_wifi_radio_data(iInterfaceIndex, 3);
+               // On mmap rx rings, consume the frames already waiting in the ring on this wakeup
+               int iMaxReads = 3;
+               int iPendingFrames = radio_get_rx_pending_frames(iInterfaceIndex);
+               if ( iPendingFrames > iMaxReads )
+                  iMaxReads = iPendingFrames;
+               iParsedPackets[iInterfaceIndex] = _radio_rx_parse_received_wifi_radio_data(iInterfaceIndex, iMaxReads);
                if ( (iParsedPackets[iInterfaceIndex] < 0) || ( radio_get_last_read_error_code() == RADIO_READ_ERROR_INTERFACE_BROKEN ) )
                {
                   log_line("[RadioRx] Mark radio interface %d as broken", iInterfaceIndex+1);
-                  s_RadioRxState.iRadioInterfacesBroken[iInterfaceIndex] = 1;
+                  _radio_rx_mark_interface_broken(iInterfaceIndex);
                   continue;
                }
                iLoopParsedPackets += iParsedPackets[iInterfaceIndex];
@@ -1050,6 +1272,53 @@ void * _thread_radio_rx(void *argument)
    return NULL;
 }
 
+// Packets buffers are allocated once, as one block, and reused if the rx thread is restarted
+int _radio_rx_init_packets_queue(t_radio_rx_state_packets_queue* pQueue)
+{
+   static int s_iRadioRxQueuesSyncInitialized = 0;
+   if ( ! s_iRadioRxQueuesSyncInitialized )
+   {
+      pthread_condattr_t attr;
+      pthread_condattr_init(&attr);
+      pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+      pthread_mutex_init(&s_RadioRxState.queue_high_priority.mutexWait, NULL);
+      pthread_cond_init(&s_RadioRxState.queue_high_priority.condWait, &attr);
+      pthread_mutex_init(&s_RadioRxState.queue_reg_priority.mutexWait, NULL);
+      pthread_cond_init(&s_RadioRxState.queue_reg_priority.condWait, &attr);
+      pthread_condattr_destroy(&attr);
+      s_iRadioRxQueuesSyncInitialized = 1;
+   }
+
+   pQueue->iQueueSize = MAX_RX_PACKETS_QUEUE;
+   if ( NULL == pQueue->pPacketsBuffers[0] )
+   {
+      u8* pBuffers = (u8*) malloc(pQueue->iQueueSize * MAX_PACKET_TOTAL_SIZE);
+      if ( NULL == pBuffers )
+      {
+         log_error_and_alarm("[RadioRx] Failed to allocate rx packets buffers!");
+         return 0;
+      }
+      for( int i=0; i<pQueue->iQueueSize; i++ )
+         pQueue->pPacketsBuffers[i] = pBuffers + i * MAX_PACKET_TOTAL_SIZE;
+   }
+
+   for( int i=0; i<pQueue->iQueueSize; i++ )
+   {
+      pQueue->iPacketsLengths[i] = 0;
+      pQueue->uPacketsAreShort[i] = 0;
+      pQueue->uPacketsRxInterface[i] = 0;
+   }
+
+   pQueue->iCurrentPacketIndexToConsume = 0;
+   pQueue->iCurrentPacketIndexToWrite = 0;
+   pQueue->iPacketIndexHeldByConsumer = -1;
+   pQueue->iConsumerWaiting = 0;
+   pQueue->iStatsMaxPacketsInQueue = 0;
+   pQueue->iStatsMaxPacketsInQueueLastMinute = 0;
+   pQueue->uStatsDroppedPackets = 0;
+   return 1;
+}
+
 int radio_rx_start_rx_thread(shared_mem_radio_stats* pSMRadioStats, int iSearchMode, u32 uAcceptedFirmwareType)
 {
    if ( s_iRadioRxInitialized )
@@ -1066,109 +1335,16 @@ int radio_rx_start_rx_thread(shared_mem_radio_stats* pSMRadioStats, int iSearchM
 
    s_iRadioRxAllInterfacesPaused = 0;
 
-   s_RadioRxState.queue_reg_priority.iQueueSize = MAX_RX_PACKETS_QUEUE;
-   s_RadioRxState.queue_high_priority.iQueueSize = MAX_RX_PACKETS_QUEUE;
-
-   for( int i=0; i<s_RadioRxState.queue_reg_priority.iQueueSize; i++ )
-   {
-      s_RadioRxState.queue_reg_priority.iPacketsLengths[i] = 0;
-      s_RadioRxState.queue_reg_priority.uPacketsAreShort[i] = 0;
-      s_RadioRxState.queue_reg_priority.uPacketsRxInterface[i] = 0;
-      s_RadioRxState.queue_reg_priority.pPacketsBuffers[i] = (u8*) malloc(MAX_PACKET_TOTAL_SIZE);
-      if ( NULL == s_RadioRxState.queue_reg_priority.pPacketsBuffers[i] )
-      {
-         log_error_and_alarm("[RadioRx] Failed to allocate rx packets buffers!");
-         return 0;
-      }
-   }
+   if ( ! _radio_rx_init_packets_queue(&s_RadioRxState.queue_reg_priority) )
+      return 0;
    log_line("[RadioRx] Allocated %u bytes for %d rx packets (reg priority)", s_RadioRxState.queue_reg_priority.iQueueSize * MAX_PACKET_TOTAL_SIZE, s_RadioRxState.queue_reg_priority.iQueueSize);
 
-   for( int i=0; i<s_RadioRxState.queue_high_priority.iQueueSize; i++ )
-   {
-      s_RadioRxState.queue_high_priority.iPacketsLengths[i] = 0;
-      s_RadioRxState.queue_high_priority.uPacketsAreShort[i] = 0;
-      s_RadioRxState.queue_high_priority.uPacketsRxInterface[i] = 0;
-      s_RadioRxState.queue_high_priority.pPacketsBuffers[i] = (u8*) malloc(MAX_PACKET_TOTAL_SIZE);
-      if ( NULL == s_RadioRxState.queue_high_priority.pPacketsBuffers[i] )
-      {
-         log_error_and_alarm("[RadioRx] Failed to allocate rx packets buffers!");
-         return 0;
-      }
-   }
+   if ( ! _radio_rx_init_packets_queue(&s_RadioRxState.queue_high_priority) )
+      return 0;
    log_line("[RadioRx] Allocated %u bytes for %d rx packets (high priority)", s_RadioRxState.queue_high_priority.iQueueSize * MAX_PACKET_TOTAL_SIZE, s_RadioRxState.queue_high_priority.iQueueSize);
 
-   s_RadioRxState.queue_high_priority.iCurrentPacketIndexToConsume = 0;
-   s_RadioRxState.queue_high_priority.iCurrentPacketIndexToWrite = 0;
-   s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToConsume = 0;
-   s_RadioRxState.queue_reg_priority.iCurrentPacketIndexToWrite = 0;
-   
-   s_RadioRxState.queue_high_priority.iStatsMaxPacketsInQueue = 0;
-   s_RadioRxState.queue_high_priority.iStatsMaxPacketsInQueueLastMinute = 0;
-   s_RadioRxState.queue_reg_priority.iStatsMaxPacketsInQueue = 0;
-   s_RadioRxState.queue_reg_priority.iStatsMaxPacketsInQueueLastMinute = 0;
-
    s_RadioRxState.uTimeLastStatsUpdate = get_current_timestamp_ms();
    s_RadioRxState.uTimeLastMinuteStatsUpdate = get_current_timestamp_ms();
-   
-   sem_unlink(RUBY_SEM_RX_RADIO_HIGH_PRIORITY);
-   sem_unlink(RUBY_SEM_RX_RADIO_REG_PRIORITY);
-
-   s_RadioRxState.queue_high_priority.pSemaphoreWrite = sem_open(RUBY_SEM_RX_RADIO_HIGH_PRIORITY, O_CREAT | O_RDWR, S_IWUSR | S_IRUSR, 0);
-   if ( (NULL == s_RadioRxState.queue_high_priority.pSemaphoreWrite) || (SEM_FAILED == s_RadioRxState.queue_high_priority.pSemaphoreWrite) )
-   {
-      log_error_and_alarm("[RadioRx] Failed to create write semaphore: %s, try alternative.", RUBY_SEM_RX_RADIO_HIGH_PRIORITY);
-      s_RadioRxState.queue_high_priority.pSemaphoreWrite = sem_open(RUBY_SEM_RX_RADIO_HIGH_PRIORITY, O_CREAT, S_IWUSR | S_IRUSR, 0); 
-      if ( (NULL == s_RadioRxState.queue_high_priority.pSemaphoreWrite) || (SEM_FAILED == s_RadioRxState.queue_high_priority.pSemaphoreWrite) )
-      {
-         log_error_and_alarm("[RadioRx] Failed to create write semaphore: %s", RUBY_SEM_RX_RADIO_HIGH_PRIORITY);
-         return 0;
-      }
-   }
-   s_RadioRxState.queue_high_priority.pSemaphoreRead = sem_open(RUBY_SEM_RX_RADIO_HIGH_PRIORITY, O_RDWR);
-   if ( (NULL == s_RadioRxState.queue_high_priority.pSemaphoreRead) || (SEM_FAILED == s_RadioRxState.queue_high_priority.pSemaphoreRead) )
-   {
-      log_error_and_alarm("[RadioRx] Failed to create read semaphore: %s, try alternative.", RUBY_SEM_RX_RADIO_HIGH_PRIORITY);
-      s_RadioRxState.queue_high_priority.pSemaphoreRead = sem_open(RUBY_SEM_RX_RADIO_HIGH_PRIORITY, O_CREAT, S_IWUSR | S_IRUSR, 0); 
-      if ( (NULL == s_RadioRxState.queue_high_priority.pSemaphoreRead) || (SEM_FAILED == s_RadioRxState.queue_high_priority.pSemaphoreRead) )
-      {
-         log_error_and_alarm("[RadioRx] Failed to create read semaphore: %s", RUBY_SEM_RX_RADIO_HIGH_PRIORITY);
-         return 0;
-      }
-   }
-   int iSemVal = 0;
-   if ( 0 == sem_getvalue(s_RadioRxState.queue_high_priority.pSemaphoreRead, &iSemVal) )
-      log_line("[RadioRx] High priority queue semaphore initial value: %d", iSemVal);
-   else
-      log_softerror_and_alarm("[RadioRx] Failed to get high priority queue sem value.");
-
-   s_RadioRxState.queue_reg_priority.pSemaphoreWrite = sem_open(RUBY_SEM_RX_RADIO_REG_PRIORITY, O_CREAT | O_RDWR, S_IWUSR | S_IRUSR, 0);
-   if ( (NULL == s_RadioRxState.queue_reg_priority.pSemaphoreWrite) || (SEM_FAILED == s_RadioRxState.queue_reg_priority.pSemaphoreWrite) )
-   {
-      log_error_and_alarm("[RadioRx] Failed to create write semaphore: %s, try alternative.", RUBY_SEM_RX_RADIO_REG_PRIORITY);
-      s_RadioRxState.queue_reg_priority.pSemaphoreWrite = sem_open(RUBY_SEM_RX_RADIO_REG_PRIORITY, O_CREAT, S_IWUSR | S_IRUSR, 0); 
-      if ( (NULL == s_RadioRxState.queue_reg_priority.pSemaphoreWrite) || (SEM_FAILED == s_RadioRxState.queue_reg_priority.pSemaphoreWrite) )
-      {
-         log_error_and_alarm("[RadioRx] Failed to create write semaphore: %s", RUBY_SEM_RX_RADIO_REG_PRIORITY);
-         return 0;
-      }
-   }
-   s_RadioRxState.queue_reg_priority.pSemaphoreRead = sem_open(RUBY_SEM_RX_RADIO_REG_PRIORITY, O_RDWR);
-   if ( (NULL == s_RadioRxState.queue_reg_priority.pSemaphoreRead) || (SEM_FAILED == s_RadioRxState.queue_reg_priority.pSemaphoreRead) )
-   {
-      log_error_and_alarm("[RadioRx] Failed to create read semaphore: %s, try alternative", RUBY_SEM_RX_RADIO_REG_PRIORITY);
-      s_RadioRxState.queue_reg_priority.pSemaphoreRead = sem_open(RUBY_SEM_RX_RADIO_REG_PRIORITY, O_CREAT, S_IWUSR | S_IRUSR, 0); 
-      if ( (NULL == s_RadioRxState.queue_reg_priority.pSemaphoreRead) || (SEM_FAILED == s_RadioRxState.queue_reg_priority.pSemaphoreRead) )
-      {
-         log_error_and_alarm("[RadioRx] Failed to create read semaphore: %s", RUBY_SEM_RX_RADIO_REG_PRIORITY);
-         return 0;
-      }
-   }
-
-   iSemVal = 0;
-   if ( 0 == sem_getvalue(s_RadioRxState.queue_reg_priority.pSemaphoreRead, &iSemVal) )
-      log_line("[RadioRx] Reg priority queue semaphore initial value: %d", iSemVal);
-   else
-      log_softerror_and_alarm("[RadioRx] Failed to get reg priority queue sem value.");
 
    for( int i=0; i<MAX_CONCURENT_VEHICLES; i++ )
    {
@@ -1188,6 +1364,10 @@ int radio_rx_start_rx_thread(shared_mem_radio_stats* pSMRadioStats, int iSearchM
    }
 
    s_RadioRxState.uMaxLoopTime = 0;
+   s_RadioRxState.uStatsEarlyRejectedDuplicates = 0;
+
+   if ( ! _radio_rx_epoll_init() )
+      return 0;
 
    if ( 0 != pthread_create(&s_pThreadRadioRx, NULL, &_thread_radio_rx, (void*)&s_iRadioRxSingalStop) )
    {
@@ -1208,24 +1388,9 @@ void radio_rx_stop_rx_thread()
    log_line("[RadioRx] Signaled radio rx thread to stop.");
    s_iRadioRxSingalStop = 1;
    s_iRadioRxInitialized = 0;
+   _radio_rx_signal_control_event();
 
    pthread_cancel(s_pThreadRadioRx);
-
-   if ( NULL != s_RadioRxState.queue_high_priority.pSemaphoreWrite )
-      sem_close(s_RadioRxState.queue_high_priority.pSemaphoreWrite);
-   if ( NULL != s_RadioRxState.queue_high_priority.pSemaphoreRead )
-      sem_close(s_RadioRxState.queue_high_priority.pSemaphoreRead);
-   if ( NULL != s_RadioRxState.queue_reg_priority.pSemaphoreWrite )
-      sem_close(s_RadioRxState.queue_reg_priority.pSemaphoreWrite);
-   if ( NULL != s_RadioRxState.queue_reg_priority.pSemaphoreRead )
-      sem_close(s_RadioRxState.queue_reg_priority.pSemaphoreRead);
-   s_RadioRxState.queue_high_priority.pSemaphoreWrite = NULL;
-   s_RadioRxState.queue_high_priority.pSemaphoreRead = NULL;
-   s_RadioRxState.queue_reg_priority.pSemaphoreWrite = NULL;
-   s_RadioRxState.queue_reg_priority.pSemaphoreRead = NULL;
-
-   sem_unlink(RUBY_SEM_RX_RADIO_HIGH_PRIORITY);
-   sem_unlink(RUBY_SEM_RX_RADIO_REG_PRIORITY);
 }
 
 void radio_rx_set_custom_thread_priority(int iPriority)
@@ -1260,12 +1425,14 @@ void radio_rx_pause_interface(int iInterfaceIndex, const char* szReason)
    if ( s_iRadioRxInitialized )
    {
       s_bHasPendingOperation = 1;
+      _radio_rx_signal_control_event();
       while ( ! s_bCanDoOperations )
          hardware_sleep_ms(1);
 
       s_iRadioRxPausedInterfaces[iInterfaceIndex]++;
       _radio_rx_check_update_all_paused_flag();
 
+      s_iRadioRxEpollSetChanged = 1;
       s_bHasPendingOperation = 0;
       s_bCanDoOperations = 0;
    }
@@ -1298,6 +1465,7 @@ void radio_rx_resume_interface(int iInterfaceIndex)
    if ( s_iRadioRxInitialized )
    {
       s_bHasPendingOperation = 1;
+      _radio_rx_signal_control_event();
       while ( ! s_bCanDoOperations )
          hardware_sleep_ms(1);
 
@@ -1307,6 +1475,7 @@ void radio_rx_resume_interface(int iInterfaceIndex)
          if ( s_iRadioRxPausedInterfaces[iInterfaceIndex] == 0 )
             s_iRadioRxAllInterfacesPaused = 0;
       }
+      s_iRadioRxEpollSetChanged = 1;
       s_bHasPendingOperation = 0;
       s_bCanDoOperations = 0;
    }
@@ -1447,6 +1616,14 @@ void radio_rx_reset_interfaces_broken_state()
       s_RadioRxState.iRadioInterfacesRxTimeouts[i] = 0;
       s_RadioRxState.iRadioInterfacesRxBadPackets[i] = 0;
    }
+   s_iRadioRxEpollSetChanged = 1;
+   _radio_rx_signal_control_event();
+}
+
+void radio_rx_signal_interfaces_changed()
+{
+   s_iRadioRxEpollSetChanged = 1;
+   _radio_rx_signal_control_event();
 }
 
 u32 radio_rx_get_and_reset_max_loop_time()
@@ -4,7 +4,6 @@
 #include "../base/config.h"
 #include "../base/hardware.h"
 #include <pthread.h>
-#include <semaphore.h>
 
 #if defined (HW_PLATFORM_RASPBERRY) || defined (HW_PLATFORM_RADXA)
 #define MAX_RX_PACKETS_QUEUE 700
@@ -27,6 +26,10 @@ typedef struct
 
 } ALIGN_STRUCT_SPEC_INFO t_radio_rx_state_vehicle;
 
+// Single producer (radio rx thread) / single consumer (router main loop) ring of preallocated packet slots.
+// Slots are handed over by index, never copied: the producer owns the slots from iCurrentPacketIndexToWrite
+// up to (not including) iCurrentPacketIndexToConsume; the consumer keeps the slot it was last given
+// (iPacketIndexHeldByConsumer) until its next read from the same queue.
 typedef struct
 {
    u8* pPacketsBuffers[MAX_RX_PACKETS_QUEUE];
@@ -34,13 +37,17 @@ typedef struct
    u8  uPacketsAreShort[MAX_RX_PACKETS_QUEUE];
    u8  uPacketsRxInterface[MAX_RX_PACKETS_QUEUE];
    int iQueueSize;
-   volatile int iCurrentPacketIndexToWrite; // Where next packet will be added
-   volatile int iCurrentPacketIndexToConsume; // Where the first packet to read/consume is
+   volatile int iCurrentPacketIndexToWrite; // Where next packet will be added. Changed only by the producer
+   volatile int iCurrentPacketIndexToConsume; // Where the first packet to read/consume is. Changed only by the consumer
+   int iPacketIndexHeldByConsumer; // Slot returned on the last read, -1 if none
    int iStatsMaxPacketsInQueue;
    int iStatsMaxPacketsInQueueLastMinute;
+   u32 uStatsDroppedPackets;
 
-   sem_t* pSemaphoreWrite;
-   sem_t* pSemaphoreRead;
+   // Used only when the consumer has to block for new packets
+   volatile int iConsumerWaiting;
+   pthread_mutex_t mutexWait;
+   pthread_cond_t condWait;
 } ALIGN_STRUCT_SPEC_INFO t_radio_rx_state_packets_queue;
 
 typedef struct
@@ -57,6 +64,7 @@ typedef struct
    u32 uAcceptedFirmwareType;
    u32 uTimeLastMinuteStatsUpdate;
    u32 uTimeLastStatsUpdate;
+   u32 uStatsEarlyRejectedDuplicates;
 } ALIGN_STRUCT_SPEC_INFO t_radio_rx_state;
 
 typedef struct
@@ -94,6 +102,7 @@ int radio_rx_get_interface_bad_packets_error_and_reset(int iInterfaceIndex);
 int radio_rx_any_rx_timeouts();
 int radio_rx_get_timeout_count_and_reset(int iInterfaceIndex);
 void radio_rx_reset_interfaces_broken_state();
+void radio_rx_signal_interfaces_changed();
 
 u32 radio_rx_get_and_reset_max_loop_time();
 u32 radio_rx_get_and_reset_max_loop_time_read();
@@ -30,8 +30,15 @@
     SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
 */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <sys/ioctl.h>
-#include <netpacket/packet.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <sys/mman.h>
 #include <net/if.h>
 #include <netinet/ether.h>
 #include <string.h>
@@ -62,6 +69,28 @@ int s_iRadioLastReadErrorCode = RADIO_READ_ERROR_NO_ERROR;
 int s_iVehicleBehindMilisec = 0;
 
 u8 sPayloadBufferRead[MAX_PACKET_LENGTH_PCAP];
+
+// TPACKET_V2 rx ring: the kernel hands over each frame as soon as it's received (TPACKET_V3 hands over
+// whole blocks, on block timeout, rounded up to a jiffy: up to 10 ms of added latency), user space reads
+// the frames in place without any syscall
+#define RADIO_RX_RING_BLOCK_SIZE (1<<15)
+#define RADIO_RX_RING_BLOCKS_COUNT 64
+#define RADIO_RX_RING_FRAME_SIZE (1<<12)
+#define RADIO_RX_RING_FRAMES_COUNT ((RADIO_RX_RING_BLOCK_SIZE / RADIO_RX_RING_FRAME_SIZE) * RADIO_RX_RING_BLOCKS_COUNT)
+
+typedef struct
+{
+   int iRequestedBackend;
+   int iBackend;
+   int iSocketFd;
+   u8* pRing;
+   u32 uRingSize;
+   int iCurrentFrame;
+   struct tpacket2_hdr* pCurrentFrame; // Frame owned by user space now, NULL if none
+} t_radio_rx_mmap_ring;
+
+t_radio_rx_mmap_ring s_RadioRxRings[MAX_RADIO_INTERFACES];
+int s_iRadioRxRingsInitialized = 0;
 int sEnableCRCGen = 0;
 
 int sRadioDataRate_bps = DEFAULT_RADIO_DATARATE_VIDEO_ATHEROS; // positive: clasic in bps; negative MCS (starts from -1)
@@ -301,6 +330,218 @@ void radio_set_bypass_socket_buffers(int iBypass)
       log_line("[Radio] Unset bypass radio sockets buffers.");
 }
 
+void _radio_rx_rings_init()
+{
+   if ( s_iRadioRxRingsInitialized )
+      return;
+   s_iRadioRxRingsInitialized = 1;
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+   {
+      memset(&s_RadioRxRings[i], 0, sizeof(t_radio_rx_mmap_ring));
+      s_RadioRxRings[i].iRequestedBackend = DEFAULT_RADIO_RX_USE_MMAP_RING?RADIO_RX_BACKEND_MMAP_RING:RADIO_RX_BACKEND_PCAP;
+      s_RadioRxRings[i].iBackend = RADIO_RX_BACKEND_PCAP;
+      s_RadioRxRings[i].iSocketFd = -1;
+   }
+}
+
+void radio_set_rx_backend(int iInterfaceIndex, int iRxBackend)
+{
+   _radio_rx_rings_init();
+   for( int i=0; i<MAX_RADIO_INTERFACES; i++ )
+   {
+      if ( (-1 == iInterfaceIndex) || (i == iInterfaceIndex) )
+         s_RadioRxRings[i].iRequestedBackend = iRxBackend;
+   }
+   log_line("[Radio] Set rx backend for radio interface %d to: %s", iInterfaceIndex+1, (iRxBackend == RADIO_RX_BACKEND_MMAP_RING)?"mmap ring":"pcap");
+}
+
+int radio_get_rx_backend(int iInterfaceIndex)
+{
+   if ( (iInterfaceIndex < 0) || (iInterfaceIndex >= MAX_RADIO_INTERFACES) || (! s_iRadioRxRingsInitialized) )
+      return RADIO_RX_BACKEND_PCAP;
+   return s_RadioRxRings[iInterfaceIndex].iBackend;
+}
+
+int radio_get_rx_pending_frames(int iInterfaceIndex)
+{
+   if ( radio_get_rx_backend(iInterfaceIndex) != RADIO_RX_BACKEND_MMAP_RING )
+      return 0;
+   t_radio_rx_mmap_ring* pRing = &s_RadioRxRings[iInterfaceIndex];
+   // Count the ready frames after the one owned by user space now (up to a limit, it's a hint for the read loop)
+   int iFrame = pRing->iCurrentFrame;
+   if ( NULL != pRing->pCurrentFrame )
+      iFrame = (iFrame + 1) % RADIO_RX_RING_FRAMES_COUNT;
+   int iCount = 0;
+   while ( iCount < 32 )
+   {
+      struct tpacket2_hdr* pFrame = (struct tpacket2_hdr*)(pRing->pRing + iFrame * RADIO_RX_RING_FRAME_SIZE);
+      if ( 0 == (__atomic_load_n(&pFrame->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) )
+         break;
+      iCount++;
+      iFrame = (iFrame + 1) % RADIO_RX_RING_FRAMES_COUNT;
+   }
+   return iCount;
+}
+
+void _radio_rx_ring_close(int iInterfaceIndex)
+{
+   t_radio_rx_mmap_ring* pRing = &s_RadioRxRings[iInterfaceIndex];
+   if ( pRing->iSocketFd >= 0 )
+   {
+      struct tpacket_stats stats;
+      socklen_t iLen = sizeof(stats);
+      if ( 0 == getsockopt(pRing->iSocketFd, SOL_PACKET, PACKET_STATISTICS, &stats, &iLen) )
+         log_line("[Radio] Rx ring of radio interface %d: %u packets, %u dropped.", iInterfaceIndex+1, stats.tp_packets, stats.tp_drops);
+   }
+   if ( NULL != pRing->pRing )
+      munmap(pRing->pRing, pRing->uRingSize);
+   if ( pRing->iSocketFd >= 0 )
+      close(pRing->iSocketFd);
+   pRing->pRing = NULL;
+   pRing->uRingSize = 0;
+   pRing->iSocketFd = -1;
+   pRing->iCurrentFrame = 0;
+   pRing->pCurrentFrame = NULL;
+   pRing->iBackend = RADIO_RX_BACKEND_PCAP;
+}
+
+// Returns the socket fd, or -1 if the ring could not be created (caller should fall back to pcap)
+
+int _radio_rx_ring_open(int iInterfaceIndex, const char* szInterfaceName, char* szFilter)
+{
+   t_radio_rx_mmap_ring* pRing = &s_RadioRxRings[iInterfaceIndex];
+   _radio_rx_ring_close(iInterfaceIndex);
+
+   // The same BPF filter as for pcap, compiled for radiotap link type and attached to the socket before binding it
+   struct bpf_program bpfprogram;
+   pcap_t* pPCAPDead = pcap_open_dead(DLT_IEEE802_11_RADIO, MAX_PACKET_LENGTH_PCAP);
+   if ( NULL == pPCAPDead )
+      return -1;
+   if ( -1 == pcap_compile(pPCAPDead, &bpfprogram, szFilter, 1, PCAP_NETMASK_UNKNOWN) )
+   {
+      log_softerror_and_alarm("[Radio] Failed to compile rx ring filter for interface %d: %s", iInterfaceIndex+1, pcap_geterr(pPCAPDead));
+      pcap_close(pPCAPDead);
+      return -1;
+   }
+   pcap_close(pPCAPDead);
+
+   pRing->iSocketFd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+   if ( pRing->iSocketFd < 0 )
+   {
+      log_softerror_and_alarm("[Radio] Failed to create rx ring socket for interface %d, error: %s", iInterfaceIndex+1, strerror(errno));
+      pcap_freecode(&bpfprogram);
+      return -1;
+   }
+
+   struct ifreq ifr;
+   memset(&ifr, 0, sizeof(ifr));
+   strncpy(ifr.ifr_name, szInterfaceName, IFNAMSIZ-1);
+   if ( (ioctl(pRing->iSocketFd, SIOCGIFHWADDR, &ifr) < 0) || (ifr.ifr_hwaddr.sa_family != ARPHRD_IEEE80211_RADIOTAP) )
+   {
+      log_line("[Radio] Interface %d (%s) does not provide radiotap headers, can't use rx ring for it.", iInterfaceIndex+1, szInterfaceName);
+      pcap_freecode(&bpfprogram);
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+   if ( ioctl(pRing->iSocketFd, SIOCGIFINDEX, &ifr) < 0 )
+   {
+      log_softerror_and_alarm("[Radio] Failed to get index of interface %d (%s), error: %s", iInterfaceIndex+1, szInterfaceName, strerror(errno));
+      pcap_freecode(&bpfprogram);
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+
+   struct sock_fprog filterProgram;
+   filterProgram.len = bpfprogram.bf_len;
+   filterProgram.filter = (struct sock_filter*) bpfprogram.bf_insns;
+   int iRes = setsockopt(pRing->iSocketFd, SOL_SOCKET, SO_ATTACH_FILTER, &filterProgram, sizeof(filterProgram));
+   pcap_freecode(&bpfprogram);
+   if ( 0 != iRes )
+   {
+      log_softerror_and_alarm("[Radio] Failed to attach rx ring filter on interface %d, error: %s", iInterfaceIndex+1, strerror(errno));
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+
+   int iVersion = TPACKET_V2;
+   if ( 0 != setsockopt(pRing->iSocketFd, SOL_PACKET, PACKET_VERSION, &iVersion, sizeof(iVersion)) )
+   {
+      log_softerror_and_alarm("[Radio] TPACKET_V2 not supported for interface %d, error: %s", iInterfaceIndex+1, strerror(errno));
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+
+   struct tpacket_req req;
+   memset(&req, 0, sizeof(req));
+   req.tp_block_size = RADIO_RX_RING_BLOCK_SIZE;
+   req.tp_block_nr = RADIO_RX_RING_BLOCKS_COUNT;
+   req.tp_frame_size = RADIO_RX_RING_FRAME_SIZE;
+   req.tp_frame_nr = RADIO_RX_RING_FRAMES_COUNT;
+   if ( 0 != setsockopt(pRing->iSocketFd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) )
+   {
+      log_softerror_and_alarm("[Radio] Failed to create rx ring for interface %d, error: %s", iInterfaceIndex+1, strerror(errno));
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+
+   pRing->uRingSize = req.tp_block_size * req.tp_block_nr;
+   pRing->pRing = (u8*) mmap(NULL, pRing->uRingSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_LOCKED, pRing->iSocketFd, 0);
+   if ( MAP_FAILED == pRing->pRing )
+      pRing->pRing = (u8*) mmap(NULL, pRing->uRingSize, PROT_READ | PROT_WRITE, MAP_SHARED, pRing->iSocketFd, 0);
+   if ( MAP_FAILED == pRing->pRing )
+   {
+      log_softerror_and_alarm("[Radio] Failed to map rx ring for interface %d, error: %s", iInterfaceIndex+1, strerror(errno));
+      pRing->pRing = NULL;
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+
+   struct sockaddr_ll ll_addr;
+   memset(&ll_addr, 0, sizeof(ll_addr));
+   ll_addr.sll_family = AF_PACKET;
+   ll_addr.sll_protocol = htons(ETH_P_ALL);
+   ll_addr.sll_ifindex = ifr.ifr_ifindex;
+   if ( 0 != bind(pRing->iSocketFd, (struct sockaddr *)&ll_addr, sizeof(ll_addr)) )
+   {
+      log_softerror_and_alarm("[Radio] Failed to bind rx ring socket to interface %d, error: %s", iInterfaceIndex+1, strerror(errno));
+      _radio_rx_ring_close(iInterfaceIndex);
+      return -1;
+   }
+
+   pRing->iCurrentFrame = 0;
+   pRing->pCurrentFrame = NULL;
+   pRing->iBackend = RADIO_RX_BACKEND_MMAP_RING;
+   log_line("[Radio] Created rx ring for interface %d (%s): %d frames of %d bytes, fd: %d", iInterfaceIndex+1, szInterfaceName, RADIO_RX_RING_FRAMES_COUNT, RADIO_RX_RING_FRAME_SIZE, pRing->iSocketFd);
+   return pRing->iSocketFd;
+}
+
+// Returns the next received frame (starting with the radiotap header) or NULL if none is available.
+// The frame stays valid until the next call for the same interface.
+
+u8* _radio_rx_ring_get_next_frame(int iInterfaceIndex, struct pcap_pkthdr* pPacketHeader)
+{
+   t_radio_rx_mmap_ring* pRing = &s_RadioRxRings[iInterfaceIndex];
+
+   // Give the previous frame back to the kernel
+   if ( NULL != pRing->pCurrentFrame )
+   {
+      __atomic_store_n(&pRing->pCurrentFrame->tp_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+      pRing->pCurrentFrame = NULL;
+      pRing->iCurrentFrame = (pRing->iCurrentFrame + 1) % RADIO_RX_RING_FRAMES_COUNT;
+   }
+
+   struct tpacket2_hdr* pFrame = (struct tpacket2_hdr*)(pRing->pRing + pRing->iCurrentFrame * RADIO_RX_RING_FRAME_SIZE);
+   if ( 0 == (__atomic_load_n(&pFrame->tp_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) )
+      return NULL;
+   pRing->pCurrentFrame = pFrame;
+
+   pPacketHeader->ts.tv_sec = pFrame->tp_sec;
+   pPacketHeader->ts.tv_usec = pFrame->tp_nsec / 1000;
+   pPacketHeader->caplen = pFrame->tp_snaplen;
+   pPacketHeader->len = (pFrame->tp_len < pFrame->tp_snaplen)?pFrame->tp_len:pFrame->tp_snaplen;
+   return (u8*)pFrame + pFrame->tp_mac;
+}
+
 // Returns 0 if the packet can't be sent (right now or ever)
 
 int radio_can_send_packet_on_slow_link(int iLinkId, int iPacketType, int iFromController, u32 uTimeNow)
@@ -596,6 +837,23 @@ int _radio_open_interface_for_read_with_filter(int interfaceIndex, char* szFilte
    pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd = -1;
    pRadioHWInfo->runtimeInterfaceInfoRx.iErrorCount = 0;
 
+   _radio_rx_rings_init();
+   if ( (interfaceIndex < MAX_RADIO_INTERFACES) && (s_RadioRxRings[interfaceIndex].iRequestedBackend == RADIO_RX_BACKEND_MMAP_RING) )
+   {
+      int iFd = _radio_rx_ring_open(interfaceIndex, pRadioHWInfo->szName, szFilter);
+      if ( iFd >= 0 )
+      {
+         pRadioHWInfo->runtimeInterfaceInfoRx.ppcap = NULL;
+         pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd = iFd;
+         pRadioHWInfo->runtimeInterfaceInfoRx.uOpenId = hardware_radio_get_new_open_id();
+         reset_runtime_radio_rx_info(&(pRadioHWInfo->runtimeInterfaceInfoRx.radioHwRxInfo));
+         pRadioHWInfo->openedForRead = 1;
+         log_line("Opened radio interface %d (%s) for reading (mmap ring) on %s, filter: [%s]. Returned fd=%d", interfaceIndex+1, pRadioHWInfo->szName, str_format_frequency(pRadioHWInfo->uCurrentFrequencyKhz), szFilter, iFd);
+         return iFd;
+      }
+      log_softerror_and_alarm("Failed to open radio interface %d (%s) for reading using mmap ring. Fallback to pcap.", interfaceIndex+1, pRadioHWInfo->szName);
+   }
+
    szErrbuf[0] = '\0';
    //pRadioHWInfo->runtimeInterfaceInfoRx.ppcap = pcap_open_live(pRadioHWInfo->szName, 4096, 1, 1, szErrbuf);
    pRadioHWInfo->runtimeInterfaceInfoRx.ppcap = pcap_create(pRadioHWInfo->szName, szErrbuf);
@@ -662,6 +920,7 @@ int _radio_open_interface_for_read_with_filter(int interfaceIndex, char* szFilte
       pcap_freecode(&bpfprogram);
    }
    pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd = pcap_get_selectable_fd(pRadioHWInfo->runtimeInterfaceInfoRx.ppcap);
+   pRadioHWInfo->runtimeInterfaceInfoRx.uOpenId = hardware_radio_get_new_open_id();
    reset_runtime_radio_rx_info(&(pRadioHWInfo->runtimeInterfaceInfoRx.radioHwRxInfo));
 
    pRadioHWInfo->openedForRead = 1;
@@ -690,6 +949,7 @@ int radio_open_interface_for_read(int interfaceIndex, int portNumber)
       return iResult;
 
    pRadioHWInfo->runtimeInterfaceInfoRx.nPort = portNumber;
+   radio_rx_signal_interfaces_changed();
 
    if ( portNumber == RADIO_PORT_ROUTER_UPLINK )
       log_line("Opened radio interface %d (%s) for reading on uplink on %s. Returned fd=%d, ppcap: %d", interfaceIndex+1, pRadioHWInfo->szName, str_format_frequency(pRadioHWInfo->uCurrentFrequencyKhz), pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd, pRadioHWInfo->runtimeInterfaceInfoRx.ppcap);
@@ -823,7 +1083,12 @@ void radio_close_interface_for_read(int interfaceIndex)
 
    radio_rx_pause_interface(interfaceIndex, "Close radio interface");
    
-   if ( NULL != pRadioHWInfo->runtimeInterfaceInfoRx.ppcap )
+   if ( radio_get_rx_backend(interfaceIndex) == RADIO_RX_BACKEND_MMAP_RING )
+   {
+      log_line("Closed radio interface %d [%s] that was used for read (mmap ring), selectable read fd was: %d", interfaceIndex+1, pRadioHWInfo->szName, pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd);
+      _radio_rx_ring_close(interfaceIndex);
+   }
+   else if ( NULL != pRadioHWInfo->runtimeInterfaceInfoRx.ppcap )
    {
       log_line("Closed radio interface %d [%s] that was used for read, selectable read fd was: %d, ppcap was: %d", interfaceIndex+1, pRadioHWInfo->szName, pRadioHWInfo->runtimeInterfaceInfoRx.selectable_fd, pRadioHWInfo->runtimeInterfaceInfoRx.ppcap);
       pcap_close(pRadioHWInfo->runtimeInterfaceInfoRx.ppcap);
@@ -884,6 +1149,15 @@ void radio_close_interface_for_write(int interfaceIndex)
 
 
 u8* radio_process_wlan_data_in(int interfaceNumber, int* outPacketLength, u32 uTimeNow)
+{
+   return radio_process_wlan_data_in_to_buffer(interfaceNumber, outPacketLength, uTimeNow, NULL, 0);
+}
+
+// Same as radio_process_wlan_data_in, but the received payload is stored directly in pOutputBuffer (if it fits),
+// so that the caller can hand the buffer over without copying it again.
+// Returns pOutputBuffer, or the internal read buffer if pOutputBuffer is NULL or too small.
+
+u8* radio_process_wlan_data_in_to_buffer(int interfaceNumber, int* outPacketLength, u32 uTimeNow, u8* pOutputBuffer, int iOutputBufferSize)
 {
    radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(interfaceNumber);
 
@@ -971,9 +1245,18 @@ u8* radio_process_wlan_data_in(int interfaceNumber, int* outPacketLength, u32 uT
    */
    struct pcap_pkthdr pcapHeader;
    ppcapPacketHeader = &pcapHeader;
-   pRadioPayload = (u8*) pcap_next(pRadioHWInfo->runtimeInterfaceInfoRx.ppcap, ppcapPacketHeader); 
+   if ( radio_get_rx_backend(interfaceNumber) == RADIO_RX_BACKEND_MMAP_RING )
+      pRadioPayload = _radio_rx_ring_get_next_frame(interfaceNumber, ppcapPacketHeader);
+   else
+      pRadioPayload = (u8*) pcap_next(pRadioHWInfo->runtimeInterfaceInfoRx.ppcap, ppcapPacketHeader); 
    if ( NULL == pRadioPayload )
+   {
+      #ifdef FEATURE_RADIO_SYNCHRONIZE_RXTX_THREADS
+      if ( 1 == s_iMutexRadioSyncRxTxThreadsInitialized )
+         pthread_mutex_unlock(&s_pMutexRadioSyncRxTxThreads);
+      #endif
       return NULL;
+   }
    #ifdef DEBUG_PACKET_RECEIVED
    log_line("RX Buffer: caplen: %d bytes, len: %d", ppcapPacketHeader->caplen, ppcapPacketHeader->len);
    #endif
@@ -1279,6 +1562,11 @@ u8* radio_process_wlan_data_in(int interfaceNumber, int* outPacketLength, u32 uT
    #endif
 
    //return pRadioPayload;
+   if ( (NULL != pOutputBuffer) && (payloadLength <= iOutputBufferSize) )
+   {
+      memcpy(pOutputBuffer, pRadioPayload, payloadLength);
+      return pOutputBuffer;
+   }
    memcpy(sPayloadBufferRead, pRadioPayload, payloadLength);
    return sPayloadBufferRead;
 }
@@ -1441,7 +1729,6 @@ int radio_build_new_raw_ieee_packet(int iLocalRadioLinkId, u8* pRawPacket, u8* p
    }
    */
 
-   memcpy(pRawPacket, pPacketData, nInputLength);
    totalRadioLength += nInputLength;
 
    if ( s_bRadioDebugFlag )
@@ -1458,14 +1745,40 @@ int radio_build_new_raw_ieee_packet(int iLocalRadioLinkId, u8* pRawPacket, u8* p
    // Compute CRC/encrypt packet
   
    t_packet_header* pPH = (t_packet_header*)pRawPacket;
-   pPH->radio_link_packet_index = uRadioLinkPacketIndex;
-   if ( bEncrypt )
-      pPH->packet_flags |= PACKET_FLAGS_BIT_HAS_ENCRYPTION;
+   int iCRCLength = -1;
+   if ( nInputLength >= (int)sizeof(t_packet_header) )
+   {
+      t_packet_header* pPHIn = (t_packet_header*)pPacketData;
+      iCRCLength = (pPHIn->packet_flags & PACKET_FLAGS_BIT_HEADERS_ONLY_CRC)?(int)sizeof(t_packet_header):(int)pPHIn->total_length;
+      if ( (iCRCLength < (int)sizeof(t_packet_header)) || (iCRCLength > nInputLength) )
+         iCRCLength = -1;
+   }
 
-   if ( pPH->packet_flags & PACKET_FLAGS_BIT_HEADERS_ONLY_CRC )
-      radio_packet_compute_crc((u8*)pPH, sizeof(t_packet_header));
+   if ( iCRCLength > 0 )
+   {
+      // Copy and update the header, then copy the rest of the CRC covered data while computing the CRC
+      memcpy(pRawPacket, pPacketData, sizeof(t_packet_header));
+      pPH->radio_link_packet_index = uRadioLinkPacketIndex;
+      if ( bEncrypt )
+         pPH->packet_flags |= PACKET_FLAGS_BIT_HAS_ENCRYPTION;
+      u32 uCRC = base_compute_crc32(pRawPacket + sizeof(u32), sizeof(t_packet_header) - sizeof(u32));
+      uCRC = base_copy_and_compute_crc32(pRawPacket + sizeof(t_packet_header), pPacketData + sizeof(t_packet_header), iCRCLength - sizeof(t_packet_header), uCRC);
+      if ( nInputLength > iCRCLength )
+         memcpy(pRawPacket + iCRCLength, pPacketData + iCRCLength, nInputLength - iCRCLength);
+      pPH->uCRC = uCRC;
+   }
    else
-      radio_packet_compute_crc((u8*)pPH, pPH->total_length);
+   {
+      memcpy(pRawPacket, pPacketData, nInputLength);
+      pPH->radio_link_packet_index = uRadioLinkPacketIndex;
+      if ( bEncrypt )
+         pPH->packet_flags |= PACKET_FLAGS_BIT_HAS_ENCRYPTION;
+
+      if ( pPH->packet_flags & PACKET_FLAGS_BIT_HEADERS_ONLY_CRC )
+         radio_packet_compute_crc((u8*)pPH, sizeof(t_packet_header));
+      else
+         radio_packet_compute_crc((u8*)pPH, pPH->total_length);
+   }
 
    if ( bEncrypt )
    {
@@ -1578,6 +1891,130 @@ int radio_write_raw_ieee_packet(int interfaceIndex, u8* pData, int dataLength, i
 }
 
 
+// Sends a batch of raw frames (built using radio_build_new_raw_ieee_packet) on a radio interface.
+// On socket tx all the frames are submitted using sendmmsg (usually a single syscall); on pcap tx they are injected one by one.
+// piResults (optional, iCount entries) receives 1 for each frame sent and 0 for each frame that failed.
+// Returns the number of frames sent.
+
+int radio_write_raw_ieee_packets_batch(int interfaceIndex, u8** pFrames, int* piFramesLengths, int iCount, int* piResults)
+{
+   if ( (NULL == pFrames) || (NULL == piFramesLengths) || (iCount <= 0) )
+      return 0;
+
+   if ( NULL != piResults )
+   for( int i=0; i<iCount; i++ )
+      piResults[i] = 0;
+
+   radio_hw_info_t* pRadioHWInfo = hardware_get_radio_info(interfaceIndex);
+   if ( NULL == pRadioHWInfo || ( 0 == pRadioHWInfo->openedForWrite) || (pRadioHWInfo->runtimeInterfaceInfoTx.selectable_fd < 0 ) )
+   {
+      log_softerror_and_alarm("RadioError: Tried to write a batch of %d radio messages to an invalid interface (%d).", iCount, interfaceIndex+1);
+      return 0;
+   }
+
+   if ( iCount > MAX_RADIO_TX_BATCH_PACKETS )
+      iCount = MAX_RADIO_TX_BATCH_PACKETS;
+
+   if ( s_bRadioDebugFlag )
+   {
+      t_packet_header* pPH = (t_packet_header*)&s_uLastPacketBuilt[0];
+      if ( pPH->packet_type == PACKET_TYPE_RUBY_PING_CLOCK )
+      {
+         s_uLastRadioPingSentTime = get_current_timestamp_ms();
+         s_uLastRadioPingId = s_uLastPacketBuilt[sizeof(t_packet_header)];
+      }
+   }
+
+   #ifdef FEATURE_RADIO_SYNCHRONIZE_RXTX_THREADS
+   if ( 1 == s_iMutexRadioSyncRxTxThreadsInitialized )
+      pthread_mutex_lock(&s_pMutexRadioSyncRxTxThreads);
+   #endif
+
+   s_uPacketsSentUsingCurrent_RadioRate += iCount;
+   s_uPacketsSentUsingCurrent_RadioFlags += iCount;
+
+   int iCountSent = 0;
+   int iCountFailed = 0;
+   int iLastError = 0;
+
+   if ( s_iUsePCAPForTx )
+   {
+      for( int i=0; i<iCount; i++ )
+      {
+         int len = pcap_inject(pRadioHWInfo->runtimeInterfaceInfoTx.ppcap, pFrames[i], piFramesLengths[i]);
+         if ( len < piFramesLengths[i] )
+         {
+            iLastError = errno;
+            iCountFailed++;
+            continue;
+         }
+         iCountSent++;
+         if ( NULL != piResults )
+            piResults[i] = 1;
+      }
+   }
+   else
+   {
+      struct mmsghdr msgs[MAX_RADIO_TX_BATCH_PACKETS];
+      struct iovec iovecs[MAX_RADIO_TX_BATCH_PACKETS];
+      memset(msgs, 0, iCount * sizeof(struct mmsghdr));
+      for( int i=0; i<iCount; i++ )
+      {
+         iovecs[i].iov_base = pFrames[i];
+         iovecs[i].iov_len = piFramesLengths[i];
+         msgs[i].msg_hdr.msg_iov = &iovecs[i];
+         msgs[i].msg_hdr.msg_iovlen = 1;
+      }
+
+      // sendmmsg stops at the first frame that fails; skip it and submit the rest
+      int iStart = 0;
+      while ( iStart < iCount )
+      {
+         int iRes = sendmmsg(pRadioHWInfo->runtimeInterfaceInfoTx.selectable_fd, &msgs[iStart], iCount - iStart, 0);
+         if ( iRes <= 0 )
+         {
+            // Save it now, the calls below can change it
+            iLastError = errno;
+            if ( (iRes < 0) && (iLastError == EINTR) )
+               continue;
+            iCountFailed++;
+            iStart++;
+            continue;
+         }
+         for( int i=iStart; i<iStart+iRes; i++ )
+         {
+            if ( (int)msgs[i].msg_len < piFramesLengths[i] )
+            {
+               // Partial write, no error code for it
+               iLastError = EIO;
+               iCountFailed++;
+               continue;
+            }
+            iCountSent++;
+            if ( NULL != piResults )
+               piResults[i] = 1;
+         }
+         iStart += iRes;
+      }
+   }
+
+   if ( 0 == iCountFailed )
+      pRadioHWInfo->runtimeInterfaceInfoTx.iErrorCount = 0;
+   else
+   {
+      pRadioHWInfo->runtimeInterfaceInfoTx.iErrorCount += iCountFailed;
+      log_softerror_and_alarm("RadioError: Failed to send %d of %d radio messages on radio interface %d, fd=%d, error: %s",
+         iCountFailed, iCount, interfaceIndex+1, pRadioHWInfo->runtimeInterfaceInfoTx.selectable_fd, strerror(iLastError));
+   }
+
+   #ifdef FEATURE_RADIO_SYNCHRONIZE_RXTX_THREADS
+   if ( 1 == s_iMutexRadioSyncRxTxThreadsInitialized )
+      pthread_mutex_unlock(&s_pMutexRadioSyncRxTxThreads);
+   #endif
+
+   return iCountSent;
+}
+
 // Returns the number of bytes written or -1 for error, -2 for write error
 
 int radio_write_serial_packet(int interfaceIndex, u8* pData, int dataLength, u32 uTimeNow)
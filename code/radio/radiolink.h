@@ -41,6 +41,7 @@
 #include <sys/resource.h>
 
 #define MAX_PACKET_LENGTH_PCAP 4096
+#define MAX_RADIO_TX_BATCH_PACKETS 64
 
 #define RADIO_PROCESSING_ERROR_NO_ERROR 0x00
 #define RADIO_PROCESSING_ERROR_CODE_INVALID_CRC_RECEIVED 0x01
@@ -53,6 +54,9 @@
 #define RADIO_READ_ERROR_INTERFACE_BROKEN 2
 #define RADIO_READ_ERROR_READ_ERROR 3
 
+#define RADIO_RX_BACKEND_PCAP 0
+#define RADIO_RX_BACKEND_MMAP_RING 1
+
 
 #ifdef __cplusplus
 extern "C" {
@@ -66,6 +70,9 @@ void radio_set_link_clock_delta(int iVehicleBehindMilisec);
 int  radio_get_link_clock_delta();
 void radio_set_use_pcap_for_tx(int iEnablePCAPTx);
 void radio_set_bypass_socket_buffers(int iBypass);
+void radio_set_rx_backend(int iInterfaceIndex, int iRxBackend); // -1 for all interfaces. Used when the interface is (re)opened for read
+int  radio_get_rx_backend(int iInterfaceIndex); // Backend actually in use by an interface opened for read
+int  radio_get_rx_pending_frames(int iInterfaceIndex); // Frames already received in the mmap ring and not read yet
 int  radio_set_out_datarate(int rate_bps, u8 uPacketType, u32 uTimeNow); // positive: classic in bps, negative: MCS; returns 1 if it was changed
 u32  radio_get_current_frames_flags();
 u32  radio_get_current_frames_flags_datarate();
@@ -87,6 +94,7 @@ void radio_close_interface_for_read(int interfaceIndex);
 void radio_close_interface_for_write(int interfaceIndex);
 
 u8* radio_process_wlan_data_in(int interfaceNumber, int* outPacketLength, u32 uTimeNow);
+u8* radio_process_wlan_data_in_to_buffer(int interfaceNumber, int* outPacketLength, u32 uTimeNow, u8* pOutputBuffer, int iOutputBufferSize);
 int radio_get_last_read_error_code();
 
 // returns 0 for failure, total length of packet for success
@@ -96,6 +104,7 @@ int get_last_processing_error_code();
 u32 radio_get_next_radio_link_packet_index(int iLocalRadioLinkId);
 int radio_build_new_raw_ieee_packet(int iLocalRadioLinkId, u8* pRawPacket, u8* pPacketData, int nInputLength, int portNb, int bEncrypt);
 int radio_write_raw_ieee_packet(int interfaceIndex, u8* pData, int dataLength, int iRepeatCount);
+int radio_write_raw_ieee_packets_batch(int interfaceIndex, u8** pFrames, int* piFramesLengths, int iCount, int* piResults);
 int radio_write_serial_packet(int interfaceIndex, u8* pData, int dataLength, u32 uTimeNow);
 int radio_write_sik_packet(int interfaceIndex, u8* pData, int dataLength, u32 uTimeNow);
 
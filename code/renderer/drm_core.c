@@ -49,6 +49,7 @@ type_drm_runtime_state s_DRMRuntimeState;
 
 
 int s_iDRMCoreInitialized = 0;
+int s_iDRMCoreOffscreen = 0;
 int s_iDRMEnableVSync = 1;
 
 static const char *_ruby_drm_core_get_connector_str(uint32_t conn_type)
@@ -749,10 +750,67 @@ int ruby_drm_core_init(int iPlaneIndex, uint32_t uFormat, int iWidth, int iHeigh
    return 0;
 }
 
+int ruby_drm_core_init_offscreen(int iWidth, int iHeight)
+{
+   log_line("[DRMCore] Init offscreen (%d x %d)...", iWidth, iHeight);
+
+   memset(&s_DRMDisplayAttributes, 0, sizeof(type_drm_display_attributes));
+   s_DRMDisplayAttributes.iWidth = iWidth;
+   s_DRMDisplayAttributes.iHeight = iHeight;
+   s_DRMDisplayAttributes.iRefreshRate = 60;
+   s_DRMDisplayAttributes.iBPP = 32;
+
+   memset(&s_DRMRuntimeState, 0, sizeof(type_drm_runtime_state));
+   s_DRMRuntimeState.uPlaneFormat = DRM_FORMAT_ARGB8888;
+   s_DRMRuntimeState.objInfoCRTc.iObjIndex = -1;
+   s_DRMRuntimeState.iVideoSourceWidth = -1;
+   s_DRMRuntimeState.iVideoSourceHeight = -1;
+
+   for( int i=0; i<2; i++ )
+   {
+      type_drm_buffer* pBuffer = &s_DRMRuntimeState.drawBuffers[i];
+      pBuffer->uWidth = iWidth;
+      pBuffer->uHeight = iHeight;
+      pBuffer->uStride = iWidth*4;
+      pBuffer->uSize = pBuffer->uStride * iHeight;
+      pBuffer->uBufferId = i+1;
+      pBuffer->pData = (uint8_t*) malloc(pBuffer->uSize);
+      if ( NULL == pBuffer->pData )
+      {
+         log_softerror_and_alarm("[DRMCore] Failed to allocate offscreen buffer (%u bytes).", pBuffer->uSize);
+         return -1;
+      }
+      memset(pBuffer->pData, 0, pBuffer->uSize);
+   }
+   s_DRMRuntimeState.iActiveOnScreenDrawBuffer = 0;
+
+   s_iDRMCoreOffscreen = 1;
+   s_iDRMCoreInitialized = 1;
+   return 0;
+}
+
+int ruby_drm_core_is_offscreen()
+{
+   return s_iDRMCoreOffscreen;
+}
+
 int ruby_drm_core_uninit()
 {
    log_line("[DRMCore] Uninit");
 
+   if ( s_iDRMCoreOffscreen )
+   {
+      for( int i=0; i<2; i++ )
+      {
+         if ( NULL != s_DRMRuntimeState.drawBuffers[i].pData )
+            free(s_DRMRuntimeState.drawBuffers[i].pData);
+         s_DRMRuntimeState.drawBuffers[i].pData = NULL;
+      }
+      s_iDRMCoreOffscreen = 0;
+      s_iDRMCoreInitialized = 0;
+      return 0;
+   }
+
    int iRet = drmModeSetCrtc(s_fdDRM, s_DRMRuntimeState.pOriginalCRTc->crtc_id, s_DRMRuntimeState.pOriginalCRTc->buffer_id, s_DRMRuntimeState.pOriginalCRTc->x, s_DRMRuntimeState.pOriginalCRTc->y,
       &s_DRMRuntimeState.objInfoConnector.uObjId, 1, &s_DRMRuntimeState.pOriginalCRTc->mode);
    if ( iRet < 0 )
@@ -839,6 +897,8 @@ uint32_t ruby_drm_core_get_back_draw_buffer_id()
 int ruby_drm_swap_mainback_buffers()
 {
    s_DRMRuntimeState.iActiveOnScreenDrawBuffer = 1 - s_DRMRuntimeState.iActiveOnScreenDrawBuffer;
+   if ( s_iDRMCoreOffscreen )
+      return 0;
    
    drmModeAtomicSetCursor(s_DRMRuntimeState.pAtomicRequest, 0);
 
@@ -874,8 +934,30 @@ int ruby_drm_swap_mainback_buffers()
 }
 
 
+int ruby_drm_core_wait_vblank()
+{
+   if ( (s_fdDRM < 0) || (! s_iDRMCoreInitialized) || s_iDRMCoreOffscreen )
+      return -1;
+
+   drmVBlank vbl;
+   memset(&vbl, 0, sizeof(vbl));
+   vbl.request.type = DRM_VBLANK_RELATIVE;
+   vbl.request.sequence = 1;
+   int iCrtcIndex = s_DRMRuntimeState.objInfoCRTc.iObjIndex;
+   if ( 1 == iCrtcIndex )
+      vbl.request.type = (drmVBlankSeqType)(vbl.request.type | DRM_VBLANK_SECONDARY);
+   else if ( iCrtcIndex > 1 )
+      vbl.request.type = (drmVBlankSeqType)(vbl.request.type | ((iCrtcIndex << DRM_VBLANK_HIGH_CRTC_SHIFT) & DRM_VBLANK_HIGH_CRTC_MASK));
+
+   if ( 0 != drmWaitVBlank(s_fdDRM, &vbl) )
+      return -1;
+   return 0;
+}
+
 int ruby_drm_core_set_plane_properties_and_buffer(uint32_t uBufferId)
 {
+   if ( s_iDRMCoreOffscreen )
+      return 0;
    uint64_t uSrcWidth = s_DRMDisplayAttributes.iWidth;
    uint64_t uSrcHeight = s_DRMDisplayAttributes.iHeight;
 
@@ -974,6 +1056,8 @@ int ruby_drm_core_set_plane_properties_and_buffer(uint32_t uBufferId)
 
 int ruby_drm_core_set_plane_buffer(uint32_t uBufferId)
 {
+   if ( s_iDRMCoreOffscreen )
+      return 0;
    drmModeAtomicSetCursor(s_DRMRuntimeState.pAtomicRequest, 0);
 
    ruby_drm_set_object_property(&s_DRMRuntimeState.objInfoPlane, "FB_ID", uBufferId );
@@ -75,6 +75,9 @@ int ruby_drm_core_is_display_connected();
 int ruby_drm_core_wait_for_display_connected();
 
 int ruby_drm_core_init(int iPlaneIndex, uint32_t uFormat, int iWidth, int iHeight, int iRefreshRate);
+// Memory only draw buffers (no display): for benchmarks and tests, renderers work the same way on them
+int ruby_drm_core_init_offscreen(int iWidth, int iHeight);
+int ruby_drm_core_is_offscreen();
 int ruby_drm_core_uninit();
 int ruby_drm_core_get_fd();
 
@@ -85,6 +88,8 @@ type_drm_buffer* ruby_drm_core_get_back_draw_buffer();
 uint32_t ruby_drm_core_get_main_draw_buffer_id();
 uint32_t ruby_drm_core_get_back_draw_buffer_id();
 int ruby_drm_swap_mainback_buffers();
+// Blocks until the next vertical blank of the used crtc. Returns 0 on success, -1 if not available
+int ruby_drm_core_wait_vblank();
 
 int ruby_drm_core_set_plane_properties_and_buffer(uint32_t uBufferId);
 int ruby_drm_core_set_plane_buffer(uint32_t uBufferId);
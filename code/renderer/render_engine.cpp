@@ -126,11 +126,68 @@ RenderEngine::RenderEngine()
 
    m_CurrentRawFontId = 0;
    m_iCountRawFonts = 0;
+
+   m_iRetainedMode = RENDER_RETAINED_MODE_OFF;
+   m_iRetainedBufferAge = 0;
+   m_bRetainedPrevFrameValid = false;
+   m_bRetainedRecording = false;
+   m_bRetainedReplaying = false;
+   m_pRetainedCommands = NULL;
+   m_pRetainedStates = NULL;
+   m_iRetainedCountCommands = 0;
+   m_iRetainedCountStates = 0;
+   m_iRetainedMaxCommands = 0;
+   m_pRetainedData = NULL;
+   m_uRetainedDataSize = 0;
+   m_uRetainedMaxDataSize = 0;
+   m_pRetainedInfos[0] = m_pRetainedInfos[1] = NULL;
+   m_iRetainedMaxInfos[0] = m_iRetainedMaxInfos[1] = 0;
+   m_iRetainedCountLayers[0] = m_iRetainedCountLayers[1] = 0;
+   m_iRetainedLayersStackDepth = 0;
+   m_uRetainedAutoLayerIndex = 0;
+   m_iRetainedCurrentAutoLayer = -1;
+   m_uRetainedLastStateHash = 0;
+   m_RetainedDamageHistory.iCount = 0;
+   m_RetainedDamageHistory.bFull = true;
+   m_RetainedDebugOverlay.iCount = 0;
+   m_RetainedDebugOverlay.bFull = false;
+   m_fRetainedRepaintPercent = 100.0;
+
+   pthread_mutexattr_t attr;
+   pthread_mutexattr_init(&attr);
+   pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_RECURSIVE);
+   pthread_mutex_init(&m_MutexFrames, &attr);
+   pthread_mutexattr_destroy(&attr);
+   m_bDeferredFrames = false;
+   m_bDeferredFramePending = false;
+
+   m_bLayerTimings = false;
+   resetLayerTimings();
+
+   memset(m_DrawCaches, 0, sizeof(m_DrawCaches));
+   m_iActiveDrawCache = -1;
 }
 
 
 RenderEngine::~RenderEngine()
 {
+   if ( NULL != m_pRetainedCommands )
+      free(m_pRetainedCommands);
+   if ( NULL != m_pRetainedStates )
+      free(m_pRetainedStates);
+   if ( NULL != m_pRetainedData )
+      free(m_pRetainedData);
+   if ( NULL != m_pRetainedInfos[0] )
+      free(m_pRetainedInfos[0]);
+   if ( NULL != m_pRetainedInfos[1] )
+      free(m_pRetainedInfos[1]);
+   m_pRetainedCommands = NULL;
+   m_pRetainedStates = NULL;
+   m_pRetainedData = NULL;
+   m_pRetainedInfos[0] = m_pRetainedInfos[1] = NULL;
+   for( int i=0; i<RENDER_MAX_DRAW_CACHES; i++ )
+      freeDrawCache((u32)i+1);
+   pthread_mutex_destroy(&m_MutexFrames);
 }
 
 bool RenderEngine::initEngine()
@@ -256,6 +313,8 @@ void RenderEngine::disableRectBlending()
 
 void RenderEngine::setClearBufferByte(u8 uClearByte)
 {
+   if ( uClearByte != m_uClearBufferByte )
+      invalidateRetainedFrames();
    m_uClearBufferByte = uClearByte;
 }
 
@@ -601,6 +660,9 @@ int RenderEngine::loadRawFont(int iFamilyId, const char* szFontFile, int iBold)
    m_pRawFonts[m_iCountRawFonts]->charIdFirst = m_pRawFonts[m_iCountRawFonts]->chars[0].charId;
    m_pRawFonts[m_iCountRawFonts]->charIdLast = m_pRawFonts[m_iCountRawFonts]->chars[m_pRawFonts[m_iCountRawFonts]->charCount-1].charId;
    m_pRawFonts[m_iCountRawFonts]->dxLetters = 0.0;
+
+   // The font becomes visible to the render thread only once fully loaded
+   lockFrames();
    m_CurrentRawFontId++;
    m_RawFontIds[m_iCountRawFonts] = m_CurrentRawFontId;
 
@@ -613,14 +675,17 @@ int RenderEngine::loadRawFont(int iFamilyId, const char* szFontFile, int iBold)
        szFile, m_pRawFonts[m_iCountRawFonts]->keringsCount, m_RawFontIds[m_iCountRawFonts], m_iCountRawFonts+1);
 
    m_iCountRawFonts++;
+   unlockFrames();
    return (int)m_CurrentRawFontId;
 }
 
 void RenderEngine::freeRawFont(u32 idFont)
 {
+   lockFrames();
    int indexFont = _getRawFontIndexFromId(idFont);
    if ( -1 == indexFont )
    {
+      unlockFrames();
       log_softerror_and_alarm("[RenderEngineRaw] Tried to delete invalid raw font id %u, not in the list (%d raw fonts)", idFont, m_iCountRawFonts);
       return;
    }
@@ -634,6 +699,8 @@ void RenderEngine::freeRawFont(u32 idFont)
       m_RawFontIds[i] = m_RawFontIds[i+1];
    }
    m_iCountRawFonts--;
+   _invalidateAllDrawCaches();
+   unlockFrames();
    log_line("[RenderEngineRaw] Unloaded font id %u, remaining fonts: %d", idFont, m_iCountRawFonts);
 }
 
@@ -647,6 +714,11 @@ u32 RenderEngine::loadImage(const char* szFile)
    return 0;
 }
 
+bool RenderEngine::saveFrameToPNG(const char* szFileName)
+{
+   return false;
+}
+
 void RenderEngine::freeImage(u32 idImage)
 {
 }
@@ -676,10 +748,15 @@ void RenderEngine::changeImageHue(u32 uImageId, u8 r, u8 g, u8 b)
 }
 
      
+// The frames lock is kept from startFrame to endFrame
 void RenderEngine::startFrame()
 {
+   lockFrames();
    if ( m_bStartedFrame  )
+   {
+      unlockFrames();
       return;
+   }
    m_bStartedFrame = true;
    m_iRenderDepth++;
 }
@@ -691,6 +768,7 @@ void RenderEngine::endFrame()
 
    m_bStartedFrame = false;
    m_iRenderDepth--;
+   unlockFrames();
 }
 
 bool RenderEngine::isFrameStarted()
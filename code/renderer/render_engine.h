@@ -1,6 +1,7 @@
 #pragma once
 
 #include "../base/base.h"
+#include <pthread.h>
 
 #define MAX_FONT_CHARS 256
 #define MAX_FONT_KERINGS 1024
@@ -8,6 +9,38 @@
 #define MAX_RAW_IMAGES 100
 #define MAX_RAW_ICONS 100
 
+// Retained rendering: draw calls done between startFrame/endFrame are recorded,
+// compared with the previous frame (per layer) and only the damaged regions
+// of the back buffer are cleared and redrawn in endFrame.
+#define RENDER_RETAINED_MODE_OFF 0
+#define RENDER_RETAINED_MODE_ON 1
+#define RENDER_RETAINED_MODE_DEBUG 2
+
+#define RENDER_LAYER_ID_AUTO 0x80000000
+#define RENDER_RETAINED_MAX_LAYERS 256
+#define RENDER_RETAINED_MAX_DAMAGE_RECTS 48
+#define RENDER_MAX_TIMED_LAYERS 64
+#define RENDER_MAX_DRAW_CACHES 32
+
+#define RENDER_CMD_IMAGE 1
+#define RENDER_CMD_IMAGE_ALPHA 2
+#define RENDER_CMD_BLT_IMAGE 3
+#define RENDER_CMD_BLT_SPRITE 4
+#define RENDER_CMD_ICON 5
+#define RENDER_CMD_BLT_ICON 6
+#define RENDER_CMD_TEXT 7
+#define RENDER_CMD_LINE 8
+#define RENDER_CMD_RECT 9
+#define RENDER_CMD_ROUND_RECT 10
+#define RENDER_CMD_ROUND_RECT_MENU 11
+#define RENDER_CMD_TRIANGLE 12
+#define RENDER_CMD_FILL_TRIANGLE 13
+#define RENDER_CMD_POLYLINE 14
+#define RENDER_CMD_FILL_POLYGON 15
+#define RENDER_CMD_FILL_CIRCLE 16
+#define RENDER_CMD_CIRCLE 17
+#define RENDER_CMD_ARC 18
+
 
 typedef struct
 {
@@ -42,6 +75,85 @@ typedef struct
 
 } RenderEngineRawFont;
 
+// Pixels, x2, y2 are exclusive
+typedef struct
+{
+   int x1, y1, x2, y2;
+} type_render_rect;
+
+typedef struct
+{
+   u8 uColorFill[4];
+   u8 uColorStroke[4];
+   u8 uColorTextBoundingBoxBgFill[4];
+   u8 uTextFontMixColor[4];
+   double dColorTextBackgroundBoundingBoxStrike[4];
+   float fStrokeSizePx;
+   float fBoundingBoxPadding;
+   u8 bDrawBackgroundBoundingBoxes;
+   u8 bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor;
+   u8 bDrawStrikeOnTextBackgroundBoundingBoxes;
+   u8 bDisableTextOutline;
+   u8 bHighlightFirstWord;
+   u8 bEnableRectBlending;
+   u8 bEnableFontScaling;
+   u8 uPadding;
+} type_render_retained_state;
+
+typedef struct
+{
+   u8 uType;
+   u8 uRedraw;
+   u16 uLayerIndex;
+   u32 uStateIndex;
+   float fParams[6];
+   int iParams[6];
+   u32 uDataOffset;
+   u32 uDataSize;
+   type_render_rect rect;
+   u32 uHash;
+} type_render_retained_command;
+
+typedef struct
+{
+   u32 uHash;
+   type_render_rect rect;
+} type_render_retained_command_info;
+
+typedef struct
+{
+   u32 uId;
+   u32 uPrevLayerId;
+   u32 uHash;
+   int iCountCommands;
+   int iFirstCommand; // In the commands info list, grouped by layer
+   type_render_rect rect;
+} type_render_retained_layer;
+
+// Copy of recorded draw calls (commands, their state and data), with the hash of each command
+// without the state (as it is before it's added to a frame)
+typedef struct
+{
+   bool bUsed;
+   bool bValid;
+   int iRenderWidth;
+   int iRenderHeight;
+   type_render_retained_command* pCommands;
+   type_render_retained_state* pStates; // one for each command
+   int iCountCommands;
+   int iMaxCommands;
+   u8* pData;
+   u32 uDataSize;
+   u32 uMaxDataSize;
+} type_render_draw_cache;
+
+typedef struct
+{
+   type_render_rect rects[RENDER_RETAINED_MAX_DAMAGE_RECTS];
+   int iCount;
+   bool bFull;
+} type_render_damage;
+
 
 class RenderEngine
 {
@@ -142,7 +254,74 @@ class RenderEngine
 
      bool rectIntersect(float x1, float y1, float w1, float h1, float x2, float y2, float w2, float h2);
 
+     void setRetainedRenderingMode(int iMode);
+     int getRetainedRenderingMode();
+     void invalidateRetainedFrames();
+     void beginLayer(u32 uLayerId);
+     void endLayer();
+     // Percent of the screen redrawn in the last frames (smoothed)
+     float getRetainedRepaintPercent();
+
+     // Frames composed and drawn by a separate render thread.
+     // lockFrames()/unlockFrames() (recursive) serialize the use of the engine between threads:
+     // frames, text measuring and resources (fonts, images, icons) are used with it locked.
+     // In deferred mode endFrame() only keeps the recorded frame (an immutable snapshot of the
+     // draw calls and their state); rasterizeDeferredFrame() then draws it and shows it.
+     void lockFrames();
+     void unlockFrames();
+     bool supportsDeferredFrames();
+     void setDeferredFrames(bool bDeferred);
+     bool isDeferredFramePending();
+     virtual bool rasterizeDeferredFrame();
+
+     // Profiling: time spent between beginLayer/endLayer, per layer id (nested layers are included in the parent).
+     // In retained mode this is the time to record the draw calls, the drawing is done in endFrame.
+     void enableLayerTimings(bool bEnable);
+     void resetLayerTimings();
+     int getLayerTimings(u32* puLayerIds, u32* puTotalMicros, u32* puCounts, int iMaxLayers);
+
+     // Saves the frame currently shown to a PNG file
+     virtual bool saveFrameToPNG(const char* szFileName);
+
+     // Draw caches: keep a copy of the draw calls done between beginDrawCache/endDrawCache, so that
+     // drawCache() can add them to later frames without running the code that made them.
+     // Available only while the frame is recorded (retained rendering or deferred frames).
+     // Caches are invalidated when fonts, images or icons are freed or the resolution changes.
+     bool canUseDrawCaches();
+     u32 createDrawCache();
+     void freeDrawCache(u32 uCacheId);
+     void invalidateDrawCache(u32 uCacheId);
+     bool isDrawCacheValid(u32 uCacheId);
+     bool beginDrawCache(u32 uCacheId);
+     void endDrawCache();
+     bool drawCache(u32 uCacheId);
+
    protected:
+      void _timedLayerBegin(u32 uLayerId);
+      void _timedLayerEnd();
+      bool _retainedStartFrame();
+      void _retainedEndFrame();
+      void _retainedFlushToImmediate();
+      void _retainedReplay(bool bAll);
+      int _retainedGetLayer(u32 uLayerId);
+      bool _retainedRecord(int iType, float x1, float y1, float x2, float y2, const float* pfParams, int iCountF, const int* piParams, int iCountI, const void* pData, int iDataSize);
+      void _retainedAppendCommand(type_render_retained_command* pCmd, const type_render_retained_state* pState, const void* pData, int iDataSize);
+      void _drawCacheAddCommand(const type_render_retained_command* pCmd, const type_render_retained_state* pState, const void* pData);
+      void _invalidateAllDrawCaches();
+      bool _retainedGrowBuffers(int iDataSize);
+      void _retainedCaptureState(type_render_retained_state* pState);
+      void _retainedApplyState(const type_render_retained_state* pState);
+      void _retainedAddDamage(type_render_damage* pDamage, const type_render_rect* pRect);
+      void _retainedComputeDamage(type_render_damage* pDamage);
+      void _retainedDiffLayers(type_render_damage* pDamage, const type_render_retained_layer* pLayer, const type_render_retained_layer* pPrevLayer);
+      int _retainedMarkCommandsToRedraw(type_render_damage* pDamage);
+      void _retainedExecuteCommand(const type_render_retained_command* pCmd);
+      void _retainedDrawDebugOverlay(const type_render_damage* pChanges);
+      bool _retainedSaveFrameInfo();
+      // Implemented by engines that support retained rendering (draw directly to the back buffer)
+      virtual void _retainedClearRect(const type_render_rect* pRect);
+      virtual void _retainedClearAll();
+
       virtual int _getRawFontIndexFromId(u32 fontId);
       virtual RenderEngineRawFont* _getRawFontFromId(u32 fontId);
       virtual u32 _getRawFontId(RenderEngineRawFont* pRawFont);
@@ -183,6 +362,48 @@ class RenderEngine
       u8 m_uTextFontMixColor[4];
       float m_fStrokeSizePx;
 
+      int m_iRetainedMode;
+      int m_iRetainedBufferAge; // 0: retained rendering not supported by the engine
+      bool m_bRetainedPrevFrameValid;
+      bool m_bRetainedRecording;
+      bool m_bRetainedReplaying;
+      type_render_retained_command* m_pRetainedCommands;
+      type_render_retained_state* m_pRetainedStates;
+      int m_iRetainedCountCommands;
+      int m_iRetainedCountStates;
+      int m_iRetainedMaxCommands;
+      u8* m_pRetainedData;
+      u32 m_uRetainedDataSize;
+      u32 m_uRetainedMaxDataSize;
+      type_render_retained_command_info* m_pRetainedInfos[2]; // current, previous frame
+      int m_iRetainedMaxInfos[2];
+      type_render_retained_layer m_RetainedLayers[2][RENDER_RETAINED_MAX_LAYERS];
+      int m_iRetainedCountLayers[2];
+      int m_iRetainedLayersStack[4];
+      int m_iRetainedLayersStackDepth;
+      u32 m_uRetainedAutoLayerIndex;
+      int m_iRetainedCurrentAutoLayer;
+      u32 m_uRetainedLastStateHash;
+      type_render_damage m_RetainedDamageHistory;
+      type_render_damage m_RetainedDebugOverlay;
+      float m_fRetainedRepaintPercent;
+
+      pthread_mutex_t m_MutexFrames;
+      bool m_bDeferredFrames;
+      bool m_bDeferredFramePending;
+
+      bool m_bLayerTimings;
+      int m_iCountTimedLayers;
+      u32 m_uTimedLayersIds[RENDER_MAX_TIMED_LAYERS];
+      u32 m_uTimedLayersMicros[RENDER_MAX_TIMED_LAYERS];
+      u32 m_uTimedLayersCounts[RENDER_MAX_TIMED_LAYERS];
+      u32 m_uTimedLayersStackIds[4];
+      u32 m_uTimedLayersStackStart[4];
+      int m_iTimedLayersStackDepth;
+
+      type_render_draw_cache m_DrawCaches[RENDER_MAX_DRAW_CACHES];
+      int m_iActiveDrawCache;
+
       RenderEngineRawFont* m_pRawFonts[MAX_RAW_FONTS];
       u32 m_RawFontIds[MAX_RAW_FONTS];
       u32 m_CurrentRawFontId;
@@ -34,6 +34,7 @@
 #include "../base/config.h"
 #include "render_engine_cairo.h"
 #include "drm_core.h"
+#include "render_spans.h"
 
 #include <stdio.h>
 #include <stdlib.h>
@@ -96,12 +97,19 @@ RenderEngineCairo::RenderEngineCairo()
    m_iCountIcons = 0;
    m_CurrentImageId = 0;
    m_CurrentIconId = 0;
+
+   _textCacheInit();
+
+   // Draws on the DRM back buffer: it has the content from two frames ago
+   m_iRetainedBufferAge = 2;
    log_line("[RenderEngineCairo] Render init done.");
 }
 
 
 RenderEngineCairo::~RenderEngineCairo()
 {
+   _textCacheFree();
+
    if ( NULL != m_pCairoCtx )
       cairo_destroy(m_pCairoCtx);
    m_pCairoCtx = NULL; 
@@ -117,19 +125,28 @@ RenderEngineCairo::~RenderEngineCairo()
 
 void* RenderEngineCairo::getDrawContext()
 {
+   // Caller draws directly on the buffer: can't keep track of the frame content
+   _retainedFlushToImmediate();
    return m_pCairoCtx;
 }
 
 
 void RenderEngineCairo::startFrame()
 {
+   lockFrames();
    if ( m_bStartedFrame )
    {
+      unlockFrames();
       log_softerror_and_alarm("[RenderEngineCairo] Tried to double start a render frame.");
       return;
    }
 
+   // A deferred frame that was not drawn yet is drawn now, so no frame is skipped
+   if ( m_bDeferredFramePending )
+      rasterizeDeferredFrame();
+
    RenderEngine::startFrame();
+   unlockFrames();
 
    if ( NULL != m_pCairoTempCtx )
       cairo_destroy(m_pCairoTempCtx);
@@ -140,7 +157,9 @@ void RenderEngineCairo::startFrame()
    
    type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
    
-   memset(pOutputBufferInfo->pData, m_uClearBufferByte, pOutputBufferInfo->uSize);
+   // In retained mode, only the damaged areas are cleared, in endFrame
+   if ( ! _retainedStartFrame() )
+      memset(pOutputBufferInfo->pData, m_uClearBufferByte, pOutputBufferInfo->uSize);
    
    if ( NULL != m_pCairoCtx )
       cairo_destroy(m_pCairoCtx);
@@ -160,12 +179,35 @@ void RenderEngineCairo::startFrame()
 
 void RenderEngineCairo::endFrame()
 {
+   lockFrames();
    if ( ! m_bStartedFrame )
    {
+      unlockFrames();
       log_softerror_and_alarm("[RenderEngineCairo] Tried to double end a render frame.");
       return;
    }
 
+   // Drawn later, by rasterizeDeferredFrame(), if it was recorded
+   m_bDeferredFramePending = true;
+   if ( (! m_bDeferredFrames) || (! m_bRetainedRecording) )
+      rasterizeDeferredFrame();
+   RenderEngine::endFrame();
+   unlockFrames();
+}
+
+// Draws the recorded frame on the back buffer and shows it
+bool RenderEngineCairo::rasterizeDeferredFrame()
+{
+   lockFrames();
+   if ( ! m_bDeferredFramePending )
+   {
+      unlockFrames();
+      return false;
+   }
+   m_bDeferredFramePending = false;
+
+   _retainedEndFrame();
+
    if ( NULL != m_pCairoCtx )
       cairo_destroy(m_pCairoCtx);
    m_pCairoCtx = NULL; 
@@ -175,7 +217,8 @@ void RenderEngineCairo::endFrame()
    m_pCairoTempCtx = NULL;
 
    ruby_drm_swap_mainback_buffers();
-   RenderEngine::endFrame();
+   unlockFrames();
+   return true;
 }
 
 
@@ -283,9 +326,11 @@ u32 RenderEngineCairo::loadImage(const char* szFile)
    else
       log_softerror_and_alarm("[RenderEngineCairo] Failed to load image %s", szFile);
 
+   lockFrames();
    m_CurrentImageId++;
    m_ImageIds[m_iCountImages] = m_CurrentImageId;
    m_iCountImages++;
+   unlockFrames();
    return m_CurrentImageId;
 }
 
@@ -303,6 +348,7 @@ void RenderEngineCairo::freeImage(u32 idImage)
    if ( -1 == indexImage )
       return;
 
+   lockFrames();
    cairo_surface_destroy(m_pImages[indexImage]);
 
    for( int i=indexImage; i<m_iCountImages-1; i++ )
@@ -311,6 +357,8 @@ void RenderEngineCairo::freeImage(u32 idImage)
       m_ImageIds[i] = m_ImageIds[i+1];
    }
    m_iCountImages--;
+   _invalidateAllDrawCaches();
+   unlockFrames();
 }
 
 u32 RenderEngineCairo::loadIcon(const char* szFile)
@@ -342,9 +390,11 @@ u32 RenderEngineCairo::loadIcon(const char* szFile)
    //_buildMipImage(m_pIcons[m_iCountIcons], m_pIconsMip[m_iCountIcons][0]);
    //_buildMipImage(m_pIconsMip[m_iCountIcons][0], m_pIconsMip[m_iCountIcons][1]);
 
+   lockFrames();
    m_CurrentIconId++;
    m_IconIds[m_iCountIcons] = m_CurrentIconId;
    m_iCountIcons++;
+   unlockFrames();
    return m_CurrentIconId;
 }
 
@@ -362,6 +412,7 @@ void RenderEngineCairo::freeIcon(u32 idIcon)
    if ( -1 == indexIcon )
       return;
 
+   lockFrames();
    cairo_surface_destroy(m_pIcons[indexIcon]);
    if ( NULL != m_pIconsMip[indexIcon][0] )
       cairo_surface_destroy(m_pIconsMip[indexIcon][0]);
@@ -376,6 +427,8 @@ void RenderEngineCairo::freeIcon(u32 idIcon)
       m_IconIds[i] = m_IconIds[i+1];
    }
    m_iCountIcons--;
+   _invalidateAllDrawCaches();
+   unlockFrames();
 }
 
 int RenderEngineCairo::getImageWidth(u32 uImageId)
@@ -420,6 +473,7 @@ int RenderEngineCairo::getImageHeight(u32 uImageId)
 
 void RenderEngineCairo::changeImageHue(u32 uImageId, u8 r, u8 g, u8 b)
 {
+   invalidateRetainedFrames();
    if ( uImageId < 1 )
       return;
 
@@ -441,6 +495,7 @@ void RenderEngineCairo::changeImageHue(u32 uImageId, u8 r, u8 g, u8 b)
    int iImageStride = cairo_image_surface_get_stride((cairo_surface_t*)m_pImages[indexImage]);
    u8* pImageData = cairo_image_surface_get_data((cairo_surface_t*)m_pImages[indexImage]);
 
+   lockFrames();
    for( int y=0; y<iHeight; y++ )
    {
       u8* pDestLine = (u8*)(pImageData + y * iImageStride);
@@ -457,14 +512,46 @@ void RenderEngineCairo::changeImageHue(u32 uImageId, u8 r, u8 g, u8 b)
          pDestLine += 4;
       }
    }
+   unlockFrames();
 }
 
 void RenderEngineCairo::rotate180()
 {
 }
 
+bool RenderEngineCairo::saveFrameToPNG(const char* szFileName)
+{
+   if ( (NULL == szFileName) || (0 == szFileName[0]) )
+      return false;
+
+   lockFrames();
+   cairo_surface_t* pSurface = NULL;
+   u32 uBufferId = ruby_drm_core_get_main_draw_buffer_id();
+   if ( uBufferId == m_uRenderDrawSurfacesIds[0] )
+      pSurface = m_pMainCairoSurface[0];
+   if ( uBufferId == m_uRenderDrawSurfacesIds[1] )
+      pSurface = m_pMainCairoSurface[1];
+
+   bool bResult = false;
+   if ( NULL != pSurface )
+   {
+      cairo_surface_flush(pSurface);
+      bResult = (CAIRO_STATUS_SUCCESS == cairo_surface_write_to_png(pSurface, szFileName));
+   }
+   unlockFrames();
+   if ( ! bResult )
+      log_softerror_and_alarm("[RenderEngineCairo] Failed to save frame to file: %s", szFileName);
+   return bResult;
+}
+
 void RenderEngineCairo::drawImage(float xPos, float yPos, float fWidth, float fHeight, u32 uImageId)
 {
+   // The image is painted over the whole screen
+   float fParams[4] = { xPos, yPos, fWidth, fHeight };
+   int iParams[1] = { (int)uImageId };
+   if ( _retainedRecord(RENDER_CMD_IMAGE, 0.0, 0.0, 1.0, 1.0, fParams, 4, iParams, 1, NULL, 0) )
+      return;
+
    if ( uImageId < 1 )
       return;
 
@@ -493,6 +580,11 @@ void RenderEngineCairo::drawImage(float xPos, float yPos, float fWidth, float fH
 
 void RenderEngineCairo::drawImageAlpha(float xPos, float yPos, float fWidth, float fHeight, u32 uImageId, u8 uAlpha)
 {
+   float fParams[4] = { xPos, yPos, fWidth, fHeight };
+   int iParams[2] = { (int)uImageId, (int)uAlpha };
+   if ( _retainedRecord(RENDER_CMD_IMAGE_ALPHA, 0.0, 0.0, 1.0, 1.0, fParams, 4, iParams, 2, NULL, 0) )
+      return;
+
    // uAlpha is 0..255
 
    if ( uImageId < 1 )
@@ -533,6 +625,11 @@ void RenderEngineCairo::drawImageAlpha(float xPos, float yPos, float fWidth, flo
 
 void RenderEngineCairo::bltImage(float xPosDest, float yPosDest, float fWidthDest, float fHeightDest, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, u32 uImageId)
 {
+   float fParams[4] = { xPosDest, yPosDest, fWidthDest, fHeightDest };
+   int iParams[5] = { iSrcX, iSrcY, iSrcWidth, iSrcHeight, (int)uImageId };
+   if ( _retainedRecord(RENDER_CMD_BLT_IMAGE, xPosDest, yPosDest, xPosDest + fWidthDest, yPosDest + fHeightDest, fParams, 4, iParams, 5, NULL, 0) )
+      return;
+
    if ( uImageId < 1 )
       return;
 
@@ -625,6 +722,11 @@ void RenderEngineCairo::bltImage(float xPosDest, float yPosDest, float fWidthDes
 
 void RenderEngineCairo::bltSprite(float xPosDest, float yPosDest, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, u32 uImageId)
 {
+   float fParams[2] = { xPosDest, yPosDest };
+   int iParams[5] = { iSrcX, iSrcY, iSrcWidth, iSrcHeight, (int)uImageId };
+   if ( _retainedRecord(RENDER_CMD_BLT_SPRITE, xPosDest, yPosDest, xPosDest + iSrcWidth * m_fPixelWidth, yPosDest + iSrcHeight * m_fPixelHeight, fParams, 2, iParams, 5, NULL, 0) )
+      return;
+
    if ( uImageId < 1 )
       return;
 
@@ -653,46 +755,25 @@ void RenderEngineCairo::bltSprite(float xPosDest, float yPosDest, int iSrcX, int
    int iSrcImageStride = cairo_image_surface_get_stride(m_pImages[indexImage]);
 
    // Input, output surface format order is: BGRA
-   u8 r = 255, g = 255, b = 255, a = 255;
-
    u8* pDestPixel = (u8*)&(pOutputBufferInfo->pData[yDest*pOutputBufferInfo->uStride + xDest*4]);
    u8* pSrcPixel = pSrcImageData + iSrcY * iSrcImageStride + iSrcX * 4;
 
+   // Source pixels tinted by the fill color, blended over the output
    for( int sy=0; sy<iSrcHeight; sy++ )
    {
-      for( int sx=0; sx<iSrcWidth; sx++ )
-      {   
-         // Output surface format order is: BGRA
-         
-         b = *pSrcPixel++;
-         g = *pSrcPixel++;
-         r = *pSrcPixel++;
-         a = *pSrcPixel++;
-
-         if ( a > 4 )
-         {
-            b = (((b*m_ColorFill[2])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
-            *pDestPixel++ = b;
-
-            g = (((g*m_ColorFill[1])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
-            *pDestPixel++ = g;
-
-            r = (((r*m_ColorFill[0])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
-            *pDestPixel++ = r;
-
-            a = (((a*m_ColorFill[3])>>8) * a + ((*pDestPixel)*(255-a)))>>8;
-            *pDestPixel++ = a;
-         }
-         else
-            pDestPixel += 4;
-      }
-      pDestPixel += pOutputBufferInfo->uStride - iSrcWidth * 4;
-      pSrcPixel += iSrcImageStride - iSrcWidth * 4;
+      render_span_blend_tinted(pDestPixel, pSrcPixel, iSrcWidth, m_ColorFill);
+      pDestPixel += pOutputBufferInfo->uStride;
+      pSrcPixel += iSrcImageStride;
    } 
 }
 
 void RenderEngineCairo::drawIcon(float xPos, float yPos, float fWidth, float fHeight, u32 uIconId)
 {
+   float fParams[4] = { xPos, yPos, fWidth, fHeight };
+   int iParams[1] = { (int)uIconId };
+   if ( _retainedRecord(RENDER_CMD_ICON, xPos, yPos, xPos + fWidth, yPos + fHeight, fParams, 4, iParams, 1, NULL, 0) )
+      return;
+
    if ( uIconId < 1 )
       return;
 
@@ -787,6 +868,11 @@ void RenderEngineCairo::drawIcon(float xPos, float yPos, float fWidth, float fHe
 
 void RenderEngineCairo::bltIcon(float xPosDest, float yPosDest, int iSrcX, int iSrcY, int iSrcWidth, int iSrcHeight, u32 uIconId)
 {
+   float fParams[2] = { xPosDest, yPosDest };
+   int iParams[5] = { iSrcX, iSrcY, iSrcWidth, iSrcHeight, (int)uIconId };
+   if ( _retainedRecord(RENDER_CMD_BLT_ICON, xPosDest, yPosDest, xPosDest + iSrcWidth * m_fPixelWidth, yPosDest + iSrcHeight * m_fPixelHeight, fParams, 2, iParams, 5, NULL, 0) )
+      return;
+
    if ( uIconId < 1 )
       return;
 
@@ -822,21 +908,7 @@ void RenderEngineCairo::bltIcon(float xPosDest, float yPosDest, int iSrcX, int i
       u8* pSrcLine = pSrcImageData + ((iSrcY +y)* iSrcImageStride);
       pSrcLine += 4 * iSrcX;
 
-      for( int x=0; x<iSrcWidth; x++ )
-      {
-          u8 uAlpha = *(pSrcLine+3);
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
-          pDestLine++;
-          pSrcLine++;
-          pDestLine++;
-          pSrcLine++;
-      }
+      render_span_blend_alpha(pDestLine, pSrcLine, iSrcWidth);
    }
 }
 
@@ -844,51 +916,14 @@ void RenderEngineCairo::bltIcon(float xPosDest, float yPosDest, int iSrcX, int i
 inline void RenderEngineCairo::_blend_pixel(unsigned char* pixel, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
    // Output surface format order is: BGRA
-   if ( *(pixel+3) == 0 )
-   {
-      *pixel = b;
-      pixel++;
-      *pixel = g;
-      pixel++;
-      *pixel = r;
-      pixel++;
-      *pixel = a;
-      pixel++;
-   }
-   else if ( *(pixel+3) == 255 )
-   {
-      *pixel = ((a * b + (255 - a) * (*pixel)) >> 8);
-      pixel++;
-      *pixel = ((a * g + (255 - a) * (*pixel)) >> 8);
-      pixel++;
-      *pixel = ((a * r + (255 - a) * (*pixel)) >> 8);
-      pixel++;
-      pixel++;
-   }
-   else
-   {
-       *pixel = ((a * b + (255 - a) * (*pixel)) >> 8);
-       pixel++;
-       *pixel = ((a * g + (255 - a) * (*pixel)) >> 8);
-       pixel++;
-       *pixel = ((a * r + (255 - a) * (*pixel)) >> 8);
-       pixel++;
-       *pixel = (*pixel) + (((255-(*pixel))*a) >> 8);
-       pixel++;
-   }
+   render_span_blend_color(pixel, 1, r, g, b, a);
 }
 
 void RenderEngineCairo::_draw_hline(int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
 {
    type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
    u8* pDestLine = (&(pOutputBufferInfo->pData[0])) + y*pOutputBufferInfo->uStride + 4*x;
-   for( int i=0; i<w; i++ )
-   {
-      *pDestLine++ = b;
-      *pDestLine++ = g;
-      *pDestLine++ = r;
-      *pDestLine++ = a;
-   }
+   render_span_fill(pDestLine, w, r, g, b, a);
 }
 
 void RenderEngineCairo::_draw_vline(int x, int y, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a)
@@ -907,6 +942,10 @@ void RenderEngineCairo::_draw_vline(int x, int y, int h, unsigned char r, unsign
       
 void RenderEngineCairo::drawLine(float x1, float y1, float x2, float y2)
 {
+   float fParams[4] = { x1, y1, x2, y2 };
+   if ( _retainedRecord(RENDER_CMD_LINE, x1, y1, x2, y2, fParams, 4, NULL, 0, NULL, 0) )
+      return;
+
    if ( fabs(y1-y2) < 0.0001 )
    {
       if ( x1 < 0 )
@@ -974,6 +1013,10 @@ void RenderEngineCairo::drawLine(float x1, float y1, float x2, float y2)
 
 void RenderEngineCairo::drawRect(float xPos, float yPos, float fWidth, float fHeight)
 {   
+   float fParams[4] = { xPos, yPos, fWidth, fHeight };
+   if ( _retainedRecord(RENDER_CMD_RECT, xPos, yPos, xPos + fWidth, yPos + fHeight, fParams, 4, NULL, 0, NULL, 0) )
+      return;
+
    int xSt = xPos*m_iRenderWidth;
    int ySt = yPos*m_iRenderHeight;
    int w = fWidth*m_iRenderWidth;
@@ -1034,15 +1077,8 @@ void RenderEngineCairo::drawRect(float xPos, float yPos, float fWidth, float fHe
       {
          u8* pDestLine = (u8*)&(pOutputBufferInfo->pData[(ySt+y)*pOutputBufferInfo->uStride]);
          pDestLine += 4*xSt;
-         for( int x=0; x<w; x++ )
-         {
-            //_blend_pixel(pDestLine, r,g,b,a);
-            //pDestLine += 4;
-            *pDestLine++ = b;
-            *pDestLine++ = g;
-            *pDestLine++ = r;
-            *pDestLine++ = a;
-         }
+         //render_span_blend_color(pDestLine, w, r,g,b,a);
+         render_span_fill(pDestLine, w, r,g,b,a);
       }
    }
    if ( m_ColorStroke[3] > 2 )
@@ -1081,6 +1117,10 @@ void RenderEngineCairo::drawRect(float xPos, float yPos, float fWidth, float fHe
 
 void RenderEngineCairo::drawRoundRect(float xPos, float yPos, float fWidth, float fHeight, float fCornerRadius)
 {
+   float fParams[5] = { xPos, yPos, fWidth, fHeight, fCornerRadius };
+   if ( _retainedRecord(RENDER_CMD_ROUND_RECT, xPos, yPos, xPos + fWidth, yPos + fHeight, fParams, 5, NULL, 0, NULL, 0) )
+      return;
+
    int xSt = xPos*m_iRenderWidth;
    int ySt = yPos*m_iRenderHeight;
    int w = fWidth*m_iRenderWidth;
@@ -1123,15 +1163,8 @@ void RenderEngineCairo::drawRoundRect(float xPos, float yPos, float fWidth, floa
       {
          u8* pDestLine = (u8*)&(pOutputBufferInfo->pData[(ySt+y)*pOutputBufferInfo->uStride]);
          pDestLine += 4*(xSt+3);
-         for( int x=0; x<(w-5); x++ )
-         {
-            //_blend_pixel(pDestLine, r,g,b,a);
-            //pDestLine += 4;
-            *pDestLine++ = b;
-            *pDestLine++ = g;
-            *pDestLine++ = r;
-            *pDestLine++ = a;
-         }
+         //render_span_blend_color(pDestLine, w-5, r,g,b,a);
+         render_span_fill(pDestLine, w-5, r,g,b,a);
       }
   
       _draw_vline(xSt+2, ySt+1, h-2 , r,g,b,a);
@@ -1198,6 +1231,10 @@ void RenderEngineCairo::drawRoundRect(float xPos, float yPos, float fWidth, floa
 
 void RenderEngineCairo::drawRoundRectMenu(float xPos, float yPos, float fWidth, float fHeight, float fCornerRadius)
 {
+   float fParams[5] = { xPos, yPos, fWidth, fHeight, fCornerRadius };
+   if ( _retainedRecord(RENDER_CMD_ROUND_RECT_MENU, xPos, yPos, xPos + fWidth, yPos + fHeight, fParams, 5, NULL, 0, NULL, 0) )
+      return;
+
    if ( m_ColorFill[3] < 150 )
    {
       drawRoundRect(xPos, yPos, fWidth, fHeight, fCornerRadius);
@@ -1285,6 +1322,10 @@ void RenderEngineCairo::drawRoundRectMenu(float xPos, float yPos, float fWidth,
 
 void RenderEngineCairo::drawTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
 {
+   float fParams[6] = { x1, y1, x2, y2, x3, y3 };
+   if ( _retainedRecord(RENDER_CMD_TRIANGLE, fminf(x1, fminf(x2, x3)), fminf(y1, fminf(y2, y3)), fmaxf(x1, fmaxf(x2, x3)), fmaxf(y1, fmaxf(y2, y3)), fParams, 6, NULL, 0, NULL, 0) )
+      return;
+
    cairo_move_to (m_pCairoCtx, x1 * m_iRenderWidth, y1 * m_iRenderHeight); 
    cairo_line_to (m_pCairoCtx, x2 * m_iRenderWidth, y2 * m_iRenderHeight);
    cairo_line_to (m_pCairoCtx, x3 * m_iRenderWidth, y3 * m_iRenderHeight);
@@ -1295,6 +1336,10 @@ void RenderEngineCairo::drawTriangle(float x1, float y1, float x2, float y2, flo
 
 void RenderEngineCairo::fillTriangle(float x1, float y1, float x2, float y2, float x3, float y3)
 {
+   float fParams[6] = { x1, y1, x2, y2, x3, y3 };
+   if ( _retainedRecord(RENDER_CMD_FILL_TRIANGLE, fminf(x1, fminf(x2, x3)), fminf(y1, fminf(y2, y3)), fmaxf(x1, fmaxf(x2, x3)), fmaxf(y1, fmaxf(y2, y3)), fParams, 6, NULL, 0, NULL, 0) )
+      return;
+
    cairo_move_to (m_pCairoCtx, x1 * m_iRenderWidth, y1 * m_iRenderHeight); 
    cairo_line_to (m_pCairoCtx, x2 * m_iRenderWidth, y2 * m_iRenderHeight);
    cairo_line_to (m_pCairoCtx, x3 * m_iRenderWidth, y3 * m_iRenderHeight);
@@ -1322,8 +1367,31 @@ void RenderEngineCairo::fillTriangle(float x1, float y1, float x2, float y2, flo
 }
 
 
+bool RenderEngineCairo::_recordPolygon(int iType, float* x, float* y, int count)
+{
+   if ( (! m_bRetainedRecording) || m_bRetainedReplaying || (count < 1) || (count > 120) )
+      return false;
+
+   float fPoints[240];
+   float xMin = x[0], xMax = x[0], yMin = y[0], yMax = y[0];
+   for( int i=0; i<count; i++ )
+   {
+      fPoints[i] = x[i];
+      fPoints[count+i] = y[i];
+      xMin = fminf(xMin, x[i]);
+      xMax = fmaxf(xMax, x[i]);
+      yMin = fminf(yMin, y[i]);
+      yMax = fmaxf(yMax, y[i]);
+   }
+   int iParams[1] = { count };
+   return _retainedRecord(iType, xMin, yMin, xMax, yMax, NULL, 0, iParams, 1, fPoints, 2*count*sizeof(float));
+}
+
 void RenderEngineCairo::drawPolyLine(float* x, float* y, int count)
 {
+   if ( _recordPolygon(RENDER_CMD_POLYLINE, x, y, count) )
+      return;
+
    for( int i=0; i<count-1; i++ )
       drawLine(x[i], y[i], x[i+1], y[i+1]);
    drawLine(x[count-1], y[count-1], x[0], y[0]);
@@ -1331,6 +1399,9 @@ void RenderEngineCairo::drawPolyLine(float* x, float* y, int count)
 
 void RenderEngineCairo::fillPolygon(float* x, float* y, int count)
 {
+   if ( _recordPolygon(RENDER_CMD_FILL_POLYGON, x, y, count) )
+      return;
+
 if ( count < 3 || count > 120 )
       return;
    float xIntersections[256];
@@ -1417,6 +1488,10 @@ if ( count < 3 || count > 120 )
 
 void RenderEngineCairo::fillCircle(float x, float y, float r)
 {
+   float fParams[3] = { x, y, r };
+   if ( _retainedRecord(RENDER_CMD_FILL_CIRCLE, x - r * m_iRenderHeight * m_fPixelWidth, y - r, x + r * m_iRenderHeight * m_fPixelWidth, y + r, fParams, 3, NULL, 0, NULL, 0) )
+      return;
+
    if ( m_ColorFill[3] > 2 )
    {
       cairo_set_source_rgba(m_pCairoCtx, m_ColorFill[0]/255.0, m_ColorFill[1]/255.0, m_ColorFill[2]/255.0, m_ColorFill[3]/255.0);
@@ -1438,6 +1513,10 @@ void RenderEngineCairo::fillCircle(float x, float y, float r)
 
 void RenderEngineCairo::drawCircle(float x, float y, float r)
 {
+   float fParams[3] = { x, y, r };
+   if ( _retainedRecord(RENDER_CMD_CIRCLE, x - r * m_iRenderHeight * m_fPixelWidth, y - r, x + r * m_iRenderHeight * m_fPixelWidth, y + r, fParams, 3, NULL, 0, NULL, 0) )
+      return;
+
    if ( m_ColorStroke[3] > 2 )
    {
       cairo_set_source_rgba(m_pCairoCtx, m_ColorStroke[0]/255.0, m_ColorStroke[1]/255.0, m_ColorStroke[2]/255.0, m_ColorStroke[3]/255.0);
@@ -1528,20 +1607,38 @@ void RenderEngineCairo::_updateCurrentFontToUse(RenderEngineRawFont* pFont, bool
    //cairo_select_font_face(pCairoCtx, "Noto Sans SC", CAIRO_FONT_SLANT_NORMAL, CAIRO_FONT_WEIGHT_NORMAL);
 }
 
+// Can be called outside of frames, from other threads than the one drawing the frames
 float RenderEngineCairo::textRawWidthScaled(u32 fontId, float fScale, const char* szText)
+{
+   lockFrames();
+   float fWidth = _textRawWidthScaled(fontId, fScale, szText);
+   unlockFrames();
+   return fWidth;
+}
+
+float RenderEngineCairo::_textRawWidthScaled(u32 fontId, float fScale, const char* szText)
 {
    RenderEngineRawFont* pFont = _getRawFontFromId(fontId);
    if ( (NULL == pFont) || (NULL == szText) || (0 == szText[0]) )
       return 0.0;
 
+   int iPixels = pFont->lineHeight*0.8*fScale;
+   if ( iPixels < 6 )
+      iPixels = 6;
+
+   float fWidthPixelsGlyphs = 0.0;
+   if ( _textCacheGetWidth(pFont, iPixels, szText, &fWidthPixelsGlyphs) )
+   {
+      if ( fWidthPixelsGlyphs <= 1.0 )
+         return 0.0;
+      return fWidthPixelsGlyphs * m_fPixelWidth * fScale;
+   }
+
    cairo_t* pCairoCtx = _getActiveCairoContext();
    if ( NULL == pCairoCtx )
        pCairoCtx = _createTempDrawContext();
    
    _updateCurrentFontToUse(pFont, false);
-   int iPixels = pFont->lineHeight*0.8*fScale;
-   if ( iPixels < 6 )
-      iPixels = 6;
    cairo_set_font_size(pCairoCtx, iPixels);
 
    char szTxt[256];
@@ -1577,8 +1674,6 @@ float RenderEngineCairo::textRawWidthScaled(u32 fontId, float fScale, const char
       return 0.0;
    }
 
-   float fWidthPixelsGlyphs = 0.0;
-
    int glyph_index = 0;
    int byte_index = 0;
    for (int i = 0; i<cluster_count; i++)
@@ -1599,6 +1694,7 @@ float RenderEngineCairo::textRawWidthScaled(u32 fontId, float fScale, const char
    if ( NULL != clusters )
       cairo_text_cluster_free(clusters);
  
+   _textCacheAddWidth(pFont, iPixels, szTxt, fWidthPixelsGlyphs);
    if ( fWidthPixelsGlyphs <= 1.0 )
       return 0.0;
 
@@ -1696,7 +1792,8 @@ void RenderEngineCairo::_drawSimpleTextScaled(RenderEngineRawFont* pFont, const
       log_softerror_and_alarm("[RenderEngineCairo] Tried to draw NULL or empty string.");
       return;
    }
-   if ( ! m_bStartedFrame )
+   // Deferred frames are replayed after endFrame
+   if ( (! m_bStartedFrame) && (! m_bRetainedReplaying) )
    {
       log_error_and_alarm("[RenderEngineCairo] Tried to draw using outside of render frame");
       return;
@@ -1721,6 +1818,25 @@ void RenderEngineCairo::_drawSimpleTextScaled(RenderEngineRawFont* pFont, const
       log_softerror_and_alarm("[RenderEngineCairo] Tried to draw an invalid text (%s)", szTxt);
       return;
    }
+
+   if ( m_bRetainedRecording && (! m_bRetainedReplaying) )
+   {
+      // Glyphs can go a bit outside of the line height and advance width
+      float fScaleBox = (fScale > 1.0)?fScale:1.0;
+      float fMarginX = 0.1 * pFont->lineHeight * fScaleBox * m_fPixelWidth;
+      float fMarginY = 0.25 * pFont->lineHeight * fScaleBox * m_fPixelHeight;
+      if ( m_bDrawBackgroundBoundingBoxes )
+      {
+         fMarginX += _get_raw_space_width(pFont) + m_fBoundingBoxPadding/getAspectRatio();
+         fMarginY += m_fBoundingBoxPadding;
+      }
+      float fParams[3] = { xPos, yPos, fScale };
+      int iParams[1] = { (int)uFontId };
+      if ( _retainedRecord(RENDER_CMD_TEXT, xPos - fMarginX, yPos - fMarginY,
+              xPos + fRenderWidth + fMarginX, yPos + pFont->lineHeight * fScaleBox * m_fPixelHeight + fMarginY,
+              fParams, 3, iParams, 1, szTxt, strlen(szTxt)+1) )
+         return;
+   }
    if ( m_bDrawBackgroundBoundingBoxes )
       _drawSimpleTextBoundingBox(pFont, szTxt, xPos, yPos, 1.0);
 
@@ -1742,13 +1858,16 @@ void RenderEngineCairo::_drawSimpleTextScaled(RenderEngineRawFont* pFont, const
    if ( (fColor[3] < 0.25) || (fColor[3] >= 1.0) )
       fColor[3] = 1.0;
 
-   cairo_set_source_rgba(m_pCairoCtx, fColor[0], fColor[1], fColor[2], fColor[3]);
-   cairo_move_to(m_pCairoCtx, xPos * m_iRenderWidth, yPos * m_iRenderHeight + pFont->baseLine);
-   _updateCurrentFontToUse(pFont, false);
    int iPixels = pFont->lineHeight*0.8;
    if ( iPixels < 6 )
       iPixels = 6;
 
+   if ( _drawCachedText(pFont, iPixels, szTxt, xPos * m_iRenderWidth, yPos * m_iRenderHeight + pFont->baseLine, fColor) )
+      return;
+
+   cairo_set_source_rgba(m_pCairoCtx, fColor[0], fColor[1], fColor[2], fColor[3]);
+   cairo_move_to(m_pCairoCtx, xPos * m_iRenderWidth, yPos * m_iRenderHeight + pFont->baseLine);
+   _updateCurrentFontToUse(pFont, false);
    cairo_set_font_size(m_pCairoCtx, iPixels);
    cairo_show_text(m_pCairoCtx, szTxt);
 }
@@ -1772,20 +1891,30 @@ void RenderEngineCairo::_bltFontChar(int iDestX, int iDestY, int iSrcX, int iSrc
       u8* pSrcLine = pSrcImageData + ((iSrcY +y)* iSrcImageStride);
       pSrcLine += 4 * iSrcX;
 
-      for( int x=0; x<iSrcWidth; x++ )
-      {
-          u8 uAlpha = *(pSrcLine+3);
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
-          pDestLine++;
-          pSrcLine++;
-          *pDestLine = ((*(pSrcLine)) * uAlpha + (*(pDestLine)) * (255-uAlpha))/256;
-          pDestLine++;
-          pSrcLine++;
-          pDestLine++;
-          pSrcLine++;
-      }
+      render_span_blend_alpha(pDestLine, pSrcLine, iSrcWidth);
+   }
+}
+
+void RenderEngineCairo::_retainedClearRect(const type_render_rect* pRect)
+{
+   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   int x1 = (pRect->x1 < 0)?0:pRect->x1;
+   int y1 = (pRect->y1 < 0)?0:pRect->y1;
+   int x2 = (pRect->x2 > (int)pOutputBufferInfo->uWidth)?(int)pOutputBufferInfo->uWidth:pRect->x2;
+   int y2 = (pRect->y2 > (int)pOutputBufferInfo->uHeight)?(int)pOutputBufferInfo->uHeight:pRect->y2;
+   if ( (x1 >= x2) || (y1 >= y2) )
+      return;
+
+   u8* pDestLine = pOutputBufferInfo->pData + y1 * pOutputBufferInfo->uStride + x1 * 4;
+   for( int y=y1; y<y2; y++ )
+   {
+      memset(pDestLine, m_uClearBufferByte, (x2-x1)*4);
+      pDestLine += pOutputBufferInfo->uStride;
    }
 }
+
+void RenderEngineCairo::_retainedClearAll()
+{
+   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   memset(pOutputBufferInfo->pData, m_uClearBufferByte, pOutputBufferInfo->uSize);
+}
@@ -3,6 +3,66 @@
 #include "render_engine.h"
 #include <cairo.h>
 
+// Text cache: glyphs rendered once in an A8 atlas per font/size, text runs (glyphs
+// composed in a single coverage mask) and text widths cached by string content
+#define CAIRO_TEXT_MAX_ATLASES 12
+#define CAIRO_TEXT_ATLAS_WIDTH 1024
+#define CAIRO_TEXT_ATLAS_HEIGHT 512
+#define CAIRO_TEXT_ATLAS_MAX_GLYPHS 1024
+#define CAIRO_TEXT_RUN_MAX_LENGTH 64
+#define CAIRO_TEXT_RUNS_CACHE_SIZE 1024
+#define CAIRO_TEXT_RUNS_MAX_BYTES 4000000
+#define CAIRO_TEXT_WIDTHS_CACHE_SIZE 2048
+// Glyphs are rendered at 4 horizontal subpixel positions
+#define CAIRO_TEXT_SUBPIXEL_PHASES 4
+
+typedef struct
+{
+   u32 uGlyphIndex;
+   u8 uPhase;
+   u8 bUsed;
+   short x, y; // Position in the atlas
+   short w, h;
+   short dx, dy; // Position of the glyph mask relative to the glyph origin
+} type_cairo_atlas_glyph;
+
+typedef struct
+{
+   int iFamilyId;
+   bool bBold;
+   int iPixels;
+   u32 uLastUseCounter;
+   cairo_surface_t* pSurface;
+   cairo_t* pCairoCtx;
+   u32 uGeneration; // Incremented each time the atlas is emptied
+   int iShelfX, iShelfY, iShelfHeight;
+   int iCountGlyphs;
+   type_cairo_atlas_glyph glyphs[CAIRO_TEXT_ATLAS_MAX_GLYPHS];
+} type_cairo_glyph_atlas;
+
+typedef struct
+{
+   u32 uHash;
+   int iFamilyId;
+   bool bBold;
+   int iPixels;
+   int iPhase;
+   char szText[CAIRO_TEXT_RUN_MAX_LENGTH];
+   u8* pMask;
+   int iWidth, iHeight;
+   int dx, dy; // Position of the mask relative to the text origin (on the baseline)
+} type_cairo_text_run;
+
+typedef struct
+{
+   u32 uHash;
+   int iFamilyId;
+   bool bBold;
+   int iPixels;
+   float fWidthPixels;
+   char szText[CAIRO_TEXT_RUN_MAX_LENGTH];
+} type_cairo_text_width;
+
 class RenderEngineCairo: public RenderEngine
 {
    public:
@@ -24,6 +84,8 @@ class RenderEngineCairo: public RenderEngine
      
      virtual void startFrame();
      virtual void endFrame();
+     virtual bool rasterizeDeferredFrame();
+     virtual bool saveFrameToPNG(const char* szFileName);
      virtual void rotate180();
 
      virtual void drawImage(float xPos, float yPos, float fWidth, float fHeight, u32 uImageId);
@@ -51,6 +113,7 @@ class RenderEngineCairo: public RenderEngine
    protected:
       cairo_t* _createTempDrawContext();
       cairo_t* _getActiveCairoContext();
+      float _textRawWidthScaled(u32 fontId, float fScale, const char* szText);
       virtual void* _loadRawFontImageObject(const char* szFileName);
       virtual void _freeRawFontImageObject(void* pImageObject);
 
@@ -62,6 +125,20 @@ class RenderEngineCairo: public RenderEngine
       void _blend_pixel(unsigned char* pixel, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
       void _draw_hline(int x, int y, int w, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
       void _draw_vline(int x, int y, int h, unsigned char r, unsigned char g, unsigned char b, unsigned char a);
+      bool _recordPolygon(int iType, float* x, float* y, int count);
+
+      void _textCacheInit();
+      void _textCacheFree();
+      void _textCacheClearRuns();
+      bool _textCacheGetWidth(RenderEngineRawFont* pFont, int iPixels, const char* szText, float* pfWidthPixels);
+      void _textCacheAddWidth(RenderEngineRawFont* pFont, int iPixels, const char* szText, float fWidthPixels);
+      type_cairo_glyph_atlas* _textCacheGetAtlas(RenderEngineRawFont* pFont, int iPixels);
+      type_cairo_atlas_glyph* _textCacheGetGlyph(type_cairo_glyph_atlas* pAtlas, cairo_scaled_font_t* pSFont, u32 uGlyphIndex, int iPhase);
+      type_cairo_text_run* _textCacheGetRun(RenderEngineRawFont* pFont, int iPixels, int iPhase, const char* szText);
+      bool _textCacheBuildRun(type_cairo_text_run* pRun, RenderEngineRawFont* pFont, int iPixels, int iPhase, const char* szText);
+      bool _drawCachedText(RenderEngineRawFont* pFont, int iPixels, const char* szText, float xPixels, float yPixels, const float* pColor);
+      virtual void _retainedClearRect(const type_render_rect* pRect);
+      virtual void _retainedClearAll();
       
       bool m_bUseDoubleBuffering;
       u32 m_uRenderDrawSurfacesIds[2];
@@ -82,5 +159,10 @@ class RenderEngineCairo: public RenderEngine
       u32 m_CurrentIconId;
       int m_iCountIcons;
 
+      type_cairo_glyph_atlas* m_pTextAtlases[CAIRO_TEXT_MAX_ATLASES];
+      u32 m_uTextAtlasesUseCounter;
+      type_cairo_text_run* m_pTextRuns;
+      int m_iTextRunsBytes;
+      type_cairo_text_width* m_pTextWidths;
 
 };
@@ -0,0 +1,502 @@
+/*
+    Ruby Licence
+    Copyright (c) 2020-2025 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and/or use in source and/or binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions and/or use of the source code (partially or complete) must retain
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Redistributions in binary form (partially or complete) must reproduce
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permitted.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE AUTHOR (PETRU SOROAGA) BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Text cache for the Cairo render engine.
+//
+// Shaping and rasterizing the same strings with Cairo on each frame is the biggest part of the
+// OSD render time (the stats panels draw hundreds of mostly unchanged labels per frame). So:
+// - each glyph is rasterized once (per font, size and horizontal subpixel phase) in an A8 atlas;
+// - each text run (font, size, subpixel phase, string) is composed once, from the atlas glyphs,
+//   in a single coverage mask that is then blended directly in the back buffer, in the text color;
+// - text widths are cached by font, size and string.
+// Anything that can't be cached (long strings, full atlas, out of memory) is drawn/measured by Cairo, as before.
+
+#include "../base/base.h"
+#include "render_engine_cairo.h"
+#include "drm_core.h"
+#include "render_spans.h"
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+static u32 _text_cache_hash(int iFamilyId, bool bBold, int iPixels, int iPhase, const char* szText)
+{
+   // FNV-1a
+   u32 uHash = 2166136261U;
+   uHash = (uHash ^ (u32)iFamilyId) * 16777619U;
+   uHash = (uHash ^ (u32)(bBold?1:0)) * 16777619U;
+   uHash = (uHash ^ (u32)iPixels) * 16777619U;
+   uHash = (uHash ^ (u32)iPhase) * 16777619U;
+   while ( *szText )
+   {
+      uHash = (uHash ^ (u8)(*szText)) * 16777619U;
+      szText++;
+   }
+   return uHash;
+}
+
+// a*b/255, rounded
+static inline u32 _mul_un8(u32 a, u32 b)
+{
+   u32 t = a * b + 0x80;
+   return (t + (t >> 8)) >> 8;
+}
+
+void RenderEngineCairo::_textCacheInit()
+{
+   for( int i=0; i<CAIRO_TEXT_MAX_ATLASES; i++ )
+      m_pTextAtlases[i] = NULL;
+   m_uTextAtlasesUseCounter = 0;
+   m_iTextRunsBytes = 0;
+   m_pTextRuns = (type_cairo_text_run*) calloc(CAIRO_TEXT_RUNS_CACHE_SIZE, sizeof(type_cairo_text_run));
+   m_pTextWidths = (type_cairo_text_width*) calloc(CAIRO_TEXT_WIDTHS_CACHE_SIZE, sizeof(type_cairo_text_width));
+   if ( (NULL == m_pTextRuns) || (NULL == m_pTextWidths) )
+      log_softerror_and_alarm("[RenderEngineCairo] Failed to allocate the text cache. Text will not be cached.");
+}
+
+void RenderEngineCairo::_textCacheFree()
+{
+   for( int i=0; i<CAIRO_TEXT_MAX_ATLASES; i++ )
+   {
+      if ( NULL == m_pTextAtlases[i] )
+         continue;
+      if ( NULL != m_pTextAtlases[i]->pCairoCtx )
+         cairo_destroy(m_pTextAtlases[i]->pCairoCtx);
+      if ( NULL != m_pTextAtlases[i]->pSurface )
+         cairo_surface_destroy(m_pTextAtlases[i]->pSurface);
+      free(m_pTextAtlases[i]);
+      m_pTextAtlases[i] = NULL;
+   }
+   if ( NULL != m_pTextRuns )
+   {
+      _textCacheClearRuns();
+      free(m_pTextRuns);
+   }
+   m_pTextRuns = NULL;
+   if ( NULL != m_pTextWidths )
+      free(m_pTextWidths);
+   m_pTextWidths = NULL;
+}
+
+void RenderEngineCairo::_textCacheClearRuns()
+{
+   if ( NULL == m_pTextRuns )
+      return;
+   for( int i=0; i<CAIRO_TEXT_RUNS_CACHE_SIZE; i++ )
+   {
+      if ( NULL != m_pTextRuns[i].pMask )
+         free(m_pTextRuns[i].pMask);
+   }
+   memset(m_pTextRuns, 0, CAIRO_TEXT_RUNS_CACHE_SIZE * sizeof(type_cairo_text_run));
+   m_iTextRunsBytes = 0;
+}
+
+bool RenderEngineCairo::_textCacheGetWidth(RenderEngineRawFont* pFont, int iPixels, const char* szText, float* pfWidthPixels)
+{
+   if ( (NULL == m_pTextWidths) || (strlen(szText) >= CAIRO_TEXT_RUN_MAX_LENGTH) )
+      return false;
+   u32 uHash = _text_cache_hash(pFont->iFamilyId, pFont->bBold, iPixels, 0, szText);
+   type_cairo_text_width* pEntry = &(m_pTextWidths[uHash % CAIRO_TEXT_WIDTHS_CACHE_SIZE]);
+   if ( (pEntry->uHash != uHash) || (pEntry->iFamilyId != pFont->iFamilyId) || (pEntry->bBold != pFont->bBold) || (pEntry->iPixels != iPixels) )
+      return false;
+   if ( 0 != strcmp(pEntry->szText, szText) )
+      return false;
+   *pfWidthPixels = pEntry->fWidthPixels;
+   return true;
+}
+
+void RenderEngineCairo::_textCacheAddWidth(RenderEngineRawFont* pFont, int iPixels, const char* szText, float fWidthPixels)
+{
+   if ( (NULL == m_pTextWidths) || (strlen(szText) >= CAIRO_TEXT_RUN_MAX_LENGTH) )
+      return;
+   u32 uHash = _text_cache_hash(pFont->iFamilyId, pFont->bBold, iPixels, 0, szText);
+   type_cairo_text_width* pEntry = &(m_pTextWidths[uHash % CAIRO_TEXT_WIDTHS_CACHE_SIZE]);
+   pEntry->uHash = uHash;
+   pEntry->iFamilyId = pFont->iFamilyId;
+   pEntry->bBold = pFont->bBold;
+   pEntry->iPixels = iPixels;
+   pEntry->fWidthPixels = fWidthPixels;
+   strcpy(pEntry->szText, szText);
+}
+
+static void _text_cache_reset_atlas(type_cairo_glyph_atlas* pAtlas)
+{
+   cairo_surface_flush(pAtlas->pSurface);
+   memset(cairo_image_surface_get_data(pAtlas->pSurface), 0, cairo_image_surface_get_stride(pAtlas->pSurface) * CAIRO_TEXT_ATLAS_HEIGHT);
+   cairo_surface_mark_dirty(pAtlas->pSurface);
+   memset(pAtlas->glyphs, 0, sizeof(pAtlas->glyphs));
+   pAtlas->iCountGlyphs = 0;
+   pAtlas->iShelfX = 0;
+   pAtlas->iShelfY = 0;
+   pAtlas->iShelfHeight = 0;
+   pAtlas->uGeneration++;
+}
+
+type_cairo_glyph_atlas* RenderEngineCairo::_textCacheGetAtlas(RenderEngineRawFont* pFont, int iPixels)
+{
+   m_uTextAtlasesUseCounter++;
+   int iFree = -1;
+   int iOldest = 0;
+   for( int i=0; i<CAIRO_TEXT_MAX_ATLASES; i++ )
+   {
+      type_cairo_glyph_atlas* pAtlas = m_pTextAtlases[i];
+      if ( NULL == pAtlas )
+      {
+         if ( -1 == iFree )
+            iFree = i;
+         continue;
+      }
+      if ( (pAtlas->iFamilyId == pFont->iFamilyId) && (pAtlas->bBold == pFont->bBold) && (pAtlas->iPixels == iPixels) )
+      {
+         pAtlas->uLastUseCounter = m_uTextAtlasesUseCounter;
+         return pAtlas;
+      }
+      if ( (NULL != m_pTextAtlases[iOldest]) && (pAtlas->uLastUseCounter < m_pTextAtlases[iOldest]->uLastUseCounter) )
+         iOldest = i;
+   }
+
+   type_cairo_glyph_atlas* pAtlas = NULL;
+   if ( -1 == iFree )
+   {
+      // Reuse the least recently used atlas
+      pAtlas = m_pTextAtlases[iOldest];
+      _text_cache_reset_atlas(pAtlas);
+   }
+   else
+   {
+      pAtlas = (type_cairo_glyph_atlas*) calloc(1, sizeof(type_cairo_glyph_atlas));
+      if ( NULL == pAtlas )
+         return NULL;
+      pAtlas->pSurface = cairo_image_surface_create(CAIRO_FORMAT_A8, CAIRO_TEXT_ATLAS_WIDTH, CAIRO_TEXT_ATLAS_HEIGHT);
+      if ( (NULL == pAtlas->pSurface) || (CAIRO_STATUS_SUCCESS != cairo_surface_status(pAtlas->pSurface)) )
+      {
+         log_softerror_and_alarm("[RenderEngineCairo] Failed to create a glyph atlas surface.");
+         if ( NULL != pAtlas->pSurface )
+            cairo_surface_destroy(pAtlas->pSurface);
+         free(pAtlas);
+         return NULL;
+      }
+      pAtlas->pCairoCtx = cairo_create(pAtlas->pSurface);
+      cairo_set_source_rgba(pAtlas->pCairoCtx, 1.0, 1.0, 1.0, 1.0);
+      m_pTextAtlases[iFree] = pAtlas;
+   }
+   pAtlas->iFamilyId = pFont->iFamilyId;
+   pAtlas->bBold = pFont->bBold;
+   pAtlas->iPixels = iPixels;
+   pAtlas->uLastUseCounter = m_uTextAtlasesUseCounter;
+   return pAtlas;
+}
+
+// The scaled font must be the one of the atlas font and size
+type_cairo_atlas_glyph* RenderEngineCairo::_textCacheGetGlyph(type_cairo_glyph_atlas* pAtlas, cairo_scaled_font_t* pSFont, u32 uGlyphIndex, int iPhase)
+{
+   u32 uSlot = ((uGlyphIndex * CAIRO_TEXT_SUBPIXEL_PHASES + (u32)iPhase) * 2654435761U) % CAIRO_TEXT_ATLAS_MAX_GLYPHS;
+   for( int i=0; i<CAIRO_TEXT_ATLAS_MAX_GLYPHS; i++ )
+   {
+      type_cairo_atlas_glyph* pGlyph = &(pAtlas->glyphs[uSlot]);
+      if ( ! pGlyph->bUsed )
+         break;
+      if ( (pGlyph->uGlyphIndex == uGlyphIndex) && (pGlyph->uPhase == iPhase) )
+         return pGlyph;
+      uSlot = (uSlot + 1) % CAIRO_TEXT_ATLAS_MAX_GLYPHS;
+   }
+
+   cairo_glyph_t glyph;
+   glyph.index = uGlyphIndex;
+   glyph.x = (double)iPhase / (double)CAIRO_TEXT_SUBPIXEL_PHASES;
+   glyph.y = 0.0;
+   cairo_text_extents_t extents;
+   cairo_scaled_font_glyph_extents(pSFont, &glyph, 1, &extents);
+
+   // Keep one pixel around the glyph for the antialiasing
+   int dx = 0, dy = 0, w = 0, h = 0;
+   if ( (extents.width > 0.0) && (extents.height > 0.0) )
+   {
+      dx = (int)floor(extents.x_bearing) - 1;
+      dy = (int)floor(extents.y_bearing) - 1;
+      w = (int)ceil(extents.x_bearing + extents.width) + 1 - dx;
+      h = (int)ceil(extents.y_bearing + extents.height) + 1 - dy;
+      if ( (w > CAIRO_TEXT_ATLAS_WIDTH) || (h > CAIRO_TEXT_ATLAS_HEIGHT) )
+         return NULL;
+   }
+
+   // Empty the atlas when it's full (the table is kept at most 3/4 full)
+   bool bFull = (pAtlas->iCountGlyphs >= (CAIRO_TEXT_ATLAS_MAX_GLYPHS*3)/4);
+   if ( (w > 0) && (pAtlas->iShelfX + w > CAIRO_TEXT_ATLAS_WIDTH) )
+   if ( pAtlas->iShelfY + pAtlas->iShelfHeight + 1 + h > CAIRO_TEXT_ATLAS_HEIGHT )
+      bFull = true;
+   if ( (w > 0) && (pAtlas->iShelfY + h > CAIRO_TEXT_ATLAS_HEIGHT) )
+      bFull = true;
+
+   if ( bFull )
+   {
+      _text_cache_reset_atlas(pAtlas);
+      uSlot = ((uGlyphIndex * CAIRO_TEXT_SUBPIXEL_PHASES + (u32)iPhase) * 2654435761U) % CAIRO_TEXT_ATLAS_MAX_GLYPHS;
+   }
+   else
+   {
+      while ( pAtlas->glyphs[uSlot].bUsed )
+         uSlot = (uSlot + 1) % CAIRO_TEXT_ATLAS_MAX_GLYPHS;
+   }
+
+   if ( (w > 0) && (pAtlas->iShelfX + w > CAIRO_TEXT_ATLAS_WIDTH) )
+   {
+      pAtlas->iShelfX = 0;
+      pAtlas->iShelfY += pAtlas->iShelfHeight + 1;
+      pAtlas->iShelfHeight = 0;
+   }
+
+   type_cairo_atlas_glyph* pGlyph = &(pAtlas->glyphs[uSlot]);
+   pGlyph->uGlyphIndex = uGlyphIndex;
+   pGlyph->uPhase = (u8)iPhase;
+   pGlyph->bUsed = 1;
+   pGlyph->x = pAtlas->iShelfX;
+   pGlyph->y = pAtlas->iShelfY;
+   pGlyph->w = w;
+   pGlyph->h = h;
+   pGlyph->dx = dx;
+   pGlyph->dy = dy;
+   pAtlas->iCountGlyphs++;
+
+   if ( w > 0 )
+   {
+      glyph.x = (double)(pGlyph->x - dx) + (double)iPhase / (double)CAIRO_TEXT_SUBPIXEL_PHASES;
+      glyph.y = (double)(pGlyph->y - dy);
+      cairo_set_scaled_font(pAtlas->pCairoCtx, pSFont);
+      cairo_show_glyphs(pAtlas->pCairoCtx, &glyph, 1);
+      cairo_surface_flush(pAtlas->pSurface);
+
+      pAtlas->iShelfX += w + 1;
+      if ( h > pAtlas->iShelfHeight )
+         pAtlas->iShelfHeight = h;
+   }
+   return pGlyph;
+}
+
+bool RenderEngineCairo::_textCacheBuildRun(type_cairo_text_run* pRun, RenderEngineRawFont* pFont, int iPixels, int iPhase, const char* szText)
+{
+   cairo_t* pCairoCtx = _getActiveCairoContext();
+   if ( NULL == pCairoCtx )
+      pCairoCtx = _createTempDrawContext();
+   if ( NULL == pCairoCtx )
+      return false;
+
+   _updateCurrentFontToUse(pFont, false);
+   cairo_set_font_size(pCairoCtx, iPixels);
+   cairo_scaled_font_t* pSFont = cairo_get_scaled_font(pCairoCtx);
+
+   type_cairo_glyph_atlas* pAtlas = _textCacheGetAtlas(pFont, iPixels);
+   if ( NULL == pAtlas )
+      return false;
+
+   cairo_glyph_t* pGlyphs = NULL;
+   int iCountGlyphs = 0;
+   cairo_status_t result = cairo_scaled_font_text_to_glyphs(pSFont, 0, 0, szText, strlen(szText), &pGlyphs, &iCountGlyphs, NULL, NULL, NULL);
+   if ( (result != CAIRO_STATUS_SUCCESS) || (iCountGlyphs <= 0) || (iCountGlyphs > 2*CAIRO_TEXT_RUN_MAX_LENGTH) )
+   {
+      if ( NULL != pGlyphs )
+         cairo_glyph_free(pGlyphs);
+      return false;
+   }
+
+   // Glyphs are copied as a glyph added to the atlas can empty it
+   type_cairo_atlas_glyph runGlyphs[2*CAIRO_TEXT_RUN_MAX_LENGTH];
+   int xGlyph[2*CAIRO_TEXT_RUN_MAX_LENGTH];
+   int yGlyph[2*CAIRO_TEXT_RUN_MAX_LENGTH];
+   bool bOk = false;
+   for( int iTry=0; (iTry<2) && (! bOk); iTry++ )
+   {
+      u32 uGeneration = pAtlas->uGeneration;
+      bOk = true;
+      for( int i=0; i<iCountGlyphs; i++ )
+      {
+         double fPos = (double)iPhase / (double)CAIRO_TEXT_SUBPIXEL_PHASES + pGlyphs[i].x;
+         double fPosInt = floor(fPos);
+         int iGlyphPhase = ((int)((fPos - fPosInt) * CAIRO_TEXT_SUBPIXEL_PHASES)) % CAIRO_TEXT_SUBPIXEL_PHASES;
+         type_cairo_atlas_glyph* pGlyph = _textCacheGetGlyph(pAtlas, pSFont, pGlyphs[i].index, iGlyphPhase);
+         if ( NULL == pGlyph )
+         {
+            bOk = false;
+            iTry = 2;
+            break;
+         }
+         runGlyphs[i] = *pGlyph;
+         xGlyph[i] = (int)fPosInt + pGlyph->dx;
+         yGlyph[i] = (int)lround(pGlyphs[i].y) + pGlyph->dy;
+      }
+      if ( bOk && (uGeneration != pAtlas->uGeneration) )
+         bOk = false;
+   }
+   cairo_glyph_free(pGlyphs);
+   if ( ! bOk )
+      return false;
+
+   int x1 = 0, y1 = 0, x2 = 0, y2 = 0;
+   bool bEmpty = true;
+   for( int i=0; i<iCountGlyphs; i++ )
+   {
+      if ( (runGlyphs[i].w <= 0) || (runGlyphs[i].h <= 0) )
+         continue;
+      if ( bEmpty || (xGlyph[i] < x1) ) x1 = xGlyph[i];
+      if ( bEmpty || (yGlyph[i] < y1) ) y1 = yGlyph[i];
+      if ( bEmpty || (xGlyph[i] + runGlyphs[i].w > x2) ) x2 = xGlyph[i] + runGlyphs[i].w;
+      if ( bEmpty || (yGlyph[i] + runGlyphs[i].h > y2) ) y2 = yGlyph[i] + runGlyphs[i].h;
+      bEmpty = false;
+   }
+
+   pRun->pMask = NULL;
+   pRun->iWidth = 0;
+   pRun->iHeight = 0;
+   pRun->dx = x1;
+   pRun->dy = y1;
+   if ( bEmpty )
+      return true;
+
+   int iSize = (x2-x1) * (y2-y1);
+   if ( m_iTextRunsBytes + iSize > CAIRO_TEXT_RUNS_MAX_BYTES )
+      _textCacheClearRuns();
+   pRun->pMask = (u8*) calloc(1, iSize);
+   if ( NULL == pRun->pMask )
+      return false;
+   pRun->iWidth = x2-x1;
+   pRun->iHeight = y2-y1;
+   m_iTextRunsBytes += iSize;
+
+   // Overlapping glyphs coverage is added (as Cairo does when compositing glyphs)
+   u8* pAtlasData = cairo_image_surface_get_data(pAtlas->pSurface);
+   int iAtlasStride = cairo_image_surface_get_stride(pAtlas->pSurface);
+   for( int i=0; i<iCountGlyphs; i++ )
+   {
+      type_cairo_atlas_glyph* pGlyph = &(runGlyphs[i]);
+      if ( (pGlyph->w <= 0) || (pGlyph->h <= 0) )
+         continue;
+      for( int y=0; y<pGlyph->h; y++ )
+      {
+         u8* pSrc = pAtlasData + (pGlyph->y + y) * iAtlasStride + pGlyph->x;
+         u8* pDest = pRun->pMask + (yGlyph[i] - y1 + y) * pRun->iWidth + (xGlyph[i] - x1);
+         for( int x=0; x<pGlyph->w; x++ )
+         {
+            u32 uSum = (u32)pDest[x] + (u32)pSrc[x];
+            pDest[x] = (uSum > 255)?255:(u8)uSum;
+         }
+      }
+   }
+   return true;
+}
+
+type_cairo_text_run* RenderEngineCairo::_textCacheGetRun(RenderEngineRawFont* pFont, int iPixels, int iPhase, const char* szText)
+{
+   if ( (NULL == m_pTextRuns) || (strlen(szText) >= CAIRO_TEXT_RUN_MAX_LENGTH) )
+      return NULL;
+
+   u32 uHash = _text_cache_hash(pFont->iFamilyId, pFont->bBold, iPixels, iPhase, szText);
+   type_cairo_text_run* pRun = &(m_pTextRuns[uHash % CAIRO_TEXT_RUNS_CACHE_SIZE]);
+   if ( (pRun->uHash == uHash) && (0 != pRun->szText[0]) )
+   if ( (pRun->iFamilyId == pFont->iFamilyId) && (pRun->bBold == pFont->bBold) && (pRun->iPixels == iPixels) && (pRun->iPhase == iPhase) )
+   if ( 0 == strcmp(pRun->szText, szText) )
+      return pRun;
+
+   if ( NULL != pRun->pMask )
+   {
+      free(pRun->pMask);
+      m_iTextRunsBytes -= pRun->iWidth * pRun->iHeight;
+   }
+   memset(pRun, 0, sizeof(type_cairo_text_run));
+
+   // Building the run can empty the runs cache
+   type_cairo_text_run run;
+   memset(&run, 0, sizeof(type_cairo_text_run));
+   if ( ! _textCacheBuildRun(&run, pFont, iPixels, iPhase, szText) )
+      return NULL;
+
+   run.uHash = uHash;
+   run.iFamilyId = pFont->iFamilyId;
+   run.bBold = pFont->bBold;
+   run.iPixels = iPixels;
+   run.iPhase = iPhase;
+   strcpy(run.szText, szText);
+   memcpy(pRun, &run, sizeof(type_cairo_text_run));
+   return pRun;
+}
+
+// xPixels, yPixels: text origin on the baseline, in screen pixels
+// Returns false if the text could not be drawn from the cache (caller must draw it)
+bool RenderEngineCairo::_drawCachedText(RenderEngineRawFont* pFont, int iPixels, const char* szText, float xPixels, float yPixels, const float* pColor)
+{
+   float fX = floorf(xPixels);
+   int iPhase = ((int)((xPixels - fX) * CAIRO_TEXT_SUBPIXEL_PHASES)) % CAIRO_TEXT_SUBPIXEL_PHASES;
+   type_cairo_text_run* pRun = _textCacheGetRun(pFont, iPixels, iPhase, szText);
+   if ( NULL == pRun )
+      return false;
+   if ( NULL == pRun->pMask )
+      return true;
+
+   type_drm_buffer* pOutputBufferInfo = ruby_drm_core_get_back_draw_buffer();
+   int xStart = (int)fX + pRun->dx;
+   int yStart = (int)lroundf(yPixels) + pRun->dy;
+   int xMaskStart = 0, yMaskStart = 0;
+   int w = pRun->iWidth;
+   int h = pRun->iHeight;
+   if ( xStart < 0 )
+   {
+      xMaskStart = -xStart;
+      w += xStart;
+      xStart = 0;
+   }
+   if ( yStart < 0 )
+   {
+      yMaskStart = -yStart;
+      h += yStart;
+      yStart = 0;
+   }
+   if ( xStart + w > (int)pOutputBufferInfo->uWidth )
+      w = (int)pOutputBufferInfo->uWidth - xStart;
+   if ( yStart + h > (int)pOutputBufferInfo->uHeight )
+      h = (int)pOutputBufferInfo->uHeight - yStart;
+   if ( (w <= 0) || (h <= 0) )
+      return true;
+
+   // Premultiplied source color, composited OVER the back buffer, through the run coverage mask
+   u32 uAlpha = (u32)(pColor[3]*255.0 + 0.5);
+   u32 uB = _mul_un8((u32)(pColor[2]*255.0 + 0.5), uAlpha);
+   u32 uG = _mul_un8((u32)(pColor[1]*255.0 + 0.5), uAlpha);
+   u32 uR = _mul_un8((u32)(pColor[0]*255.0 + 0.5), uAlpha);
+
+   for( int y=0; y<h; y++ )
+   {
+      const u8* pMask = pRun->pMask + (yMaskStart + y) * pRun->iWidth + xMaskStart;
+      u8* pDest = pOutputBufferInfo->pData + (yStart + y) * pOutputBufferInfo->uStride + xStart * 4;
+      render_span_blend_mask(pDest, pMask, w, (u8)uR, (u8)uG, (u8)uB, (u8)uAlpha);
+   }
+   return true;
+}
@@ -0,0 +1,1111 @@
+/*
+    Ruby Licence
+    Copyright (c) 2020-2025 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and/or use in source and/or binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions and/or use of the source code (partially or complete) must retain
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Redistributions in binary form (partially or complete) must reproduce
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permitted.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE AUTHOR (PETRU SOROAGA) BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Retained rendering for the render engines that draw directly into the display buffers.
+//
+// While a frame is recorded, the drawing functions just add a command (parameters, text,
+// drawing state and the screen rectangle it touches) to the frame's command list.
+// On endFrame the commands of each layer are compared with the previous frame ones
+// (a layer is an OSD element/panel, or the draw calls done outside of any layer):
+// the rectangles of the changed, added and removed commands are the frame damage.
+// The back buffer still has the content from <buffer age> frames ago, so the damage of
+// the frames since then is repainted: the damaged rectangles are extended to fully contain
+// any command they touch (so no clipping is needed when drawing), cleared, and only those
+// commands are drawn again, in the original order.
+// Everything is redrawn when there is no valid previous frame or when too much of the screen is damaged.
+
+#include "render_engine.h"
+#include <math.h>
+
+#define RETAINED_INITIAL_COMMANDS 1024
+#define RETAINED_MAX_COMMANDS 65536
+#define RETAINED_INITIAL_DATA_SIZE 32768
+#define RETAINED_MAX_DATA_SIZE 4000000
+#define RETAINED_RECT_MARGIN_PX 2
+#define RETAINED_DIFF_LOOKAHEAD 8
+// Above this, the whole frame is redrawn
+#define RETAINED_MAX_REPAINT_PERCENT 60
+
+static bool _rect_is_empty(const type_render_rect* pRect)
+{
+   return (pRect->x1 >= pRect->x2) || (pRect->y1 >= pRect->y2);
+}
+
+static bool _rects_overlap(const type_render_rect* pRect1, const type_render_rect* pRect2)
+{
+   return (pRect1->x1 < pRect2->x2) && (pRect2->x1 < pRect1->x2) && (pRect1->y1 < pRect2->y2) && (pRect2->y1 < pRect1->y2);
+}
+
+static bool _rect_contains(const type_render_rect* pRect, const type_render_rect* pInner)
+{
+   return (pInner->x1 >= pRect->x1) && (pInner->x2 <= pRect->x2) && (pInner->y1 >= pRect->y1) && (pInner->y2 <= pRect->y2);
+}
+
+static void _rect_union(type_render_rect* pRect, const type_render_rect* pOther)
+{
+   if ( _rect_is_empty(pOther) )
+      return;
+   if ( _rect_is_empty(pRect) )
+   {
+      *pRect = *pOther;
+      return;
+   }
+   if ( pOther->x1 < pRect->x1 ) pRect->x1 = pOther->x1;
+   if ( pOther->y1 < pRect->y1 ) pRect->y1 = pOther->y1;
+   if ( pOther->x2 > pRect->x2 ) pRect->x2 = pOther->x2;
+   if ( pOther->y2 > pRect->y2 ) pRect->y2 = pOther->y2;
+}
+
+static int _rect_area(const type_render_rect* pRect)
+{
+   if ( _rect_is_empty(pRect) )
+      return 0;
+   return (pRect->x2 - pRect->x1) * (pRect->y2 - pRect->y1);
+}
+
+void RenderEngine::setRetainedRenderingMode(int iMode)
+{
+   if ( m_iRetainedBufferAge <= 0 )
+      iMode = RENDER_RETAINED_MODE_OFF;
+   if ( iMode == m_iRetainedMode )
+      return;
+   log_line("[RenderEngine] Set retained rendering mode: %d (was %d)", iMode, m_iRetainedMode);
+   m_iRetainedMode = iMode;
+   invalidateRetainedFrames();
+}
+
+int RenderEngine::getRetainedRenderingMode()
+{
+   return m_iRetainedMode;
+}
+
+// Next frame is fully redrawn
+void RenderEngine::invalidateRetainedFrames()
+{
+   m_bRetainedPrevFrameValid = false;
+   m_iRetainedCountLayers[1] = 0;
+}
+
+float RenderEngine::getRetainedRepaintPercent()
+{
+   return m_fRetainedRepaintPercent;
+}
+
+void RenderEngine::lockFrames()
+{
+   pthread_mutex_lock(&m_MutexFrames);
+}
+
+void RenderEngine::unlockFrames()
+{
+   pthread_mutex_unlock(&m_MutexFrames);
+}
+
+// Needs the frames to be recorded
+bool RenderEngine::supportsDeferredFrames()
+{
+   return (m_iRetainedBufferAge > 0);
+}
+
+void RenderEngine::setDeferredFrames(bool bDeferred)
+{
+   if ( ! supportsDeferredFrames() )
+      bDeferred = false;
+   m_bDeferredFrames = bDeferred;
+}
+
+bool RenderEngine::isDeferredFramePending()
+{
+   return m_bDeferredFramePending;
+}
+
+bool RenderEngine::rasterizeDeferredFrame()
+{
+   return false;
+}
+
+void RenderEngine::enableLayerTimings(bool bEnable)
+{
+   m_bLayerTimings = bEnable;
+   m_iTimedLayersStackDepth = 0;
+}
+
+void RenderEngine::resetLayerTimings()
+{
+   m_iCountTimedLayers = 0;
+   m_iTimedLayersStackDepth = 0;
+}
+
+int RenderEngine::getLayerTimings(u32* puLayerIds, u32* puTotalMicros, u32* puCounts, int iMaxLayers)
+{
+   int iCount = 0;
+   for( int i=0; (i<m_iCountTimedLayers) && (iCount<iMaxLayers); i++ )
+   {
+      if ( NULL != puLayerIds ) puLayerIds[iCount] = m_uTimedLayersIds[i];
+      if ( NULL != puTotalMicros ) puTotalMicros[iCount] = m_uTimedLayersMicros[i];
+      if ( NULL != puCounts ) puCounts[iCount] = m_uTimedLayersCounts[i];
+      iCount++;
+   }
+   return iCount;
+}
+
+void RenderEngine::_timedLayerBegin(u32 uLayerId)
+{
+   if ( m_iTimedLayersStackDepth < (int)(sizeof(m_uTimedLayersStackIds)/sizeof(m_uTimedLayersStackIds[0])) )
+   {
+      m_uTimedLayersStackIds[m_iTimedLayersStackDepth] = uLayerId;
+      m_uTimedLayersStackStart[m_iTimedLayersStackDepth] = get_current_timestamp_micros();
+   }
+   m_iTimedLayersStackDepth++;
+}
+
+void RenderEngine::_timedLayerEnd()
+{
+   if ( m_iTimedLayersStackDepth <= 0 )
+      return;
+   m_iTimedLayersStackDepth--;
+   if ( m_iTimedLayersStackDepth >= (int)(sizeof(m_uTimedLayersStackIds)/sizeof(m_uTimedLayersStackIds[0])) )
+      return;
+
+   u32 uLayerId = m_uTimedLayersStackIds[m_iTimedLayersStackDepth];
+   u32 uMicros = get_current_timestamp_micros() - m_uTimedLayersStackStart[m_iTimedLayersStackDepth];
+   int iIndex = -1;
+   for( int i=0; i<m_iCountTimedLayers; i++ )
+   {
+      if ( m_uTimedLayersIds[i] == uLayerId )
+      {
+         iIndex = i;
+         break;
+      }
+   }
+   if ( -1 == iIndex )
+   {
+      if ( m_iCountTimedLayers >= RENDER_MAX_TIMED_LAYERS )
+         return;
+      iIndex = m_iCountTimedLayers;
+      m_iCountTimedLayers++;
+      m_uTimedLayersIds[iIndex] = uLayerId;
+      m_uTimedLayersMicros[iIndex] = 0;
+      m_uTimedLayersCounts[iIndex] = 0;
+   }
+   m_uTimedLayersMicros[iIndex] += uMicros;
+   m_uTimedLayersCounts[iIndex]++;
+}
+
+void RenderEngine::beginLayer(u32 uLayerId)
+{
+   if ( m_bLayerTimings && (! m_bRetainedReplaying) )
+      _timedLayerBegin(uLayerId);
+
+   if ( (! m_bRetainedRecording) || m_bRetainedReplaying )
+      return;
+   if ( m_iRetainedLayersStackDepth >= (int)(sizeof(m_iRetainedLayersStack)/sizeof(m_iRetainedLayersStack[0])) )
+   {
+      m_iRetainedLayersStackDepth++;
+      return;
+   }
+   m_iRetainedLayersStack[m_iRetainedLayersStackDepth] = _retainedGetLayer(uLayerId & (~RENDER_LAYER_ID_AUTO));
+   m_iRetainedLayersStackDepth++;
+   m_iRetainedCurrentAutoLayer = -1;
+}
+
+void RenderEngine::endLayer()
+{
+   if ( m_bLayerTimings && (! m_bRetainedReplaying) )
+      _timedLayerEnd();
+
+   if ( (! m_bRetainedRecording) || m_bRetainedReplaying )
+      return;
+   if ( m_iRetainedLayersStackDepth > 0 )
+      m_iRetainedLayersStackDepth--;
+   m_iRetainedCurrentAutoLayer = -1;
+}
+
+int RenderEngine::_retainedGetLayer(u32 uLayerId)
+{
+   for( int i=0; i<m_iRetainedCountLayers[0]; i++ )
+   {
+      if ( m_RetainedLayers[0][i].uId == uLayerId )
+         return i;
+   }
+   // Too many layers: the rest of the commands go to the last one
+   if ( m_iRetainedCountLayers[0] >= RENDER_RETAINED_MAX_LAYERS )
+      return RENDER_RETAINED_MAX_LAYERS-1;
+
+   type_render_retained_layer* pLayer = &(m_RetainedLayers[0][m_iRetainedCountLayers[0]]);
+   memset(pLayer, 0, sizeof(type_render_retained_layer));
+   pLayer->uId = uLayerId;
+   if ( m_iRetainedCountLayers[0] > 0 )
+      pLayer->uPrevLayerId = m_RetainedLayers[0][m_iRetainedCountLayers[0]-1].uId;
+   m_iRetainedCountLayers[0]++;
+   return m_iRetainedCountLayers[0]-1;
+}
+
+bool RenderEngine::_retainedStartFrame()
+{
+   m_iRetainedCountCommands = 0;
+   m_iRetainedCountStates = 0;
+   m_uRetainedDataSize = 0;
+   m_iRetainedCountLayers[0] = 0;
+   m_iRetainedLayersStackDepth = 0;
+   m_uRetainedAutoLayerIndex = 0;
+   m_iRetainedCurrentAutoLayer = -1;
+   m_bRetainedRecording = false;
+   m_bRetainedReplaying = false;
+   m_iActiveDrawCache = -1;
+
+   // Deferred frames are always recorded (the recording is what gets drawn later)
+   if ( (RENDER_RETAINED_MODE_OFF == m_iRetainedMode) && (! m_bDeferredFrames) )
+      return false;
+   if ( m_iRetainedBufferAge <= 0 )
+      return false;
+
+   if ( ! _retainedGrowBuffers(0) )
+   {
+      invalidateRetainedFrames();
+      return false;
+   }
+   m_bRetainedRecording = true;
+   return true;
+}
+
+bool RenderEngine::_retainedGrowBuffers(int iDataSize)
+{
+   if ( (NULL == m_pRetainedCommands) || (m_iRetainedCountCommands >= m_iRetainedMaxCommands) )
+   {
+      int iNewMax = (m_iRetainedMaxCommands > 0)?(m_iRetainedMaxCommands*2):RETAINED_INITIAL_COMMANDS;
+      if ( iNewMax > RETAINED_MAX_COMMANDS )
+         return false;
+      type_render_retained_command* pCommands = (type_render_retained_command*) realloc(m_pRetainedCommands, iNewMax * sizeof(type_render_retained_command));
+      if ( NULL == pCommands )
+         return false;
+      m_pRetainedCommands = pCommands;
+      type_render_retained_state* pStates = (type_render_retained_state*) realloc(m_pRetainedStates, iNewMax * sizeof(type_render_retained_state));
+      if ( NULL == pStates )
+         return false;
+      m_pRetainedStates = pStates;
+      m_iRetainedMaxCommands = iNewMax;
+   }
+
+   u32 uNeededSize = m_uRetainedDataSize + (u32)iDataSize + 4;
+   if ( (NULL == m_pRetainedData) || (uNeededSize > m_uRetainedMaxDataSize) )
+   {
+      u32 uNewMax = (m_uRetainedMaxDataSize > 0)?m_uRetainedMaxDataSize:RETAINED_INITIAL_DATA_SIZE;
+      while ( uNewMax < uNeededSize )
+         uNewMax *= 2;
+      if ( uNewMax > RETAINED_MAX_DATA_SIZE )
+         return false;
+      u8* pData = (u8*) realloc(m_pRetainedData, uNewMax);
+      if ( NULL == pData )
+         return false;
+      m_pRetainedData = pData;
+      m_uRetainedMaxDataSize = uNewMax;
+   }
+   return true;
+}
+
+void RenderEngine::_retainedCaptureState(type_render_retained_state* pState)
+{
+   memset(pState, 0, sizeof(type_render_retained_state));
+   memcpy(pState->uColorFill, m_ColorFill, 4*sizeof(u8));
+   memcpy(pState->uColorStroke, m_ColorStroke, 4*sizeof(u8));
+   memcpy(pState->uColorTextBoundingBoxBgFill, m_ColorTextBoundingBoxBgFill, 4*sizeof(u8));
+   memcpy(pState->uTextFontMixColor, m_uTextFontMixColor, 4*sizeof(u8));
+   memcpy(pState->dColorTextBackgroundBoundingBoxStrike, m_ColorTextBackgroundBoundingBoxStrike, 4*sizeof(double));
+   pState->fStrokeSizePx = m_fStrokeSizePx;
+   pState->fBoundingBoxPadding = m_fBoundingBoxPadding;
+   pState->bDrawBackgroundBoundingBoxes = m_bDrawBackgroundBoundingBoxes?1:0;
+   pState->bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor = m_bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor?1:0;
+   pState->bDrawStrikeOnTextBackgroundBoundingBoxes = m_bDrawStrikeOnTextBackgroundBoundingBoxes?1:0;
+   pState->bDisableTextOutline = m_bDisableTextOutline?1:0;
+   pState->bHighlightFirstWord = m_bHighlightFirstWord?1:0;
+   pState->bEnableRectBlending = m_bEnableRectBlending?1:0;
+   pState->bEnableFontScaling = m_bEnableFontScaling?1:0;
+}
+
+void RenderEngine::_retainedApplyState(const type_render_retained_state* pState)
+{
+   memcpy(m_ColorFill, pState->uColorFill, 4*sizeof(u8));
+   memcpy(m_ColorStroke, pState->uColorStroke, 4*sizeof(u8));
+   memcpy(m_ColorTextBoundingBoxBgFill, pState->uColorTextBoundingBoxBgFill, 4*sizeof(u8));
+   memcpy(m_uTextFontMixColor, pState->uTextFontMixColor, 4*sizeof(u8));
+   memcpy(m_ColorTextBackgroundBoundingBoxStrike, pState->dColorTextBackgroundBoundingBoxStrike, 4*sizeof(double));
+   m_fStrokeSizePx = pState->fStrokeSizePx;
+   m_fBoundingBoxPadding = pState->fBoundingBoxPadding;
+   m_bDrawBackgroundBoundingBoxes = pState->bDrawBackgroundBoundingBoxes?true:false;
+   m_bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor = pState->bDrawBackgroundBoundingBoxesTextUsesSameStrokeColor?true:false;
+   m_bDrawStrikeOnTextBackgroundBoundingBoxes = pState->bDrawStrikeOnTextBackgroundBoundingBoxes?true:false;
+   m_bDisableTextOutline = pState->bDisableTextOutline?true:false;
+   m_bHighlightFirstWord = pState->bHighlightFirstWord?true:false;
+   m_bEnableRectBlending = pState->bEnableRectBlending?true:false;
+   m_bEnableFontScaling = pState->bEnableFontScaling?true:false;
+}
+
+// Returns true if the draw call was recorded (the caller must not draw it now).
+// x1,y1,x2,y2: screen area (0..1) touched by the draw call, without the stroke/antialiasing margin
+bool RenderEngine::_retainedRecord(int iType, float x1, float y1, float x2, float y2, const float* pfParams, int iCountF, const int* piParams, int iCountI, const void* pData, int iDataSize)
+{
+   if ( (! m_bRetainedRecording) || m_bRetainedReplaying )
+      return false;
+
+   if ( ! _retainedGrowBuffers(iDataSize) )
+   {
+      log_softerror_and_alarm("[RenderEngine] Retained rendering: too many draw calls in frame (%d commands, %u bytes). Draw the rest of the frame directly.",
+         m_iRetainedCountCommands, m_uRetainedDataSize);
+      _retainedFlushToImmediate();
+      return false;
+   }
+
+   type_render_retained_command* pCmd = &(m_pRetainedCommands[m_iRetainedCountCommands]);
+   memset(pCmd, 0, sizeof(type_render_retained_command));
+   pCmd->uType = (u8)iType;
+   for( int i=0; (i<iCountF) && (i<6); i++ )
+      pCmd->fParams[i] = pfParams[i];
+   for( int i=0; (i<iCountI) && (i<6); i++ )
+      pCmd->iParams[i] = piParams[i];
+
+   int iMargin = RETAINED_RECT_MARGIN_PX + (int)m_fStrokeSizePx;
+   pCmd->rect.x1 = (int)floorf(((x1 < x2)?x1:x2) * m_iRenderWidth) - iMargin;
+   pCmd->rect.y1 = (int)floorf(((y1 < y2)?y1:y2) * m_iRenderHeight) - iMargin;
+   pCmd->rect.x2 = (int)ceilf(((x1 < x2)?x2:x1) * m_iRenderWidth) + iMargin + 1;
+   pCmd->rect.y2 = (int)ceilf(((y1 < y2)?y2:y1) * m_iRenderHeight) + iMargin + 1;
+   if ( pCmd->rect.x1 < 0 ) pCmd->rect.x1 = 0;
+   if ( pCmd->rect.y1 < 0 ) pCmd->rect.y1 = 0;
+   if ( pCmd->rect.x2 > m_iRenderWidth ) pCmd->rect.x2 = m_iRenderWidth;
+   if ( pCmd->rect.y2 > m_iRenderHeight ) pCmd->rect.y2 = m_iRenderHeight;
+
+   // Completly outside of the screen: nothing to draw
+   if ( _rect_is_empty(&pCmd->rect) )
+      return true;
+
+   type_render_retained_state state;
+   _retainedCaptureState(&state);
+
+   // Hash: parameters and rect (offsets, layer and state index are still 0) and data; the state is added when appended
+   pCmd->uHash = base_compute_crc32((u8*)pCmd, sizeof(type_render_retained_command));
+   if ( (NULL != pData) && (iDataSize > 0) )
+      pCmd->uHash = base_compute_crc32_continue(pCmd->uHash, (u8*)pData, iDataSize);
+   _retainedAppendCommand(pCmd, &state, pData, iDataSize);
+   return true;
+}
+
+// Adds the command (already in the commands list, at the end) to the frame: its state, data and layer.
+// Buffers must have room for it (_retainedGrowBuffers)
+void RenderEngine::_retainedAppendCommand(type_render_retained_command* pCmd, const type_render_retained_state* pState, const void* pData, int iDataSize)
+{
+   if ( m_iActiveDrawCache >= 0 )
+   {
+      pCmd->uDataSize = ((NULL != pData) && (iDataSize > 0))?(u32)iDataSize:0;
+      _drawCacheAddCommand(pCmd, pState, pData);
+   }
+
+   if ( (0 == m_iRetainedCountStates) || (0 != memcmp(pState, &(m_pRetainedStates[m_iRetainedCountStates-1]), sizeof(type_render_retained_state))) )
+   {
+      memcpy(&(m_pRetainedStates[m_iRetainedCountStates]), pState, sizeof(type_render_retained_state));
+      m_iRetainedCountStates++;
+      m_uRetainedLastStateHash = base_compute_crc32((u8*)pState, sizeof(type_render_retained_state));
+   }
+
+   pCmd->uDataOffset = 0;
+   pCmd->uDataSize = 0;
+   if ( (NULL != pData) && (iDataSize > 0) )
+   {
+      pCmd->uDataOffset = m_uRetainedDataSize;
+      pCmd->uDataSize = (u32)iDataSize;
+      memcpy(m_pRetainedData + m_uRetainedDataSize, pData, iDataSize);
+      m_uRetainedDataSize += ((u32)iDataSize + 3) & (~0x03);
+   }
+   pCmd->uHash = base_compute_crc32_continue(pCmd->uHash, (u8*)&m_uRetainedLastStateHash, sizeof(u32));
+   pCmd->uStateIndex = (u32)(m_iRetainedCountStates-1);
+
+   int iLayer = -1;
+   if ( m_iRetainedLayersStackDepth > 0 )
+   {
+      int iDepth = m_iRetainedLayersStackDepth;
+      if ( iDepth > (int)(sizeof(m_iRetainedLayersStack)/sizeof(m_iRetainedLayersStack[0])) )
+         iDepth = (int)(sizeof(m_iRetainedLayersStack)/sizeof(m_iRetainedLayersStack[0]));
+      iLayer = m_iRetainedLayersStack[iDepth-1];
+   }
+   else
+   {
+      if ( m_iRetainedCurrentAutoLayer < 0 )
+      {
+         m_iRetainedCurrentAutoLayer = _retainedGetLayer(RENDER_LAYER_ID_AUTO | m_uRetainedAutoLayerIndex);
+         m_uRetainedAutoLayerIndex++;
+      }
+      iLayer = m_iRetainedCurrentAutoLayer;
+   }
+   type_render_retained_layer* pLayer = &(m_RetainedLayers[0][iLayer]);
+   pCmd->uLayerIndex = (u16)iLayer;
+   pLayer->uHash = base_compute_crc32_continue(pLayer->uHash, (u8*)&pCmd->uHash, sizeof(u32));
+   pLayer->iCountCommands++;
+   _rect_union(&pLayer->rect, &pCmd->rect);
+
+   m_iRetainedCountCommands++;
+}
+
+// Something can't be recorded: draw what was recorded so far and the rest of the frame directly
+void RenderEngine::_retainedFlushToImmediate()
+{
+   if ( ! m_bRetainedRecording )
+      return;
+   m_bRetainedRecording = false;
+   _retainedClearAll();
+   _retainedReplay(true);
+   invalidateRetainedFrames();
+}
+
+void RenderEngine::_retainedReplay(bool bAll)
+{
+   type_render_retained_state stateCurrent;
+   _retainedCaptureState(&stateCurrent);
+
+   m_bRetainedReplaying = true;
+   int iLastState = -1;
+   for( int i=0; i<m_iRetainedCountCommands; i++ )
+   {
+      type_render_retained_command* pCmd = &(m_pRetainedCommands[i]);
+      if ( (! bAll) && (! pCmd->uRedraw) )
+         continue;
+      if ( (int)pCmd->uStateIndex != iLastState )
+      {
+         iLastState = (int)pCmd->uStateIndex;
+         _retainedApplyState(&(m_pRetainedStates[iLastState]));
+      }
+      _retainedExecuteCommand(pCmd);
+   }
+   m_bRetainedReplaying = false;
+
+   _retainedApplyState(&stateCurrent);
+}
+
+void RenderEngine::_retainedExecuteCommand(const type_render_retained_command* pCmd)
+{
+   const float* f = pCmd->fParams;
+   const int* i = pCmd->iParams;
+   u8* pData = m_pRetainedData + pCmd->uDataOffset;
+
+   switch ( pCmd->uType )
+   {
+      case RENDER_CMD_IMAGE: drawImage(f[0], f[1], f[2], f[3], (u32)i[0]); break;
+      case RENDER_CMD_IMAGE_ALPHA: drawImageAlpha(f[0], f[1], f[2], f[3], (u32)i[0], (u8)i[1]); break;
+      case RENDER_CMD_BLT_IMAGE: bltImage(f[0], f[1], f[2], f[3], i[0], i[1], i[2], i[3], (u32)i[4]); break;
+      case RENDER_CMD_BLT_SPRITE: bltSprite(f[0], f[1], i[0], i[1], i[2], i[3], (u32)i[4]); break;
+      case RENDER_CMD_ICON: drawIcon(f[0], f[1], f[2], f[3], (u32)i[0]); break;
+      case RENDER_CMD_BLT_ICON: bltIcon(f[0], f[1], i[0], i[1], i[2], i[3], (u32)i[4]); break;
+      case RENDER_CMD_TEXT:
+         {
+            RenderEngineRawFont* pFont = _getRawFontFromId((u32)i[0]);
+            if ( (NULL != pFont) && (pCmd->uDataSize > 0) )
+               _drawSimpleTextScaled(pFont, (const char*)pData, f[0], f[1], f[2]);
+            break;
+         }
+      case RENDER_CMD_LINE: drawLine(f[0], f[1], f[2], f[3]); break;
+      case RENDER_CMD_RECT: drawRect(f[0], f[1], f[2], f[3]); break;
+      case RENDER_CMD_ROUND_RECT: drawRoundRect(f[0], f[1], f[2], f[3], f[4]); break;
+      case RENDER_CMD_ROUND_RECT_MENU: drawRoundRectMenu(f[0], f[1], f[2], f[3], f[4]); break;
+      case RENDER_CMD_TRIANGLE: drawTriangle(f[0], f[1], f[2], f[3], f[4], f[5]); break;
+      case RENDER_CMD_FILL_TRIANGLE: fillTriangle(f[0], f[1], f[2], f[3], f[4], f[5]); break;
+      case RENDER_CMD_POLYLINE: drawPolyLine((float*)pData, ((float*)pData) + i[0], i[0]); break;
+      case RENDER_CMD_FILL_POLYGON: fillPolygon((float*)pData, ((float*)pData) + i[0], i[0]); break;
+      case RENDER_CMD_FILL_CIRCLE: fillCircle(f[0], f[1], f[2]); break;
+      case RENDER_CMD_CIRCLE: drawCircle(f[0], f[1], f[2]); break;
+      case RENDER_CMD_ARC: drawArc(f[0], f[1], f[2], f[3], f[4]); break;
+      default: break;
+   }
+}
+
+// Adds a rectangle to the damage, keeping the damage rectangles disjoint
+void RenderEngine::_retainedAddDamage(type_render_damage* pDamage, const type_render_rect* pRect)
+{
+   if ( pDamage->bFull || _rect_is_empty(pRect) )
+      return;
+
+   type_render_rect rect = *pRect;
+   bool bMerged = true;
+   while ( bMerged )
+   {
+      bMerged = false;
+      for( int i=0; i<pDamage->iCount; i++ )
+      {
+         if ( ! _rects_overlap(&rect, &(pDamage->rects[i])) )
+            continue;
+         _rect_union(&rect, &(pDamage->rects[i]));
+         pDamage->rects[i] = pDamage->rects[pDamage->iCount-1];
+         pDamage->iCount--;
+         bMerged = true;
+         break;
+      }
+      if ( bMerged )
+         continue;
+
+      if ( pDamage->iCount < RENDER_RETAINED_MAX_DAMAGE_RECTS )
+         break;
+
+      // No more room: merge with the rectangle that grows the least
+      int iBest = 0;
+      int iBestGrow = -1;
+      for( int i=0; i<pDamage->iCount; i++ )
+      {
+         type_render_rect tmp = pDamage->rects[i];
+         _rect_union(&tmp, &rect);
+         int iGrow = _rect_area(&tmp) - _rect_area(&(pDamage->rects[i])) - _rect_area(&rect);
+         if ( (iBestGrow < 0) || (iGrow < iBestGrow) )
+         {
+            iBest = i;
+            iBestGrow = iGrow;
+         }
+      }
+      _rect_union(&rect, &(pDamage->rects[iBest]));
+      pDamage->rects[iBest] = pDamage->rects[pDamage->iCount-1];
+      pDamage->iCount--;
+      bMerged = true;
+   }
+   pDamage->rects[pDamage->iCount] = rect;
+   pDamage->iCount++;
+}
+
+// Commands are matched in order; a few added or removed commands are skipped over
+void RenderEngine::_retainedDiffLayers(type_render_damage* pDamage, const type_render_retained_layer* pLayer, const type_render_retained_layer* pPrevLayer)
+{
+   const type_render_retained_command_info* pCurrent = m_pRetainedInfos[0] + pLayer->iFirstCommand;
+   const type_render_retained_command_info* pPrev = m_pRetainedInfos[1] + pPrevLayer->iFirstCommand;
+   int iCountCurrent = pLayer->iCountCommands;
+   int iCountPrev = pPrevLayer->iCountCommands;
+   int i = 0, j = 0;
+
+   while ( (i < iCountCurrent) && (j < iCountPrev) )
+   {
+      if ( pCurrent[i].uHash == pPrev[j].uHash )
+      {
+         i++;
+         j++;
+         continue;
+      }
+
+      int iRemoved = 0;
+      for( int k=1; (k<=RETAINED_DIFF_LOOKAHEAD) && (j+k < iCountPrev); k++ )
+      {
+         if ( pPrev[j+k].uHash == pCurrent[i].uHash )
+         {
+            iRemoved = k;
+            break;
+         }
+      }
+      if ( iRemoved > 0 )
+      {
+         for( int k=0; k<iRemoved; k++ )
+            _retainedAddDamage(pDamage, &(pPrev[j+k].rect));
+         j += iRemoved;
+         continue;
+      }
+
+      int iAdded = 0;
+      for( int k=1; (k<=RETAINED_DIFF_LOOKAHEAD) && (i+k < iCountCurrent); k++ )
+      {
+         if ( pCurrent[i+k].uHash == pPrev[j].uHash )
+         {
+            iAdded = k;
+            break;
+         }
+      }
+      if ( iAdded > 0 )
+      {
+         for( int k=0; k<iAdded; k++ )
+            _retainedAddDamage(pDamage, &(pCurrent[i+k].rect));
+         i += iAdded;
+         continue;
+      }
+
+      _retainedAddDamage(pDamage, &(pCurrent[i].rect));
+      _retainedAddDamage(pDamage, &(pPrev[j].rect));
+      i++;
+      j++;
+   }
+   for( ; i<iCountCurrent; i++ )
+      _retainedAddDamage(pDamage, &(pCurrent[i].rect));
+   for( ; j<iCountPrev; j++ )
+      _retainedAddDamage(pDamage, &(pPrev[j].rect));
+}
+
+// Damage between the previous frame and this one
+void RenderEngine::_retainedComputeDamage(type_render_damage* pDamage)
+{
+   pDamage->iCount = 0;
+   pDamage->bFull = false;
+   if ( ! m_bRetainedPrevFrameValid )
+   {
+      pDamage->bFull = true;
+      return;
+   }
+
+   bool bPrevMatched[RENDER_RETAINED_MAX_LAYERS];
+   memset(bPrevMatched, 0, sizeof(bPrevMatched));
+
+   for( int iLayer=0; iLayer<m_iRetainedCountLayers[0]; iLayer++ )
+   {
+      type_render_retained_layer* pLayer = &(m_RetainedLayers[0][iLayer]);
+      type_render_retained_layer* pPrevLayer = NULL;
+      for( int k=0; k<m_iRetainedCountLayers[1]; k++ )
+      {
+         if ( m_RetainedLayers[1][k].uId == pLayer->uId )
+         {
+            pPrevLayer = &(m_RetainedLayers[1][k]);
+            bPrevMatched[k] = true;
+            break;
+         }
+      }
+
+      if ( NULL != pPrevLayer )
+      if ( (pPrevLayer->uHash == pLayer->uHash) && (pPrevLayer->iCountCommands == pLayer->iCountCommands) && (pPrevLayer->uPrevLayerId == pLayer->uPrevLayerId) )
+         continue;
+
+      // Layers order changed: all of it is redrawn
+      if ( (NULL == pPrevLayer) || (pPrevLayer->uPrevLayerId != pLayer->uPrevLayerId) )
+      {
+         for( int k=0; k<pLayer->iCountCommands; k++ )
+            _retainedAddDamage(pDamage, &(m_pRetainedInfos[0][pLayer->iFirstCommand + k].rect));
+         if ( NULL != pPrevLayer )
+         for( int k=0; k<pPrevLayer->iCountCommands; k++ )
+            _retainedAddDamage(pDamage, &(m_pRetainedInfos[1][pPrevLayer->iFirstCommand + k].rect));
+         continue;
+      }
+      _retainedDiffLayers(pDamage, pLayer, pPrevLayer);
+   }
+
+   for( int k=0; k<m_iRetainedCountLayers[1]; k++ )
+   {
+      if ( bPrevMatched[k] )
+         continue;
+      type_render_retained_layer* pPrevLayer = &(m_RetainedLayers[1][k]);
+      for( int i=0; i<pPrevLayer->iCountCommands; i++ )
+         _retainedAddDamage(pDamage, &(m_pRetainedInfos[1][pPrevLayer->iFirstCommand + i].rect));
+   }
+}
+
+// Extends the repaint area to fully contain all the commands it touches, marks them for redraw.
+// Returns the repainted pixels count
+int RenderEngine::_retainedMarkCommandsToRedraw(type_render_damage* pRepaint)
+{
+   for( int i=0; i<m_iRetainedCountCommands; i++ )
+      m_pRetainedCommands[i].uRedraw = 0;
+
+   bool bChanged = true;
+   while ( bChanged && (! pRepaint->bFull) )
+   {
+      bChanged = false;
+      for( int i=0; i<m_iRetainedCountCommands; i++ )
+      {
+         type_render_retained_command* pCmd = &(m_pRetainedCommands[i]);
+         if ( pCmd->uRedraw )
+            continue;
+         for( int k=0; k<pRepaint->iCount; k++ )
+         {
+            if ( ! _rects_overlap(&pCmd->rect, &(pRepaint->rects[k])) )
+               continue;
+            pCmd->uRedraw = 1;
+            if ( ! _rect_contains(&(pRepaint->rects[k]), &pCmd->rect) )
+            {
+               _retainedAddDamage(pRepaint, &pCmd->rect);
+               bChanged = true;
+            }
+            break;
+         }
+      }
+   }
+
+   int iPixels = 0;
+   for( int k=0; k<pRepaint->iCount; k++ )
+      iPixels += _rect_area(&(pRepaint->rects[k]));
+   return iPixels;
+}
+
+// Outlines of the repainted areas. They are added to the next frame damage so they get erased.
+void RenderEngine::_retainedDrawDebugOverlay(const type_render_damage* pChanges)
+{
+   m_RetainedDebugOverlay.iCount = 0;
+   m_RetainedDebugOverlay.bFull = false;
+
+   type_render_retained_state stateCurrent;
+   _retainedCaptureState(&stateCurrent);
+   m_ColorFill[0] = m_ColorFill[1] = m_ColorFill[2] = m_ColorFill[3] = 0;
+   m_ColorStroke[0] = 255; m_ColorStroke[1] = 0; m_ColorStroke[2] = 255; m_ColorStroke[3] = 255;
+   m_fStrokeSizePx = 1.0;
+   m_bRetainedReplaying = true;
+
+   if ( pChanges->bFull )
+   {
+      // Full redraw: red border around the screen (as non overlapping strips, so they are not merged into a full damage)
+      m_ColorStroke[0] = 255; m_ColorStroke[1] = 0; m_ColorStroke[2] = 0;
+      drawRect(m_fPixelWidth, m_fPixelHeight, 1.0 - 3.0*m_fPixelWidth, 1.0 - 3.0*m_fPixelHeight);
+      type_render_rect rects[4] = {
+         { 0, 0, m_iRenderWidth, 4 },
+         { 0, m_iRenderHeight - 4, m_iRenderWidth, m_iRenderHeight },
+         { 0, 4, 4, m_iRenderHeight - 4 },
+         { m_iRenderWidth - 4, 4, m_iRenderWidth, m_iRenderHeight - 4 } };
+      for( int i=0; i<4; i++ )
+         _retainedAddDamage(&m_RetainedDebugOverlay, &rects[i]);
+   }
+   else
+   {
+      for( int i=0; i<pChanges->iCount; i++ )
+      {
+         const type_render_rect* pRect = &(pChanges->rects[i]);
+         if ( (pRect->x2 - pRect->x1 < 3) || (pRect->y2 - pRect->y1 < 3) )
+            continue;
+         drawRect(((float)pRect->x1 + 0.5) * m_fPixelWidth, ((float)pRect->y1 + 0.5) * m_fPixelHeight,
+            ((float)(pRect->x2 - pRect->x1 - 1) + 0.5) * m_fPixelWidth, ((float)(pRect->y2 - pRect->y1 - 1) + 0.5) * m_fPixelHeight);
+         _retainedAddDamage(&m_RetainedDebugOverlay, pRect);
+      }
+   }
+   m_bRetainedReplaying = false;
+   _retainedApplyState(&stateCurrent);
+}
+
+// Saves the commands (grouped by layer) and the layers of this frame, to be compared with the next frame
+bool RenderEngine::_retainedSaveFrameInfo()
+{
+   if ( m_iRetainedMaxInfos[0] < m_iRetainedCountCommands )
+   {
+      type_render_retained_command_info* pInfos = (type_render_retained_command_info*) realloc(m_pRetainedInfos[0], m_iRetainedMaxCommands * sizeof(type_render_retained_command_info));
+      if ( NULL == pInfos )
+         return false;
+      m_pRetainedInfos[0] = pInfos;
+      m_iRetainedMaxInfos[0] = m_iRetainedMaxCommands;
+   }
+
+   int iFirst = 0;
+   for( int i=0; i<m_iRetainedCountLayers[0]; i++ )
+   {
+      m_RetainedLayers[0][i].iFirstCommand = iFirst;
+      iFirst += m_RetainedLayers[0][i].iCountCommands;
+      m_RetainedLayers[0][i].iCountCommands = 0;
+   }
+   for( int i=0; i<m_iRetainedCountCommands; i++ )
+   {
+      type_render_retained_command* pCmd = &(m_pRetainedCommands[i]);
+      type_render_retained_layer* pLayer = &(m_RetainedLayers[0][pCmd->uLayerIndex]);
+      type_render_retained_command_info* pInfo = &(m_pRetainedInfos[0][pLayer->iFirstCommand + pLayer->iCountCommands]);
+      pInfo->uHash = pCmd->uHash;
+      pInfo->rect = pCmd->rect;
+      pLayer->iCountCommands++;
+   }
+   return true;
+}
+
+void RenderEngine::_retainedEndFrame()
+{
+   if ( ! m_bRetainedRecording )
+   {
+      // Frame was drawn directly
+      m_RetainedDamageHistory.iCount = 0;
+      m_RetainedDamageHistory.bFull = true;
+      m_RetainedDebugOverlay.iCount = 0;
+      invalidateRetainedFrames();
+      return;
+   }
+   m_bRetainedRecording = false;
+
+   // Recorded only to be deferred: draw all of it
+   if ( RENDER_RETAINED_MODE_OFF == m_iRetainedMode )
+      invalidateRetainedFrames();
+
+   bool bSavedInfo = _retainedSaveFrameInfo();
+   if ( ! bSavedInfo )
+      invalidateRetainedFrames();
+
+   type_render_damage damage;
+   _retainedComputeDamage(&damage);
+   // The debug overlay shows only this frame changes (not the repainted areas, as the
+   // previous overlay is repainted too and the overlay would keep growing)
+   type_render_damage changes = damage;
+   for( int i=0; i<m_RetainedDebugOverlay.iCount; i++ )
+      _retainedAddDamage(&damage, &(m_RetainedDebugOverlay.rects[i]));
+
+   // The back buffer was drawn <buffer age> frames ago
+   type_render_damage repaint = damage;
+   if ( m_iRetainedBufferAge > 1 )
+   {
+      if ( m_RetainedDamageHistory.bFull )
+         repaint.bFull = true;
+      for( int i=0; i<m_RetainedDamageHistory.iCount; i++ )
+         _retainedAddDamage(&repaint, &(m_RetainedDamageHistory.rects[i]));
+   }
+
+   int iRepaintPixels = 0;
+   if ( ! repaint.bFull )
+      iRepaintPixels = _retainedMarkCommandsToRedraw(&repaint);
+   if ( (m_iRenderWidth > 0) && (m_iRenderHeight > 0) )
+   if ( iRepaintPixels > (m_iRenderWidth/100) * m_iRenderHeight * RETAINED_MAX_REPAINT_PERCENT )
+      repaint.bFull = true;
+
+   if ( repaint.bFull )
+   {
+      _retainedClearAll();
+      _retainedReplay(true);
+      m_fRetainedRepaintPercent = m_fRetainedRepaintPercent * 0.9 + 10.0;
+   }
+   else
+   {
+      for( int i=0; i<repaint.iCount; i++ )
+         _retainedClearRect(&(repaint.rects[i]));
+      _retainedReplay(false);
+      if ( (m_iRenderWidth > 0) && (m_iRenderHeight > 0) )
+         m_fRetainedRepaintPercent = m_fRetainedRepaintPercent * 0.9 + 10.0 * (float)iRepaintPixels / ((float)m_iRenderWidth * (float)m_iRenderHeight);
+   }
+
+   if ( RENDER_RETAINED_MODE_DEBUG == m_iRetainedMode )
+   {
+      if ( repaint.bFull )
+         changes.bFull = true;
+      _retainedDrawDebugOverlay(&changes);
+   }
+   else
+      m_RetainedDebugOverlay.iCount = 0;
+
+   m_RetainedDamageHistory = damage;
+   if ( ! bSavedInfo )
+      return;
+
+   memcpy(&(m_RetainedLayers[1][0]), &(m_RetainedLayers[0][0]), m_iRetainedCountLayers[0] * sizeof(type_render_retained_layer));
+   m_iRetainedCountLayers[1] = m_iRetainedCountLayers[0];
+   type_render_retained_command_info* pTmp = m_pRetainedInfos[0];
+   m_pRetainedInfos[0] = m_pRetainedInfos[1];
+   m_pRetainedInfos[1] = pTmp;
+   int iTmp = m_iRetainedMaxInfos[0];
+   m_iRetainedMaxInfos[0] = m_iRetainedMaxInfos[1];
+   m_iRetainedMaxInfos[1] = iTmp;
+   m_bRetainedPrevFrameValid = true;
+}
+
+bool RenderEngine::canUseDrawCaches()
+{
+   return m_bRetainedRecording && (! m_bRetainedReplaying);
+}
+
+u32 RenderEngine::createDrawCache()
+{
+   for( int i=0; i<RENDER_MAX_DRAW_CACHES; i++ )
+   {
+      if ( m_DrawCaches[i].bUsed )
+         continue;
+      memset(&(m_DrawCaches[i]), 0, sizeof(type_render_draw_cache));
+      m_DrawCaches[i].bUsed = true;
+      return (u32)i+1;
+   }
+   log_softerror_and_alarm("[RenderEngine] No more draw caches available (max %d).", RENDER_MAX_DRAW_CACHES);
+   return 0;
+}
+
+void RenderEngine::freeDrawCache(u32 uCacheId)
+{
+   if ( (uCacheId < 1) || (uCacheId > RENDER_MAX_DRAW_CACHES) )
+      return;
+   lockFrames();
+   type_render_draw_cache* pCache = &(m_DrawCaches[uCacheId-1]);
+   if ( m_iActiveDrawCache == (int)uCacheId-1 )
+      m_iActiveDrawCache = -1;
+   if ( NULL != pCache->pCommands )
+      free(pCache->pCommands);
+   if ( NULL != pCache->pStates )
+      free(pCache->pStates);
+   if ( NULL != pCache->pData )
+      free(pCache->pData);
+   memset(pCache, 0, sizeof(type_render_draw_cache));
+   unlockFrames();
+}
+
+void RenderEngine::invalidateDrawCache(u32 uCacheId)
+{
+   if ( (uCacheId < 1) || (uCacheId > RENDER_MAX_DRAW_CACHES) )
+      return;
+   m_DrawCaches[uCacheId-1].bValid = false;
+}
+
+bool RenderEngine::isDrawCacheValid(u32 uCacheId)
+{
+   if ( (uCacheId < 1) || (uCacheId > RENDER_MAX_DRAW_CACHES) )
+      return false;
+   type_render_draw_cache* pCache = &(m_DrawCaches[uCacheId-1]);
+   if ( (! pCache->bUsed) || (! pCache->bValid) )
+      return false;
+   if ( (pCache->iRenderWidth != m_iRenderWidth) || (pCache->iRenderHeight != m_iRenderHeight) )
+      return false;
+   return true;
+}
+
+void RenderEngine::_invalidateAllDrawCaches()
+{
+   for( int i=0; i<RENDER_MAX_DRAW_CACHES; i++ )
+      m_DrawCaches[i].bValid = false;
+}
+
+// Starts capturing the draw calls of the frame into the cache (replacing its content)
+bool RenderEngine::beginDrawCache(u32 uCacheId)
+{
+   if ( (uCacheId < 1) || (uCacheId > RENDER_MAX_DRAW_CACHES) || (! m_DrawCaches[uCacheId-1].bUsed) )
+      return false;
+   if ( (m_iActiveDrawCache >= 0) || (! canUseDrawCaches()) )
+      return false;
+   type_render_draw_cache* pCache = &(m_DrawCaches[uCacheId-1]);
+   pCache->bValid = true;
+   pCache->iRenderWidth = m_iRenderWidth;
+   pCache->iRenderHeight = m_iRenderHeight;
+   pCache->iCountCommands = 0;
+   pCache->uDataSize = 0;
+   m_iActiveDrawCache = (int)uCacheId-1;
+   return true;
+}
+
+void RenderEngine::endDrawCache()
+{
+   if ( m_iActiveDrawCache < 0 )
+      return;
+   // Part of the draw calls were not recorded (the frame was switched to direct drawing)
+   if ( ! m_bRetainedRecording )
+      m_DrawCaches[m_iActiveDrawCache].bValid = false;
+   m_iActiveDrawCache = -1;
+}
+
+void RenderEngine::_drawCacheAddCommand(const type_render_retained_command* pCmd, const type_render_retained_state* pState, const void* pData)
+{
+   type_render_draw_cache* pCache = &(m_DrawCaches[m_iActiveDrawCache]);
+   if ( ! pCache->bValid )
+      return;
+
+   if ( pCache->iCountCommands >= pCache->iMaxCommands )
+   {
+      int iNewMax = (pCache->iMaxCommands > 0)?(pCache->iMaxCommands*2):64;
+      type_render_retained_command* pCommands = NULL;
+      type_render_retained_state* pStates = NULL;
+      if ( iNewMax <= RETAINED_MAX_COMMANDS )
+         pCommands = (type_render_retained_command*) realloc(pCache->pCommands, iNewMax * sizeof(type_render_retained_command));
+      if ( NULL != pCommands )
+      {
+         pCache->pCommands = pCommands;
+         pStates = (type_render_retained_state*) realloc(pCache->pStates, iNewMax * sizeof(type_render_retained_state));
+      }
+      if ( NULL == pStates )
+      {
+         pCache->bValid = false;
+         return;
+      }
+      pCache->pStates = pStates;
+      pCache->iMaxCommands = iNewMax;
+   }
+
+   u32 uNeededSize = pCache->uDataSize + ((pCmd->uDataSize + 3) & (~0x03));
+   if ( uNeededSize > pCache->uMaxDataSize )
+   {
+      u32 uNewMax = (pCache->uMaxDataSize > 0)?pCache->uMaxDataSize:1024;
+      while ( uNewMax < uNeededSize )
+         uNewMax *= 2;
+      u8* pNewData = NULL;
+      if ( uNewMax <= RETAINED_MAX_DATA_SIZE )
+         pNewData = (u8*) realloc(pCache->pData, uNewMax);
+      if ( NULL == pNewData )
+      {
+         pCache->bValid = false;
+         return;
+      }
+      pCache->pData = pNewData;
+      pCache->uMaxDataSize = uNewMax;
+   }
+
+   type_render_retained_command* pCacheCmd = &(pCache->pCommands[pCache->iCountCommands]);
+   memcpy(pCacheCmd, pCmd, sizeof(type_render_retained_command));
+   memcpy(&(pCache->pStates[pCache->iCountCommands]), pState, sizeof(type_render_retained_state));
+   pCacheCmd->uDataOffset = pCache->uDataSize;
+   if ( (NULL != pData) && (pCmd->uDataSize > 0) )
+   {
+      memcpy(pCache->pData + pCache->uDataSize, pData, pCmd->uDataSize);
+      pCache->uDataSize += (pCmd->uDataSize + 3) & (~0x03);
+   }
+   else
+      pCacheCmd->uDataSize = 0;
+   pCache->iCountCommands++;
+}
+
+// Adds the cached draw calls to the current frame, in the current layer
+bool RenderEngine::drawCache(u32 uCacheId)
+{
+   if ( (! isDrawCacheValid(uCacheId)) || (! canUseDrawCaches()) )
+      return false;
+   if ( m_iActiveDrawCache == (int)uCacheId-1 )
+      return false;
+
+   type_render_draw_cache* pCache = &(m_DrawCaches[uCacheId-1]);
+   for( int i=0; i<pCache->iCountCommands; i++ )
+   {
+      const type_render_retained_command* pCacheCmd = &(pCache->pCommands[i]);
+      const u8* pData = (pCacheCmd->uDataSize > 0)?(pCache->pData + pCacheCmd->uDataOffset):NULL;
+      if ( m_bRetainedRecording && _retainedGrowBuffers((int)pCacheCmd->uDataSize) )
+      {
+         type_render_retained_command* pCmd = &(m_pRetainedCommands[m_iRetainedCountCommands]);
+         memcpy(pCmd, pCacheCmd, sizeof(type_render_retained_command));
+         _retainedAppendCommand(pCmd, &(pCache->pStates[i]), pData, (int)pCacheCmd->uDataSize);
+         continue;
+      }
+
+      // Too many draw calls in the frame: draw the rest directly
+      if ( m_bRetainedRecording )
+      {
+         log_softerror_and_alarm("[RenderEngine] Retained rendering: too many draw calls in frame (%d commands, %u bytes). Draw the rest of the frame directly.",
+            m_iRetainedCountCommands, m_uRetainedDataSize);
+         _retainedFlushToImmediate();
+      }
+      type_render_retained_state stateCurrent;
+      _retainedCaptureState(&stateCurrent);
+      // _retainedExecuteCommand() reads the commands data from the frame data buffer
+      u8* pFrameData = m_pRetainedData;
+      m_pRetainedData = pCache->pData;
+      m_bRetainedReplaying = true;
+      for( ; i<pCache->iCountCommands; i++ )
+      {
+         _retainedApplyState(&(pCache->pStates[i]));
+         _retainedExecuteCommand(&(pCache->pCommands[i]));
+      }
+      m_bRetainedReplaying = false;
+      m_pRetainedData = pFrameData;
+      _retainedApplyState(&stateCurrent);
+      break;
+   }
+   return true;
+}
+
+void RenderEngine::_retainedClearRect(const type_render_rect* pRect)
+{
+}
+
+void RenderEngine::_retainedClearAll()
+{
+}
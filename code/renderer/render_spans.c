@@ -0,0 +1,497 @@
+/*
+    Ruby Licence
+    Copyright (c) 2020-2025 Petru Soroaga petrusoroaga@yahoo.com
+    All rights reserved.
+
+    Redistribution and/or use in source and/or binary forms, with or without
+    modification, are permitted provided that the following conditions are met:
+        * Redistributions and/or use of the source code (partially or complete) must retain
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Redistributions in binary form (partially or complete) must reproduce
+        the above copyright notice, this list of conditions and the following disclaimer
+        in the documentation and/or other materials provided with the distribution.
+        * Copyright info and developer info must be preserved as is in the user
+        interface, additions could be made to that info.
+        * Neither the name of the organization nor the
+        names of its contributors may be used to endorse or promote products
+        derived from this software without specific prior written permission.
+        * Military use is not permitted.
+
+    THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND
+    ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED
+    WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+    DISCLAIMED. IN NO EVENT SHALL THE AUTHOR (PETRU SOROAGA) BE LIABLE FOR ANY
+    DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES
+    (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+    LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND
+    ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT
+    (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS
+    SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+*/
+
+// Row (span) pixel routines for the software renderers: solid fill, color blend,
+// tinted/alpha image blend and coverage mask blend (text), in BGRA byte order.
+// The SIMD code does the same integer math as the portable code, on 4 (SSE2) or 8 (NEON) pixels at a time,
+// and leaves the remaining pixels of each span to the portable code.
+
+#include "render_spans.h"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#define RENDER_SPAN_HAS_SSE2 1
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RENDER_SPAN_HAS_NEON 1
+#endif
+
+#if defined(RENDER_SPAN_HAS_SSE2)
+static int s_iRenderSpanAccel = RENDER_SPAN_ACCEL_SSE2;
+#elif defined(RENDER_SPAN_HAS_NEON)
+static int s_iRenderSpanAccel = RENDER_SPAN_ACCEL_NEON;
+#else
+static int s_iRenderSpanAccel = RENDER_SPAN_ACCEL_NONE;
+#endif
+
+int render_span_set_accel(int iAccel)
+{
+   if ( RENDER_SPAN_ACCEL_AUTO == iAccel )
+   {
+      #if defined(RENDER_SPAN_HAS_SSE2)
+      iAccel = RENDER_SPAN_ACCEL_SSE2;
+      #elif defined(RENDER_SPAN_HAS_NEON)
+      iAccel = RENDER_SPAN_ACCEL_NEON;
+      #else
+      iAccel = RENDER_SPAN_ACCEL_NONE;
+      #endif
+   }
+   s_iRenderSpanAccel = RENDER_SPAN_ACCEL_NONE;
+   #if defined(RENDER_SPAN_HAS_SSE2)
+   if ( RENDER_SPAN_ACCEL_SSE2 == iAccel )
+      s_iRenderSpanAccel = RENDER_SPAN_ACCEL_SSE2;
+   #endif
+   #if defined(RENDER_SPAN_HAS_NEON)
+   if ( RENDER_SPAN_ACCEL_NEON == iAccel )
+      s_iRenderSpanAccel = RENDER_SPAN_ACCEL_NEON;
+   #endif
+   return s_iRenderSpanAccel;
+}
+
+int render_span_get_accel()
+{
+   return s_iRenderSpanAccel;
+}
+
+const char* render_span_get_accel_name(int iAccel)
+{
+   switch ( iAccel )
+   {
+      case RENDER_SPAN_ACCEL_NONE: return "generic";
+      case RENDER_SPAN_ACCEL_SSE2: return "sse2";
+      case RENDER_SPAN_ACCEL_NEON: return "neon";
+      case RENDER_SPAN_ACCEL_AUTO: return "auto";
+      default: return "unknown";
+   }
+}
+
+static inline u32 _span_mul_un8(u32 a, u32 b)
+{
+   u32 t = a * b + 0x80;
+   return (t + (t >> 8)) >> 8;
+}
+
+//-------------------------------------------------------
+// Portable code
+
+static void _span_fill_generic(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   u8 uPixel[4] = { b, g, r, a };
+   u32 uValue;
+   memcpy(&uValue, uPixel, 4);
+   for( int i=0; i<iCount; i++, pDest += 4 )
+      memcpy(pDest, &uValue, 4);
+}
+
+static void _span_blend_color_generic(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   for( int i=0; i<iCount; i++, pDest += 4 )
+   {
+      if ( 0 == pDest[3] )
+      {
+         pDest[0] = b;
+         pDest[1] = g;
+         pDest[2] = r;
+         pDest[3] = a;
+         continue;
+      }
+      pDest[0] = (a * b + (255 - a) * pDest[0]) >> 8;
+      pDest[1] = (a * g + (255 - a) * pDest[1]) >> 8;
+      pDest[2] = (a * r + (255 - a) * pDest[2]) >> 8;
+      pDest[3] = pDest[3] + (((255 - pDest[3]) * a) >> 8);
+   }
+}
+
+static void _span_blend_tinted_generic(u8* pDest, const u8* pSrc, int iCount, const u8* pTint)
+{
+   for( int i=0; i<iCount; i++, pDest += 4, pSrc += 4 )
+   {
+      u32 a = pSrc[3];
+      if ( a <= 4 )
+         continue;
+      pDest[0] = (((pSrc[0]*pTint[2])>>8) * a + pDest[0]*(255-a))>>8;
+      pDest[1] = (((pSrc[1]*pTint[1])>>8) * a + pDest[1]*(255-a))>>8;
+      pDest[2] = (((pSrc[2]*pTint[0])>>8) * a + pDest[2]*(255-a))>>8;
+      pDest[3] = (((a*pTint[3])>>8) * a + pDest[3]*(255-a))>>8;
+   }
+}
+
+static void _span_blend_alpha_generic(u8* pDest, const u8* pSrc, int iCount)
+{
+   for( int i=0; i<iCount; i++, pDest += 4, pSrc += 4 )
+   {
+      u32 a = pSrc[3];
+      pDest[0] = (pSrc[0] * a + pDest[0] * (255-a)) >> 8;
+      pDest[1] = (pSrc[1] * a + pDest[1] * (255-a)) >> 8;
+      pDest[2] = (pSrc[2] * a + pDest[2] * (255-a)) >> 8;
+   }
+}
+
+static void _span_blend_mask_generic(u8* pDest, const u8* pMask, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   for( int i=0; i<iCount; i++, pDest += 4 )
+   {
+      u32 uCoverage = pMask[i];
+      if ( 0 == uCoverage )
+         continue;
+      u32 uSrcAlpha = _span_mul_un8(a, uCoverage);
+      u32 uInv = 255 - uSrcAlpha;
+      u32 uValue = _span_mul_un8(b, uCoverage) + _span_mul_un8(pDest[0], uInv);
+      pDest[0] = (uValue > 255)?255:(u8)uValue;
+      uValue = _span_mul_un8(g, uCoverage) + _span_mul_un8(pDest[1], uInv);
+      pDest[1] = (uValue > 255)?255:(u8)uValue;
+      uValue = _span_mul_un8(r, uCoverage) + _span_mul_un8(pDest[2], uInv);
+      pDest[2] = (uValue > 255)?255:(u8)uValue;
+      uValue = uSrcAlpha + _span_mul_un8(pDest[3], uInv);
+      pDest[3] = (uValue > 255)?255:(u8)uValue;
+   }
+}
+
+//-------------------------------------------------------
+// SSE2: two pixels per 16 bit lanes register, all products fit in 16 bits
+
+#if defined(RENDER_SPAN_HAS_SSE2)
+
+static inline __m128i _sse2_broadcast_alpha(__m128i x)
+{
+   return _mm_shufflehi_epi16(_mm_shufflelo_epi16(x, 0xFF), 0xFF);
+}
+
+static inline __m128i _sse2_mul_un8(__m128i x, __m128i y)
+{
+   __m128i t = _mm_add_epi16(_mm_mullo_epi16(x, y), _mm_set1_epi16(0x80));
+   return _mm_srli_epi16(_mm_add_epi16(t, _mm_srli_epi16(t, 8)), 8);
+}
+
+static int _span_fill_sse2(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   __m128i vPixel = _mm_set1_epi32((int)(b | (g<<8) | (r<<16) | ((u32)a<<24)));
+   int i = 0;
+   for( ; i+4 <= iCount; i += 4, pDest += 16 )
+      _mm_storeu_si128((__m128i*)pDest, vPixel);
+   return i;
+}
+
+static int _span_blend_color_sse2(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   // The alpha lane uses d + (((255-d)*a)>>8) == (255*a + (256-a)*d)>>8
+   const __m128i vZero = _mm_setzero_si128();
+   const __m128i vAlphaMask = _mm_set1_epi32((int)0xFF000000);
+   const __m128i vColor = _mm_set1_epi32((int)(b | (g<<8) | (r<<16) | ((u32)a<<24)));
+   const __m128i vSrc = _mm_setr_epi16((short)(b*a), (short)(g*a), (short)(r*a), (short)(255*a), (short)(b*a), (short)(g*a), (short)(r*a), (short)(255*a));
+   const __m128i vInv = _mm_setr_epi16(255-a, 255-a, 255-a, 256-a, 255-a, 255-a, 255-a, 256-a);
+   int i = 0;
+   for( ; i+4 <= iCount; i += 4, pDest += 16 )
+   {
+      __m128i vDest = _mm_loadu_si128((const __m128i*)pDest);
+      __m128i vLo = _mm_unpacklo_epi8(vDest, vZero);
+      __m128i vHi = _mm_unpackhi_epi8(vDest, vZero);
+      vLo = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(vLo, vInv), vSrc), 8);
+      vHi = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(vHi, vInv), vSrc), 8);
+      __m128i vResult = _mm_packus_epi16(vLo, vHi);
+      __m128i vTransparent = _mm_cmpeq_epi32(_mm_and_si128(vDest, vAlphaMask), vZero);
+      vResult = _mm_or_si128(_mm_and_si128(vTransparent, vColor), _mm_andnot_si128(vTransparent, vResult));
+      _mm_storeu_si128((__m128i*)pDest, vResult);
+   }
+   return i;
+}
+
+static int _span_blend_tinted_sse2(u8* pDest, const u8* pSrc, int iCount, const u8* pTint)
+{
+   const __m128i vZero = _mm_setzero_si128();
+   const __m128i v255 = _mm_set1_epi16(255);
+   const __m128i vMinAlpha = _mm_set1_epi32(4);
+   const __m128i vTint = _mm_setr_epi16(pTint[2], pTint[1], pTint[0], pTint[3], pTint[2], pTint[1], pTint[0], pTint[3]);
+   int i = 0;
+   for( ; i+4 <= iCount; i += 4, pDest += 16, pSrc += 16 )
+   {
+      __m128i vSrc = _mm_loadu_si128((const __m128i*)pSrc);
+      __m128i vDest = _mm_loadu_si128((const __m128i*)pDest);
+      __m128i vHalf[2];
+      for( int k=0; k<2; k++ )
+      {
+         __m128i vS = k?_mm_unpackhi_epi8(vSrc, vZero):_mm_unpacklo_epi8(vSrc, vZero);
+         __m128i vD = k?_mm_unpackhi_epi8(vDest, vZero):_mm_unpacklo_epi8(vDest, vZero);
+         __m128i vA = _sse2_broadcast_alpha(vS);
+         __m128i vT = _mm_srli_epi16(_mm_mullo_epi16(vS, vTint), 8);
+         vHalf[k] = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(vT, vA), _mm_mullo_epi16(vD, _mm_sub_epi16(v255, vA))), 8);
+      }
+      __m128i vResult = _mm_packus_epi16(vHalf[0], vHalf[1]);
+      __m128i vKeep = _mm_cmpgt_epi32(_mm_srli_epi32(vSrc, 24), vMinAlpha);
+      vResult = _mm_or_si128(_mm_and_si128(vKeep, vResult), _mm_andnot_si128(vKeep, vDest));
+      _mm_storeu_si128((__m128i*)pDest, vResult);
+   }
+   return i;
+}
+
+static int _span_blend_alpha_sse2(u8* pDest, const u8* pSrc, int iCount)
+{
+   const __m128i vZero = _mm_setzero_si128();
+   const __m128i v255 = _mm_set1_epi16(255);
+   const __m128i vAlphaMask = _mm_set1_epi32((int)0xFF000000);
+   int i = 0;
+   for( ; i+4 <= iCount; i += 4, pDest += 16, pSrc += 16 )
+   {
+      __m128i vSrc = _mm_loadu_si128((const __m128i*)pSrc);
+      __m128i vDest = _mm_loadu_si128((const __m128i*)pDest);
+      __m128i vHalf[2];
+      for( int k=0; k<2; k++ )
+      {
+         __m128i vS = k?_mm_unpackhi_epi8(vSrc, vZero):_mm_unpacklo_epi8(vSrc, vZero);
+         __m128i vD = k?_mm_unpackhi_epi8(vDest, vZero):_mm_unpacklo_epi8(vDest, vZero);
+         __m128i vA = _sse2_broadcast_alpha(vS);
+         vHalf[k] = _mm_srli_epi16(_mm_add_epi16(_mm_mullo_epi16(vS, vA), _mm_mullo_epi16(vD, _mm_sub_epi16(v255, vA))), 8);
+      }
+      __m128i vResult = _mm_packus_epi16(vHalf[0], vHalf[1]);
+      vResult = _mm_or_si128(_mm_andnot_si128(vAlphaMask, vResult), _mm_and_si128(vAlphaMask, vDest));
+      _mm_storeu_si128((__m128i*)pDest, vResult);
+   }
+   return i;
+}
+
+static int _span_blend_mask_sse2(u8* pDest, const u8* pMask, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   // Zero coverage leaves the pixel unchanged (mul_un8(d, 255) == d), so no per pixel test is needed
+   const __m128i vZero = _mm_setzero_si128();
+   const __m128i v255 = _mm_set1_epi16(255);
+   const __m128i vColor = _mm_setr_epi16(b, g, r, a, b, g, r, a);
+   int i = 0;
+   for( ; i+4 <= iCount; i += 4, pDest += 16 )
+   {
+      u32 uMask4;
+      memcpy(&uMask4, pMask + i, 4);
+      if ( 0 == uMask4 )
+         continue;
+      __m128i vMask = _mm_cvtsi32_si128((int)uMask4);
+      vMask = _mm_unpacklo_epi8(vMask, vMask);
+      vMask = _mm_unpacklo_epi16(vMask, vMask);
+      __m128i vDest = _mm_loadu_si128((const __m128i*)pDest);
+      __m128i vSrcPart[2], vDestPart[2];
+      for( int k=0; k<2; k++ )
+      {
+         __m128i vM = k?_mm_unpackhi_epi8(vMask, vZero):_mm_unpacklo_epi8(vMask, vZero);
+         __m128i vD = k?_mm_unpackhi_epi8(vDest, vZero):_mm_unpacklo_epi8(vDest, vZero);
+         vSrcPart[k] = _sse2_mul_un8(vColor, vM);
+         vDestPart[k] = _sse2_mul_un8(vD, _mm_sub_epi16(v255, _sse2_broadcast_alpha(vSrcPart[k])));
+      }
+      __m128i vResult = _mm_adds_epu8(_mm_packus_epi16(vSrcPart[0], vSrcPart[1]), _mm_packus_epi16(vDestPart[0], vDestPart[1]));
+      _mm_storeu_si128((__m128i*)pDest, vResult);
+   }
+   return i;
+}
+
+#endif
+
+//-------------------------------------------------------
+// NEON: 8 pixels at a time, deinterleaved in B, G, R, A planes
+
+#if defined(RENDER_SPAN_HAS_NEON)
+
+static inline uint8x8_t _neon_mul_un8(uint8x8_t x, uint8x8_t y)
+{
+   uint16x8_t t = vaddq_u16(vmull_u8(x, y), vdupq_n_u16(0x80));
+   return vshrn_n_u16(vaddq_u16(t, vshrq_n_u16(t, 8)), 8);
+}
+
+static int _span_fill_neon(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   uint8x16_t vPixel = vreinterpretq_u8_u32(vdupq_n_u32(b | (g<<8) | (r<<16) | ((u32)a<<24)));
+   int i = 0;
+   for( ; i+4 <= iCount; i += 4, pDest += 16 )
+      vst1q_u8(pDest, vPixel);
+   return i;
+}
+
+static int _span_blend_color_neon(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   const uint8x8_t vZero = vdup_n_u8(0);
+   const uint8x8_t v255 = vdup_n_u8(255);
+   const uint8x8_t vA = vdup_n_u8(a);
+   const uint8x8_t vInv = vdup_n_u8(255-a);
+   const uint8x8_t vColor[4] = { vdup_n_u8(b), vdup_n_u8(g), vdup_n_u8(r), vdup_n_u8(a) };
+   const uint16x8_t vSrc[3] = { vdupq_n_u16(b*a), vdupq_n_u16(g*a), vdupq_n_u16(r*a) };
+   int i = 0;
+   for( ; i+8 <= iCount; i += 8, pDest += 32 )
+   {
+      uint8x8x4_t vDest = vld4_u8(pDest);
+      uint8x8_t vTransparent = vceq_u8(vDest.val[3], vZero);
+      for( int k=0; k<3; k++ )
+         vDest.val[k] = vbsl_u8(vTransparent, vColor[k], vshrn_n_u16(vmlal_u8(vSrc[k], vDest.val[k], vInv), 8));
+      uint8x8_t vAlpha = vadd_u8(vDest.val[3], vshrn_n_u16(vmull_u8(vsub_u8(v255, vDest.val[3]), vA), 8));
+      vDest.val[3] = vbsl_u8(vTransparent, vColor[3], vAlpha);
+      vst4_u8(pDest, vDest);
+   }
+   return i;
+}
+
+static int _span_blend_tinted_neon(u8* pDest, const u8* pSrc, int iCount, const u8* pTint)
+{
+   const uint8x8_t v255 = vdup_n_u8(255);
+   const uint8x8_t vMinAlpha = vdup_n_u8(4);
+   const uint8x8_t vTint[4] = { vdup_n_u8(pTint[2]), vdup_n_u8(pTint[1]), vdup_n_u8(pTint[0]), vdup_n_u8(pTint[3]) };
+   int i = 0;
+   for( ; i+8 <= iCount; i += 8, pDest += 32, pSrc += 32 )
+   {
+      uint8x8x4_t vSrc = vld4_u8(pSrc);
+      uint8x8x4_t vDest = vld4_u8(pDest);
+      uint8x8_t vA = vSrc.val[3];
+      uint8x8_t vInv = vsub_u8(v255, vA);
+      uint8x8_t vKeep = vcgt_u8(vA, vMinAlpha);
+      for( int k=0; k<4; k++ )
+      {
+         uint8x8_t vT = vshrn_n_u16(vmull_u8(vSrc.val[k], vTint[k]), 8);
+         uint8x8_t vValue = vshrn_n_u16(vmlal_u8(vmull_u8(vT, vA), vDest.val[k], vInv), 8);
+         vDest.val[k] = vbsl_u8(vKeep, vValue, vDest.val[k]);
+      }
+      vst4_u8(pDest, vDest);
+   }
+   return i;
+}
+
+static int _span_blend_alpha_neon(u8* pDest, const u8* pSrc, int iCount)
+{
+   const uint8x8_t v255 = vdup_n_u8(255);
+   int i = 0;
+   for( ; i+8 <= iCount; i += 8, pDest += 32, pSrc += 32 )
+   {
+      uint8x8x4_t vSrc = vld4_u8(pSrc);
+      uint8x8x4_t vDest = vld4_u8(pDest);
+      uint8x8_t vA = vSrc.val[3];
+      uint8x8_t vInv = vsub_u8(v255, vA);
+      for( int k=0; k<3; k++ )
+         vDest.val[k] = vshrn_n_u16(vmlal_u8(vmull_u8(vSrc.val[k], vA), vDest.val[k], vInv), 8);
+      vst4_u8(pDest, vDest);
+   }
+   return i;
+}
+
+static int _span_blend_mask_neon(u8* pDest, const u8* pMask, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   const uint8x8_t v255 = vdup_n_u8(255);
+   const uint8x8_t vColor[4] = { vdup_n_u8(b), vdup_n_u8(g), vdup_n_u8(r), vdup_n_u8(a) };
+   int i = 0;
+   for( ; i+8 <= iCount; i += 8, pDest += 32 )
+   {
+      uint8x8_t vMask = vld1_u8(pMask + i);
+      if ( 0 == vget_lane_u64(vreinterpret_u64_u8(vMask), 0) )
+         continue;
+      uint8x8x4_t vDest = vld4_u8(pDest);
+      uint8x8_t vSrcAlpha = _neon_mul_un8(vColor[3], vMask);
+      uint8x8_t vInv = vsub_u8(v255, vSrcAlpha);
+      for( int k=0; k<3; k++ )
+         vDest.val[k] = vqadd_u8(_neon_mul_un8(vColor[k], vMask), _neon_mul_un8(vDest.val[k], vInv));
+      vDest.val[3] = vqadd_u8(vSrcAlpha, _neon_mul_un8(vDest.val[3], vInv));
+      vst4_u8(pDest, vDest);
+   }
+   return i;
+}
+
+#endif
+
+//-------------------------------------------------------
+
+void render_span_fill(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   int iDone = 0;
+   #if defined(RENDER_SPAN_HAS_SSE2)
+   if ( RENDER_SPAN_ACCEL_SSE2 == s_iRenderSpanAccel )
+      iDone = _span_fill_sse2(pDest, iCount, r, g, b, a);
+   #endif
+   #if defined(RENDER_SPAN_HAS_NEON)
+   if ( RENDER_SPAN_ACCEL_NEON == s_iRenderSpanAccel )
+      iDone = _span_fill_neon(pDest, iCount, r, g, b, a);
+   #endif
+   if ( iDone < iCount )
+      _span_fill_generic(pDest + iDone*4, iCount - iDone, r, g, b, a);
+}
+
+void render_span_blend_color(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   int iDone = 0;
+   #if defined(RENDER_SPAN_HAS_SSE2)
+   if ( RENDER_SPAN_ACCEL_SSE2 == s_iRenderSpanAccel )
+      iDone = _span_blend_color_sse2(pDest, iCount, r, g, b, a);
+   #endif
+   #if defined(RENDER_SPAN_HAS_NEON)
+   if ( RENDER_SPAN_ACCEL_NEON == s_iRenderSpanAccel )
+      iDone = _span_blend_color_neon(pDest, iCount, r, g, b, a);
+   #endif
+   if ( iDone < iCount )
+      _span_blend_color_generic(pDest + iDone*4, iCount - iDone, r, g, b, a);
+}
+
+void render_span_blend_tinted(u8* pDest, const u8* pSrc, int iCount, const u8* pTint)
+{
+   int iDone = 0;
+   #if defined(RENDER_SPAN_HAS_SSE2)
+   if ( RENDER_SPAN_ACCEL_SSE2 == s_iRenderSpanAccel )
+      iDone = _span_blend_tinted_sse2(pDest, pSrc, iCount, pTint);
+   #endif
+   #if defined(RENDER_SPAN_HAS_NEON)
+   if ( RENDER_SPAN_ACCEL_NEON == s_iRenderSpanAccel )
+      iDone = _span_blend_tinted_neon(pDest, pSrc, iCount, pTint);
+   #endif
+   if ( iDone < iCount )
+      _span_blend_tinted_generic(pDest + iDone*4, pSrc + iDone*4, iCount - iDone, pTint);
+}
+
+void render_span_blend_alpha(u8* pDest, const u8* pSrc, int iCount)
+{
+   int iDone = 0;
+   #if defined(RENDER_SPAN_HAS_SSE2)
+   if ( RENDER_SPAN_ACCEL_SSE2 == s_iRenderSpanAccel )
+      iDone = _span_blend_alpha_sse2(pDest, pSrc, iCount);
+   #endif
+   #if defined(RENDER_SPAN_HAS_NEON)
+   if ( RENDER_SPAN_ACCEL_NEON == s_iRenderSpanAccel )
+      iDone = _span_blend_alpha_neon(pDest, pSrc, iCount);
+   #endif
+   if ( iDone < iCount )
+      _span_blend_alpha_generic(pDest + iDone*4, pSrc + iDone*4, iCount - iDone);
+}
+
+void render_span_blend_mask(u8* pDest, const u8* pMask, int iCount, u8 r, u8 g, u8 b, u8 a)
+{
+   int iDone = 0;
+   #if defined(RENDER_SPAN_HAS_SSE2)
+   if ( RENDER_SPAN_ACCEL_SSE2 == s_iRenderSpanAccel )
+      iDone = _span_blend_mask_sse2(pDest, pMask, iCount, r, g, b, a);
+   #endif
+   #if defined(RENDER_SPAN_HAS_NEON)
+   if ( RENDER_SPAN_ACCEL_NEON == s_iRenderSpanAccel )
+      iDone = _span_blend_mask_neon(pDest, pMask, iCount, r, g, b, a);
+   #endif
+   if ( iDone < iCount )
+      _span_blend_mask_generic(pDest + iDone*4, pMask + iDone, iCount - iDone, r, g, b, a);
+}
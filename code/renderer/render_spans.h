@@ -0,0 +1,46 @@
+#pragma once
+#include "../base/base.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// Row (span) pixel routines used by the software renderers.
+// Pixels are 32 bits, byte order in memory is BGRA (cairo ARGB32 / DRM ARGB8888 on little endian).
+// Every implementation (portable, SSE2, NEON) gives the same output, byte for byte.
+
+#define RENDER_SPAN_ACCEL_NONE 0
+#define RENDER_SPAN_ACCEL_SSE2 1
+#define RENDER_SPAN_ACCEL_NEON 2
+#define RENDER_SPAN_ACCEL_AUTO 0xFF
+
+// SIMD code is selected at build time (SSE2 on x86, NEON on aarch64 or when built with NEON on 32 bit ARM).
+// render_span_set_accel() can force the portable code (for tests/benchmarks);
+// returns the implementation that was actually selected.
+int render_span_set_accel(int iAccel);
+int render_span_get_accel();
+const char* render_span_get_accel_name(int iAccel);
+
+// Writes the color as is (no blending)
+void render_span_fill(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a);
+
+// Blends the color over the destination:
+// transparent destination pixels get the color, the others get c = (a*c + (255-a)*d)>>8
+// and their alpha increases by ((255-d)*a)>>8
+void render_span_blend_color(u8* pDest, int iCount, u8 r, u8 g, u8 b, u8 a);
+
+// Blends BGRA source pixels, tinted by pTint (r,g,b,a), over the destination (sprites):
+// d = (((s*tint)>>8)*sa + d*(255-sa))>>8, on all four channels; source pixels with alpha <= 4 are skipped
+void render_span_blend_tinted(u8* pDest, const u8* pSrc, int iCount, const u8* pTint);
+
+// Blends BGRA source pixels over the destination (icons):
+// d = (s*sa + d*(255-sa))>>8 on the color channels, the destination alpha is not changed
+void render_span_blend_alpha(u8* pDest, const u8* pSrc, int iCount);
+
+// Composites a premultiplied color (r,g,b already multiplied by a) OVER the destination,
+// through an 8 bit coverage mask, one mask byte per pixel (glyphs, text runs)
+void render_span_blend_mask(u8* pDest, const u8* pMask, int iCount, u8 r, u8 g, u8 b, u8 a);
+
+#ifdef __cplusplus
+}
+#endif
@@ -24,3 +24,8 @@ float getDefaultHeight();
 void onNewVehicle(u32 uVehicleId);
 int requestTelemetryStreams();
 void onTelemetryStreamData(u8* pData, int nDataLength, int nTelemetryType);
+
+// Return a value > 0 to have the plugin drawing cached: render() is called again only when the telemetry
+// or the settings given to it change, or after this many milliseconds; in between, the last drawing is shown.
+// Return 0 (or don't export it) to have render() called on every frame.
+int getRenderCacheInterval();